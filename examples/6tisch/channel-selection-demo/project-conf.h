@@ -86,6 +86,12 @@ extern bool tsch_cs_process(void);
 #define TSCH_CALLBACK_CHANNEL_STATS_UPDATED tsch_cs_channel_stats_updated
 #define TSCH_CALLBACK_SELECT_CHANNELS tsch_cs_process
 
+/* Hop over the selected channels in a longer sequence that repeats them in
+ * proportion to their quality. The sequence defaults to twice the length of
+ * the default hopping sequence; all nodes must be able to store it. */
+#define TSCH_CS_CONF_WEIGHTED_HOPPING 1
+#define TSCH_CONF_HOPPING_SEQUENCE_MAX_LEN 8
+
 /* The coordinator will update the network nodes with new hopping sequences */
 #define TSCH_PACKET_CONF_EB_WITH_HOPPING_SEQUENCE 1
 
@@ -58,6 +58,15 @@
  * Larger values result in less frequent active slots: reduces capacity and saves energy. */
 #define TSCH_SCHEDULE_CONF_DEFAULT_LENGTH 3
 
+#if WITH_ORCHESTRA_ADAPTIVE
+
+/* Negotiate extra unicast cells with 6P as queues build up */
+#define TSCH_CONF_WITH_SIXTOP 1
+#define TSCH_CONF_DEDICATED_LINKS_ANY_PACKET 1
+#define ORCHESTRA_CONF_RULES { &eb_per_time_source, &unicast_traffic_adaptive, &unicast_per_neighbor_rpl_ns, &default_common }
+
+#endif /* WITH_ORCHESTRA_ADAPTIVE */
+
 #if WITH_SECURITY
 
 /* Enable security */
@@ -43,11 +43,14 @@
 #include "net/ipv6/uip-sr.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/routing/routing.h"
+#include "coap-engine.h"
 
 #define DEBUG DEBUG_PRINT
 #include "net/ipv6/uip-debug.h"
 
 /*---------------------------------------------------------------------------*/
+extern coap_resource_t res_tsch_timing;
+
 PROCESS(node_process, "RPL Node");
 AUTOSTART_PROCESSES(&node_process);
 
@@ -69,6 +72,9 @@ PROCESS_THREAD(node_process, ev, data)
   }
   NETSTACK_MAC.on();
 
+  /* Export the slot timing profile, at coap://[node]/tsch/timing */
+  coap_activate_resource(&res_tsch_timing, "tsch/timing");
+
 #if WITH_PERIODIC_ROUTES_PRINT
   {
     static struct etimer et;
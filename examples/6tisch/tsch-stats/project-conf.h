@@ -76,6 +76,11 @@
 /* Reduce the TSCH stat "decay to normal" period to get printouts more often */
 #define TSCH_STATS_CONF_DECAY_INTERVAL (60 * CLOCK_SECOND)
 
+#define TSCH_STATS_CONF_SLOT_TIMING 1
+
+/* Small CoAP blocks, to fit UIP_CONF_BUFFER_SIZE */
+#define COAP_MAX_CHUNK_SIZE 32
+
 /*******************************************************/
 /************* Other system configuration **************/
 /*******************************************************/
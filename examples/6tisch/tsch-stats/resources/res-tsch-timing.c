@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/**
+ * \file
+ *         CoAP resource exporting the TSCH slot timing profile as JSON.
+ *         Served block-wise, as it does not fit a single CoAP chunk.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "coap-engine.h"
+#include "net/mac/tsch/tsch.h"
+
+static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_delete_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+RESOURCE(res_tsch_timing,
+         "title=\"TSCH slot timing\";rt=\"Data\";ct=50",
+         res_get_handler,
+         NULL,
+         NULL,
+         res_delete_handler);
+
+/* Longest rendering of the profile, with every number at its widest:
+ * 10 digits for a 32-bit counter, 11 for the signed worst slack, 5 for
+ * a histogram bin, and up to 3 digits per byte of an rtimer timestamp.
+ * "offset" is the longest phase name. */
+#define JSON_HEAD_MAX_LEN (sizeof("{\"ticks_per_s\":,\"skipped\":{\"locked\":,\"no_link\":,\"missed\":},\"phases\":{") - 1 \
+                           + 4 * 10)
+#define JSON_PHASE_MAX_LEN (sizeof(",\"offset\":{\"worst\":,\"last\":,\"hist\":[]}") - 1 \
+                            + 11 + 3 * sizeof(rtimer_clock_t) \
+                            + TSCH_STATS_SLOT_TIMING_BINS * (5 + 1))
+#define JSON_MAX_LEN (JSON_HEAD_MAX_LEN + TSCH_SLOT_PHASE_COUNT * JSON_PHASE_MAX_LEN \
+                      + sizeof("}}"))
+
+/* The profile is rendered when the first block is requested, and
+ * later blocks are served from that snapshot */
+static char json[JSON_MAX_LEN];
+static int json_len;
+
+/*---------------------------------------------------------------------------*/
+static int
+render(void)
+{
+  int len;
+  int phase;
+  int bin;
+
+  len = snprintf(json, sizeof(json),
+                 "{\"ticks_per_s\":%lu,\"skipped\":{\"locked\":%lu,\"no_link\":%lu,\"missed\":%lu},\"phases\":{",
+                 (unsigned long)RTIMER_SECOND,
+                 (unsigned long)tsch_slot_timing_stats.skipped_locked,
+                 (unsigned long)tsch_slot_timing_stats.skipped_no_link,
+                 (unsigned long)tsch_slot_timing_stats.skipped_missed);
+  for(phase = 0; phase < TSCH_SLOT_PHASE_COUNT && len < sizeof(json); phase++) {
+    len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":{\"worst\":%ld,\"last\":%lu,\"hist\":[",
+                    phase > 0 ? "," : "",
+                    tsch_stats_slot_phase_name(phase),
+                    (long)tsch_slot_timing_stats.worst[phase],
+                    (unsigned long)tsch_slot_timing_stats.last[phase]);
+    for(bin = 0; bin < TSCH_STATS_SLOT_TIMING_BINS && len < sizeof(json); bin++) {
+      len += snprintf(json + len, sizeof(json) - len, "%s%u", bin > 0 ? "," : "",
+                      tsch_slot_timing_stats.histogram[phase][bin]);
+    }
+    if(len < sizeof(json)) {
+      len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+  }
+  if(len < sizeof(json)) {
+    len += snprintf(json + len, sizeof(json) - len, "}}");
+  }
+
+  return MIN(len, sizeof(json) - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  int32_t len;
+
+  if(*offset == 0) {
+    json_len = render();
+  }
+
+  if(*offset >= json_len) {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    /* A block error message should not exceed the minimum block size (16). */
+    const char *error_msg = "BlockOutOfScope";
+    coap_set_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  len = MIN(json_len - *offset, preferred_size);
+  memcpy(buffer, json + *offset, len);
+
+  coap_set_header_content_format(response, APPLICATION_JSON);
+  coap_set_payload(response, buffer, len);
+
+  *offset += len;
+  if(*offset >= json_len) {
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_delete_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  tsch_stats_slot_timing_reset();
+  coap_set_status_code(response, DELETED_2_02);
+}
+/*---------------------------------------------------------------------------*/
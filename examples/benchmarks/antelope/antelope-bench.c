@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         A native benchmark that measures how many rows per second
+ *         Antelope processes in AQL selections with different kinds of
+ *         predicates, and checks the number of selected rows.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+#include "index.h"
+#include "relation.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#define ROWS                  1000
+#define REPETITIONS           200
+#define READINGS              60
+#define JOIN_REPETITIONS      20
+#define EVENTS                500
+/* Coprime with EVENTS, so that the event IDs are a permutation. */
+#define EVENT_STRIDE          419
+
+/* Whether the sample IDs are indexed with a B+-tree. */
+#ifndef WITH_BTREE
+#define WITH_BTREE            0
+#endif
+/*---------------------------------------------------------------------------*/
+struct query {
+  const char *name;
+  const char *text;
+  int (*match)(long id, long temp, long hum);
+  /* Whether the B+-tree finds the selected rows. */
+  int indexed;
+};
+/*---------------------------------------------------------------------------*/
+struct join {
+  const char *name;
+  const char *text;
+  /* The cardinality of the left relation. */
+  long left_rows;
+};
+/*---------------------------------------------------------------------------*/
+/*
+ * The number of outer tuples that a join iterates over, which shows the
+ * strategy that it uses. An index on the sample IDs is used from the
+ * readings, even if the samples are the left relation. Otherwise, a
+ * hash table is built over the readings and probed with the samples,
+ * unless hash joins are disabled and the join falls back to a nested
+ * loop over the left relation.
+ */
+#if WITH_BTREE
+#define JOIN_OUTER_ROWS(join) READINGS
+#elif DB_JOIN_HASH_LIMIT > 0
+#define JOIN_OUTER_ROWS(join) ROWS
+#else
+#define JOIN_OUTER_ROWS(join) ((join)->left_rows)
+#endif
+/*---------------------------------------------------------------------------*/
+static int failed;
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_bench_process, "Antelope benchmark");
+AUTOSTART_PROCESSES(&antelope_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static long
+sample_temp(long id)
+{
+  return (id * 7919) % 1000;
+}
+/*---------------------------------------------------------------------------*/
+static long
+sample_hum(long id)
+{
+  return (id * 104729) % 997;
+}
+/*---------------------------------------------------------------------------*/
+static int
+match_range(long id, long temp, long hum)
+{
+  return temp >= 200 && temp < 400;
+}
+/*---------------------------------------------------------------------------*/
+static int
+match_point(long id, long temp, long hum)
+{
+  return id == 577;
+}
+/*---------------------------------------------------------------------------*/
+static int
+match_window(long id, long temp, long hum)
+{
+  return id >= 400 && id < 450;
+}
+/*---------------------------------------------------------------------------*/
+static int
+match_arithmetic(long id, long temp, long hum)
+{
+  return temp + hum > 1000;
+}
+/*---------------------------------------------------------------------------*/
+static int
+match_disjunction(long id, long temp, long hum)
+{
+  return id < 100 || hum > 950;
+}
+/*---------------------------------------------------------------------------*/
+/* Some readings refer to the same sample, and some to no sample. */
+static long
+reading_id(long row)
+{
+  return row * 29 % 40 * 31;
+}
+/*---------------------------------------------------------------------------*/
+static const struct query queries[] = {
+  { "range",
+    "SELECT id, temp FROM samples WHERE temp >= 200 AND temp < 400;",
+    match_range, 0 },
+  { "point",
+    "SELECT id FROM samples WHERE id = 577;",
+    match_point, 1 },
+  { "window",
+    "SELECT id, temp FROM samples WHERE id >= 400 AND id < 450;",
+    match_window, 1 },
+  { "arithmetic",
+    "SELECT id, temp, hum FROM samples WHERE temp + hum > 1000;",
+    match_arithmetic, 0 },
+  { "disjunction",
+    "SELECT id, hum FROM samples WHERE id < 100 OR hum > 950;",
+    match_disjunction, 0 },
+};
+/*---------------------------------------------------------------------------*/
+static const struct join joins[] = {
+  { "join",
+    "JOIN samples, readings ON id PROJECT temp, value;", ROWS },
+  { "join swapped",
+    "JOIN readings, samples ON id PROJECT value, temp;", READINGS },
+};
+/*---------------------------------------------------------------------------*/
+static int
+execute(const char *text, long *matching, long *processed)
+{
+  db_handle_t handle;
+  db_result_t result;
+
+  *matching = *processed = 0;
+
+  result = db_query(&handle, text);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", text, db_get_result_message(result));
+    db_free(&handle);
+    return 0;
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      (*matching)++;
+      (*processed)++;
+    } else if(result == DB_OK) {
+      (*processed)++;
+    } else {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        printf("Processing \"%s\" failed: %s\n", text,
+               db_get_result_message(result));
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create_relation(void)
+{
+  long matching;
+  long processed;
+  long id;
+
+  if(!execute("CREATE RELATION samples;", &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE id DOMAIN INT IN samples;",
+              &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE temp DOMAIN INT IN samples;",
+              &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE hum DOMAIN INT IN samples;",
+              &matching, &processed)) {
+    return 0;
+  }
+
+  for(id = 0; id < ROWS; id++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %ld, %ld) INTO samples;",
+                         id, sample_temp(id), sample_hum(id)))) {
+      printf("Failed to insert row %ld\n", id);
+      return 0;
+    }
+  }
+
+  if(!execute("CREATE RELATION readings;", &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE id DOMAIN INT IN readings;",
+              &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE value DOMAIN INT IN readings;",
+              &matching, &processed)) {
+    return 0;
+  }
+
+  for(id = 0; id < READINGS; id++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %ld) INTO readings;",
+                         reading_id(id), id))) {
+      printf("Failed to insert reading %ld\n", id);
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if WITH_BTREE
+/* Return 1 when the index has been loaded, 0 while it is being loaded,
+   and -1 if the loading failed. */
+static int
+index_state(void)
+{
+  relation_t *rel;
+  attribute_t *attr;
+  index_t *index;
+  int state;
+
+  rel = relation_load("samples");
+  if(rel == NULL) {
+    return -1;
+  }
+  attr = relation_attribute_get(rel, "id");
+  index = attr != NULL ? attr->index : NULL;
+  if(index == NULL || (index->flags & INDEX_LOAD_ERROR)) {
+    state = -1;
+  } else {
+    state = index_exists(attr);
+  }
+  relation_release(rel);
+  return state;
+}
+/*---------------------------------------------------------------------------*/
+static long
+event_id(tuple_id_t row)
+{
+  return (long)row * EVENT_STRIDE % EVENTS;
+}
+/*---------------------------------------------------------------------------*/
+/* Check that the index returns all event IDs in order, except for
+   those from removed_min up to removed_max. */
+static int
+check_events(index_t *index, long removed_min, long removed_max)
+{
+  index_iterator_t iterator;
+  attribute_value_t min;
+  attribute_value_t max;
+  tuple_id_t row;
+  long expected;
+
+  min.domain = max.domain = DOMAIN_INT;
+  VALUE_INT(&min) = 0;
+  VALUE_INT(&max) = EVENTS - 1;
+  if(DB_ERROR(index_get_iterator(&iterator, index, &min, &max))) {
+    return 0;
+  }
+
+  for(expected = 0;
+      (row = index_get_next(&iterator)) != INVALID_TUPLE; expected++) {
+    if(expected == removed_min) {
+      expected = removed_max;
+    }
+    if(event_id(row) != expected) {
+      printf("Row %lu has ID %ld, expected %ld\n", (unsigned long)row,
+             event_id(row), expected);
+      return 0;
+    }
+  }
+  return expected == EVENTS;
+}
+/*---------------------------------------------------------------------------*/
+/* Insert IDs in a scattered order, which splits leaves and inner nodes
+   in the middle of the tree, and remove some of them again. */
+static void
+run_index_updates(void)
+{
+  unsigned long long start;
+  attribute_value_t value;
+  relation_t *rel;
+  attribute_t *attr;
+  long matching;
+  long processed;
+  tuple_id_t row;
+  long id;
+
+  if(!execute("CREATE RELATION events;", &matching, &processed) ||
+     !execute("CREATE ATTRIBUTE id DOMAIN INT IN events;",
+              &matching, &processed) ||
+     !execute("CREATE INDEX events.id TYPE BTREE;", &matching, &processed)) {
+    printf("=check-me= FAILED - events\n");
+    failed = 1;
+    return;
+  }
+
+  start = now_ns();
+  for(row = 0; row < EVENTS; row++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld) INTO events;", event_id(row)))) {
+      printf("=check-me= FAILED - event %lu\n", (unsigned long)row);
+      failed = 1;
+      return;
+    }
+  }
+  printf("index insert %9llu us\n", (now_ns() - start) / 1000);
+
+  if(!execute("SELECT id FROM events WHERE id >= 100 AND id < 150;",
+              &matching, &processed) || matching != 50 || processed != 50) {
+    printf("=check-me= FAILED - events selected %ld rows, expected 50\n",
+           matching);
+    failed = 1;
+  }
+
+  rel = relation_load("events");
+  if(rel == NULL) {
+    printf("=check-me= FAILED - events load\n");
+    failed = 1;
+    return;
+  }
+  attr = relation_attribute_get(rel, "id");
+
+  if(!check_events(attr->index, 0, 0)) {
+    printf("=check-me= FAILED - index insert\n");
+    failed = 1;
+  }
+
+  value.domain = DOMAIN_INT;
+  for(id = 200; id < 300; id++) {
+    VALUE_INT(&value) = id;
+    if(DB_ERROR(index_delete(attr->index, &value))) {
+      break;
+    }
+  }
+  if(id < 300 || !check_events(attr->index, 200, 300)) {
+    printf("=check-me= FAILED - index delete\n");
+    failed = 1;
+  }
+
+  relation_release(rel);
+}
+#endif /* WITH_BTREE */
+/*---------------------------------------------------------------------------*/
+static void
+run_query(const struct query *query)
+{
+  unsigned long long start;
+  unsigned long long elapsed;
+  long matching;
+  long processed;
+  long expected;
+  long scanned;
+  long id;
+  int i;
+
+  expected = 0;
+  for(id = 0; id < ROWS; id++) {
+    expected += query->match(id, sample_temp(id), sample_hum(id));
+  }
+
+  start = now_ns();
+  for(i = 0; i < REPETITIONS; i++) {
+    if(!execute(query->text, &matching, &processed)) {
+      printf("=check-me= FAILED - %s\n", query->name);
+      failed = 1;
+      return;
+    }
+  }
+  elapsed = now_ns() - start;
+
+  /* An index search processes the selected rows only. */
+  scanned = WITH_BTREE && query->indexed ? expected : ROWS;
+
+  printf("%-12s rows %4ld/%4ld %9llu rows/s %7llu queries/s\n", query->name,
+         matching, processed,
+         elapsed ? (unsigned long long)processed * REPETITIONS *
+         1000000000ULL / elapsed : 0,
+         elapsed ? REPETITIONS * 1000000000ULL / elapsed : 0);
+
+  if(matching != expected || processed != scanned) {
+    printf("=check-me= FAILED - %s selected %ld rows, expected %ld\n",
+           query->name, matching, expected);
+    failed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_join(const struct join *join)
+{
+  unsigned long long start;
+  unsigned long long elapsed;
+  long matching;
+  long processed;
+  long expected;
+  long outer;
+  long row;
+  int i;
+
+  /* The sample IDs are unique. */
+  expected = 0;
+  for(row = 0; row < READINGS; row++) {
+    expected += reading_id(row) < ROWS;
+  }
+
+  start = now_ns();
+  for(i = 0; i < JOIN_REPETITIONS; i++) {
+    if(!execute(join->text, &matching, &processed)) {
+      printf("=check-me= FAILED - %s\n", join->name);
+      failed = 1;
+      return;
+    }
+  }
+  elapsed = now_ns() - start;
+
+  /* Each outer tuple is processed once, in addition to the joined rows. */
+  outer = JOIN_OUTER_ROWS(join);
+
+  printf("%-12s rows %4ld/%4ld %9llu rows/s %7llu queries/s\n", join->name,
+         matching, processed,
+         elapsed ? (unsigned long long)processed * JOIN_REPETITIONS *
+         1000000000ULL / elapsed : 0,
+         elapsed ? JOIN_REPETITIONS * 1000000000ULL / elapsed : 0);
+
+  if(matching != expected || processed != outer + expected) {
+    printf("=check-me= FAILED - %s joined %ld rows over %ld tuples, "
+           "expected %ld over %ld\n", join->name, matching,
+           processed - matching, expected, outer);
+    failed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_bench_process, ev, data)
+{
+#if WITH_BTREE
+  static unsigned long long start;
+  static int state;
+  long matching;
+  long processed;
+#endif /* WITH_BTREE */
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Antelope benchmark, %s predicates, %s, %u rows\n",
+         LVM_USE_COMPILER ? "compiled" : "interpreted",
+         WITH_BTREE ? "B+-tree on id" : "no index", ROWS);
+
+  cfs_coffee_format();
+  db_init();
+
+  if(!create_relation()) {
+    printf("=check-me= FAILED - create\n");
+    failed = 1;
+  }
+
+#if WITH_BTREE
+  /* Index the existing rows, which the indexer process loads in
+     the background. */
+  start = now_ns();
+  if(!failed &&
+     !execute("CREATE INDEX samples.id TYPE BTREE;", &matching, &processed)) {
+    printf("=check-me= FAILED - index\n");
+    failed = 1;
+  }
+  while(!failed && (state = index_state()) == 0) {
+    PROCESS_PAUSE();
+  }
+  if(!failed && state < 0) {
+    printf("=check-me= FAILED - index load\n");
+    failed = 1;
+  }
+  printf("index load   %9llu us\n", (now_ns() - start) / 1000);
+#endif /* WITH_BTREE */
+
+  if(!failed) {
+    for(i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+      run_query(&queries[i]);
+    }
+    for(i = 0; i < sizeof(joins) / sizeof(joins[0]); i++) {
+      run_join(&joins[i]);
+    }
+  }
+
+#if WITH_BTREE
+  if(!failed) {
+    run_index_updates();
+  }
+#endif /* WITH_BTREE */
+
+  printf("=check-me= DONE\n");
+  exit(failed);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define LOG_CONF_LEVEL_MAIN LOG_LEVEL_WARN
+
+/* The samples and the events are indexed with B+-trees */
+#define DB_BTREE_INDEX_LIMIT 2
+
+#endif /* PROJECT_CONF_H_ */
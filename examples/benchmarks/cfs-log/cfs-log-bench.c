@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         A native benchmark that compares appending sensor samples to a
+ *         plain Coffee file with appending them to a cfs-log, and checks
+ *         the data read back from the log.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "cfs/cfs-log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#define SAMPLE_COUNT          12000
+#define EXTENT_SIZE           (8192 / RECORD_SIZE * RECORD_SIZE)
+#define RETENTION_EXTENTS     4
+#define RETENTION_SAMPLES     (8 * RETENTION_EXTENTS * EXTENT_SAMPLES)
+#define CIRCULAR_EXTENT_SIZE  (16384 / RECORD_SIZE * RECORD_SIZE)
+#define CIRCULAR_SAMPLES      (3 * 1024UL * 1024UL / SAMPLE_SIZE)
+#define CACHE_FILES           16
+/*---------------------------------------------------------------------------*/
+struct sample {
+  uint32_t seq;
+  uint32_t timestamp;
+  int16_t values[3];
+  uint8_t flags;
+  uint8_t reserved;     /* Zero, which the log must keep after reopening */
+};
+
+#define SAMPLE_SIZE           sizeof(struct sample)
+/* Each sample is appended as one record. The extents hold whole records,
+   so that samples do not straddle extents. */
+#define RECORD_SIZE           (SAMPLE_SIZE + CFS_LOG_RECORD_HEADER_SIZE)
+#define EXTENT_SAMPLES        (EXTENT_SIZE / RECORD_SIZE)
+
+struct result {
+  unsigned long appends;
+  unsigned long failures;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+};
+/*---------------------------------------------------------------------------*/
+static struct result result;
+static struct cfs_log log;
+static int failed;
+/*---------------------------------------------------------------------------*/
+PROCESS(cfs_log_bench_process, "cfs-log benchmark");
+AUTOSTART_PROCESSES(&cfs_log_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_sample(struct sample *s, uint32_t seq)
+{
+  s->seq = seq;
+  s->timestamp = seq * 10;
+  s->values[0] = (int16_t)(seq * 3);
+  s->values[1] = (int16_t)(seq ^ 0x5555);
+  s->values[2] = -(int16_t)seq;
+  s->flags = seq & 0xff;
+  s->reserved = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_sample(const struct sample *s, uint32_t seq)
+{
+  struct sample expected;
+
+  make_sample(&expected, seq);
+  return memcmp(s, &expected, SAMPLE_SIZE) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+account(unsigned long long start, int ok)
+{
+  unsigned long long elapsed;
+
+  elapsed = now_ns() - start;
+  result.appends++;
+  result.total_ns += elapsed;
+  if(elapsed > result.max_ns) {
+    result.max_ns = elapsed;
+  }
+  if(!ok) {
+    result.failures++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name)
+{
+  printf("%-10s appends %6lu failures %lu avg %6llu ns max %9llu ns\n",
+         name, result.appends, result.failures,
+         result.appends ? result.total_ns / result.appends : 0,
+         result.max_ns);
+  memset(&result, 0, sizeof(result));
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *what)
+{
+  printf("=check-me= FAILED - %s\n", what);
+  failed = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_plain_file(void)
+{
+  struct sample s;
+  unsigned long long start;
+  uint32_t seq;
+  int fd;
+
+  fd = cfs_open("plain", CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    fail("plain open");
+    return;
+  }
+  for(seq = 0; seq < SAMPLE_COUNT; seq++) {
+    make_sample(&s, seq);
+    start = now_ns();
+    account(start, cfs_write(fd, &s, SAMPLE_SIZE) == SAMPLE_SIZE);
+  }
+  cfs_close(fd);
+  report("plain");
+  cfs_remove("plain");
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+read_log(struct cfs_log_cursor *cursor, uint32_t seq, uint32_t limit)
+{
+  struct sample s;
+  uint32_t count;
+
+  for(count = 0; count < limit; count++, seq++) {
+    if(cfs_log_read(&log, cursor, &s, SAMPLE_SIZE) != SAMPLE_SIZE) {
+      break;
+    }
+    if(!check_sample(&s, seq)) {
+      fail("log content");
+      break;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Coffee keeps the ends of recently used files in RAM. Keep other files
+   open until no more can be opened, as if after a reboot, so that the
+   end of the newest extent is determined from the flash again. */
+static void
+clear_file_cache(void)
+{
+  char name[8];
+  int fds[CACHE_FILES];
+  int i;
+
+  for(i = 0; i < CACHE_FILES; i++) {
+    sprintf(name, "tmp%d", i);
+    fds[i] = cfs_open(name, CFS_WRITE);
+    if(fds[i] < 0) {
+      break;
+    }
+  }
+  while(--i >= 0) {
+    cfs_close(fds[i]);
+    sprintf(name, "tmp%d", i);
+    cfs_remove(name);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_samples(uint32_t from, uint32_t to)
+{
+  struct sample s;
+  unsigned long long start;
+  uint32_t seq;
+
+  for(seq = from; seq < to; seq++) {
+    make_sample(&s, seq);
+    start = now_ns();
+    account(start, cfs_log_append(&log, &s, SAMPLE_SIZE) == SAMPLE_SIZE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_log(void)
+{
+  struct cfs_log_cursor cursor;
+  uint32_t count;
+
+  if(cfs_log_open(&log, "samples", EXTENT_SIZE, 0) < 0) {
+    fail("log open");
+    return;
+  }
+  append_samples(0, SAMPLE_COUNT);
+  report("cfs-log");
+
+  /* Read half of the log, then continue with the saved cursor after
+     the log has been opened again. */
+  cfs_log_rewind(&log, &cursor);
+  count = read_log(&cursor, 0, SAMPLE_COUNT / 2);
+  cfs_log_close(&log);
+  clear_file_cache();
+  if(cfs_log_open(&log, "samples", EXTENT_SIZE, 0) < 0) {
+    fail("log reopen");
+    return;
+  }
+  count += read_log(&cursor, count, SAMPLE_COUNT);
+  if(count != SAMPLE_COUNT) {
+    printf("read back %lu of %u samples\n", (unsigned long)count,
+           SAMPLE_COUNT);
+    fail("log read back");
+  }
+
+  /* Appends after opening again continue the same log. */
+  append_samples(SAMPLE_COUNT, SAMPLE_COUNT + 100);
+  if(read_log(&cursor, SAMPLE_COUNT, 100) != 100) {
+    fail("log continue");
+  }
+  memset(&result, 0, sizeof(result));
+
+  if(cfs_log_remove(&log) < 0 || log.count != 0) {
+    fail("log remove");
+  }
+  cfs_log_close(&log);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_retention(void)
+{
+  struct cfs_log_cursor cursor;
+  uint32_t first;
+  uint32_t count;
+
+  if(cfs_log_open(&log, "ring", EXTENT_SIZE, RETENTION_EXTENTS) < 0) {
+    fail("ring open");
+    return;
+  }
+  cfs_log_rewind(&log, &cursor);
+  append_samples(0, RETENTION_SAMPLES);
+  report("retention");
+
+  if(log.count != RETENTION_EXTENTS) {
+    fail("ring extent count");
+  }
+
+  /* The log wrapped eight times. The cursor points into a dropped extent and continues with the
+     oldest sample that is still kept. */
+  first = RETENTION_SAMPLES - RETENTION_EXTENTS * EXTENT_SAMPLES;
+  count = read_log(&cursor, first, RETENTION_SAMPLES);
+  if(first + count != RETENTION_SAMPLES) {
+    printf("ring kept samples %lu to %lu\n", (unsigned long)first,
+           (unsigned long)(first + count));
+    fail("ring read back");
+  }
+
+  cfs_log_remove(&log);
+  cfs_log_close(&log);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_circular_full(void)
+{
+  struct cfs_log_cursor cursor;
+  struct sample s;
+  uint32_t seq;
+
+  /* The retention limit exceeds the flash size, so the log wraps when
+     Coffee runs out of space, several times over. */
+  if(cfs_log_open(&log, "full", CIRCULAR_EXTENT_SIZE, 1000) < 0) {
+    fail("full open");
+    return;
+  }
+  append_samples(0, CIRCULAR_SAMPLES);
+  report("wrap");
+
+  cfs_log_rewind(&log, &cursor);
+  if(cfs_log_read(&log, &cursor, &s, SAMPLE_SIZE) != SAMPLE_SIZE) {
+    fail("full read");
+    return;
+  }
+  seq = s.seq;
+  if(!check_sample(&s, seq) ||
+     seq + 1 + read_log(&cursor, seq + 1, CIRCULAR_SAMPLES) !=
+     CIRCULAR_SAMPLES) {
+    fail("full read back");
+  }
+  printf("wrap kept %lu samples in %u extents\n",
+         (unsigned long)(CIRCULAR_SAMPLES - seq), log.count);
+
+  cfs_log_remove(&log);
+  cfs_log_close(&log);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(cfs_log_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("cfs-log benchmark, %u byte samples, %u byte extents\n",
+         (unsigned)SAMPLE_SIZE, (unsigned)EXTENT_SIZE);
+
+  if(cfs_coffee_format() < 0) {
+    fail("format");
+  } else {
+    run_plain_file();
+    run_log();
+    run_retention();
+    run_circular_full();
+  }
+
+  printf("=check-me= DONE\n");
+  exit(failed);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         A native benchmark that replays allocation traces against
+ *         the heapmem allocator and verifies the allocated memory.
+ */
+
+#include "contiki.h"
+#include "lib/heapmem.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#define MAX_OBJECTS         64
+#define STRESS_OPERATIONS   20000
+#define HANDSHAKE_ROUNDS    200
+/*---------------------------------------------------------------------------*/
+typedef struct trace_op {
+  char type;
+  uint8_t id;
+  uint16_t size;
+} trace_op_t;
+
+struct object {
+  uint8_t *ptr;
+  uint16_t size;
+};
+
+struct result {
+  unsigned long operations;
+  unsigned long failures;
+  unsigned long errors;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+};
+/*---------------------------------------------------------------------------*/
+extern int contiki_argc;
+extern char **contiki_argv;
+
+static struct object objects[MAX_OBJECTS];
+static struct result result;
+static int failed;
+/*---------------------------------------------------------------------------*/
+PROCESS(heapmem_bench_process, "heapmem benchmark");
+AUTOSTART_PROCESSES(&heapmem_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_object(int id)
+{
+  memset(objects[id].ptr, id, objects[id].size);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_object(int id, uint16_t size)
+{
+  uint16_t i;
+
+  for(i = 0; i < size; i++) {
+    if(objects[id].ptr[i] != (uint8_t)id) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+account(unsigned long long start)
+{
+  unsigned long long elapsed;
+
+  elapsed = now_ns() - start;
+  result.operations++;
+  result.total_ns += elapsed;
+  if(elapsed > result.max_ns) {
+    result.max_ns = elapsed;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+replay(const trace_op_t *op)
+{
+  struct object *obj;
+  unsigned long long start;
+  void *ptr;
+
+  if(op->id >= MAX_OBJECTS) {
+    result.errors++;
+    return;
+  }
+  obj = &objects[op->id];
+
+  switch(op->type) {
+  case 'a':
+    if(obj->ptr != NULL) {
+      /* Traces may reuse identifiers without freeing first. */
+      heapmem_free(obj->ptr);
+      obj->ptr = NULL;
+    }
+    start = now_ns();
+    obj->ptr = heapmem_alloc(op->size);
+    account(start);
+    if(obj->ptr == NULL) {
+      result.failures++;
+      break;
+    }
+    obj->size = op->size;
+    fill_object(op->id);
+    break;
+  case 'r':
+    start = now_ns();
+    ptr = heapmem_realloc(obj->ptr, op->size);
+    account(start);
+    if(ptr == NULL) {
+      if(op->size != 0) {
+        result.failures++;
+      } else {
+        obj->ptr = NULL;
+      }
+      break;
+    }
+    obj->ptr = ptr;
+    if(!check_object(op->id, MIN(obj->size, op->size))) {
+      result.errors++;
+    }
+    obj->size = op->size;
+    fill_object(op->id);
+    break;
+  case 'f':
+    if(obj->ptr != NULL && !check_object(op->id, obj->size)) {
+      result.errors++;
+    }
+    start = now_ns();
+    heapmem_free(obj->ptr);
+    account(start);
+    obj->ptr = NULL;
+    break;
+  default:
+    result.errors++;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+release_all(void)
+{
+  int i;
+
+  for(i = 0; i < MAX_OBJECTS; i++) {
+    if(objects[i].ptr != NULL) {
+      if(!check_object(i, objects[i].size)) {
+        result.errors++;
+      }
+      heapmem_free(objects[i].ptr);
+      objects[i].ptr = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name)
+{
+  heapmem_stats_t stats;
+#if HEAPMEM_SEGREGATED
+  int i;
+#endif
+
+  heapmem_stats(&stats);
+
+  printf("%s: %lu ops, %lu failed, avg %llu ns, max %llu ns\n",
+         name, result.operations, result.failures,
+         result.operations ? result.total_ns / result.operations : 0,
+         result.max_ns);
+  printf("  allocated %lu overhead %lu available %lu footprint %lu chunks %lu\n",
+         (unsigned long)stats.allocated, (unsigned long)stats.overhead,
+         (unsigned long)stats.available, (unsigned long)stats.footprint,
+         (unsigned long)stats.chunks);
+#if HEAPMEM_SEGREGATED
+  printf("  coalesce runs %lu\n", stats.coalesce_runs);
+  for(i = 0; i < HEAPMEM_BIN_COUNT; i++) {
+    if(stats.bins[i].chunks > 0) {
+      printf("  bin %2d (>= %5lu): %lu free chunks, %lu bytes\n", i,
+             (unsigned long)1 << (i + HEAPMEM_BIN_MIN_SHIFT),
+             (unsigned long)stats.bins[i].chunks,
+             (unsigned long)stats.bins[i].available);
+    }
+  }
+#endif /* HEAPMEM_SEGREGATED */
+
+  release_all();
+
+  printf("=check-me= %s - %s\n",
+         result.errors == 0 ? "SUCCEEDED" : "FAILED", name);
+  if(result.errors != 0) {
+    failed = 1;
+  }
+  memset(&result, 0, sizeof(result));
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t seed;
+
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * A trace that models DTLS sessions: a long-lived session object, a
+ * handshake buffer that grows while the flight is assembled, and
+ * short-lived record buffers for each message.
+ */
+static void
+run_handshake_trace(void)
+{
+  trace_op_t op;
+  int round;
+  int msg;
+  int session;
+
+  seed = 1;
+  for(round = 0; round < HANDSHAKE_ROUNDS; round++) {
+    session = round % 8;
+
+    op.type = 'a';
+    op.id = session;
+    op.size = 180 + next_random() % 40;
+    replay(&op);
+
+    op.id = 8 + session;
+    op.size = 64;
+    replay(&op);
+    op.type = 'r';
+    op.size = 256 + next_random() % 256;
+    replay(&op);
+
+    for(msg = 0; msg < 12; msg++) {
+      op.type = 'a';
+      op.id = 16 + msg;
+      op.size = 13 + next_random() % 120;
+      replay(&op);
+      if(msg & 1) {
+        op.type = 'f';
+        op.id = 16 + msg - 1;
+        replay(&op);
+      }
+    }
+    for(msg = 0; msg < 12; msg++) {
+      op.type = 'f';
+      op.id = 16 + msg;
+      replay(&op);
+    }
+
+    op.type = 'f';
+    op.id = 8 + session;
+    replay(&op);
+    if((round % 8) == 7) {
+      for(session = 0; session < 8; session++) {
+        op.id = session;
+        replay(&op);
+      }
+    }
+  }
+  report("handshake");
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_stress_trace(void)
+{
+  trace_op_t op;
+  unsigned long i;
+
+  seed = 42;
+  for(i = 0; i < STRESS_OPERATIONS; i++) {
+    op.id = next_random() % MAX_OBJECTS;
+    if(objects[op.id].ptr == NULL) {
+      op.type = 'a';
+      op.size = 1 + next_random() % ((next_random() & 7) == 0 ? 600 : 100);
+    } else if((next_random() & 3) == 0) {
+      op.type = 'r';
+      op.size = 1 + next_random() % 300;
+    } else {
+      op.type = 'f';
+    }
+    replay(&op);
+  }
+  report("stress");
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_trace_file(const char *filename)
+{
+  FILE *fp;
+  char line[64];
+  char type;
+  unsigned id;
+  unsigned size;
+  trace_op_t op;
+
+  fp = fopen(filename, "r");
+  if(fp == NULL) {
+    printf("Failed to open trace %s\n", filename);
+    printf("=check-me= FAILED - %s\n", filename);
+    failed = 1;
+    return;
+  }
+
+  while(fgets(line, sizeof(line), fp) != NULL) {
+    size = 0;
+    if(line[0] == '#' || sscanf(line, " %c %u %u", &type, &id, &size) < 2) {
+      continue;
+    }
+    op.type = type;
+    op.id = id < MAX_OBJECTS ? id : MAX_OBJECTS;
+    op.size = size;
+    replay(&op);
+  }
+  fclose(fp);
+
+  report(filename);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(heapmem_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("heapmem benchmark, %s mode, arena %u bytes\n",
+         HEAPMEM_SEGREGATED ? "segregated-fit" : "best-fit",
+         (unsigned)HEAPMEM_CONF_ARENA_SIZE);
+
+  if(contiki_argc > 1) {
+    for(i = 1; i < contiki_argc; i++) {
+      run_trace_file(contiki_argv[i]);
+    }
+  } else {
+    run_handshake_trace();
+    run_stress_trace();
+  }
+
+  printf("=check-me= DONE\n");
+  exit(failed);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
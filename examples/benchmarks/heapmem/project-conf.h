@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define HEAPMEM_CONF_ARENA_SIZE 8192
+
+#define LOG_CONF_LEVEL_MAIN LOG_LEVEL_WARN
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,6 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define LOG_CONF_LEVEL_MAIN LOG_LEVEL_WARN
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         A native benchmark that stores sensor samples as fixed-width
+ *         rows and in a compressed time series, and compares their size
+ *         and the throughput of aggregate and range queries.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#if !WITH_POSIX
+#include "cfs/cfs-coffee.h"
+#endif
+#include "tsdb.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#define SAMPLE_COUNT          20000
+#define SAMPLE_PERIOD         10
+#define GAP_INTERVAL          2500
+#define GAP_LENGTH            3600
+#define QUERY_COUNT           200
+#define RANGE_COUNT           50
+#define ROW_BUFFER            64
+/*---------------------------------------------------------------------------*/
+struct row {
+  uint32_t t;
+  int32_t value;
+};
+
+struct window {
+  const char *name;
+  uint32_t length;
+};
+
+static const struct window windows[] = {
+  { "hour", 3600 },
+  { "day", 86400 },
+  { "week", 7 * 86400UL }
+};
+
+#define WINDOW_COUNT (sizeof(windows) / sizeof(windows[0]))
+/*---------------------------------------------------------------------------*/
+static struct row samples[SAMPLE_COUNT];
+static struct row rows[ROW_BUFFER];
+static struct tsdb_series series;
+static struct tsdb_cursor cursor;
+static uint32_t random_state = 12345;
+static int failed;
+/*---------------------------------------------------------------------------*/
+PROCESS(tsdb_bench_process, "tsdb benchmark");
+AUTOSTART_PROCESSES(&tsdb_bench_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+next_random(void)
+{
+  random_state = random_state * 1103515245UL + 12345;
+  return random_state >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *what)
+{
+  printf("=check-me= FAILED - %s\n", what);
+  failed = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* A temperature in hundredths of a degree, sampled every ten seconds:
+   a slow daily swing with a little noise, quantized by the sensor, and
+   an occasional gap in the measurements. */
+static void
+make_samples(void)
+{
+  uint32_t t;
+  int32_t phase;
+  int32_t value;
+  int i;
+
+  t = 1000000;
+  value = 0;
+  for(i = 0; i < SAMPLE_COUNT; i++) {
+    if(i > 0 && i % GAP_INTERVAL == 0) {
+      t += GAP_LENGTH;
+    }
+    /* Occasional jitter of the sampling time. */
+    t += SAMPLE_PERIOD + (next_random() % 16 == 0 ? 1 : 0);
+
+    if(i % 4 == 0) {
+      phase = (t / 60) % 1440;
+      if(phase > 720) {
+        phase = 1440 - phase;
+      }
+      value = 1800 + phase + (int32_t)(next_random() % 8) - 4;
+      value -= value % 2;
+    }
+    samples[i].t = t;
+    samples[i].value = value;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+expected_aggregate(uint32_t from, uint32_t to, struct tsdb_aggregate *a)
+{
+  int i;
+
+  memset(a, 0, sizeof(*a));
+  a->min = INT32_MAX;
+  a->max = INT32_MIN;
+  for(i = 0; i < SAMPLE_COUNT; i++) {
+    if(samples[i].t >= from && samples[i].t <= to) {
+      a->count++;
+      a->sum += samples[i].value;
+      if(samples[i].value < a->min) {
+        a->min = samples[i].value;
+      }
+      if(samples[i].value > a->max) {
+        a->max = samples[i].value;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+same_aggregate(const struct tsdb_aggregate *a, const struct tsdb_aggregate *b)
+{
+  return a->count == b->count && a->sum == b->sum &&
+    (a->count == 0 || (a->min == b->min && a->max == b->max));
+}
+/*---------------------------------------------------------------------------*/
+static cfs_offset_t
+write_rows(unsigned long long *elapsed)
+{
+  unsigned long long start;
+  cfs_offset_t size;
+  int fd;
+  int i;
+
+#if !WITH_POSIX
+  cfs_coffee_reserve("rows", sizeof(samples));
+#endif
+  fd = cfs_open("rows", CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    fail("rows open");
+    return 0;
+  }
+  start = now_ns();
+  for(i = 0; i < SAMPLE_COUNT; i++) {
+    if(cfs_write(fd, &samples[i], sizeof(struct row)) != sizeof(struct row)) {
+      fail("rows write");
+      break;
+    }
+  }
+  *elapsed = now_ns() - start;
+  size = cfs_seek(fd, 0, CFS_SEEK_END);
+  cfs_close(fd);
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+/* The baseline: find the first row of the range by binary search over
+   the fixed-width rows, and read the rows from there. */
+static void
+aggregate_rows(int fd, uint32_t from, uint32_t to, struct tsdb_aggregate *a)
+{
+  struct row row;
+  int low;
+  int high;
+  int middle;
+  int count;
+  int i;
+
+  memset(a, 0, sizeof(*a));
+  a->min = INT32_MAX;
+  a->max = INT32_MIN;
+
+  low = 0;
+  high = SAMPLE_COUNT;
+  while(low < high) {
+    middle = (low + high) / 2;
+    cfs_seek(fd, middle * sizeof(struct row), CFS_SEEK_SET);
+    cfs_read(fd, &row, sizeof(row));
+    if(row.t < from) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  cfs_seek(fd, low * sizeof(struct row), CFS_SEEK_SET);
+  for(;;) {
+    count = cfs_read(fd, rows, sizeof(rows)) / sizeof(struct row);
+    if(count <= 0) {
+      return;
+    }
+    for(i = 0; i < count; i++) {
+      if(rows[i].t > to) {
+        return;
+      }
+      a->count++;
+      a->sum += rows[i].value;
+      if(rows[i].value < a->min) {
+        a->min = rows[i].value;
+      }
+      if(rows[i].value > a->max) {
+        a->max = rows[i].value;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_series(void)
+{
+  unsigned long long start;
+  unsigned long long elapsed;
+  int i;
+
+  if(tsdb_open(&series, "series") < 0) {
+    fail("series open");
+    return;
+  }
+#if !WITH_POSIX
+  cfs_coffee_reserve("series", sizeof(samples) / 2);
+#endif
+
+  start = now_ns();
+  for(i = 0; i < SAMPLE_COUNT; i++) {
+    if(tsdb_append(&series, samples[i].t, samples[i].value) < 0) {
+      fail("series append");
+      break;
+    }
+  }
+  if(tsdb_close(&series) < 0) {
+    fail("series close");
+  }
+  elapsed = now_ns() - start;
+
+  printf("tsdb    %7ld bytes %5.2f bits/sample append %6llu ns/sample\n",
+         (long)tsdb_size(&series),
+         tsdb_size(&series) * 8.0 / SAMPLE_COUNT,
+         elapsed / SAMPLE_COUNT);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_series(void)
+{
+  uint32_t t;
+  int32_t value;
+  int i;
+
+  /* The sparse index is rebuilt from the block summaries. */
+  if(tsdb_open(&series, "series") < 0) {
+    fail("series reopen");
+    return;
+  }
+
+  tsdb_range(&series, &cursor, 0, UINT32_MAX);
+  for(i = 0; tsdb_range_next(&cursor, &t, &value) == 1; i++) {
+    if(i >= SAMPLE_COUNT || t != samples[i].t || value != samples[i].value) {
+      fail("series content");
+      return;
+    }
+  }
+  if(i != SAMPLE_COUNT) {
+    printf("read back %d of %d samples\n", i, SAMPLE_COUNT);
+    fail("series read back");
+  }
+
+  if(tsdb_append(&series, samples[0].t, 0) == 0) {
+    fail("out-of-order append");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_ranges(void)
+{
+  uint32_t from;
+  uint32_t to;
+  uint32_t t;
+  int32_t value;
+  int index;
+  int q;
+  int i;
+
+  for(q = 0; q < RANGE_COUNT; q++) {
+    index = next_random() % SAMPLE_COUNT;
+    from = samples[index].t - next_random() % 20;
+    to = from + next_random() % 3600;
+
+    while(index > 0 && samples[index - 1].t >= from) {
+      index--;
+    }
+    while(index < SAMPLE_COUNT && samples[index].t < from) {
+      index++;
+    }
+
+    tsdb_range(&series, &cursor, from, to);
+    for(i = index; tsdb_range_next(&cursor, &t, &value) == 1; i++) {
+      if(i >= SAMPLE_COUNT || t != samples[i].t || value != samples[i].value) {
+        fail("range content");
+        return;
+      }
+    }
+    if(i < SAMPLE_COUNT && samples[i].t <= to) {
+      fail("range end");
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_aggregates(void)
+{
+  struct tsdb_aggregate expected;
+  struct tsdb_aggregate result;
+  unsigned long long rows_ns;
+  unsigned long long tsdb_ns;
+  unsigned long long start;
+  unsigned long decoded;
+  unsigned long summarized;
+  uint32_t first;
+  uint32_t span;
+  uint32_t from;
+  uint32_t to;
+  unsigned w;
+  int fd;
+  int q;
+
+  fd = cfs_open("rows", CFS_READ);
+  if(fd < 0) {
+    fail("rows reopen");
+    return;
+  }
+
+  first = samples[0].t;
+  span = samples[SAMPLE_COUNT - 1].t - first;
+  for(w = 0; w < WINDOW_COUNT; w++) {
+    rows_ns = tsdb_ns = 0;
+    decoded = summarized = 0;
+    for(q = 0; q < QUERY_COUNT; q++) {
+      from = first + next_random() % span;
+      to = from + windows[w].length;
+      expected_aggregate(from, to, &expected);
+
+      start = now_ns();
+      aggregate_rows(fd, from, to, &result);
+      rows_ns += now_ns() - start;
+      if(!same_aggregate(&result, &expected)) {
+        fail("rows aggregate");
+      }
+
+      start = now_ns();
+      if(tsdb_aggregate(&series, from, to, &result) < 0) {
+        fail("tsdb aggregate");
+      }
+      tsdb_ns += now_ns() - start;
+      if(!same_aggregate(&result, &expected)) {
+        printf("%lu..%lu: count %lu/%lu sum %lld/%lld\n",
+               (unsigned long)from, (unsigned long)to,
+               (unsigned long)result.count, (unsigned long)expected.count,
+               (long long)result.sum, (long long)expected.sum);
+        fail("tsdb aggregate result");
+      }
+      decoded += result.blocks_decoded;
+      summarized += result.blocks_summarized;
+    }
+
+    printf("%-5s rows %8.0f queries/s tsdb %8.0f queries/s "
+           "(%4.1f blocks decoded, %5.1f summarized)\n",
+           windows[w].name,
+           QUERY_COUNT * 1e9 / (rows_ns ? rows_ns : 1),
+           QUERY_COUNT * 1e9 / (tsdb_ns ? tsdb_ns : 1),
+           (double)decoded / QUERY_COUNT, (double)summarized / QUERY_COUNT);
+  }
+
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsdb_bench_process, ev, data)
+{
+  unsigned long long elapsed;
+  cfs_offset_t size;
+
+  PROCESS_BEGIN();
+
+  printf("tsdb benchmark, %u samples, %u byte blocks, %s\n",
+         SAMPLE_COUNT, TSDB_BLOCK_SIZE,
+         WITH_POSIX ? "host file system" : "Coffee");
+
+#if !WITH_POSIX
+  if(cfs_coffee_format() < 0) {
+    fail("format");
+  }
+#else
+  cfs_remove("rows");
+  cfs_remove("series");
+#endif
+
+  make_samples();
+  size = write_rows(&elapsed);
+  printf("rows    %7ld bytes %5.2f bits/sample append %6llu ns/sample\n",
+         (long)size, size * 8.0 / SAMPLE_COUNT, elapsed / SAMPLE_COUNT);
+
+  append_series();
+  if(tsdb_size(&series) > 0) {
+    printf("compression ratio %.2f\n", (double)size / tsdb_size(&series));
+  }
+
+  check_series();
+  run_ranges();
+  run_aggregates();
+
+  tsdb_remove(&series);
+  cfs_remove("rows");
+
+  printf("=check-me= DONE\n");
+  exit(failed);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -48,11 +48,6 @@
 #define PRINTF(...)
 #endif
 
-#ifdef PROJECT_CONF_PATH
-/* Load the heapmem configuration from a project configuration file. */
-#include PROJECT_CONF_PATH
-#endif
-
 #include <stdint.h>
 #include <string.h>
 
@@ -104,6 +99,21 @@
 #define ALIGN(size)						\
   (((size) + (HEAPMEM_ALIGNMENT - 1)) & ~(HEAPMEM_ALIGNMENT - 1))
 
+/*
+ * In the segregated mode, free chunks are kept in HEAPMEM_BIN_COUNT
+ * bins. Bin i holds the free chunks whose size is in the range
+ * [2^(i + HEAPMEM_BIN_MIN_SHIFT), 2^(i + 1 + HEAPMEM_BIN_MIN_SHIFT)).
+ * The first bin also holds smaller chunks, and the last bin holds all
+ * larger chunks.
+ */
+#if HEAPMEM_SEGREGATED
+#if HEAPMEM_BIN_COUNT > 32
+#error "HEAPMEM_CONF_BIN_COUNT must not exceed 32"
+#endif
+
+#define LAST_BIN          (HEAPMEM_BIN_COUNT - 1)
+#endif /* HEAPMEM_SEGREGATED */
+
 /* Macros for chunk iteration. */
 #define NEXT_CHUNK(chunk)						\
   ((chunk_t *)((char *)(chunk) + sizeof(chunk_t) + (chunk)->size))
@@ -147,8 +157,53 @@ static char heap_base[HEAPMEM_ARENA_SIZE];
 static size_t heap_usage;
 
 static chunk_t *first_chunk = (chunk_t *)heap_base;
+
+#if HEAPMEM_SEGREGATED
+/* One free list per size class, and a bitmap of the non-empty bins. */
+static chunk_t *free_bins[HEAPMEM_BIN_COUNT];
+static uint32_t bin_map;
+static unsigned long coalesce_runs;
+
+#define FREE_LIST(chunk) free_bins[bin_index((chunk)->size)]
+#else
 static chunk_t *free_list;
 
+#define FREE_LIST(chunk) free_list
+#endif /* HEAPMEM_SEGREGATED */
+
+#if HEAPMEM_SEGREGATED
+/* bin_index: Get the bin that holds free chunks of a certain size. */
+static int
+bin_index(size_t size)
+{
+  int bin;
+
+  size >>= HEAPMEM_BIN_MIN_SHIFT + 1;
+  for(bin = 0; size != 0 && bin < LAST_BIN; bin++) {
+    size >>= 1;
+  }
+  return bin;
+}
+
+/* first_bin: Get the first non-empty bin at or above a certain bin,
+   or -1 if all such bins are empty. */
+static int
+first_bin(int bin)
+{
+  uint32_t map;
+
+  map = bin_map >> bin;
+  if(map == 0) {
+    return -1;
+  }
+  while((map & 1) == 0) {
+    map >>= 1;
+    bin++;
+  }
+  return bin;
+}
+#endif /* HEAPMEM_SEGREGATED */
+
 /* extend_space: Increases the current footprint used in the heap, and
    returns a pointer to the old end. */
 static void *
@@ -178,11 +233,14 @@ free_chunk(chunk_t * const chunk)
   } else {
     /* Put the chunk on the free list. */
     chunk->prev = NULL;
-    chunk->next = free_list;
-    if(free_list != NULL) {
-      free_list->prev = chunk;
+    chunk->next = FREE_LIST(chunk);
+    if(chunk->next != NULL) {
+      chunk->next->prev = chunk;
     }
-    free_list = chunk;
+    FREE_LIST(chunk) = chunk;
+#if HEAPMEM_SEGREGATED
+    bin_map |= (uint32_t)1 << bin_index(chunk->size);
+#endif
   }
 }
 
@@ -193,11 +251,13 @@ allocate_chunk(chunk_t * const chunk)
 {
   chunk->flags |= CHUNK_FLAG_ALLOCATED;
 
-  if(chunk == free_list) {
-    free_list = chunk->next;
-    if(free_list != NULL) {
-      free_list->prev = NULL;
+  if(chunk == FREE_LIST(chunk)) {
+    FREE_LIST(chunk) = chunk->next;
+#if HEAPMEM_SEGREGATED
+    if(chunk->next == NULL) {
+      bin_map &= ~((uint32_t)1 << bin_index(chunk->size));
     }
+#endif
   } else {
     chunk->prev->next = chunk->next;
   }
@@ -236,6 +296,16 @@ static void
 coalesce_chunks(chunk_t *chunk)
 {
   chunk_t *next;
+#if HEAPMEM_SEGREGATED
+  int was_free;
+
+  /* The chunk changes its size class when it grows, so a free chunk
+     is taken out of its bin while coalescing. */
+  was_free = CHUNK_FREE(chunk);
+  if(was_free) {
+    allocate_chunk(chunk);
+  }
+#endif
 
   for(next = NEXT_CHUNK(chunk);
       (char *)next < &heap_base[heap_usage] && CHUNK_FREE(next);
@@ -243,8 +313,106 @@ coalesce_chunks(chunk_t *chunk)
     chunk->size += sizeof(chunk_t) + next->size;
     allocate_chunk(next);
   }
+
+#if HEAPMEM_SEGREGATED
+  if(was_free) {
+    free_chunk(chunk);
+  }
+#endif
 }
 
+/*
+ * release_chunk: Free an allocated chunk. In the segregated mode, the
+ * free chunks that directly follow it are merged into it first. They
+ * are found without a search, and merging them keeps the bins from
+ * filling up with small chunks while the coalescing of the whole heap
+ * is deferred.
+ */
+static void
+release_chunk(chunk_t * const chunk)
+{
+#if HEAPMEM_SEGREGATED
+  coalesce_chunks(chunk);
+#endif
+  free_chunk(chunk);
+}
+
+#if HEAPMEM_SEGREGATED
+/*
+ * defrag_chunks: Coalesce all adjacent free chunks in the heap, and
+ * release a trailing free chunk back into the wilderness. In the
+ * segregated mode, this is only done when the bins cannot satisfy an
+ * allocation request.
+ */
+static void
+defrag_chunks(void)
+{
+  chunk_t *chunk;
+  chunk_t *next;
+
+  coalesce_runs++;
+
+  for(chunk = first_chunk;
+      (char *)chunk < &heap_base[heap_usage];
+      chunk = next) {
+    if(CHUNK_FREE(chunk)) {
+      coalesce_chunks(chunk);
+    }
+    next = NEXT_CHUNK(chunk);
+    if((char *)next == &heap_base[heap_usage] && CHUNK_FREE(chunk)) {
+      /* coalesce_chunks() has put the chunk back into a bin, so it
+         must be taken out again before it is released. */
+      allocate_chunk(chunk);
+      free_chunk(chunk);
+    }
+  }
+}
+
+/*
+ * get_free_chunk: Take a chunk from the bins to satisfy an allocation
+ * request. The bin that corresponds to the size itself is searched
+ * for the most suitable chunk, and at most CHUNK_SEARCH_MAX chunks in
+ * it are examined. If none of them is large enough, the chunk is
+ * taken from the first non-empty bin of a larger size class, whose
+ * chunks are all guaranteed to be large enough.
+ */
+static chunk_t *
+get_free_chunk(const size_t size)
+{
+  int i;
+  int bin;
+  chunk_t *chunk, *best;
+
+  best = NULL;
+  for(bin = first_bin(bin_index(size)); bin >= 0 && best == NULL;
+      bin = bin < LAST_BIN ? first_bin(bin + 1) : -1) {
+    /* Limit the time we spend on searching the bin. */
+    i = CHUNK_SEARCH_MAX;
+    for(chunk = free_bins[bin]; chunk != NULL; chunk = chunk->next) {
+      if(i-- == 0) {
+        break;
+      }
+      if(size <= chunk->size) {
+        if(best == NULL || chunk->size < best->size) {
+          best = chunk;
+        }
+        if(best->size == size) {
+          /* We found a perfect chunk -- stop the search. */
+          break;
+        }
+      }
+    }
+  }
+
+  if(best != NULL) {
+    /* We found a chunk for the allocation. Split it if necessary. */
+    allocate_chunk(best);
+    split_chunk(best, size);
+  }
+
+  return best;
+}
+#else
 /* defrag_chunks: Scan the free list for chunks that can be coalesced,
    and stop within a bounded time. */
 static void
@@ -305,6 +473,7 @@ get_free_chunk(const size_t size)
 
   return best;
 }
+#endif /* HEAPMEM_SEGREGATED */
 
 /*
  * heapmem_alloc: Allocate an object of the specified size, returning
@@ -332,6 +501,15 @@ heapmem_alloc(size_t size)
   size = ALIGN(size);
 
   chunk = get_free_chunk(size);
+#if HEAPMEM_SEGREGATED
+  if(chunk == NULL && bin_map != 0) {
+    /* None of the free chunks is large enough, so this is the point
+       where the deferred coalescing takes place. Growing the heap
+       instead would leave the free chunks fragmented for good. */
+    defrag_chunks();
+    chunk = get_free_chunk(size);
+  }
+#endif /* HEAPMEM_SEGREGATED */
   if(chunk == NULL) {
     chunk = extend_space(sizeof(chunk_t) + size);
     if(chunk == NULL) {
@@ -379,7 +557,7 @@ heapmem_free(void *ptr)
     PRINTF("%s ptr %p, allocated at %s:%u\n", __func__, ptr,
            chunk->file, chunk->line);
 
-    free_chunk(chunk);
+    release_chunk(chunk);
   }
 }
 
@@ -477,7 +655,7 @@ heapmem_realloc(void *ptr, size_t size)
   }
 
   memcpy(newptr, ptr, chunk->size);
-  free_chunk(chunk);
+  release_chunk(chunk);
 
   return newptr;
 }
@@ -497,7 +675,14 @@ heapmem_stats(heapmem_stats_t *stats)
     if(CHUNK_ALLOCATED(chunk)) {
       stats->allocated += chunk->size;
     } else {
+#if HEAPMEM_SEGREGATED
+      /* The chunks are not coalesced here, because the bin statistics
+         should show the fragmentation that the allocator sees. */
+      stats->bins[bin_index(chunk->size)].chunks++;
+      stats->bins[bin_index(chunk->size)].available += chunk->size;
+#else
       coalesce_chunks(chunk);
+#endif
       stats->available += chunk->size;
     }
     stats->overhead += sizeof(chunk_t);
@@ -505,4 +690,7 @@ heapmem_stats(heapmem_stats_t *stats)
   stats->available += HEAPMEM_ARENA_SIZE - heap_usage;
   stats->footprint = heap_usage;
   stats->chunks = stats->overhead / sizeof(chunk_t);
+#if HEAPMEM_SEGREGATED
+  stats->coalesce_runs = coalesce_runs;
+#endif
 }
@@ -52,6 +52,14 @@
  * heapmem_realloc(), because the chunk structure immediately precedes
  * the memory of the chunk.
  *
+ * Optionally, the allocator can run in a segregated-fit mode, which
+ * is enabled by setting HEAPMEM_CONF_SEGREGATED to a non-zero value.
+ * In this mode, free chunks are kept in bins of power-of-two size
+ * classes, so that allocations and deallocations take a short,
+ * bounded time. A freed chunk is merged with the free chunks that
+ * follow it, and the coalescing of the whole heap is deferred until
+ * none of the free chunks can satisfy an allocation request.
+ *
  * \note This module does not contain a corresponding function to the
  *       standard C function calloc().
  *
@@ -74,14 +82,48 @@
 #ifndef HEAPMEM_H
 #define HEAPMEM_H
 
+#include "contiki.h"
+
 #include <stdlib.h>
 
+/* The HEAPMEM_CONF_SEGREGATED parameter enables the segregated-fit
+   mode, in which free chunks are kept in size-class bins. */
+#ifdef HEAPMEM_CONF_SEGREGATED
+#define HEAPMEM_SEGREGATED HEAPMEM_CONF_SEGREGATED
+#else
+#define HEAPMEM_SEGREGATED 0
+#endif /* HEAPMEM_CONF_SEGREGATED */
+
+/* The number of size-class bins used in the segregated-fit mode. */
+#ifdef HEAPMEM_CONF_BIN_COUNT
+#define HEAPMEM_BIN_COUNT HEAPMEM_CONF_BIN_COUNT
+#else
+#define HEAPMEM_BIN_COUNT 10
+#endif /* HEAPMEM_CONF_BIN_COUNT */
+
+/* The logarithm of the smallest size class in the segregated-fit
+   mode. The default value gives a smallest class of 8 bytes. */
+#ifdef HEAPMEM_CONF_BIN_MIN_SHIFT
+#define HEAPMEM_BIN_MIN_SHIFT HEAPMEM_CONF_BIN_MIN_SHIFT
+#else
+#define HEAPMEM_BIN_MIN_SHIFT 3
+#endif /* HEAPMEM_CONF_BIN_MIN_SHIFT */
+
 typedef struct heapmem_stats {
   size_t allocated;
   size_t overhead;
   size_t available;
   size_t footprint;
   size_t chunks;
+#if HEAPMEM_SEGREGATED
+  /* The free chunks and the free bytes in each size-class bin. */
+  struct {
+    size_t chunks;
+    size_t available;
+  } bins[HEAPMEM_BIN_COUNT];
+  /* The number of times that the deferred coalescing has run. */
+  unsigned long coalesce_runs;
+#endif /* HEAPMEM_SEGREGATED */
 } heapmem_stats_t;
 
 #if HEAPMEM_DEBUG
@@ -157,6 +199,10 @@ void heapmem_free(void *ptr);
  * and the number of chunks allocated. By using this information, developers
  * can tune their software to use the heapmem allocator more efficiently.
  *
+ * In the segregated-fit mode, the statistics also contain the number
+ * of free chunks and the amount of free memory in each size-class
+ * bin. A high number of small free chunks indicates fragmentation.
+ *
  */
 
 void heapmem_stats(heapmem_stats_t *stats);
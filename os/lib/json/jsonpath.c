@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Dispatch JSON values by their path in a single pass
+ */
+
+#include "jsonpath.h"
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+static int
+segment_matches(const struct jsonpath *path,
+                const struct jsonpath_segment *segment,
+                struct jsonstream_state *state, int index)
+{
+  if(index >= 0) {
+    return segment->index == JSONPATH_ANY_INDEX || segment->index == index;
+  }
+  if(segment->index == JSONPATH_ANY_NAME) {
+    return 1;
+  }
+  return segment->index == JSONPATH_NAME &&
+    !jsonstream_is_truncated(state) &&
+    jsonstream_get_len(state) == segment->len &&
+    memcmp(jsonstream_get_value(state), path->pattern + segment->offset,
+           segment->len) == 0;
+}
+/*--------------------------------------------------------------------*/
+/* A new member name or array element at a depth: paths that matched a
+   sibling match one segment less, and may now match the new one. */
+static void
+step(struct jsonpath_matcher *matcher, int depth, int index)
+{
+  struct jsonpath *path;
+
+  for(path = list_head(matcher->paths); path != NULL; path = path->next) {
+    if(path->matched >= depth) {
+      path->matched = depth - 1;
+    }
+    if(path->matched == depth - 1 && depth <= path->count &&
+       segment_matches(path, &path->segments[depth - 1], &matcher->stream,
+                       index)) {
+      path->matched = depth;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+dispatch(struct jsonpath_matcher *matcher, int depth, int type)
+{
+  struct jsonpath *path;
+
+  for(path = list_head(matcher->paths); path != NULL; path = path->next) {
+    if(type == '}' || type == ']') {
+      /* Leave the members of the container. */
+      if(path->matched > depth) {
+        path->matched = depth;
+      }
+    }
+    if(path->matched == depth && path->count == depth) {
+      path->callback(matcher, path, type);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+token(struct jsonstream_state *state, int type)
+{
+  struct jsonpath_matcher *matcher;
+  int depth;
+  int index;
+
+  matcher = state->ptr;
+  depth = jsonstream_get_depth(state);
+
+  if(type == JSON_TYPE_PAIR_NAME) {
+    step(matcher, depth, -1);
+    return;
+  }
+
+  if(type != '}' && type != ']') {
+    /* The start of a value, which is an element if it is in an array. */
+    index = jsonstream_get_index(state, depth);
+    if(index >= 0) {
+      step(matcher, depth, index);
+    }
+  }
+  dispatch(matcher, depth, type);
+}
+/*--------------------------------------------------------------------*/
+int
+jsonpath_compile(struct jsonpath *path, const char *pattern,
+                 jsonpath_callback_t callback)
+{
+  struct jsonpath_segment *segment;
+  size_t pos;
+  size_t start;
+  long index;
+
+  if(strlen(pattern) > 0xff) {
+    return -1;
+  }
+
+  path->next = NULL;
+  path->pattern = pattern;
+  path->callback = callback;
+  path->count = 0;
+  path->matched = 0;
+
+  pos = 0;
+  while(pattern[pos] != '\0') {
+    if(path->count == JSONPATH_MAX_SEGMENTS) {
+      return -1;
+    }
+    segment = &path->segments[path->count++];
+
+    if(pattern[pos] == '[') {
+      pos++;
+      if(pattern[pos] == '*') {
+        segment->index = JSONPATH_ANY_INDEX;
+        pos++;
+      } else {
+        for(index = 0, start = pos;
+            pattern[pos] >= '0' && pattern[pos] <= '9'; pos++) {
+          index = index * 10 + pattern[pos] - '0';
+          if(index > 0x7fff) {
+            return -1;
+          }
+        }
+        if(pos == start) {
+          return -1;
+        }
+        segment->index = index;
+      }
+      if(pattern[pos] != ']') {
+        return -1;
+      }
+      pos++;
+    } else {
+      for(start = pos; pattern[pos] != '\0' && pattern[pos] != '.' &&
+            pattern[pos] != '['; pos++);
+      if(pos == start) {
+        return -1;
+      }
+      segment->offset = start;
+      segment->len = pos - start;
+      segment->index = segment->len == 1 && pattern[start] == '*' ?
+        JSONPATH_ANY_NAME : JSONPATH_NAME;
+    }
+
+    /* A dot must be followed by a name. */
+    if(pattern[pos] == '.') {
+      pos++;
+      if(pattern[pos] == '\0' || pattern[pos] == '.' || pattern[pos] == '[') {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+/*--------------------------------------------------------------------*/
+void
+jsonpath_setup(struct jsonpath_matcher *matcher, void *ptr)
+{
+  LIST_STRUCT_INIT(matcher, paths);
+  matcher->ptr = ptr;
+  jsonstream_setup(&matcher->stream, token, matcher);
+}
+/*--------------------------------------------------------------------*/
+void
+jsonpath_add(struct jsonpath_matcher *matcher, struct jsonpath *path)
+{
+  path->matched = 0;
+  list_add(matcher->paths, path);
+}
+/*--------------------------------------------------------------------*/
+int
+jsonpath_feed(struct jsonpath_matcher *matcher, const char *data, int len)
+{
+  return jsonstream_feed(&matcher->stream, data, len);
+}
+/*--------------------------------------------------------------------*/
+int
+jsonpath_finish(struct jsonpath_matcher *matcher)
+{
+  return jsonstream_finish(&matcher->stream);
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Dispatch JSON values by their path in a single pass
+ *
+ * A path is compiled once from a pattern of member names and array
+ * indices, such as "bn", "e[*].n" or "sensors[0].value", where "*"
+ * matches any name or index and "[*]" alone matches the elements of
+ * a top-level array. The empty pattern matches the whole document.
+ *
+ * A matcher feeds the document to a jsonstream tokenizer, keeps track
+ * of how many leading segments of each path the current position
+ * matches, and calls the callback of a path for each value at that
+ * path. Objects and arrays at the path are reported twice: with their
+ * start token, and with '}' or ']' at their end. Atomic values are
+ * read with the jsonstream functions on the matcher's tokenizer state.
+ */
+
+#ifndef JSONPATH_H_
+#define JSONPATH_H_
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "jsonstream.h"
+
+#ifdef JSONPATH_CONF_MAX_SEGMENTS
+#define JSONPATH_MAX_SEGMENTS JSONPATH_CONF_MAX_SEGMENTS
+#else
+#define JSONPATH_MAX_SEGMENTS 4
+#endif /* JSONPATH_CONF_MAX_SEGMENTS */
+
+/* segment index values besides array indices */
+#define JSONPATH_NAME       -1
+#define JSONPATH_ANY_NAME   -2
+#define JSONPATH_ANY_INDEX  -3
+
+struct jsonpath_segment {
+  uint8_t offset;   /* Start of the name in the pattern */
+  uint8_t len;      /* Length of the name */
+  int16_t index;    /* Array index, or one of the values above */
+};
+
+struct jsonpath_matcher;
+struct jsonpath;
+
+typedef void (* jsonpath_callback_t)(struct jsonpath_matcher *matcher,
+                                     struct jsonpath *path, int type);
+
+struct jsonpath {
+  struct jsonpath *next;
+  const char *pattern;
+  jsonpath_callback_t callback;
+  uint8_t count;    /* Number of segments */
+  uint8_t matched;  /* Number of segments matched at the current depth */
+  struct jsonpath_segment segments[JSONPATH_MAX_SEGMENTS];
+};
+
+struct jsonpath_matcher {
+  struct jsonstream_state stream;
+  LIST_STRUCT(paths);
+  void *ptr;
+};
+
+/**
+ * \brief      Compile a path pattern.
+ * \param path A pointer to the path
+ * \param pattern The pattern, which must stay valid while the path is used
+ * \param callback The function to call for each value at the path
+ * \return     0 on success, -1 if the pattern is invalid or too long
+ */
+int jsonpath_compile(struct jsonpath *path, const char *pattern,
+                     jsonpath_callback_t callback);
+
+/**
+ * \brief      Initialize a matcher for a new document.
+ * \param matcher A pointer to the matcher
+ * \param ptr  A pointer that is kept in the matcher for the callbacks
+ */
+void jsonpath_setup(struct jsonpath_matcher *matcher, void *ptr);
+
+/* add a compiled path to a matcher */
+void jsonpath_add(struct jsonpath_matcher *matcher, struct jsonpath *path);
+
+/* feed a fragment of the document, see jsonstream_feed() */
+int jsonpath_feed(struct jsonpath_matcher *matcher, const char *data,
+                  int len);
+
+/* signal the end of the document, see jsonstream_finish() */
+int jsonpath_finish(struct jsonpath_matcher *matcher);
+
+#endif /* JSONPATH_H_ */
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Incremental, push-style JSON tokenizer
+ */
+
+#include "jsonstream.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  EXPECT_VALUE,
+  EXPECT_VALUE_OR_END,
+  EXPECT_NAME,
+  EXPECT_NAME_OR_END,
+  EXPECT_COLON,
+  EXPECT_COMMA_OR_END,
+  EXPECT_NOTHING
+};
+
+enum {
+  LEX_NONE,
+  LEX_STRING,
+  LEX_NUMBER,
+  LEX_LITERAL
+};
+
+/* Escape positions: after the backslash, and before each hex digit of
+   a \u sequence. */
+#define ESCAPE_NONE   0
+#define ESCAPE_START  1
+#define ESCAPE_HEX    2
+#define ESCAPE_END    6
+/*--------------------------------------------------------------------*/
+static void
+error(struct jsonstream_state *state, char code)
+{
+  if(state->error == JSON_ERROR_OK) {
+    state->error = code;
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+append(struct jsonstream_state *state, char c)
+{
+  if(state->vlen < JSONSTREAM_VALUE_SIZE - 1) {
+    state->value[state->vlen++] = c;
+  } else {
+    state->truncated = 1;
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+append_codepoint(struct jsonstream_state *state, uint16_t cp)
+{
+  if(cp < 0x80) {
+    append(state, cp);
+  } else if(cp < 0x800) {
+    append(state, 0xc0 | (cp >> 6));
+    append(state, 0x80 | (cp & 0x3f));
+  } else {
+    append(state, 0xe0 | (cp >> 12));
+    append(state, 0x80 | ((cp >> 6) & 0x3f));
+    append(state, 0x80 | (cp & 0x3f));
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+emit(struct jsonstream_state *state, char type)
+{
+  state->vtype = type;
+  state->value[state->vlen] = 0;
+  if(state->callback != NULL) {
+    state->callback(state, type);
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+end_value(struct jsonstream_state *state)
+{
+  state->expect = state->depth == 0 ? EXPECT_NOTHING : EXPECT_COMMA_OR_END;
+}
+/*--------------------------------------------------------------------*/
+static int
+expects_value(struct jsonstream_state *state)
+{
+  return state->expect == EXPECT_VALUE || state->expect == EXPECT_VALUE_OR_END;
+}
+/*--------------------------------------------------------------------*/
+static void
+start_token(struct jsonstream_state *state, uint8_t lexer, char type)
+{
+  state->lexer = lexer;
+  state->vtype = type;
+  state->escape = ESCAPE_NONE;
+  state->vlen = 0;
+  state->truncated = 0;
+}
+/*--------------------------------------------------------------------*/
+static void
+end_literal(struct jsonstream_state *state)
+{
+  const char *str;
+  char type;
+
+  state->lexer = LEX_NONE;
+  state->value[state->vlen] = 0;
+  switch(state->value[0]) {
+  case 'n': str = "null";  type = JSON_TYPE_NULL;  break;
+  case 't': str = "true";  type = JSON_TYPE_TRUE;  break;
+  default:  str = "false"; type = JSON_TYPE_FALSE; break;
+  }
+  if(state->truncated || strcmp(state->value, str) != 0) {
+    error(state, JSON_ERROR_SYNTAX);
+    return;
+  }
+  emit(state, type);
+  end_value(state);
+}
+/*--------------------------------------------------------------------*/
+static void
+end_number(struct jsonstream_state *state)
+{
+  state->lexer = LEX_NONE;
+  emit(state, JSON_TYPE_NUMBER);
+  end_value(state);
+}
+/*--------------------------------------------------------------------*/
+static void
+string_char(struct jsonstream_state *state, char c)
+{
+  uint8_t digit;
+
+  if(state->escape == ESCAPE_NONE) {
+    if(c == '"') {
+      state->lexer = LEX_NONE;
+      if(state->vtype == JSON_TYPE_PAIR_NAME) {
+        emit(state, JSON_TYPE_PAIR_NAME);
+        state->expect = EXPECT_COLON;
+      } else {
+        emit(state, JSON_TYPE_STRING);
+        end_value(state);
+      }
+    } else if(c == '\\') {
+      state->escape = ESCAPE_START;
+    } else if((unsigned char)c < ' ') {
+      error(state, JSON_ERROR_SYNTAX);
+    } else {
+      append(state, c);
+    }
+  } else if(state->escape == ESCAPE_START) {
+    state->escape = ESCAPE_NONE;
+    switch(c) {
+    case '"':  append(state, '"');  break;
+    case '\\': append(state, '\\'); break;
+    case '/':  append(state, '/');  break;
+    case 'b':  append(state, '\b'); break;
+    case 'f':  append(state, '\f'); break;
+    case 'n':  append(state, '\n'); break;
+    case 'r':  append(state, '\r'); break;
+    case 't':  append(state, '\t'); break;
+    case 'u':
+      state->escape = ESCAPE_HEX;
+      state->codepoint = 0;
+      break;
+    default:
+      error(state, JSON_ERROR_SYNTAX);
+    }
+  } else {
+    if(c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if(c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if(c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      error(state, JSON_ERROR_SYNTAX);
+      return;
+    }
+    state->codepoint = (state->codepoint << 4) | digit;
+    if(++state->escape == ESCAPE_END) {
+      state->escape = ESCAPE_NONE;
+      append_codepoint(state, state->codepoint);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static void
+open_container(struct jsonstream_state *state, char c)
+{
+  if(!expects_value(state)) {
+    error(state, c == '{' ? JSON_ERROR_UNEXPECTED_OBJECT :
+          JSON_ERROR_UNEXPECTED_ARRAY);
+    return;
+  }
+  if(state->depth >= JSONSTREAM_MAX_DEPTH) {
+    error(state, JSON_ERROR_SYNTAX);
+    return;
+  }
+  state->vlen = 0;
+  emit(state, c);
+  state->stack[state->depth] = c;
+  state->index[state->depth] = 0;
+  state->depth++;
+  state->expect = c == '{' ? EXPECT_NAME_OR_END : EXPECT_VALUE_OR_END;
+}
+/*--------------------------------------------------------------------*/
+static void
+close_container(struct jsonstream_state *state, char c)
+{
+  char open;
+  uint8_t allowed;
+
+  open = c == '}' ? '{' : '[';
+  allowed = c == '}' ? EXPECT_NAME_OR_END : EXPECT_VALUE_OR_END;
+  if(state->depth == 0 || state->stack[state->depth - 1] != open ||
+     (state->expect != allowed && state->expect != EXPECT_COMMA_OR_END)) {
+    error(state, c == '}' ? JSON_ERROR_UNEXPECTED_END_OF_OBJECT :
+          JSON_ERROR_UNEXPECTED_END_OF_ARRAY);
+    return;
+  }
+  state->depth--;
+  state->vlen = 0;
+  emit(state, c);
+  end_value(state);
+}
+/*--------------------------------------------------------------------*/
+static void
+structural_char(struct jsonstream_state *state, char c)
+{
+  switch(c) {
+  case ' ':
+  case '\t':
+  case '\n':
+  case '\r':
+    break;
+  case '{':
+  case '[':
+    open_container(state, c);
+    break;
+  case '}':
+  case ']':
+    close_container(state, c);
+    break;
+  case ':':
+    if(state->expect != EXPECT_COLON) {
+      error(state, JSON_ERROR_SYNTAX);
+    }
+    state->expect = EXPECT_VALUE;
+    break;
+  case ',':
+    if(state->expect != EXPECT_COMMA_OR_END) {
+      error(state, JSON_ERROR_SYNTAX);
+    } else if(state->stack[state->depth - 1] == '{') {
+      state->expect = EXPECT_NAME;
+    } else {
+      state->index[state->depth - 1]++;
+      state->expect = EXPECT_VALUE;
+    }
+    break;
+  case '"':
+    if(state->expect == EXPECT_NAME || state->expect == EXPECT_NAME_OR_END) {
+      start_token(state, LEX_STRING, JSON_TYPE_PAIR_NAME);
+    } else if(expects_value(state)) {
+      start_token(state, LEX_STRING, JSON_TYPE_STRING);
+    } else {
+      error(state, JSON_ERROR_UNEXPECTED_STRING);
+    }
+    break;
+  default:
+    if(!expects_value(state)) {
+      error(state, JSON_ERROR_SYNTAX);
+    } else if(c == '-' || (c >= '0' && c <= '9')) {
+      start_token(state, LEX_NUMBER, JSON_TYPE_NUMBER);
+      append(state, c);
+    } else if(c == 'n' || c == 't' || c == 'f') {
+      start_token(state, LEX_LITERAL, 0);
+      append(state, c);
+    } else {
+      error(state, JSON_ERROR_SYNTAX);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+void
+jsonstream_setup(struct jsonstream_state *state,
+                 jsonstream_callback_t callback, void *ptr)
+{
+  memset(state, 0, sizeof(*state));
+  state->callback = callback;
+  state->ptr = ptr;
+  state->expect = EXPECT_VALUE;
+  state->lexer = LEX_NONE;
+  state->error = JSON_ERROR_OK;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_feed(struct jsonstream_state *state, const char *data, int len)
+{
+  char c;
+  int i;
+
+  for(i = 0; i < len && state->error == JSON_ERROR_OK; i++) {
+    c = data[i];
+    switch(state->lexer) {
+    case LEX_STRING:
+      string_char(state, c);
+      continue;
+    case LEX_NUMBER:
+      if((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' ||
+         c == 'e' || c == 'E') {
+        append(state, c);
+        continue;
+      }
+      /* The character after the number is processed below. */
+      end_number(state);
+      break;
+    case LEX_LITERAL:
+      if(c >= 'a' && c <= 'z') {
+        append(state, c);
+        continue;
+      }
+      end_literal(state);
+      if(state->error != JSON_ERROR_OK) {
+        continue;
+      }
+      break;
+    }
+    structural_char(state, c);
+  }
+
+  return state->error;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_finish(struct jsonstream_state *state)
+{
+  if(state->error != JSON_ERROR_OK) {
+    return state->error;
+  }
+
+  if(state->lexer == LEX_NUMBER) {
+    end_number(state);
+  } else if(state->lexer == LEX_LITERAL) {
+    end_literal(state);
+  }
+
+  if(state->lexer != LEX_NONE || state->expect != EXPECT_NOTHING) {
+    error(state, JSON_ERROR_SYNTAX);
+  }
+  return state->error;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_get_depth(struct jsonstream_state *state)
+{
+  return state->depth;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_get_index(struct jsonstream_state *state, int depth)
+{
+  if(depth < 1 || depth > state->depth ||
+     state->stack[depth - 1] != JSON_TYPE_ARRAY) {
+    return -1;
+  }
+  return state->index[depth - 1];
+}
+/*--------------------------------------------------------------------*/
+const char *
+jsonstream_get_value(struct jsonstream_state *state)
+{
+  return state->value;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_get_len(struct jsonstream_state *state)
+{
+  return state->vlen;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonstream_is_truncated(struct jsonstream_state *state)
+{
+  return state->truncated;
+}
+/*--------------------------------------------------------------------*/
+long
+jsonstream_get_value_as_long(struct jsonstream_state *state)
+{
+  if(state->vtype != JSON_TYPE_NUMBER) {
+    return 0;
+  }
+  return atol(state->value);
+}
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Incremental, push-style JSON tokenizer
+ *
+ * The document is fed in fragments of any size, e.g., as TCP segments or
+ * CoAP blocks arrive, and a callback is called for each token. The
+ * tokenizer only keeps a fixed-size state: the open containers, the
+ * element index in each open array, and the current name or atomic
+ * value, which is unescaped into a buffer of JSONSTREAM_VALUE_SIZE
+ * bytes. Longer values are truncated.
+ *
+ * The callback receives the token type, which is one of the JSON_TYPE_
+ * values of json.h, or '}' and ']' at the end of an object or array.
+ * Member names are JSON_TYPE_PAIR_NAME tokens that precede the value.
+ * During the callback, jsonstream_get_depth() returns the depth of the
+ * token: the number of containers around it. Start and end tokens of a
+ * container have the depth of the container itself.
+ */
+
+#ifndef JSONSTREAM_H_
+#define JSONSTREAM_H_
+
+#include "contiki.h"
+#include "json.h"
+
+#ifdef JSONSTREAM_CONF_MAX_DEPTH
+#define JSONSTREAM_MAX_DEPTH JSONSTREAM_CONF_MAX_DEPTH
+#else
+#define JSONSTREAM_MAX_DEPTH 10
+#endif /* JSONSTREAM_CONF_MAX_DEPTH */
+
+#ifdef JSONSTREAM_CONF_VALUE_SIZE
+#define JSONSTREAM_VALUE_SIZE JSONSTREAM_CONF_VALUE_SIZE
+#else
+#define JSONSTREAM_VALUE_SIZE 32
+#endif /* JSONSTREAM_CONF_VALUE_SIZE */
+
+struct jsonstream_state;
+
+typedef void (* jsonstream_callback_t)(struct jsonstream_state *state,
+                                       int type);
+
+struct jsonstream_state {
+  jsonstream_callback_t callback;
+  void *ptr;
+  uint8_t depth;
+  uint8_t expect;     /* What the grammar allows next */
+  uint8_t lexer;      /* Whether the lexer is inside a token */
+  uint8_t escape;     /* Position in an escape sequence */
+  uint16_t codepoint; /* Code point of a \u escape sequence */
+  char vtype;
+  char error;
+  uint8_t truncated;
+  uint8_t vlen;
+  char value[JSONSTREAM_VALUE_SIZE];
+  char stack[JSONSTREAM_MAX_DEPTH];
+  uint16_t index[JSONSTREAM_MAX_DEPTH];
+};
+
+/**
+ * \brief      Initialize a JSON tokenizer state.
+ * \param state A pointer to a JSON tokenizer state
+ * \param callback The function to call for each token
+ * \param ptr  A pointer that is kept in the state for the callback
+ */
+void jsonstream_setup(struct jsonstream_state *state,
+                      jsonstream_callback_t callback, void *ptr);
+
+/**
+ * \brief      Feed a fragment of a JSON document to the tokenizer.
+ * \param state A pointer to a JSON tokenizer state
+ * \param data The fragment
+ * \param len  The length of the fragment
+ * \return     JSON_ERROR_OK, or the error found in the document
+ *
+ *             Tokens that are complete within the fragment are passed
+ *             to the callback before the function returns. After an
+ *             error, the rest of the document is ignored.
+ */
+int jsonstream_feed(struct jsonstream_state *state, const char *data,
+                    int len);
+
+/**
+ * \brief      Signal the end of a JSON document.
+ * \param state A pointer to a JSON tokenizer state
+ * \return     JSON_ERROR_OK if the document was complete, or an error
+ *
+ *             A number at the end of the document is only passed to the
+ *             callback at this point.
+ */
+int jsonstream_finish(struct jsonstream_state *state);
+
+/* get the depth of the current token */
+int jsonstream_get_depth(struct jsonstream_state *state);
+
+/* get the array index of the element at the specified depth, or -1 if
+   the element is a member of an object */
+int jsonstream_get_index(struct jsonstream_state *state, int depth);
+
+/* get the unescaped value of the current token */
+const char *jsonstream_get_value(struct jsonstream_state *state);
+
+/* get the length of the current value */
+int jsonstream_get_len(struct jsonstream_state *state);
+
+/* check whether the current value was longer than the value buffer */
+int jsonstream_is_truncated(struct jsonstream_state *state);
+
+/* get the current JSON value parsed as a long */
+long jsonstream_get_value_as_long(struct jsonstream_state *state);
+
+#endif /* JSONSTREAM_H_ */
@@ -50,6 +50,68 @@
 #define PRINTF(...)
 #endif
 
+#define CHUNK_OVERFLOW 0x01
+#define CHUNK_DONE     0x02
+
+/* The context being serialized by jsontree_print_chunk() */
+static struct jsontree_context *chunk_ctx;
+
+/*---------------------------------------------------------------------------*/
+static void
+chunk_write(const char *text, int len)
+{
+  struct jsontree_context *js_ctx = chunk_ctx;
+  int n;
+
+  /* Output of an interrupted step that already went into a chunk */
+  n = len < js_ctx->skip ? len : js_ctx->skip;
+  js_ctx->skip -= n;
+  js_ctx->delivered += n;
+  text += n;
+  len -= n;
+
+  /* Output before the requested offset */
+  n = len < js_ctx->seek ? len : js_ctx->seek;
+  js_ctx->seek -= n;
+  js_ctx->delivered += n;
+  js_ctx->offset += n;
+  text += n;
+  len -= n;
+
+  n = js_ctx->chunk_size - js_ctx->chunk_len;
+  if(len < n) {
+    n = len;
+  }
+  memcpy(js_ctx->chunk + js_ctx->chunk_len, text, n);
+  js_ctx->chunk_len += n;
+  js_ctx->delivered += n;
+  js_ctx->offset += n;
+
+  if(len > n) {
+    js_ctx->chunk_flags |= CHUNK_OVERFLOW;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+chunk_putchar(int c)
+{
+  char ch = c;
+
+  chunk_write(&ch, 1);
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_text(const struct jsontree_context *js_ctx, const char *text, int len)
+{
+  if(js_ctx->putchar == chunk_putchar) {
+    chunk_write(text, len);
+  } else {
+    while(len-- > 0) {
+      js_ctx->putchar(*text++);
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
@@ -57,22 +119,25 @@ jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
   if(text == NULL) {
     js_ctx->putchar('0');
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    write_text(js_ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
+  int len;
+
   js_ctx->putchar('"');
   if(text != NULL) {
     while(*text != '\0') {
+      for(len = 0; text[len] != '\0' && text[len] != '"'; len++);
+      write_text(js_ctx, text, len);
+      text += len;
       if(*text == '"') {
-        js_ctx->putchar('\\');
+        write_text(js_ctx, "\\\"", 2);
+        text++;
       }
-      js_ctx->putchar(*text++);
     }
   }
   js_ctx->putchar('"');
@@ -90,9 +155,8 @@ jsontree_write_uint(const struct jsontree_context *js_ctx, unsigned int value)
     value /= 10;
   } while(value > 0 && l >= 0);
 
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  l++;
+  write_text(js_ctx, &buf[l], sizeof(buf) - l);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -275,6 +339,83 @@ jsontree_print_next(struct jsontree_context *js_ctx)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static void
+chunk_restart(struct jsontree_context *js_ctx)
+{
+  jsontree_reset(js_ctx);
+  js_ctx->resume = 0;
+  js_ctx->chunk_flags = 0;
+  js_ctx->offset = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_setup_chunked(struct jsontree_context *js_ctx,
+                       struct jsontree_value *root)
+{
+  jsontree_setup(js_ctx, root, chunk_putchar);
+  chunk_restart(js_ctx);
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_print_chunk(struct jsontree_context *js_ctx, char *buf, int size,
+                     uint32_t offset)
+{
+  uint8_t depth;
+  uint16_t index;
+  uint16_t parent_index;
+  int callback_state;
+  int more;
+
+  if(offset < js_ctx->offset) {
+    chunk_restart(js_ctx);
+  }
+  js_ctx->seek = offset - js_ctx->offset;
+  js_ctx->chunk = buf;
+  js_ctx->chunk_size = size;
+  js_ctx->chunk_len = 0;
+  chunk_ctx = js_ctx;
+
+  while(!(js_ctx->chunk_flags & CHUNK_DONE)) {
+    /* Save what a step may change, in case its output does not fit */
+    depth = js_ctx->depth;
+    index = js_ctx->index[depth];
+    parent_index = depth > 0 ? js_ctx->index[depth - 1] : 0;
+    callback_state = js_ctx->callback_state;
+
+    js_ctx->skip = js_ctx->resume;
+    js_ctx->delivered = 0;
+    js_ctx->chunk_flags &= ~CHUNK_OVERFLOW;
+
+    more = jsontree_print_next(js_ctx);
+
+    if(js_ctx->chunk_flags & CHUNK_OVERFLOW) {
+      /* Chunk full: redo the step for the next chunk, skipping the
+         output already delivered */
+      js_ctx->depth = depth;
+      js_ctx->index[depth] = index;
+      if(depth > 0) {
+        js_ctx->index[depth - 1] = parent_index;
+      }
+      js_ctx->callback_state = callback_state;
+      js_ctx->resume = js_ctx->delivered;
+      break;
+    }
+    js_ctx->resume = 0;
+    if(!more) {
+      js_ctx->chunk_flags |= CHUNK_DONE;
+    }
+  }
+
+  chunk_ctx = NULL;
+  return js_ctx->chunk_len;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_print_done(const struct jsontree_context *js_ctx)
+{
+  return (js_ctx->chunk_flags & CHUNK_DONE) != 0;
+}
+/*---------------------------------------------------------------------------*/
 static struct jsontree_value *
 find_next(struct jsontree_context *js_ctx)
 {
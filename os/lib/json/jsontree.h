@@ -62,6 +62,16 @@ struct jsontree_context {
   uint8_t depth;
   uint8_t path;
   int callback_state;
+  /* chunked output, see jsontree_print_chunk() */
+  char *chunk;
+  uint16_t chunk_size;
+  uint16_t chunk_len;
+  uint16_t resume;      /* bytes of an interrupted step already output */
+  uint16_t skip;        /* bytes of the current step to skip */
+  uint16_t delivered;   /* bytes of the current step output so far */
+  uint8_t chunk_flags;
+  uint32_t offset;      /* bytes output since the start */
+  uint32_t seek;        /* bytes to skip to reach the requested offset */
 };
 
 struct jsontree_value {
@@ -154,6 +164,40 @@ void jsontree_write_atom(const struct jsontree_context *js_ctx,
 void jsontree_write_string(const struct jsontree_context *js_ctx,
                            const char *text);
 int jsontree_print_next(struct jsontree_context *js_ctx);
+
+/**
+ * \brief      Set up a JSON tree for output into caller-provided chunks.
+ * \param js_ctx A pointer to a JSON tree context
+ * \param root The root of the JSON tree
+ */
+void jsontree_setup_chunked(struct jsontree_context *js_ctx,
+                            struct jsontree_value *root);
+
+/**
+ * \brief      Serialize the next chunk of a JSON tree into a buffer.
+ * \param js_ctx A pointer to a JSON tree context set up for chunks
+ * \param buf  The buffer
+ * \param size The size of the buffer
+ * \param offset The offset in the output of the first byte to write
+ * \return     The number of bytes written
+ *
+ *             The serialization resumes where the previous chunk ended,
+ *             so consecutive chunks cost as much as the output they hold.
+ *             An offset after the end of the previous chunk skips the
+ *             output in between, and an earlier offset restarts the
+ *             serialization from the root, e.g., when a CoAP block is
+ *             requested again.
+ *
+ *             Output that does not fit into the buffer is generated
+ *             again for the next chunk, so callbacks must produce the
+ *             same output when called with the same callback_state.
+ */
+int jsontree_print_chunk(struct jsontree_context *js_ctx, char *buf,
+                         int size, uint32_t offset);
+
+/* check whether the whole JSON tree has been serialized into chunks */
+int jsontree_print_done(const struct jsontree_context *js_ctx);
+
 struct jsontree_value *jsontree_find_next(struct jsontree_context *js_ctx,
                                           int type);
 
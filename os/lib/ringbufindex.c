@@ -44,6 +44,18 @@
 
 #include <string.h>
 #include "lib/ringbufindex.h"
+#include "sys/memory-barrier.h"
+
+/*
+ * The ring is lock-free for one producer (put side) and one consumer (get
+ * side), typically a process and an interrupt handler. The producer writes
+ * the element at ringbufindex_peek_put() before publishing it with
+ * ringbufindex_put(); the consumer reads the element at
+ * ringbufindex_peek_get() before releasing it with ringbufindex_get().
+ * Each side only writes its own pointer, and the fences below order the
+ * element accesses against the pointer updates: an element is never seen
+ * before it is written, nor overwritten before it is read.
+ */
 
 /* Initialize a ring buffer. The size must be a power of two */
 void
@@ -60,15 +72,14 @@ ringbufindex_put(struct ringbufindex *r)
   /* Check if buffer is full. If it is full, return 0 to indicate that
      the element was not inserted.
 
-     XXX: there is a potential risk for a race condition here, because
-     the ->get_ptr field may be written concurrently by the
-     ringbufindex_get() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
+     Access to ->get_ptr, written concurrently by ringbufindex_get(), is
+     atomic as it is an uint8_t.
    */
   if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
     return 0;
   }
+  /* Complete the element writes before publishing the element */
+  memory_barrier();
   r->put_ptr = (r->put_ptr + 1) & r->mask;
   return 1;
 }
@@ -83,6 +94,8 @@ ringbufindex_peek_put(const struct ringbufindex *r)
   if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
     return -1;
   }
+  /* The consumer is done with the slot: do not write it any earlier */
+  memory_barrier();
   return r->put_ptr;
 }
 /* Remove the first element and return its index */
@@ -95,14 +108,15 @@ ringbufindex_get(struct ringbufindex *r)
      first one and increase the pointer. If there are no bytes left, we
      return -1.
 
-     XXX: there is a potential risk for a race condition here, because
-     the ->put_ptr field may be written concurrently by the
-     ringbufindex_put() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
+     Access to ->put_ptr, written concurrently by ringbufindex_put(), is
+     atomic as it is an uint8_t. The element must have been read (through
+     ringbufindex_peek_get()) before calling this function, as the slot
+     may be reused as soon as the pointer moves.
    */
   if(((r->put_ptr - r->get_ptr) & r->mask) > 0) {
     get_ptr = r->get_ptr;
+    /* Complete the element reads before releasing the slot */
+    memory_barrier();
     r->get_ptr = (r->get_ptr + 1) & r->mask;
     return get_ptr;
   } else {
@@ -118,6 +132,8 @@ ringbufindex_peek_get(const struct ringbufindex *r)
      first one. If there are no bytes left, we return -1.
    */
   if(((r->put_ptr - r->get_ptr) & r->mask) > 0) {
+    /* The element was published: do not read it any earlier */
+    memory_barrier();
     return r->get_ptr;
   } else {
     return -1;
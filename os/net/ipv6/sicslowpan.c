@@ -73,6 +73,8 @@
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+/* For CSMA_WITH_AGGREGATION */
+#include "net/mac/csma/csma.h"
 
 #include "net/routing/routing.h"
 
@@ -212,6 +214,11 @@ static uint16_t my_tag;
 #define SICSLOWPAN_FRAGMENT_BUFFERS 12
 #endif
 
+/* Fragment buffers are chained by their 8-bit index */
+#if SICSLOWPAN_FRAGMENT_BUFFERS > 255
+#error "SICSLOWPAN_CONF_FRAGMENT_BUFFERS must be at most 255"
+#endif
+
 /* REASS_CONTEXTS corresponds to the number of simultaneous
  * reassemblies that can be made. NOTE: the first buffer for each
  * reassembly is stored in the context since it can be larger than the
@@ -234,6 +241,94 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* SICSLOWPAN_CONF_FRAG_RECOVERY enables 6LoWPAN Selective Fragment
+ * Recovery (RFC 8931). Datagrams are then sent as RFRAG fragments and
+ * the receiver acknowledges them with a bitmap, so that only missing
+ * fragments are retransmitted. Both ends must enable it. Reception of
+ * RFC 4944 fragments is always supported. */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY
+#define SICSLOWPAN_FRAG_RECOVERY SICSLOWPAN_CONF_FRAG_RECOVERY
+#else
+#define SICSLOWPAN_FRAG_RECOVERY 0
+#endif
+
+#if SICSLOWPAN_FRAG_RECOVERY
+/* The number of datagrams that can await acknowledgment at a time.
+ * Further datagrams are sent with RFC 4944 fragmentation. */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY_CONTEXTS
+#define SICSLOWPAN_FRAG_RECOVERY_CONTEXTS SICSLOWPAN_CONF_FRAG_RECOVERY_CONTEXTS
+#else
+#define SICSLOWPAN_FRAG_RECOVERY_CONTEXTS 1
+#endif
+
+/* The size of the buffer that keeps a compressed datagram for
+ * retransmission. Larger datagrams are sent with RFC 4944
+ * fragmentation. */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY_BUFFER_SIZE
+#define SICSLOWPAN_FRAG_RECOVERY_BUFFER_SIZE SICSLOWPAN_CONF_FRAG_RECOVERY_BUFFER_SIZE
+#else
+#define SICSLOWPAN_FRAG_RECOVERY_BUFFER_SIZE 640
+#endif
+
+/* The time to wait for an RFRAG-ACK before the last fragment is sent
+ * again with an acknowledgment request */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY_ACK_TIMEOUT
+#define SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT SICSLOWPAN_CONF_FRAG_RECOVERY_ACK_TIMEOUT
+#else
+#define SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT (4 * CLOCK_SECOND)
+#endif
+
+/* The number of times fragments are retransmitted before the datagram
+ * is dropped */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY_RETRIES
+#define SICSLOWPAN_FRAG_RECOVERY_RETRIES SICSLOWPAN_CONF_FRAG_RECOVERY_RETRIES
+#else
+#define SICSLOWPAN_FRAG_RECOVERY_RETRIES 3
+#endif
+
+/* The RFRAG sequence number has five bits */
+#define RFRAG_MAX_FRAGMENTS     32
+#define RFRAG_ACK_REQUEST       0x8000
+#define RFRAG_BITMAP_NULL       0x00000000UL
+#define RFRAG_BITMAP_FULL       0xffffffffUL
+#define RFRAG_BIT(seq)          (0x80000000UL >> (seq))
+/* The bits of the first count fragments. A shift by the width of the
+   bitmap is undefined, hence the full window is a special case. */
+#define RFRAG_WINDOW(count)                                             \
+  ((count) >= RFRAG_MAX_FRAGMENTS ? RFRAG_BITMAP_FULL :                 \
+   (uint32_t)~(RFRAG_BITMAP_FULL >> (count)))
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+/* SICSLOWPAN_CONF_FRAG_FORWARDING enables fragment forwarding with
+ * virtual reassembly buffers (RFC 8930). A router then forwards each
+ * RFC 4944 fragment of a transiting datagram as soon as it arrives,
+ * instead of reassembling the whole datagram first. Only the first
+ * fragment goes through the IP layer; the next hop it selects and a new
+ * tag are kept in a switching table for the remaining fragments. */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* The number of datagrams that can be forwarded at a time. Further
+ * datagrams are reassembled before they are forwarded. */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
+/* Reassembly context flags */
+#define FRAG_INFO_IN_USE        0x01
+#define FRAG_INFO_HAVE_FIRST    0x02
+#define FRAG_INFO_RFRAG         0x04
+
+/* End of a chain of fragment buffers */
+#define FRAG_BUF_NONE           0xff
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -242,12 +337,23 @@ struct sicslowpan_frag_info {
   linkaddr_t receiver;
   /** When reassembling, the tag in the fragments being merged. */
   uint16_t tag;
-  /** Total length of the fragmented packet */
+  /** Total length of the fragmented packet, 0 until known */
   uint16_t len;
   /** Current length of reassembled fragments */
   uint16_t reassembled_len;
   /** Reassembly %process %timer. */
   struct timer reass_timer;
+  /** FRAG_INFO_ flags of the context */
+  uint8_t flags;
+  /** The first of the fragment buffers of this context */
+  uint8_t frag_bufs;
+#if SICSLOWPAN_FRAG_RECOVERY
+  /** The RFRAG sequence numbers received so far */
+  uint32_t bitmap;
+  /** Growth of the first fragment by header decompression. RFRAG
+      offsets refer to the compressed datagram. */
+  int16_t offset_shift;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 
   /** Fragment size of first fragment */
   uint16_t first_frag_len;
@@ -259,30 +365,107 @@ struct sicslowpan_frag_info {
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
 struct sicslowpan_frag_buf {
-  /* the index of the frag_info */
-  uint8_t index;
-  /* Fragment offset */
-  uint8_t offset;
-  /* Length of this fragment (if zero this buffer is not allocated) */
+  /* The next buffer of the same context, or of the free list */
+  uint8_t next;
+  /* Length of this fragment */
   uint8_t len;
+  /* Fragment offset in bytes */
+  uint16_t offset;
   uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
 };
 
 static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
+static uint8_t free_frag_bufs;
+
+#if SICSLOWPAN_FRAG_RECOVERY
+/* The last datagram that was reassembled from RFRAGs, so that late
+   acknowledgment requests for it can still be answered */
+static struct {
+  linkaddr_t sender;
+  uint16_t tag;
+  struct timer timer;
+} rfrag_done;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* Virtual reassembly buffer states */
+#define VRB_FREE                0
+/* The first fragment is being forwarded through the IP layer */
+#define VRB_PENDING             1
+/* The first fragment could not be forwarded on its own, the datagram
+   is reassembled instead */
+#define VRB_REASSEMBLE          2
+/* The fragments are forwarded to the next hop */
+#define VRB_FORWARDING          3
+/* The IP layer dropped the datagram, so are its fragments */
+#define VRB_DISCARD             4
+
+/* An entry of the fragment switching table */
+struct sicslowpan_vrb {
+  /** The previous hop and the tag it sends the fragments with */
+  linkaddr_t sender;
+  uint16_t tag;
+  /** The next hop and the tag the fragments are forwarded with */
+  linkaddr_t next_hop;
+  uint16_t out_tag;
+  /** Size of the uncompressed datagram */
+  uint16_t size;
+  /** Number of bytes of the datagram received so far */
+  uint16_t received;
+  /** Expiration of the entry, refreshed by each fragment */
+  struct timer timer;
+  /** Attributes of the first fragment, for the following ones */
+  uint8_t max_mac_transmissions;
+#if LLSEC802154_USES_AUX_HEADER
+  uint8_t security_level;
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  uint8_t key_index;
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_USES_AUX_HEADER */
+  /** VRB_ state of the entry */
+  uint8_t state;
+};
+
+static struct sicslowpan_vrb vrb[SICSLOWPAN_VRB_ENTRIES];
+/* The entry whose first fragment is in uip_buf, on its way through
+   the IP layer, and the IPv6 header of that fragment as received */
+static struct sicslowpan_vrb *vrb_pending;
+static const struct uip_ip_hdr *vrb_pending_ip;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 
+/*---------------------------------------------------------------------------*/
+static void
+init_fragments(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    frag_info[i].flags = 0;
+    frag_info[i].frag_bufs = FRAG_BUF_NONE;
+  }
+  /* Initially, all buffers are in the free list */
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    frag_buf[i].next = i + 1 < SICSLOWPAN_FRAGMENT_BUFFERS ? i + 1 : FRAG_BUF_NONE;
+  }
+  free_frag_bufs = SICSLOWPAN_FRAGMENT_BUFFERS > 0 ? 0 : FRAG_BUF_NONE;
+}
 /*---------------------------------------------------------------------------*/
 static int
 clear_fragments(uint8_t frag_info_index)
 {
-  int i, clear_count;
+  int clear_count;
+  uint8_t i;
+  struct sicslowpan_frag_info *info = &frag_info[frag_info_index];
+
   clear_count = 0;
-  frag_info[frag_info_index].len = 0;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
-      /* deallocate the buffer */
-      frag_buf[i].len = 0;
-      clear_count++;
-    }
+  info->flags = 0;
+  /* Return the chain of buffers of this context to the free list */
+  while(info->frag_bufs != FRAG_BUF_NONE) {
+    i = info->frag_bufs;
+    info->frag_bufs = frag_buf[i].next;
+    frag_buf[i].next = free_frag_bufs;
+    free_frag_bufs = i;
+    clear_count++;
   }
   return clear_count;
 }
@@ -293,7 +476,7 @@ timeout_fragments(int not_context)
   int i;
   int count = 0;
   for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].len > 0 && i != not_context &&
+    if((frag_info[i].flags & FRAG_INFO_IN_USE) && i != not_context &&
        timer_expired(&frag_info[i].reass_timer)) {
       /* This context can be freed */
       count += clear_fragments(i);
@@ -303,116 +486,150 @@ timeout_fragments(int not_context)
 }
 /*---------------------------------------------------------------------------*/
 static int
-store_fragment(uint8_t index, uint8_t offset)
+store_fragment(uint8_t index, uint16_t offset)
 {
-  int i;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len == 0) {
-      /* copy over the data from packetbuf into the fragment buffer and store offset and len */
-      frag_buf[i].offset = offset; /* frag offset */
-      frag_buf[i].len = packetbuf_datalen() - packetbuf_hdr_len;
-      frag_buf[i].index = index;
-      memcpy(frag_buf[i].data, packetbuf_ptr + packetbuf_hdr_len,
-             packetbuf_datalen() - packetbuf_hdr_len);
-      /* return the length of the stored fragment */
-      return frag_buf[i].len;
-    }
+  uint8_t i;
+  uint16_t len;
+
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(len == 0 || len > SICSLOWPAN_FRAGMENT_SIZE) {
+    return -1;
+  }
+
+  i = free_frag_bufs;
+  if(i == FRAG_BUF_NONE) {
+    /* failed */
+    return -1;
   }
-  /* failed */
-  return -1;
+  free_frag_bufs = frag_buf[i].next;
+
+  /* copy over the data from packetbuf into the fragment buffer and store offset and len */
+  frag_buf[i].offset = offset;
+  frag_buf[i].len = len;
+  memcpy(frag_buf[i].data, packetbuf_ptr + packetbuf_hdr_len, len);
+  frag_buf[i].next = frag_info[index].frag_bufs;
+  frag_info[index].frag_bufs = i;
+  /* return the length of the stored fragment */
+  return len;
 }
 /*---------------------------------------------------------------------------*/
-/* add a new fragment to the buffer */
+/* Find the reassembly context of a datagram, or allocate a new one.
+   Fragments may arrive in any order, so a context is created by
+   whichever fragment of the datagram arrives first. */
 static int8_t
-add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
+get_context(uint16_t tag, uint8_t rfrag)
 {
   int i;
-  int len;
   int8_t found = -1;
 
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
-    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-      /* clear all fragment info with expired timer to free all fragment buffers */
-      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
-        clear_fragments(i);
-      }
-
-      /* We use len as indication on used or not used */
-      if(found < 0 && frag_info[i].len == 0) {
-        /* We remember the first free fragment info but must continue
-           the loop to free any other expired fragment buffers. */
-        found = i;
-      }
-    }
-
-    if(found < 0) {
-      LOG_WARN("reassembly: failed to store new fragment session - tag: %d\n", tag);
-      return -1;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if((frag_info[i].flags & FRAG_INFO_IN_USE) &&
+       frag_info[i].tag == tag &&
+       (frag_info[i].flags & FRAG_INFO_RFRAG) == rfrag &&
+       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      /* Tag and Sender match - this must be the correct info to store in */
+      return i;
     }
-
-    /* Found a free fragment info to store data in */
-    frag_info[found].len = frag_size;
-    frag_info[found].tag = tag;
-    linkaddr_copy(&frag_info[found].sender,
-                  packetbuf_addr(PACKETBUF_ADDR_SENDER));
-    timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-    /* first fragment can not be stored immediately but is moved into
-       the buffer while uncompressing */
-    return found;
   }
 
-  /* This is a N-fragment - should find the info */
   for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-      /* Tag and Sender match - this must be the correct info to store in */
+    /* clear all fragment info with expired timer to free all fragment buffers */
+    if((frag_info[i].flags & FRAG_INFO_IN_USE) &&
+       timer_expired(&frag_info[i].reass_timer)) {
+      clear_fragments(i);
+    }
+
+    if(found < 0 && !(frag_info[i].flags & FRAG_INFO_IN_USE)) {
+      /* We remember the first free fragment info but must continue
+         the loop to free any other expired fragment buffers. */
       found = i;
-      break;
     }
   }
 
   if(found < 0) {
-    /* no entry found for storing the new fragment */
-    LOG_WARN("reassembly: failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
+    LOG_WARN("reassembly: failed to store new fragment session - tag: %d\n", tag);
     return -1;
   }
 
-  /* i is the index of the reassembly context */
-  len = store_fragment(i, offset);
-  if(len < 0 && timeout_fragments(i) > 0) {
-    len = store_fragment(i, offset);
+  /* Found a free fragment info to store data in */
+  frag_info[found].flags = FRAG_INFO_IN_USE | rfrag;
+  frag_info[found].len = 0;
+  frag_info[found].reassembled_len = 0;
+  frag_info[found].first_frag_len = 0;
+  frag_info[found].tag = tag;
+#if SICSLOWPAN_FRAG_RECOVERY
+  frag_info[found].bitmap = 0;
+  frag_info[found].offset_shift = 0;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+  linkaddr_copy(&frag_info[found].sender,
+                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+/* add a non-first fragment to the buffer of a context */
+static int
+add_fragment(int8_t context, uint16_t offset)
+{
+  uint8_t i;
+  int len;
+
+  /* Drop duplicates, as they would be counted twice */
+  for(i = frag_info[context].frag_bufs; i != FRAG_BUF_NONE; i = frag_buf[i].next) {
+    if(frag_buf[i].offset == offset) {
+      LOG_WARN("reassembly: duplicate fragment - tag: %d offset: %d\n",
+               frag_info[context].tag, offset);
+      return -1;
+    }
+  }
+
+  len = store_fragment(context, offset);
+  if(len < 0 && timeout_fragments(context) > 0) {
+    len = store_fragment(context, offset);
   }
   if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
+    frag_info[context].reassembled_len += len;
+    return len;
   } else {
     /* should we also clear all fragments since we failed to store
        this fragment? */
-    LOG_WARN("reassembly: failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
+    LOG_WARN("reassembly: failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[context].tag);
     return -1;
   }
 }
 /*---------------------------------------------------------------------------*/
 /* Copy all the fragments that are associated with a specific context
    into uip */
-static void
+static int
 copy_frags2uip(int context)
 {
-  int i;
+  uint8_t i;
+  int offset;
+  int shift = 0;
+
+#if SICSLOWPAN_FRAG_RECOVERY
+  shift = frag_info[context].offset_shift;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 
   /* Copy from the fragment context info buffer first */
   memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
          frag_info[context].first_frag_len);
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    /* And also copy all matching fragments */
-    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
-      memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[i].offset << 3),
-             (uint8_t *)frag_buf[i].data, frag_buf[i].len);
+  /* And also copy all fragments of the context */
+  for(i = frag_info[context].frag_bufs; i != FRAG_BUF_NONE; i = frag_buf[i].next) {
+    offset = frag_buf[i].offset + shift;
+    if(offset < frag_info[context].first_frag_len ||
+       offset + frag_buf[i].len > sizeof(uip_buf)) {
+      LOG_ERR("reassembly: fragment out of bounds - tag: %d offset: %d\n",
+              frag_info[context].tag, offset);
+      clear_fragments(context);
+      return 0;
     }
+    memcpy((uint8_t *)UIP_IP_BUF + offset,
+           (uint8_t *)frag_buf[i].data, frag_buf[i].len);
   }
   /* deallocate all the fragments for this context */
   clear_fragments(context);
+  return 1;
 }
 #endif /* SICSLOWPAN_CONF_FRAG */
 
@@ -1482,26 +1699,27 @@ send_packet(linkaddr_t *dest)
  */
 static int
 fragment_copy_payload_and_send(uint16_t uip_offset, linkaddr_t *dest) {
-  struct queuebuf *q;
+  /* Attributes of the fragment, which the MAC layer may modify */
+  static struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  static struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
 
   /* Now copy fragment payload from uip_buf */
   memcpy(packetbuf_ptr + packetbuf_hdr_len,
          (uint8_t *)UIP_IP_BUF + uip_offset, packetbuf_payload_len);
   packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
 
-  /* Backup packetbuf to queuebuf. Enables preserving attributes for all framgnets */
-  q = queuebuf_new_from_packetbuf();
-  if(q == NULL) {
-    LOG_WARN("output: could not allocate queuebuf, dropping fragment\n");
-    return 0;
-  }
+  /* Only the attributes must be preserved for all fragments. The
+     payload of each fragment is copied from uip_buf, and the FRAGN
+     header is rewritten for each fragment. */
+  packetbuf_attr_copyto(attrs, addrs);
 
   /* Send fragment */
   send_packet(dest);
 
-  /* Restore packetbuf from queuebuf */
-  queuebuf_to_packetbuf(q);
-  queuebuf_free(q);
+  /* Reset packetbuf for the next fragment */
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(attrs, addrs);
+  packetbuf_ptr = packetbuf_dataptr();
 
   /* Check tx result. */
   if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1512,6 +1730,493 @@ fragment_copy_payload_and_send(uint16_t uip_offset, linkaddr_t *dest) {
   }
   return 1;
 }
+#if SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/* Find the switching table entry of a datagram being forwarded */
+static struct sicslowpan_vrb *
+vrb_lookup(uint16_t tag)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].state >= VRB_FORWARDING &&
+       !timer_expired(&vrb[i].timer) &&
+       vrb[i].tag == tag &&
+       linkaddr_cmp(&vrb[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      return &vrb[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a non-first fragment of a datagram to its next hop.
+ * \param v the switching table entry of the datagram
+ * \param offset the offset of the fragment in the datagram, in bytes
+ * \param data the payload of the fragment, which may be in packetbuf
+ * \param len the length of the payload
+ */
+static void
+vrb_send_fragment(struct sicslowpan_vrb *v, uint16_t offset,
+                  const uint8_t *data, uint8_t len)
+{
+  uint8_t discard = v->state == VRB_DISCARD;
+
+  v->received += len;
+  timer_restart(&v->timer);
+  if(v->received >= v->size) {
+    /* This completes the datagram */
+    v->state = VRB_FREE;
+  }
+  if(discard) {
+    return;
+  }
+  if(queuebuf_numfree() == 0) {
+    LOG_WARN("forward: dropping fragment, no free queuebuf (tag %d)\n",
+             v->tag);
+    return;
+  }
+
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  /* The payload moves towards the start of packetbuf, if it is there */
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN, data, len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAGN << 8) | v->size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = offset >> 3;
+  packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + len);
+
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     v->max_mac_transmissions);
+#if LLSEC802154_USES_AUX_HEADER
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, v->security_level);
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, v->key_index);
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_USES_AUX_HEADER */
+
+  LOG_INFO("forward: fragment (tag %d -> %d, payload %d, offset %d)\n",
+           v->tag, v->out_tag, len, offset);
+  send_packet(&v->next_hop);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Send the first fragment of a datagram that is forwarded
+ * fragment by fragment. Called by output() with the first fragment in
+ * uip_buf, after the IP layer has processed it and selected the next
+ * hop. The fragment carries the same part of the datagram as the
+ * received one, so that the offsets of the following fragments stay
+ * valid.
+ * \param dest the next hop
+ * \return 1 if the fragment was sent, 0 otherwise
+ */
+static int
+vrb_output(linkaddr_t *dest)
+{
+  struct sicslowpan_vrb *v = vrb_pending;
+  struct sicslowpan_frag_info *info = NULL;
+  int i;
+
+  vrb_pending = NULL;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if((frag_info[i].flags & FRAG_INFO_IN_USE) &&
+       !(frag_info[i].flags & FRAG_INFO_RFRAG) &&
+       frag_info[i].tag == v->tag &&
+       linkaddr_cmp(&frag_info[i].sender, &v->sender)) {
+      info = &frag_info[i];
+      break;
+    }
+  }
+
+  /* The headers must not have grown beyond the first fragment, and
+     the first fragment must still fit a frame */
+  if(info == NULL || uncomp_hdr_len > info->first_frag_len ||
+     packetbuf_hdr_len + SICSLOWPAN_FRAG1_HDR_LEN +
+     info->first_frag_len - uncomp_hdr_len > mac_max_payload ||
+     queuebuf_numfree() == 0) {
+    LOG_INFO("forward: first fragment does not fit, reassembling (tag %d)\n",
+             v->tag);
+    v->state = VRB_REASSEMBLE;
+    return 0;
+  }
+
+  last_tx_status = MAC_TX_OK;
+  v->out_tag = my_tag++;
+
+  /* Move IPHC/IPv6 header to make room for FRAG1 header */
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+  packetbuf_payload_len = info->first_frag_len - uncomp_hdr_len;
+
+  linkaddr_copy(&v->next_hop, dest);
+  v->max_mac_transmissions = packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
+#if LLSEC802154_USES_AUX_HEADER
+  v->security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  v->key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_USES_AUX_HEADER */
+
+  LOG_INFO("forward: first fragment (tag %d -> %d, payload %d)\n",
+           v->tag, v->out_tag, packetbuf_payload_len);
+  if(fragment_copy_payload_and_send(uncomp_hdr_len, dest) == 0) {
+    v->state = VRB_DISCARD;
+    return 0;
+  }
+  v->state = VRB_FORWARDING;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Try to forward a datagram fragment by fragment, after its
+ * first fragment was received.
+ * \param context the reassembly context that holds the first fragment
+ * \return 1 if the datagram is taken care of, 0 if it must be reassembled
+ */
+static int
+vrb_forward(int8_t context)
+{
+  struct sicslowpan_frag_info *info = &frag_info[context];
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)info->first_frag;
+  struct sicslowpan_vrb *v = NULL;
+  uint8_t i;
+
+  /* Datagrams for this node are reassembled. This includes source
+     routed datagrams, whose headers are rewritten here. */
+  if((info->flags & FRAG_INFO_RFRAG) ||
+     info->first_frag_len < UIP_IPH_LEN ||
+     uip_is_addr_mcast(&ip->destipaddr) ||
+     uip_ds6_is_my_addr(&ip->destipaddr) ||
+     uip_ds6_is_my_aaddr(&ip->destipaddr) ||
+     ip->ttl <= 1) {
+    return 0;
+  }
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb[i].state == VRB_FREE || timer_expired(&vrb[i].timer)) {
+      v = &vrb[i];
+      break;
+    }
+  }
+  if(v == NULL) {
+    return 0;
+  }
+
+  linkaddr_copy(&v->sender, &info->sender);
+  v->tag = info->tag;
+  v->size = info->len;
+  v->received = info->first_frag_len;
+  v->state = VRB_PENDING;
+  timer_set(&v->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  /* Pass the first fragment to the IP layer as if it was the whole
+     datagram. It only processes the headers before it forwards the
+     datagram, which ends up in output(). */
+  memcpy(uip_buf, info->first_frag, info->first_frag_len);
+  uip_len = info->len;
+#if LLSEC802154_USES_AUX_HEADER
+  uipbuf_set_attr(UIPBUF_ATTR_LLSEC_LEVEL,
+    packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL));
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  uipbuf_set_attr(UIPBUF_ATTR_LLSEC_KEY_ID,
+    packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX));
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /*  LLSEC802154_USES_AUX_HEADER */
+  vrb_pending = v;
+  vrb_pending_ip = ip;
+  tcpip_input();
+  vrb_pending = NULL;
+
+  if(v->state == VRB_REASSEMBLE) {
+    v->state = VRB_FREE;
+    return 0;
+  }
+  if(v->state == VRB_PENDING) {
+    /* The IP layer did not forward the datagram */
+    v->state = VRB_DISCARD;
+  }
+
+  /* Pass on the fragments that arrived before the first one. A
+     VRB_DISCARD entry only keeps track of them. */
+  for(i = info->frag_bufs; i != FRAG_BUF_NONE && v->state != VRB_FREE;
+      i = frag_buf[i].next) {
+    vrb_send_fragment(v, frag_buf[i].offset, frag_buf[i].data, frag_buf[i].len);
+  }
+  clear_fragments(context);
+  return 1;
+}
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+#if SICSLOWPAN_FRAG_RECOVERY
+/*--------------------------------------------------------------------*/
+/** A datagram sent with RFRAG fragments that awaits acknowledgment */
+struct sicslowpan_rfrag_tx {
+  struct ctimer timer;
+  /** The link layer destination of the fragments */
+  linkaddr_t dest;
+  /** The fragments acknowledged by the receiver */
+  uint32_t acked;
+  /** Size of the compressed datagram */
+  uint16_t len;
+  /** Compressed header and payload size of the first fragment */
+  uint16_t first_len;
+  /** Payload size of the other fragments */
+  uint16_t frag_len;
+  uint8_t tag;
+  uint8_t count;
+  uint8_t retries;
+  uint8_t in_use;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  /** The compressed datagram */
+  uint8_t buf[SICSLOWPAN_FRAG_RECOVERY_BUFFER_SIZE];
+};
+
+static struct sicslowpan_rfrag_tx rfrag_tx[SICSLOWPAN_FRAG_RECOVERY_CONTEXTS];
+static uint8_t rfrag_tag;
+
+static void rfrag_timeout(void *ptr);
+/*--------------------------------------------------------------------*/
+/* Send one fragment of a datagram that awaits acknowledgment */
+static void
+rfrag_send(struct sicslowpan_rfrag_tx *tx, uint8_t seq, uint8_t ack_request)
+{
+  uint16_t offset;
+  uint16_t len;
+
+  if(seq == 0) {
+    offset = 0;
+    len = tx->first_len;
+  } else {
+    offset = tx->first_len + (seq - 1) * tx->frag_len;
+    len = MIN(tx->frag_len, tx->len - offset);
+  }
+
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(tx->attrs, tx->addrs);
+  packetbuf_ptr = packetbuf_dataptr();
+
+  /* RFRAG header. The offset of the first fragment carries the size
+     of the compressed datagram. */
+  packetbuf_ptr[0] = SICSLOWPAN_DISPATCH_RFRAG;
+  packetbuf_ptr[1] = tx->tag;
+  SET16(packetbuf_ptr, 2, (ack_request ? RFRAG_ACK_REQUEST : 0) |
+        ((uint16_t)seq << 10) | len);
+  SET16(packetbuf_ptr, 4, seq == 0 ? tx->len : offset);
+  memcpy(packetbuf_ptr + SICSLOWPAN_RFRAG_HDR_LEN, tx->buf + offset, len);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN + len);
+
+  LOG_INFO("output: rfrag %u/%u (tag %u, size %u, offset %u%s)\n",
+           seq + 1, tx->count, tx->tag, len, offset,
+           ack_request ? ", ack request" : "");
+  send_packet(&tx->dest);
+}
+/*--------------------------------------------------------------------*/
+/* Send the fragments that have not been acknowledged yet, requesting
+   an acknowledgment with the last one */
+static void
+rfrag_send_missing(struct sicslowpan_rfrag_tx *tx)
+{
+  int seq;
+  int last;
+  int missing;
+
+  last = -1;
+  missing = 0;
+  for(seq = 0; seq < tx->count; seq++) {
+    if(!(tx->acked & RFRAG_BIT(seq))) {
+      last = seq;
+      missing++;
+    }
+  }
+
+  if(missing > queuebuf_numfree()) {
+    /* Try again when the timer expires */
+    LOG_WARN("output: rfrag retransmission deferred, %u fragments, %u free bufs\n",
+             missing, queuebuf_numfree());
+  } else {
+    for(seq = 0; seq <= last; seq++) {
+      if(!(tx->acked & RFRAG_BIT(seq))) {
+        rfrag_send(tx, seq, seq == last);
+      }
+    }
+  }
+  ctimer_set(&tx->timer, SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT, rfrag_timeout, tx);
+}
+/*--------------------------------------------------------------------*/
+static void
+rfrag_release(struct sicslowpan_rfrag_tx *tx)
+{
+  ctimer_stop(&tx->timer);
+  tx->in_use = 0;
+}
+/*--------------------------------------------------------------------*/
+static void
+rfrag_timeout(void *ptr)
+{
+  struct sicslowpan_rfrag_tx *tx = ptr;
+
+  if(tx->retries >= SICSLOWPAN_FRAG_RECOVERY_RETRIES) {
+    LOG_WARN("output: rfrag tag %u not acknowledged, dropping datagram\n",
+             tx->tag);
+    rfrag_release(tx);
+    return;
+  }
+  tx->retries++;
+
+  /* Ask the receiver which fragments it misses */
+  if(queuebuf_numfree() > 0) {
+    rfrag_send(tx, tx->count - 1, 1);
+  }
+  ctimer_set(&tx->timer, SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT, rfrag_timeout, tx);
+}
+/*--------------------------------------------------------------------*/
+/* Process a received RFRAG-ACK */
+static void
+rfrag_ack_input(void)
+{
+  int i;
+  uint8_t tag;
+  uint32_t bitmap;
+  struct sicslowpan_rfrag_tx *tx;
+
+  if(packetbuf_datalen() < SICSLOWPAN_RFRAG_ACK_HDR_LEN) {
+    LOG_WARN("input: rfrag ack too short\n");
+    return;
+  }
+  tag = packetbuf_ptr[1];
+  bitmap = ((uint32_t)GET16(packetbuf_ptr, 2) << 16) | GET16(packetbuf_ptr, 4);
+
+  for(i = 0; i < SICSLOWPAN_FRAG_RECOVERY_CONTEXTS; i++) {
+    tx = &rfrag_tx[i];
+    if(tx->in_use && tx->tag == tag &&
+       linkaddr_cmp(&tx->dest, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      break;
+    }
+  }
+  if(i == SICSLOWPAN_FRAG_RECOVERY_CONTEXTS) {
+    LOG_INFO("input: rfrag ack for unknown datagram (tag %u)\n", tag);
+    return;
+  }
+
+  LOG_INFO("input: rfrag ack (tag %u, bitmap %08lx)\n",
+           tag, (unsigned long)bitmap);
+
+  if(bitmap == RFRAG_BITMAP_NULL) {
+    LOG_WARN("input: rfrag tag %u aborted by receiver\n", tag);
+    rfrag_release(tx);
+    return;
+  }
+
+  tx->acked |= bitmap;
+  if(bitmap == RFRAG_BITMAP_FULL ||
+     (tx->acked & RFRAG_WINDOW(tx->count)) == RFRAG_WINDOW(tx->count)) {
+    LOG_INFO("output: rfrag tag %u delivered\n", tag);
+    rfrag_release(tx);
+    return;
+  }
+
+  if(tx->retries >= SICSLOWPAN_FRAG_RECOVERY_RETRIES) {
+    LOG_WARN("output: rfrag tag %u incomplete, dropping datagram\n", tag);
+    rfrag_release(tx);
+    return;
+  }
+  tx->retries++;
+  rfrag_send_missing(tx);
+}
+/*--------------------------------------------------------------------*/
+/* Send an RFRAG-ACK with the given bitmap */
+static void
+rfrag_ack_output(linkaddr_t *dest, uint8_t tag, uint32_t bitmap)
+{
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_ptr[0] = SICSLOWPAN_DISPATCH_RFRAG_ACK;
+  packetbuf_ptr[1] = tag;
+  SET16(packetbuf_ptr, 2, bitmap >> 16);
+  SET16(packetbuf_ptr, 4, bitmap & 0xffff);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_ACK_HDR_LEN);
+#if PACKETBUF_WITH_TRAFFIC_CLASS
+  packetbuf_set_attr(PACKETBUF_ATTR_TRAFFIC_CLASS,
+                     PACKETBUF_ATTR_TRAFFIC_CLASS_CONTROL);
+#endif /* PACKETBUF_WITH_TRAFFIC_CLASS */
+
+  LOG_INFO("output: rfrag ack (tag %u, bitmap %08lx)\n",
+           tag, (unsigned long)bitmap);
+  send_packet(dest);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Send the compressed datagram in packetbuf and uip_buf as
+ * RFRAG fragments and keep it until the receiver acknowledges it.
+ * \param dest the link layer destination address of the packet
+ * \return 1 if the datagram was sent, 0 if it was dropped, and -1 if
+ * RFC 4944 fragmentation must be used instead
+ */
+static int
+rfrag_output(linkaddr_t *dest)
+{
+  int i;
+  int seq;
+  uint16_t len;
+  struct sicslowpan_rfrag_tx *tx;
+
+  len = packetbuf_hdr_len + uip_len - uncomp_hdr_len;
+  if(len > SICSLOWPAN_FRAG_RECOVERY_BUFFER_SIZE) {
+    return -1;
+  }
+
+  for(i = 0; i < SICSLOWPAN_FRAG_RECOVERY_CONTEXTS; i++) {
+    if(!rfrag_tx[i].in_use) {
+      break;
+    }
+  }
+  if(i == SICSLOWPAN_FRAG_RECOVERY_CONTEXTS) {
+    LOG_INFO("output: no free rfrag context\n");
+    return -1;
+  }
+  tx = &rfrag_tx[i];
+
+  tx->len = len;
+  /* The receiver stores fragments in SICSLOWPAN_FRAGMENT_SIZE buffers */
+  tx->first_len = MIN(mac_max_payload - SICSLOWPAN_RFRAG_HDR_LEN,
+                      SICSLOWPAN_FRAGMENT_SIZE);
+  tx->frag_len = tx->first_len;
+  if(tx->first_len <= packetbuf_hdr_len) {
+    return -1;
+  }
+  tx->count = 1 + (len - tx->first_len + tx->frag_len - 1) / tx->frag_len;
+  if(tx->count > RFRAG_MAX_FRAGMENTS) {
+    return -1;
+  }
+  if(queuebuf_numfree() < tx->count) {
+    LOG_WARN("output: dropping packet, not enough free bufs (needed: %u, free: %u)\n",
+             tx->count, queuebuf_numfree());
+    return 0;
+  }
+
+  /* Keep the compressed datagram for retransmissions */
+  memcpy(tx->buf, packetbuf_ptr, packetbuf_hdr_len);
+  memcpy(tx->buf + packetbuf_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         uip_len - uncomp_hdr_len);
+  packetbuf_attr_copyto(tx->attrs, tx->addrs);
+  linkaddr_copy(&tx->dest, dest);
+  tx->tag = rfrag_tag++;
+  tx->acked = 0;
+  tx->retries = 0;
+  tx->in_use = 1;
+
+  for(seq = 0; seq < tx->count; seq++) {
+    rfrag_send(tx, seq, seq == tx->count - 1);
+  }
+  ctimer_set(&tx->timer, SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT, rfrag_timeout, tx);
+  return 1;
+}
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 #endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
@@ -1562,6 +2267,17 @@ output(const linkaddr_t *localdest)
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
 
+#if PACKETBUF_WITH_TRAFFIC_CLASS
+  /* copy over the traffic class; untagged ICMPv6 (ND, RPL) is control traffic */
+  if(uipbuf_get_attr(UIPBUF_ATTR_TRAFFIC_CLASS) != PACKETBUF_ATTR_TRAFFIC_CLASS_NONE) {
+    packetbuf_set_attr(PACKETBUF_ATTR_TRAFFIC_CLASS,
+                       uipbuf_get_attr(UIPBUF_ATTR_TRAFFIC_CLASS));
+  } else if(UIP_IP_BUF->proto == UIP_PROTO_ICMP6) {
+    packetbuf_set_attr(PACKETBUF_ATTR_TRAFFIC_CLASS,
+                       PACKETBUF_ATTR_TRAFFIC_CLASS_CONTROL);
+  }
+#endif /* PACKETBUF_WITH_TRAFFIC_CLASS */
+
 /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_MAC */
   packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
 #if LLSEC802154_USES_AUX_HEADER
@@ -1613,6 +2329,27 @@ output(const linkaddr_t *localdest)
             uip_len, uip_len - uncomp_hdr_len + packetbuf_hdr_len,
             mac_max_payload, frag_needed);
 
+#if SICSLOWPAN_FRAG_FORWARDING
+  if(vrb_pending != NULL &&
+     uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &vrb_pending_ip->srcipaddr)) {
+    /* The first fragment of a datagram that is forwarded fragment by
+       fragment. uip_buf does not hold the rest of the datagram. Other
+       packets that the IP layer sends meanwhile, such as ICMPv6 errors
+       or neighbor solicitations, have this node as their source. */
+    if(!frag_needed || uip_len != vrb_pending->size) {
+      /* The IP layer changed the length of the headers, e.g., when a
+         RPL root replaces the hop-by-hop option with a source routing
+         header. The offsets of the following fragments no longer
+         hold, so the datagram is reassembled and goes through the IP
+         layer again. */
+      vrb_pending->state = VRB_REASSEMBLE;
+      vrb_pending = NULL;
+      return 0;
+    }
+    return vrb_output(&dest);
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
   if(frag_needed) {
 #if SICSLOWPAN_CONF_FRAG
     /* Number of bytes processed. */
@@ -1644,7 +2381,14 @@ output(const linkaddr_t *localdest)
       fragment_count += 1 + (middle_fragn_total_payload - 1) / fragn_max_payload;
     }
 
-    int freebuf = queuebuf_numfree() - 1;
+#if SICSLOWPAN_FRAG_RECOVERY
+    int rfrag_result = rfrag_output(&dest);
+    if(rfrag_result >= 0) {
+      return rfrag_result;
+    }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+    int freebuf = queuebuf_numfree();
     LOG_INFO("output: fragmentation needed, fragments: %u, free queuebufs: %u\n",
       fragment_count, freebuf);
 
@@ -1690,10 +2434,7 @@ output(const linkaddr_t *localdest)
 
     /* Now prepare for subsequent fragments. */
 
-    /* FRAGN header: tag was already set at FRAG1. Now set dispatch for all FRAGN */
     packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
 
     /* Keep track of the total length of data sent */
     processed_ip_out_len = uncomp_hdr_len + packetbuf_payload_len;
@@ -1701,7 +2442,10 @@ output(const linkaddr_t *localdest)
     /* Create and send subsequent fragments. */
     while(processed_ip_out_len < uip_len) {
       curr_frag++;
-      /* FRAGN header: set offset for this fragment */
+      /* FRAGN header: packetbuf is reset after each fragment */
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
       PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
 
       /* Calculate fragment len */
@@ -1742,6 +2486,41 @@ output(const linkaddr_t *localdest)
   return 1;
 }
 
+/*--------------------------------------------------------------------*/
+#if CSMA_WITH_AGGREGATION
+static void input_packet(void);
+/**
+ * \brief Split a frame holding several packets, each prefixed with its
+ * length, and process them one by one with the attributes of the frame
+ */
+static void
+input_aggregate(void)
+{
+  static uint8_t buf[PACKETBUF_SIZE];
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint16_t len;
+  uint16_t offset;
+  uint8_t plen;
+
+  len = packetbuf_datalen();
+  memcpy(buf, packetbuf_dataptr(), len);
+  packetbuf_attr_copyto(attrs, addrs);
+
+  for(offset = 1; offset < len; offset += plen) {
+    plen = buf[offset++];
+    if(plen == 0 || offset + plen > len
+       || buf[offset] == SICSLOWPAN_DISPATCH_AGGREGATE) {
+      LOG_WARN("input: malformed aggregate, dropping\n");
+      return;
+    }
+    /* The packet may be forwarded, which reuses the packetbuf */
+    packetbuf_copyfrom(&buf[offset], plen);
+    packetbuf_attr_copyfrom(attrs, addrs);
+    input_packet();
+  }
+}
+#endif /* CSMA_WITH_AGGREGATION */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *
@@ -1755,12 +2534,12 @@ output(const linkaddr_t *localdest)
  * (it is a SHALL in the RFC 4944 and should never happen)
  */
 static void
-input(void)
+input_packet(void)
 {
   /* size of the IP packet (read from fragment) */
   uint16_t frag_size = 0;
-  /* offset of the fragment in the IP packet */
-  uint8_t frag_offset = 0;
+  /* offset of the fragment in the IP packet, in bytes */
+  uint16_t frag_offset = 0;
   uint8_t *buffer;
 
 #if SICSLOWPAN_CONF_FRAG
@@ -1771,9 +2550,12 @@ input(void)
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0, last_fragment = 0;
 #endif /*SICSLOWPAN_CONF_FRAG*/
-
-  /* Update link statistics */
-  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+#if SICSLOWPAN_FRAG_RECOVERY
+  uint8_t rfrag_seq = 0;
+  uint8_t rfrag_ack = 0;
+  uint32_t rfrag_bitmap = RFRAG_BITMAP_NULL;
+  linkaddr_t rfrag_sender;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 
   /* init */
   uncomp_hdr_len = 0;
@@ -1815,13 +2597,25 @@ input(void)
       LOG_INFO("input: received first element of a fragmented packet (tag %d, len %d)\n",
              frag_tag, frag_size);
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_lookup(frag_tag) != NULL) {
+        LOG_WARN("input: duplicate first fragment (tag %d)\n", frag_tag);
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context */
-      frag_context = add_fragment(frag_tag, frag_size, frag_offset);
+      frag_context = get_context(frag_tag, 0);
 
       if(frag_context == -1) {
         LOG_ERR("input: failed to allocate new reassembly context\n");
         return;
       }
+      if(frag_info[frag_context].flags & FRAG_INFO_HAVE_FIRST) {
+        LOG_WARN("input: duplicate first fragment (tag %d)\n", frag_tag);
+        return;
+      }
+      frag_info[frag_context].len = frag_size;
 
       buffer = frag_info[frag_context].first_frag;
       break;
@@ -1830,29 +2624,114 @@ input(void)
        * set offset, tag, size
        * Offset is in units of 8 bytes
        */
-      frag_offset = PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET];
+      frag_offset = PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] << 3;
       frag_tag = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG);
       frag_size = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE) & 0x07ff;
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
-      /* Add the fragment to the fragmentation context (this will also
-         copy the payload) */
-      frag_context = add_fragment(frag_tag, frag_size, frag_offset);
+#if SICSLOWPAN_FRAG_FORWARDING
+      {
+        struct sicslowpan_vrb *v = vrb_lookup(frag_tag);
+        if(v != NULL) {
+          if(packetbuf_datalen() > packetbuf_hdr_len) {
+            vrb_send_fragment(v, frag_offset, packetbuf_ptr + packetbuf_hdr_len,
+                              packetbuf_datalen() - packetbuf_hdr_len);
+          }
+          return;
+        }
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
+      /* The FRAGN may arrive before the FRAG1 of the datagram */
+      frag_context = get_context(frag_tag, 0);
 
       if(frag_context == -1) {
         LOG_ERR("input: reassembly context not found (tag %d)\n", frag_tag);
         return;
       }
+      frag_info[frag_context].len = frag_size;
+
+      /* Add the fragment to the fragmentation context (this will also
+         copy the payload) */
+      if(add_fragment(frag_context, frag_offset) < 0) {
+        return;
+      }
 
       /* Ok - add_fragment will store the fragment automatically - so
          we should not store more */
       buffer = NULL;
-
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
-        last_fragment = 1;
+      is_fragment = 1;
+      break;
+#if SICSLOWPAN_FRAG_RECOVERY
+    case SICSLOWPAN_DISPATCH_RFRAG:
+      if((PACKETBUF_FRAG_PTR[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK) ==
+         SICSLOWPAN_DISPATCH_RFRAG_ACK) {
+        rfrag_ack_input();
+        return;
+      }
+      if(packetbuf_datalen() < SICSLOWPAN_RFRAG_HDR_LEN) {
+        LOG_ERR("input: rfrag too short\n");
+        return;
       }
+      frag_tag = PACKETBUF_FRAG_PTR[1];
+      rfrag_ack = (GET16(PACKETBUF_FRAG_PTR, 2) & RFRAG_ACK_REQUEST) != 0;
+      rfrag_seq = (GET16(PACKETBUF_FRAG_PTR, 2) >> 10) & 0x1f;
+      frag_offset = GET16(PACKETBUF_FRAG_PTR, 4);
+      packetbuf_hdr_len += SICSLOWPAN_RFRAG_HDR_LEN;
+      linkaddr_copy(&rfrag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
       is_fragment = 1;
+
+      LOG_INFO("input: rfrag (tag %d, seq %u, offset %u%s)\n", frag_tag,
+               rfrag_seq, frag_offset, rfrag_ack ? ", ack request" : "");
+
+      if(!timer_expired(&rfrag_done.timer) && rfrag_done.tag == frag_tag &&
+         linkaddr_cmp(&rfrag_done.sender, &rfrag_sender)) {
+        /* The datagram was already delivered, the acknowledgment may
+           have been lost */
+        if(rfrag_ack) {
+          rfrag_ack_output(&rfrag_sender, frag_tag, RFRAG_BITMAP_FULL);
+        }
+        return;
+      }
+
+      frag_context = get_context(frag_tag, FRAG_INFO_RFRAG);
+      if(frag_context == -1) {
+        LOG_ERR("input: failed to allocate new reassembly context\n");
+        if(rfrag_ack) {
+          /* Abort the datagram */
+          rfrag_ack_output(&rfrag_sender, frag_tag, RFRAG_BITMAP_NULL);
+        }
+        return;
+      }
+
+      if(frag_info[frag_context].bitmap & RFRAG_BIT(rfrag_seq)) {
+        LOG_INFO("input: duplicate rfrag (tag %d, seq %u)\n", frag_tag, rfrag_seq);
+        if(rfrag_ack) {
+          rfrag_ack_output(&rfrag_sender, frag_tag, frag_info[frag_context].bitmap);
+        }
+        return;
+      }
+
+      if(rfrag_seq == 0) {
+        /* The offset of the first fragment is the size of the
+           compressed datagram */
+        first_fragment = 1;
+        frag_size = frag_offset;
+        frag_offset = 0;
+        frag_info[frag_context].len = frag_size;
+        buffer = frag_info[frag_context].first_frag;
+      } else {
+        if(add_fragment(frag_context, frag_offset) < 0) {
+          if(rfrag_ack) {
+            rfrag_ack_output(&rfrag_sender, frag_tag, frag_info[frag_context].bitmap);
+          }
+          return;
+        }
+        frag_info[frag_context].bitmap |= RFRAG_BIT(rfrag_seq);
+        buffer = NULL;
+      }
       break;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
     default:
       break;
   }
@@ -1877,6 +2756,16 @@ input(void)
   /* Process next dispatch and headers */
   if((PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK) == SICSLOWPAN_DISPATCH_IPHC) {
     LOG_DBG("uncompression: IPHC dispatch\n");
+#if SICSLOWPAN_FRAG_RECOVERY
+    if(first_fragment && (frag_info[frag_context].flags & FRAG_INFO_RFRAG)) {
+      /* frag_size is the size of the compressed datagram. Let the
+         lengths be derived as if all of it was in this frame. */
+      uint16_t datalen = packetbuf_datalen();
+      packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN + frag_size);
+      uncompress_hdr_iphc(buffer, 0);
+      packetbuf_set_datalen(datalen);
+    } else
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
     uncompress_hdr_iphc(buffer, frag_size);
   } else if(PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] == SICSLOWPAN_DISPATCH_IPV6) {
     LOG_DBG("uncompression: IPV6 dispatch\n");
@@ -1913,18 +2802,24 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   if(is_fragment) {
     LOG_INFO("input: fragment (tag %d, payload %d, offset %d) -- %u %u\n",
-         frag_tag, packetbuf_payload_len, frag_offset << 3, packetbuf_datalen(), packetbuf_hdr_len);
+         frag_tag, packetbuf_payload_len, frag_offset, packetbuf_datalen(), packetbuf_hdr_len);
+  }
+  if(first_fragment &&
+     uncomp_hdr_len + packetbuf_payload_len > SICSLOWPAN_FIRST_FRAGMENT_SIZE) {
+    LOG_ERR("input: first fragment too large (%u bytes)\n",
+            uncomp_hdr_len + packetbuf_payload_len);
+    return;
   }
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* Sanity-check size of incoming packet to avoid buffer overflow */
   {
-    int req_size = uncomp_hdr_len + (uint16_t)(frag_offset << 3)
+    int req_size = uncomp_hdr_len + frag_offset
         + packetbuf_payload_len;
     if(req_size > sizeof(uip_buf)) {
       LOG_ERR(
           "input: packet dropped, minimum required IP_BUF size: %d+%d+%d=%d (current size: %u)\n",
-          uncomp_hdr_len, (uint16_t)(frag_offset << 3),
+          uncomp_hdr_len, frag_offset,
           packetbuf_payload_len, req_size, (unsigned)sizeof(uip_buf));
       return;
     }
@@ -1939,19 +2834,56 @@ input(void)
   /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
+  if(is_fragment) {
+    struct sicslowpan_frag_info *info = &frag_info[frag_context];
+
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
-      frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+      info->first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+      info->flags |= FRAG_INFO_HAVE_FIRST;
+#if SICSLOWPAN_FRAG_RECOVERY
+      if(info->flags & FRAG_INFO_RFRAG) {
+        /* RFRAG offsets and sizes refer to the compressed datagram */
+        info->offset_shift = uncomp_hdr_len -
+          (packetbuf_hdr_len - SICSLOWPAN_RFRAG_HDR_LEN);
+        info->reassembled_len += packetbuf_datalen() - SICSLOWPAN_RFRAG_HDR_LEN;
+        info->bitmap |= RFRAG_BIT(0);
+      } else
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+      info->reassembled_len += info->first_frag_len;
     }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      frag_info[frag_context].reassembled_len = frag_size;
+#if SICSLOWPAN_FRAG_RECOVERY
+    rfrag_bitmap = info->bitmap;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+    /* The fragments may arrive in any order. For the last fragment,
+       we are OK if there is extrenous bytes at the end of the packet. */
+    if((info->flags & FRAG_INFO_HAVE_FIRST) &&
+       info->reassembled_len >= info->len) {
+      last_fragment = 1;
+      frag_size = info->len;
+#if SICSLOWPAN_FRAG_RECOVERY
+      if(info->flags & FRAG_INFO_RFRAG) {
+        frag_size += info->offset_shift;
+        /* Always acknowledge the complete datagram */
+        rfrag_ack = 1;
+        rfrag_bitmap = RFRAG_BITMAP_FULL;
+        linkaddr_copy(&rfrag_done.sender, &rfrag_sender);
+        rfrag_done.tag = frag_tag;
+        /* Remember the datagram for as long as the sender may ask */
+        timer_set(&rfrag_done.timer, (SICSLOWPAN_FRAG_RECOVERY_RETRIES + 1) *
+                  SICSLOWPAN_FRAG_RECOVERY_ACK_TIMEOUT);
+      }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
       /* copy to uip */
-      copy_frags2uip(frag_context);
+      if(!copy_frags2uip(frag_context)) {
+        return;
+      }
+    }
+#if SICSLOWPAN_FRAG_FORWARDING
+    else if(first_fragment && vrb_forward(frag_context)) {
+      return;
     }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
   }
 
   /*
@@ -2004,6 +2936,33 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   }
 #endif /* SICSLOWPAN_CONF_FRAG */
+
+#if SICSLOWPAN_FRAG_RECOVERY
+  if(rfrag_ack) {
+    rfrag_ack_output(&rfrag_sender, frag_tag, rfrag_bitmap);
+  }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Process a frame received by the MAC. Link statistics are
+ * updated once per frame, also when it carries several packets.
+ */
+static void
+input(void)
+{
+  /* Update link statistics */
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+
+#if CSMA_WITH_AGGREGATION
+  if(packetbuf_datalen() > 0
+     && *(uint8_t *)packetbuf_dataptr() == SICSLOWPAN_DISPATCH_AGGREGATE) {
+    input_aggregate();
+    return;
+  }
+#endif /* CSMA_WITH_AGGREGATION */
+
+  input_packet();
 }
 /** @} */
 
@@ -2013,6 +2972,9 @@ input(void)
 void
 sicslowpan_init(void)
 {
+#if SICSLOWPAN_CONF_FRAG
+  init_fragments();
+#endif /* SICSLOWPAN_CONF_FRAG */
 
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPHC
 /* Preinitialize any address contexts for better header compression
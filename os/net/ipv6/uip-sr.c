@@ -58,6 +58,35 @@ static int num_nodes;
 LIST(nodelist);
 MEMB(nodememb, uip_sr_node_t, UIP_SR_LINK_NUM);
 
+#if UIP_SR_NODE_INDEX
+/* Hash table over the link identifiers, with linear probing. Each slot
+ * holds 1 + the position of a node in the node pool, or 0 if empty. */
+#define NODE_INDEX_SIZE (2 * UIP_SR_LINK_NUM + 1)
+static uint16_t node_index[NODE_INDEX_SIZE];
+#endif /* UIP_SR_NODE_INDEX */
+
+#if UIP_SR_ROUTE_CACHE_SIZE
+/* Compiled routes, indexed by position of the destination in the node pool */
+struct route_cache_entry {
+  uip_sr_route_t route;
+  uip_sr_node_t *root_node;
+  uint16_t generation;
+  uint8_t addrs[UIP_SR_ROUTE_CACHE_ENTRY_LEN];
+};
+static struct route_cache_entry route_cache[UIP_SR_ROUTE_CACHE_SIZE];
+/* Incremented upon every topology change, invalidating all cached routes.
+ * When it wraps, routes cached that many changes ago would match again:
+ * the cache is flushed then. */
+static uint16_t topology_generation;
+#define TOPOLOGY_CHANGED() do { \
+    if(++topology_generation == 0) { \
+      memset(route_cache, 0, sizeof(route_cache)); \
+    } \
+  } while(0)
+#else /* UIP_SR_ROUTE_CACHE_SIZE */
+#define TOPOLOGY_CHANGED()
+#endif /* UIP_SR_ROUTE_CACHE_SIZE */
+
 /*---------------------------------------------------------------------------*/
 int
 uip_sr_num_nodes(void)
@@ -77,9 +106,108 @@ node_matches_address(void *graph, const uip_sr_node_t *node, const uip_ipaddr_t
   }
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_SR_NODE_INDEX || UIP_SR_ROUTE_CACHE_SIZE
+static uint16_t
+node_position(const uip_sr_node_t *node)
+{
+  return node - (uip_sr_node_t *)nodememb.mem;
+}
+#endif /* UIP_SR_NODE_INDEX || UIP_SR_ROUTE_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
+#if UIP_SR_NODE_INDEX
+static uint16_t
+node_index_hash(const unsigned char *link_identifier)
+{
+  uint32_t hash = 0;
+  int i;
+  for(i = 0; i < 8; i++) {
+    hash = hash * 31 + link_identifier[i];
+  }
+  return hash % NODE_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uip_sr_node_t *
+node_index_get(uint16_t slot)
+{
+  return &((uip_sr_node_t *)nodememb.mem)[node_index[slot] - 1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_index_add(const uip_sr_node_t *node)
+{
+  uint16_t slot = node_index_hash(node->link_identifier);
+  /* The table has more slots than nodes: there is always a free one */
+  while(node_index[slot] != 0) {
+    slot = (slot + 1) % NODE_INDEX_SIZE;
+  }
+  node_index[slot] = node_position(node) + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_index_remove(const uip_sr_node_t *node)
+{
+  uint16_t slot = node_index_hash(node->link_identifier);
+  uint16_t next;
+
+  while(node_index[slot] != node_position(node) + 1) {
+    if(node_index[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NODE_INDEX_SIZE;
+  }
+
+  /* Move back the entries that follow in the probe sequence, so that
+   * lookups need no tombstones */
+  next = slot;
+  for(;;) {
+    uint16_t home;
+    next = (next + 1) % NODE_INDEX_SIZE;
+    if(node_index[next] == 0) {
+      break;
+    }
+    home = node_index_hash(node_index_get(next)->link_identifier);
+    /* Can the entry at 'next' move to the free slot? Only if its home
+     * slot is not cyclically within (slot, next] */
+    if(slot <= next ? (home <= slot || home > next) : (home <= slot && home > next)) {
+      node_index[slot] = node_index[next];
+      slot = next;
+    }
+  }
+  node_index[slot] = 0;
+}
+#endif /* UIP_SR_NODE_INDEX */
+/*---------------------------------------------------------------------------*/
+static void
+remove_node(uip_sr_node_t *node)
+{
+#if UIP_SR_NODE_INDEX
+  node_index_remove(node);
+#endif /* UIP_SR_NODE_INDEX */
+  list_remove(nodelist, node);
+  memb_free(&nodememb, node);
+  num_nodes--;
+  TOPOLOGY_CHANGED();
+}
+/*---------------------------------------------------------------------------*/
 uip_sr_node_t *
 uip_sr_get_node(void *graph, const uip_ipaddr_t *addr)
 {
+#if UIP_SR_NODE_INDEX
+  uint16_t slot;
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(slot = node_index_hash(((const unsigned char *)addr) + 8);
+      node_index[slot] != 0;
+      slot = (slot + 1) % NODE_INDEX_SIZE) {
+    uip_sr_node_t *l = node_index_get(slot);
+    /* Compare node identifier first, then prefix */
+    if(memcmp(l->link_identifier, ((const unsigned char *)addr) + 8, 8) == 0
+       && node_matches_address(graph, l, addr)) {
+      return l;
+    }
+  }
+#else /* UIP_SR_NODE_INDEX */
   uip_sr_node_t *l;
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Compare prefix and node identifier */
@@ -87,6 +215,7 @@ uip_sr_get_node(void *graph, const uip_ipaddr_t *addr)
       return l;
     }
   }
+#endif /* UIP_SR_NODE_INDEX */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -148,18 +277,28 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child, const uip_ipaddr_t *p
       return NULL;
     }
     child_node->parent = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
     list_add(nodelist, child_node);
+#if UIP_SR_NODE_INDEX
+    node_index_add(child_node);
+#endif /* UIP_SR_NODE_INDEX */
     num_nodes++;
+    /* The node may reuse the memory of a removed one, still referred to
+     * as parent by other nodes */
+    TOPOLOGY_CHANGED();
   }
 
   /* Initialize node */
+  if(child_node->graph != graph) {
+    /* The node address derives from the graph prefix */
+    TOPOLOGY_CHANGED();
+  }
   child_node->graph = graph;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
+  old_parent_node = child_node->parent;
   /* Is the node reachable before the update? */
   if(uip_sr_is_addr_reachable(graph, child)) {
-    old_parent_node = child_node->parent;
     /* Update node */
     child_node->parent = parent_node;
     /* Has the node become unreachable? May happen if we create a loop. */
@@ -172,6 +311,9 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child, const uip_ipaddr_t *p
   } else {
     child_node->parent = parent_node;
   }
+  if(child_node->parent != old_parent_node) {
+    TOPOLOGY_CHANGED();
+  }
 
   LOG_INFO("NS: updating link, child ");
   LOG_INFO_6ADDR(child);
@@ -182,12 +324,107 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child, const uip_ipaddr_t *p
   return child_node;
 }
 /*---------------------------------------------------------------------------*/
+/* Counts the number of bytes in common between two addresses at p1 and p2 */
+static int
+count_matching_bytes(const void *p1, const void *p2, size_t n)
+{
+  int i = 0;
+  for(i = 0; i < n; i++) {
+    if(((uint8_t *)p1)[i] != ((uint8_t *)p2)[i]) {
+      return i;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_sr_get_route(uip_sr_node_t *node, uip_sr_node_t *root_node, uip_sr_route_t *route)
+{
+  uip_sr_node_t *hop;
+  uip_ipaddr_t dest_addr;
+  uip_ipaddr_t hop_addr;
+  int max_depth = UIP_SR_LINK_NUM;
+#if UIP_SR_ROUTE_CACHE_SIZE
+  struct route_cache_entry *entry;
+
+  entry = &route_cache[node_position(node) % UIP_SR_ROUTE_CACHE_SIZE];
+  if(entry->route.node == node && entry->root_node == root_node
+     && entry->generation == topology_generation) {
+    *route = entry->route;
+    return 1;
+  }
+#endif /* UIP_SR_ROUTE_CACHE_SIZE */
+
+  route->node = node;
+  route->first_hop = node;
+  route->path_len = 0;
+  route->addrs = NULL;
+  /* For simplicity, we use cmpri = cmpre */
+  route->cmpr = 15;
+
+  /* Walk up to the root. Note that in case of a direct child, the route is
+   * empty but still valid. */
+  NETSTACK_ROUTING.get_sr_node_ipaddr(&dest_addr, node);
+  for(hop = node->parent; hop != root_node; hop = hop->parent) {
+    if(hop == NULL || --max_depth <= 0) {
+      /* No path to the root */
+      return 0;
+    }
+    NETSTACK_ROUTING.get_sr_node_ipaddr(&hop_addr, hop);
+    /* How many bytes in common between all nodes in the path? */
+    route->cmpr = MIN(route->cmpr, count_matching_bytes(&hop_addr, &dest_addr, 16));
+    route->first_hop = hop;
+    route->path_len++;
+  }
+  route->len = route->path_len * (16 - route->cmpr);
+
+#if UIP_SR_ROUTE_CACHE_SIZE
+  if(route->len <= UIP_SR_ROUTE_CACHE_ENTRY_LEN) {
+    uip_sr_write_route(route, entry->addrs);
+    route->addrs = entry->addrs;
+    entry->route = *route;
+    entry->root_node = root_node;
+    entry->generation = topology_generation;
+  }
+#endif /* UIP_SR_ROUTE_CACHE_SIZE */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_sr_write_route(const uip_sr_route_t *route, uint8_t *buf)
+{
+  uip_sr_node_t *hop;
+  uip_ipaddr_t hop_addr;
+  uint8_t *hop_ptr;
+
+  if(route->addrs != NULL) {
+    memcpy(buf, route->addrs, route->len);
+    return;
+  }
+
+  /* From last (the destination) to first. The first hop is not part of the
+   * list, it is the IPv6 destination address. */
+  hop_ptr = buf + route->len;
+  for(hop = route->node; hop != route->first_hop; hop = hop->parent) {
+    NETSTACK_ROUTING.get_sr_node_ipaddr(&hop_addr, hop);
+    hop_ptr -= 16 - route->cmpr;
+    memcpy(hop_ptr, ((uint8_t *)&hop_addr) + route->cmpr, 16 - route->cmpr);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 uip_sr_init(void)
 {
   num_nodes = 0;
   memb_init(&nodememb);
   list_init(nodelist);
+#if UIP_SR_NODE_INDEX
+  memset(node_index, 0, sizeof(node_index));
+#endif /* UIP_SR_NODE_INDEX */
+#if UIP_SR_ROUTE_CACHE_SIZE
+  memset(route_cache, 0, sizeof(route_cache));
+#endif /* UIP_SR_ROUTE_CACHE_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 uip_sr_node_t *
@@ -226,9 +463,7 @@ uip_sr_periodic(unsigned seconds)
         LOG_INFO_("\n");
       }
       /* No child found, deallocate node */
-      list_remove(nodelist, l);
-      memb_free(&nodememb, l);
-      num_nodes--;
+      remove_node(l);
     } else if(l->lifetime != UIP_SR_INFINITE_LIFETIME) {
       l->lifetime = l->lifetime > seconds ? l->lifetime - seconds : 0;
     }
@@ -242,9 +477,7 @@ uip_sr_free_all(void)
   uip_sr_node_t *next;
   for(l = list_head(nodelist); l != NULL; l = next) {
     next = list_item_next(l);
-    list_remove(nodelist, l);
-    memb_free(&nodememb, l);
-    num_nodes--;
+    remove_node(l);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -85,6 +85,32 @@
 
 #define UIP_SR_INFINITE_LIFETIME           0xFFFFFFFF
 
+/* Index the nodes in a hash table over their link identifiers, making
+ * node lookups (several per downward packet and per DAO) constant-time
+ * instead of a walk of the whole node list */
+#ifdef UIP_SR_CONF_NODE_INDEX
+#define UIP_SR_NODE_INDEX             UIP_SR_CONF_NODE_INDEX
+#else /* UIP_SR_CONF_NODE_INDEX */
+#define UIP_SR_NODE_INDEX             0
+#endif /* UIP_SR_CONF_NODE_INDEX */
+
+/* The number of compiled source routes to keep, each for one destination.
+ * Cached routes are reused until the topology changes, i.e. until a node
+ * is added, changes parent or is removed. 0 to compile every route on use. */
+#ifdef UIP_SR_CONF_ROUTE_CACHE_SIZE
+#define UIP_SR_ROUTE_CACHE_SIZE       UIP_SR_CONF_ROUTE_CACHE_SIZE
+#else /* UIP_SR_CONF_ROUTE_CACHE_SIZE */
+#define UIP_SR_ROUTE_CACHE_SIZE       0
+#endif /* UIP_SR_CONF_ROUTE_CACHE_SIZE */
+
+/* The size of the compressed address list stored per cached route. Longer
+ * routes are compiled on use. */
+#ifdef UIP_SR_CONF_ROUTE_CACHE_ENTRY_LEN
+#define UIP_SR_ROUTE_CACHE_ENTRY_LEN  UIP_SR_CONF_ROUTE_CACHE_ENTRY_LEN
+#else /* UIP_SR_CONF_ROUTE_CACHE_ENTRY_LEN */
+#define UIP_SR_ROUTE_CACHE_ENTRY_LEN  64
+#endif /* UIP_SR_CONF_ROUTE_CACHE_ENTRY_LEN */
+
 /********** Data Structures  **********/
 
 /** \brief A node in a source routing graph, stored at the root and representing
@@ -100,6 +126,23 @@ typedef struct uip_sr_node {
   struct uip_sr_node *parent;
 } uip_sr_node_t;
 
+/** \brief A source route from the root to a node, in the form of the
+ * address list of a RFC 6554 Source Routing Header */
+typedef struct uip_sr_route {
+  /* The destination */
+  uip_sr_node_t *node;
+  /* The child of the root on the way, i.e. the first hop */
+  uip_sr_node_t *first_hop;
+  /* Number of addresses in the list: the hops after the first, and the destination */
+  uint8_t path_len;
+  /* Number of prefix bytes elided from every address (ComprI == ComprE) */
+  uint8_t cmpr;
+  /* Length of the address list in bytes */
+  uint16_t len;
+  /* The address list if cached, NULL otherwise */
+  const uint8_t *addrs;
+} uip_sr_route_t;
+
 /********** Public functions **********/
 
 /**
@@ -162,6 +205,26 @@ uip_sr_node_t *uip_sr_get_node(void *graph, const uip_ipaddr_t *addr);
 */
 int uip_sr_is_addr_reachable(void *graph, const uip_ipaddr_t *addr);
 
+/**
+ * Compiles the source route from a root to a node, or fetches it from the
+ * route cache
+ *
+ * \param node The destination node
+ * \param root_node The node of the root
+ * \param route The route to be filled in
+ * \return 1 if the node is reachable from the root, 0 otherwise
+*/
+int uip_sr_get_route(uip_sr_node_t *node, uip_sr_node_t *root_node, uip_sr_route_t *route);
+
+/**
+ * Writes the compressed address list of a source route
+ *
+ * \param route A route obtained from uip_sr_get_route, with no topology
+ * change since
+ * \param buf Where to write the route->len bytes of the list
+*/
+void uip_sr_write_route(const uip_sr_route_t *route, uint8_t *buf);
+
 /**
  * A function called periodically. Used to age the links (decrease lifetime
  * and expire links accordingly)
@@ -201,6 +201,7 @@ enum {
   UIPBUF_ATTR_PHYSICAL_NETWORK_ID, /**< Physical network ID (mapped to PAN ID)*/
   UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS, /**< MAX transmissions of the packet MAC */
   UIPBUF_ATTR_FLAGS,   /**< Flags that can control lower layers.  see above. */
+  UIPBUF_ATTR_TRAFFIC_CLASS, /**< MAC traffic class, a PACKETBUF_ATTR_TRAFFIC_CLASS_ value */
   UIPBUF_ATTR_MAX
 };
 
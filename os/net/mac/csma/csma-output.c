@@ -51,6 +51,10 @@
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "lib/assert.h"
+#if CSMA_WITH_AGGREGATION
+#include "net/ipv6/sicslowpan.h"
+#endif /* CSMA_WITH_AGGREGATION */
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -87,13 +91,43 @@
 #define CSMA_MAX_FRAME_RETRIES 7
 #endif
 
+#if CSMA_WITH_TRAFFIC_CLASSES
+/* Initial backoff exponent per traffic class, so that control and
+ * latency-sensitive packets win the channel over bulk packets queued
+ * for other neighbors */
+#ifdef CSMA_CONF_CLASS_MIN_BE
+#define CSMA_CLASS_MIN_BE CSMA_CONF_CLASS_MIN_BE
+#else
+#define CSMA_CLASS_MIN_BE { MAX(CSMA_MIN_BE - 2, 0), MAX(CSMA_MIN_BE - 1, 0), CSMA_MIN_BE }
+#endif
+
+static const uint8_t class_min_be[CSMA_NUM_CLASSES] = CSMA_CLASS_MIN_BE;
+static const clock_time_t class_lifetime[CSMA_NUM_CLASSES] = CSMA_CLASS_LIFETIME;
+#if CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED
+static const uint8_t class_weights[CSMA_NUM_CLASSES] = CSMA_CLASS_WEIGHTS;
+#endif /* CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED */
+static const char *const class_names[CSMA_NUM_CLASSES] = { "control", "latency", "bulk" };
+#else /* CSMA_WITH_TRAFFIC_CLASSES */
+static const char *const class_names[CSMA_NUM_CLASSES] = { "all" };
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+#if CSMA_WITH_TRAFFIC_CLASSES
+  uint8_t traffic_class;
+  clock_time_t enqueued;
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
 };
 
+#if CSMA_WITH_TRAFFIC_CLASSES
+#define METADATA_CLASS(m) ((m)->traffic_class)
+#else /* CSMA_WITH_TRAFFIC_CLASSES */
+#define METADATA_CLASS(m) 0
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
   struct neighbor_queue *next;
@@ -101,6 +135,18 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+#if CSMA_WITH_TRAFFIC_CLASSES && CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED
+  /* Transmissions left to each class in the current round */
+  uint8_t credits[CSMA_NUM_CLASSES];
+#endif
+#if CSMA_WITH_AGGREGATION
+  /* Packets sent along with the head in its last transmission */
+  struct packet_queue *aggregated[CSMA_AGGREGATION_MAX_PACKETS - 1];
+  uint8_t num_aggregated;
+#endif /* CSMA_WITH_AGGREGATION */
+  /* All packets in arrival order. The head is the packet in service;
+   * with traffic classes, the next one is moved to the head when it
+   * is selected. */
   LIST_STRUCT(packet_queue);
 };
 
@@ -132,11 +178,14 @@ MEMB(packet_memb, struct packet_queue, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+static struct csma_class_stats class_stats[CSMA_NUM_CLASSES];
+
 static void packet_sent(struct neighbor_queue *n,
     struct packet_queue *q,
     int status,
     int num_transmissions);
 static void transmit_from_queue(void *ptr);
+static void free_packet(struct neighbor_queue *n, struct packet_queue *p, int status);
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
@@ -151,6 +200,157 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_WITH_TRAFFIC_CLASSES
+/* Map PACKETBUF_ATTR_TRAFFIC_CLASS to a queue class */
+static uint8_t
+class_from_packetbuf(void)
+{
+  uint16_t tc = packetbuf_attr(PACKETBUF_ATTR_TRAFFIC_CLASS);
+  if(tc == PACKETBUF_ATTR_TRAFFIC_CLASS_NONE || tc > CSMA_NUM_CLASSES) {
+    tc = PACKETBUF_ATTR_TRAFFIC_CLASS_BULK;
+  }
+  return tc - PACKETBUF_ATTR_TRAFFIC_CLASS_CONTROL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+packet_expired(const struct qbuf_metadata *metadata)
+{
+  clock_time_t lifetime = class_lifetime[metadata->traffic_class];
+  return lifetime != 0 && clock_time() - metadata->enqueued >= lifetime;
+}
+/*---------------------------------------------------------------------------*/
+/* Pick the class to serve next among those with packets queued */
+static uint8_t
+select_class(struct neighbor_queue *n, struct packet_queue *first[])
+{
+  uint8_t c;
+#if CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED
+  uint8_t round;
+  for(round = 0; round < 2; round++) {
+    for(c = 0; c < CSMA_NUM_CLASSES; c++) {
+      if(first[c] != NULL && n->credits[c] > 0) {
+        n->credits[c]--;
+        return c;
+      }
+    }
+    /* The backlogged classes used up their credits: start a new round */
+    memcpy(n->credits, class_weights, sizeof(n->credits));
+  }
+#endif /* CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED */
+  /* Strict priority, or all weights of the backlogged classes are zero */
+  for(c = 0; c < CSMA_NUM_CLASSES - 1; c++) {
+    if(first[c] != NULL) {
+      break;
+    }
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+/* Move the packet to send next to the head of the neighbor queue.
+ * Within a class, packets are served in arrival order. */
+static void
+select_next_packet(struct neighbor_queue *n)
+{
+  struct packet_queue *q;
+  struct packet_queue *first[CSMA_NUM_CLASSES] = { NULL };
+  uint8_t c;
+
+  for(q = list_head(n->packet_queue); q != NULL; q = list_item_next(q)) {
+    c = METADATA_CLASS((struct qbuf_metadata *)q->ptr);
+    if(first[c] == NULL) {
+      first[c] = q;
+    }
+  }
+
+  q = first[select_class(n, first)];
+  if(q != NULL && q != list_head(n->packet_queue)) {
+    list_remove(n->packet_queue, q);
+    list_push(n->packet_queue, q);
+  }
+}
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+/*---------------------------------------------------------------------------*/
+#if CSMA_WITH_AGGREGATION
+/* Can p share a frame with q, i.e. are its framing attributes the same? */
+static int
+same_framing(struct packet_queue *q, struct packet_queue *p)
+{
+#if LLSEC802154_USES_AUX_HEADER
+  if(queuebuf_attr(q->buf, PACKETBUF_ATTR_SECURITY_LEVEL)
+     != queuebuf_attr(p->buf, PACKETBUF_ATTR_SECURITY_LEVEL)) {
+    return 0;
+  }
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  if(queuebuf_attr(q->buf, PACKETBUF_ATTR_KEY_INDEX)
+     != queuebuf_attr(p->buf, PACKETBUF_ATTR_KEY_INDEX)) {
+    return 0;
+  }
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_USES_AUX_HEADER */
+  return queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_NO_SRC_ADDR)
+      == queuebuf_attr(p->buf, PACKETBUF_ATTR_MAC_NO_SRC_ADDR)
+    && queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_NO_DEST_ADDR)
+      == queuebuf_attr(p->buf, PACKETBUF_ATTR_MAC_NO_DEST_ADDR);
+}
+/*---------------------------------------------------------------------------*/
+/* The head packet q is in packetbuf. Append the packets queued behind it,
+ * in order, as long as they fit in the frame. The payload then becomes
+ * the aggregate dispatch followed by each packet prefixed with its length. */
+static void
+aggregate(struct neighbor_queue *n, struct packet_queue *q)
+{
+  static uint8_t buf[CSMA_MAC_LEN];
+  struct packet_queue *p;
+  int max_len;
+  int len;
+  int plen;
+
+  n->num_aggregated = 0;
+
+  p = list_item_next(q);
+  if(p == NULL) {
+    return;
+  }
+
+  /* The header and, with LLSEC, the MIC */
+  max_len = csma_security_frame_len();
+  if(max_len < 0) {
+    max_len = CSMA_MAC_MAX_HEADER;
+  }
+  max_len = CSMA_MAC_LEN - max_len;
+  len = 2 + packetbuf_datalen();
+  if(len + 1 + queuebuf_datalen(p->buf) > max_len) {
+    return;
+  }
+
+  buf[0] = SICSLOWPAN_DISPATCH_AGGREGATE;
+  buf[1] = packetbuf_datalen();
+  memcpy(&buf[2], packetbuf_dataptr(), packetbuf_datalen());
+
+  for(; p != NULL && n->num_aggregated < CSMA_AGGREGATION_MAX_PACKETS - 1;
+      p = list_item_next(p)) {
+    plen = queuebuf_datalen(p->buf);
+    if(len + 1 + plen > max_len || !same_framing(q, p)
+#if CSMA_WITH_TRAFFIC_CLASSES
+       || packet_expired((struct qbuf_metadata *)p->ptr)
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+       ) {
+      break;
+    }
+    buf[len++] = plen;
+    memcpy(&buf[len], queuebuf_dataptr(p->buf), plen);
+    len += plen;
+    n->aggregated[n->num_aggregated++] = p;
+  }
+
+  if(n->num_aggregated > 0) {
+    memcpy(packetbuf_dataptr(), buf, len);
+    packetbuf_set_datalen(len);
+    LOG_DBG("aggregated %u packets, len %u\n", n->num_aggregated + 1, len);
+  }
+}
+#endif /* CSMA_WITH_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 backoff_period(void)
 {
@@ -259,6 +459,25 @@ transmit_from_queue(void *ptr)
   struct neighbor_queue *n = ptr;
   if(n) {
     struct packet_queue *q = list_head(n->packet_queue);
+#if CSMA_WITH_TRAFFIC_CLASSES
+    if(q != NULL && packet_expired((struct qbuf_metadata *)q->ptr)) {
+      /* Too late to be useful: drop it and schedule the next packet */
+      struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
+      mac_callback_t sent = metadata->sent;
+      void *cptr = metadata->cptr;
+      uint8_t ntx = n->transmissions;
+      LOG_WARN("dropping expired packet to ");
+      LOG_WARN_LLADDR(&n->addr);
+      LOG_WARN_(", class %s, tx %u\n", class_names[metadata->traffic_class], ntx);
+      class_stats[metadata->traffic_class].expired++;
+#if CSMA_WITH_AGGREGATION
+      n->num_aggregated = 0;
+#endif /* CSMA_WITH_AGGREGATION */
+      free_packet(n, q, MAC_TX_ERR);
+      mac_call_sent_callback(sent, cptr, MAC_TX_ERR, ntx);
+      return;
+    }
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
     if(q != NULL) {
       LOG_INFO("preparing packet for ");
       LOG_INFO_LLADDR(&n->addr);
@@ -267,6 +486,9 @@ transmit_from_queue(void *ptr)
         n->transmissions, list_length(n->packet_queue));
       /* Send first packet in the neighbor queue */
       queuebuf_to_packetbuf(q->buf);
+#if CSMA_WITH_AGGREGATION
+      aggregate(n, q);
+#endif /* CSMA_WITH_AGGREGATION */
       send_one_packet(n, q);
     }
   }
@@ -278,7 +500,13 @@ schedule_transmission(struct neighbor_queue *n)
   clock_time_t delay;
   int backoff_exponent; /* BE in IEEE 802.15.4 */
 
+#if CSMA_WITH_TRAFFIC_CLASSES
+  struct packet_queue *q = list_head(n->packet_queue);
+  backoff_exponent = MIN(n->collisions +
+      class_min_be[METADATA_CLASS((struct qbuf_metadata *)q->ptr)], CSMA_MAX_BE);
+#else /* CSMA_WITH_TRAFFIC_CLASSES */
   backoff_exponent = MIN(n->collisions + CSMA_MIN_BE, CSMA_MAX_BE);
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
 
   /* Compute max delay as per IEEE 802.15.4: 2^BE-1 backoff periods  */
   delay = ((1 << backoff_exponent) - 1) * backoff_period();
@@ -293,21 +521,31 @@ schedule_transmission(struct neighbor_queue *n)
 }
 /*---------------------------------------------------------------------------*/
 static void
+release_packet(struct neighbor_queue *n, struct packet_queue *p)
+{
+  /* Remove packet from queue and deallocate */
+  list_remove(n->packet_queue, p);
+  class_stats[METADATA_CLASS((struct qbuf_metadata *)p->ptr)].queued--;
+
+  queuebuf_free(p->buf);
+  memb_free(&metadata_memb, p->ptr);
+  memb_free(&packet_memb, p);
+}
+/*---------------------------------------------------------------------------*/
+static void
 free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
 {
   if(p != NULL) {
-    /* Remove packet from queue and deallocate */
-    list_remove(n->packet_queue, p);
-
-    queuebuf_free(p->buf);
-    memb_free(&metadata_memb, p->ptr);
-    memb_free(&packet_memb, p);
+    release_packet(n, p);
     LOG_DBG("free_queued_packet, queue length %d, free packets %d\n",
            list_length(n->packet_queue), memb_numfree(&packet_memb));
     if(list_head(n->packet_queue) != NULL) {
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
+#if CSMA_WITH_TRAFFIC_CLASSES
+      select_next_packet(n);
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
       /* Schedule next transmissions */
       schedule_transmission(n);
     } else {
@@ -326,12 +564,39 @@ tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
   struct qbuf_metadata *metadata;
   void *cptr;
   uint8_t ntx;
+#if CSMA_WITH_AGGREGATION
+  struct qbuf_metadata aggregated[CSMA_AGGREGATION_MAX_PACKETS - 1];
+  uint8_t i, num_aggregated;
+#endif /* CSMA_WITH_AGGREGATION */
 
   metadata = (struct qbuf_metadata *)q->ptr;
   sent = metadata->sent;
   cptr = metadata->cptr;
   ntx = n->transmissions;
 
+  if(status == MAC_TX_OK) {
+    class_stats[METADATA_CLASS(metadata)].sent++;
+  } else {
+    class_stats[METADATA_CLASS(metadata)].failed++;
+  }
+
+#if CSMA_WITH_AGGREGATION
+  /* The packets that shared the frame share its fate. Release them
+   * before the head, which may free the neighbor. */
+  num_aggregated = n->num_aggregated;
+  n->num_aggregated = 0;
+  for(i = 0; i < num_aggregated; i++) {
+    metadata = (struct qbuf_metadata *)n->aggregated[i]->ptr;
+    aggregated[i] = *metadata;
+    if(status == MAC_TX_OK) {
+      class_stats[METADATA_CLASS(metadata)].sent++;
+    } else {
+      class_stats[METADATA_CLASS(metadata)].failed++;
+    }
+    release_packet(n, n->aggregated[i]);
+  }
+#endif /* CSMA_WITH_AGGREGATION */
+
   LOG_INFO("packet sent to ");
   LOG_INFO_LLADDR(&n->addr);
   LOG_INFO_(", seqno %u, status %u, tx %u, coll %u\n",
@@ -340,15 +605,25 @@ tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
 
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
+#if CSMA_WITH_AGGREGATION
+  for(i = 0; i < num_aggregated; i++) {
+    mac_call_sent_callback(aggregated[i].sent, aggregated[i].cptr, status, ntx);
+  }
+#endif /* CSMA_WITH_AGGREGATION */
 }
 /*---------------------------------------------------------------------------*/
 static void
 rexmit(struct packet_queue *q, struct neighbor_queue *n)
 {
-  schedule_transmission(n);
   /* This is needed to correctly attribute energy that we spent
      transmitting this packet. */
-  queuebuf_update_attr_from_packetbuf(q->buf);
+  if(!queuebuf_update_attr_from_packetbuf(q->buf)) {
+    /* The queuebuf would keep stale attributes, so drop the packet */
+    LOG_WARN("could not update queued packet, dropping it\n");
+    tx_done(MAC_TX_ERR, q, n);
+    return;
+  }
+  schedule_transmission(n);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -442,6 +717,7 @@ csma_output_packet(mac_callback_t sent, void *ptr)
 {
   struct packet_queue *q;
   struct neighbor_queue *n;
+  struct csma_class_stats *stats;
   static uint8_t initialized = 0;
   static uint8_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -460,6 +736,12 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno++);
   packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
 
+#if CSMA_WITH_TRAFFIC_CLASSES
+  stats = &class_stats[class_from_packetbuf()];
+#else /* CSMA_WITH_TRAFFIC_CLASSES */
+  stats = &class_stats[0];
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
@@ -470,6 +752,12 @@ csma_output_packet(mac_callback_t sent, void *ptr)
       linkaddr_copy(&n->addr, addr);
       n->transmissions = 0;
       n->collisions = 0;
+#if CSMA_WITH_TRAFFIC_CLASSES && CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_WEIGHTED
+      memcpy(n->credits, class_weights, sizeof(n->credits));
+#endif
+#if CSMA_WITH_AGGREGATION
+      n->num_aggregated = 0;
+#endif /* CSMA_WITH_AGGREGATION */
       /* Init packet queue for this neighbor */
       LIST_STRUCT_INIT(n, packet_queue);
       /* Add neighbor to the neighbor list */
@@ -495,7 +783,25 @@ csma_output_packet(mac_callback_t sent, void *ptr)
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
+#if CSMA_WITH_TRAFFIC_CLASSES
+            metadata->traffic_class = stats - class_stats;
+            metadata->enqueued = clock_time();
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
             list_add(n->packet_queue, q);
+#if CSMA_WITH_TRAFFIC_CLASSES && CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_STRICT
+            /* Preempt a lower-class head that was not attempted yet */
+            struct packet_queue *head = list_head(n->packet_queue);
+            if(head != q && n->transmissions == 0 && n->collisions == 0
+               && METADATA_CLASS((struct qbuf_metadata *)head->ptr) > metadata->traffic_class) {
+              list_remove(n->packet_queue, q);
+              list_push(n->packet_queue, q);
+              ctimer_stop(&n->transmit_timer);
+            }
+#endif /* CSMA_WITH_TRAFFIC_CLASSES && CSMA_CLASS_SCHEDULING == CSMA_CLASS_SCHEDULING_STRICT */
+            stats->enqueued++;
+            if(++stats->queued > stats->peak) {
+              stats->peak = stats->queued;
+            }
 
             LOG_INFO("sending to ");
             LOG_INFO_LLADDR(addr);
@@ -527,13 +833,27 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   } else {
     LOG_WARN("could not allocate neighbor, dropping packet\n");
   }
+  stats->overflows++;
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
+const struct csma_class_stats *
+csma_output_class_stats(uint8_t traffic_class)
+{
+  return traffic_class < CSMA_NUM_CLASSES ? &class_stats[traffic_class] : NULL;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+csma_output_class_name(uint8_t traffic_class)
+{
+  return traffic_class < CSMA_NUM_CLASSES ? class_names[traffic_class] : NULL;
+}
+/*---------------------------------------------------------------------------*/
 void
 csma_output_init(void)
 {
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+  memset(class_stats, 0, sizeof(class_stats));
 }
@@ -219,12 +219,16 @@ csma_security_create_frame(void)
 int
 csma_security_frame_len(void)
 {
-  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) > 0 &&
+  int hdr_len;
+
+  hdr_len = NETSTACK_FRAMER.length();
+  if(hdr_len >= 0 &&
+     packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) > 0 &&
      LLSEC_KEY_INDEX != 0xffff) {
-    return NETSTACK_FRAMER.length() +
+    return hdr_len +
       MIC_LEN(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) & 0x07);
   }
-  return NETSTACK_FRAMER.length();
+  return hdr_len;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -298,6 +302,11 @@ csma_security_create_frame(void)
   return NETSTACK_FRAMER.create();
 }
 int
+csma_security_frame_len(void)
+{
+  return NETSTACK_FRAMER.length();
+}
+int
 csma_security_parse_frame(void)
 {
   return NETSTACK_FRAMER.parse();
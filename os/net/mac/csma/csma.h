@@ -43,6 +43,7 @@
 
 #include "contiki.h"
 #include "net/mac/mac.h"
+#include "net/packetbuf.h"
 #include "dev/radio.h"
 
 #ifdef CSMA_CONF_SEND_SOFT_ACK
@@ -75,15 +76,98 @@
 /* just a default - with LLSEC, etc */
 #define CSMA_MAC_MAX_HEADER 21
 
+/* Per-neighbor queues ordered by traffic class (control, latency-sensitive,
+ * bulk), as tagged by the upper layers in PACKETBUF_ATTR_TRAFFIC_CLASS.
+ * When disabled, every neighbor queue is a single FIFO. Enabled by default
+ * when packets carry a traffic class (PACKETBUF_CONF_WITH_TRAFFIC_CLASS). */
+#ifdef CSMA_CONF_WITH_TRAFFIC_CLASSES
+#define CSMA_WITH_TRAFFIC_CLASSES CSMA_CONF_WITH_TRAFFIC_CLASSES
+#else /* CSMA_CONF_WITH_TRAFFIC_CLASSES */
+#define CSMA_WITH_TRAFFIC_CLASSES PACKETBUF_WITH_TRAFFIC_CLASS
+#endif /* CSMA_CONF_WITH_TRAFFIC_CLASSES */
+
+#if CSMA_WITH_TRAFFIC_CLASSES && !PACKETBUF_WITH_TRAFFIC_CLASS
+#error "CSMA_CONF_WITH_TRAFFIC_CLASSES requires PACKETBUF_CONF_WITH_TRAFFIC_CLASS"
+#endif
+
+#if CSMA_WITH_TRAFFIC_CLASSES
+#define CSMA_NUM_CLASSES 3
+#else /* CSMA_WITH_TRAFFIC_CLASSES */
+#define CSMA_NUM_CLASSES 1
+#endif /* CSMA_WITH_TRAFFIC_CLASSES */
+
+/* Class scheduling: strict priority, or weighted round-robin where each
+ * class gets up to CSMA_CLASS_WEIGHTS[class] transmissions per round */
+#define CSMA_CLASS_SCHEDULING_STRICT   0
+#define CSMA_CLASS_SCHEDULING_WEIGHTED 1
+
+#ifdef CSMA_CONF_CLASS_SCHEDULING
+#define CSMA_CLASS_SCHEDULING CSMA_CONF_CLASS_SCHEDULING
+#else /* CSMA_CONF_CLASS_SCHEDULING */
+#define CSMA_CLASS_SCHEDULING CSMA_CLASS_SCHEDULING_STRICT
+#endif /* CSMA_CONF_CLASS_SCHEDULING */
+
+/* Weights of the control, latency and bulk classes (weighted scheduling only) */
+#ifdef CSMA_CONF_CLASS_WEIGHTS
+#define CSMA_CLASS_WEIGHTS CSMA_CONF_CLASS_WEIGHTS
+#else /* CSMA_CONF_CLASS_WEIGHTS */
+#define CSMA_CLASS_WEIGHTS { 4, 2, 1 }
+#endif /* CSMA_CONF_CLASS_WEIGHTS */
+
+/* Lifetime of a queued packet per class, in clock ticks. A packet still
+ * queued when its lifetime elapses is dropped instead of sent. 0: no limit */
+#ifdef CSMA_CONF_CLASS_LIFETIME
+#define CSMA_CLASS_LIFETIME CSMA_CONF_CLASS_LIFETIME
+#else /* CSMA_CONF_CLASS_LIFETIME */
+#define CSMA_CLASS_LIFETIME { 0, CLOCK_SECOND, 0 }
+#endif /* CSMA_CONF_CLASS_LIFETIME */
+
+/* Pack packets queued for the same neighbor into a single frame, with the
+ * SICSLOWPAN_DISPATCH_AGGREGATE dispatch, when they fit. Saves a backoff,
+ * CCA and ACK per packet. This dispatch is not standard: all nodes must
+ * enable it, as the receiver splits the frame in 6LoWPAN input. */
+#ifdef CSMA_CONF_WITH_AGGREGATION
+#define CSMA_WITH_AGGREGATION CSMA_CONF_WITH_AGGREGATION
+#else /* CSMA_CONF_WITH_AGGREGATION */
+#define CSMA_WITH_AGGREGATION 0
+#endif /* CSMA_CONF_WITH_AGGREGATION */
+
+/* Max number of packets in an aggregate frame */
+#ifdef CSMA_CONF_AGGREGATION_MAX_PACKETS
+#define CSMA_AGGREGATION_MAX_PACKETS CSMA_CONF_AGGREGATION_MAX_PACKETS
+#else /* CSMA_CONF_AGGREGATION_MAX_PACKETS */
+#define CSMA_AGGREGATION_MAX_PACKETS 4
+#endif /* CSMA_CONF_AGGREGATION_MAX_PACKETS */
+
+/* Per-class queue statistics */
+struct csma_class_stats {
+  uint16_t queued;      /* Packets currently queued, all neighbors */
+  uint16_t peak;        /* Highest number of packets queued at once */
+  uint32_t enqueued;    /* Packets accepted in a queue */
+  uint32_t sent;        /* Packets sent successfully */
+  uint32_t failed;      /* Packets dropped after their last transmission attempt */
+  uint32_t expired;     /* Packets dropped as their lifetime elapsed */
+  uint32_t overflows;   /* Packets rejected as the queue or the pool was full */
+};
+
 
 extern const struct mac_driver csma_driver;
 
 /* CSMA security framer functions */
 int csma_security_create_frame(void);
+/* Length of the header and MIC that the framer will add to the packetbuf,
+ * negative if framing fails */
+int csma_security_frame_len(void);
 int csma_security_parse_frame(void);
 
 /* key management for CSMA */
 int csma_security_set_key(uint8_t index, const uint8_t *key);
 
+/* Queue statistics of a traffic class, 0..CSMA_NUM_CLASSES-1, in priority
+ * order. Returns NULL for an invalid class */
+const struct csma_class_stats *csma_output_class_stats(uint8_t traffic_class);
+/* Name of a traffic class, for display */
+const char *csma_output_class_name(uint8_t traffic_class);
+
 
 #endif /* CSMA_H_ */
@@ -56,6 +56,13 @@ struct tsch_asn_divisor_t {
   uint16_t asn_ms1b_remainder; /* Remainder of the operation 0x100000000 / val */
 };
 
+/** \brief The last result of a modulo operation on ASN, for incremental updates */
+struct tsch_asn_mod_cache_t {
+  struct tsch_asn_t asn; /* ASN the cached result belongs to */
+  uint16_t div; /* Divisor value the result was computed for; 0 if invalid */
+  uint16_t mod; /* asn % div */
+};
+
 /************ Macros **********/
 
 /** \brief Initialize ASN */
@@ -95,5 +102,43 @@ struct tsch_asn_divisor_t {
    + (uint16_t)((asn).ms1b * (div).asn_ms1b_remainder % (div).val)) \
   % (div).val
 
+/** \brief Invalidate a struct tsch_asn_mod_cache_t */
+#define TSCH_ASN_MOD_CACHE_INIT(cache) do { \
+    (cache).div = 0; \
+} while(0);
+
+/************ Functions *******/
+
+/**
+ * \brief Returns the same as TSCH_ASN_MOD, but advances the result of the
+ * previous call instead of computing it from scratch when the ASN has moved
+ * forward (by less than 2^32 slots) since. Slot operation walks the ASN
+ * forward a few slots at a time, which turns the two 32-bit divisions of
+ * TSCH_ASN_MOD into an addition and a compare in the common case.
+ */
+static inline uint16_t
+tsch_asn_mod_cached(const struct tsch_asn_t *asn, const struct tsch_asn_divisor_t *div,
+                    struct tsch_asn_mod_cache_t *cache)
+{
+  uint32_t diff = TSCH_ASN_DIFF(*asn, cache->asn);
+  /* The ms1b the ASN has if it is 'diff' slots ahead of the cached one.
+   * 16 bits wide, so that a wrap of the 5-byte ASN is not taken as a step. */
+  uint16_t ms1b = cache->asn.ms1b + (asn->ls4b < cache->asn.ls4b ? 1 : 0);
+  uint32_t mod;
+
+  if(cache->div == div->val && asn->ms1b == ms1b) {
+    mod = cache->mod + (diff < div->val ? diff : diff % div->val);
+    if(mod >= div->val) {
+      mod -= div->val;
+    }
+  } else {
+    mod = TSCH_ASN_MOD(*asn, *div);
+    cache->div = div->val;
+  }
+  cache->asn = *asn;
+  cache->mod = mod;
+  return mod;
+}
+
 #endif /* __TSCH_ASN_H__ */
 /** @} */
@@ -362,6 +362,16 @@
 #define TSCH_WITH_LINK_SELECTOR (BUILD_WITH_ORCHESTRA)
 #endif /* TSCH_CONF_WITH_LINK_SELECTOR */
 
+/* Let dedicated Tx links to a neighbor carry any packet queued for it,
+ * whatever link the link selector assigned the packet to. Needed when
+ * cells are added on demand, e.g. by Orchestra's traffic-adaptive rule,
+ * so that packets already queued can use them. */
+#ifdef TSCH_CONF_DEDICATED_LINKS_ANY_PACKET
+#define TSCH_DEDICATED_LINKS_ANY_PACKET TSCH_CONF_DEDICATED_LINKS_ANY_PACKET
+#else /* TSCH_CONF_DEDICATED_LINKS_ANY_PACKET */
+#define TSCH_DEDICATED_LINKS_ANY_PACKET 0
+#endif /* TSCH_CONF_DEDICATED_LINKS_ANY_PACKET */
+
 /******** Configuration: CSMA *******/
 
 /* TSCH CSMA-CA parameters, see IEEE 802.15.4e-2012 */
@@ -33,7 +33,8 @@
 /**
  * \file
  *         Per-neighbor packet queues for TSCH MAC.
- *         The list of neighbors uses the TSCH lock, but per-neighbor packet array are lock-free.
+ *         Neighbors are added lock-free, removed under the TSCH lock. Per-neighbor
+ *         packet arrays are lock-free single-producer/single-consumer rings.
  *				 Read-only operation on neighbor and packets are allowed from interrupts and outside of them.
  *				 *Other operations are allowed outside of interrupt only.*
  * \author
@@ -53,6 +54,8 @@
 #include "lib/random.h"
 #include "net/queuebuf.h"
 #include "net/mac/tsch/tsch.h"
+#include "sys/int-master.h"
+#include "sys/memory-barrier.h"
 #include <string.h>
 
 /* Log configuration */
@@ -74,6 +77,55 @@ LIST(neighbor_list);
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+/* Head of the ready list: unicast neighbors that have queued packets but
+ * no tx link, in the order they became ready. The list is modified with
+ * interrupts disabled, as packets are dequeued from the slot operation. */
+static struct tsch_neighbor *ready_head;
+
+/*---------------------------------------------------------------------------*/
+/* Adds or removes a neighbor from the ready list, as needed */
+void
+tsch_queue_update_ready(struct tsch_neighbor *n)
+{
+  int_master_status_t status;
+  int ready;
+
+  if(n == NULL) {
+    return;
+  }
+
+  ready = !n->is_broadcast && n->tx_links_count == 0
+    && !ringbufindex_empty(&n->tx_ringbuf);
+
+  status = int_master_read_and_disable();
+  if(ready && n->ready_next == NULL) {
+    /* Append to the tail of the circular list */
+    if(ready_head == NULL) {
+      n->ready_next = n;
+      n->ready_prev = n;
+      ready_head = n;
+    } else {
+      n->ready_next = ready_head;
+      n->ready_prev = ready_head->ready_prev;
+      ready_head->ready_prev->ready_next = n;
+      ready_head->ready_prev = n;
+    }
+  } else if(!ready && n->ready_next != NULL) {
+    if(n->ready_next == n) {
+      ready_head = NULL;
+    } else {
+      n->ready_prev->ready_next = n->ready_next;
+      n->ready_next->ready_prev = n->ready_prev;
+      if(ready_head == n) {
+        ready_head = n->ready_next;
+      }
+    }
+    n->ready_next = NULL;
+    n->ready_prev = NULL;
+  }
+  int_master_status_set(status);
+}
+
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -82,22 +134,26 @@ tsch_queue_add_nbr(const linkaddr_t *addr)
   struct tsch_neighbor *n = NULL;
   /* If we have an entry for this neighbor already, we simply update it */
   n = tsch_queue_get_nbr(addr);
-  if(n == NULL) {
-    if(tsch_get_lock()) {
-      /* Allocate a neighbor */
+  if(n == NULL && !tsch_is_locked()) {
+    /* Allocate a neighbor, reclaiming unused ones if we ran out */
+    n = memb_alloc(&neighbor_memb);
+    if(n == NULL) {
+      tsch_queue_free_unused_neighbors();
       n = memb_alloc(&neighbor_memb);
-      if(n != NULL) {
-        /* Initialize neighbor entry */
-        memset(n, 0, sizeof(struct tsch_neighbor));
-        ringbufindex_init(&n->tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
-        linkaddr_copy(&n->addr, addr);
-        n->is_broadcast = linkaddr_cmp(addr, &tsch_eb_address)
-          || linkaddr_cmp(addr, &tsch_broadcast_address);
-        tsch_queue_backoff_reset(n);
-        /* Add neighbor to the list */
-        list_add(neighbor_list, n);
-      }
-      tsch_release_lock();
+    }
+    if(n != NULL) {
+      /* Initialize neighbor entry */
+      memset(n, 0, sizeof(struct tsch_neighbor));
+      ringbufindex_init(&n->tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
+      linkaddr_copy(&n->addr, addr);
+      n->is_broadcast = linkaddr_cmp(addr, &tsch_eb_address)
+        || linkaddr_cmp(addr, &tsch_broadcast_address);
+      tsch_queue_backoff_reset(n);
+      /* Add neighbor to the list. No need for the TSCH lock: the slot
+       * operation only reads the list, and list_add links the entry at
+       * the tail in a single store, once it is fully initialized. */
+      memory_barrier();
+      list_add(neighbor_list, n);
     }
   }
   return n;
@@ -254,6 +310,7 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+            tsch_queue_update_ready(n);
             LOG_DBG("packet is added put_index %u, packet %p\n",
                    put_index, p);
             return p;
@@ -295,10 +352,16 @@ tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n)
 {
   if(!tsch_is_locked()) {
     if(n != NULL) {
-      /* Get and remove packet from ringbuf (remove committed through an atomic operation */
-      int16_t get_index = ringbufindex_get(&n->tx_ringbuf);
+      /* Read the packet before removing it from ringbuf (remove committed
+       * through an atomic operation), as the slot is free for reuse after */
+      int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf);
       if(get_index != -1) {
-        return n->tx_array[get_index];
+        struct tsch_packet *p = n->tx_array[get_index];
+        ringbufindex_get(&n->tx_ringbuf);
+        if(ringbufindex_empty(&n->tx_ringbuf)) {
+          tsch_queue_update_ready(n);
+        }
+        return p;
       } else {
         return NULL;
       }
@@ -417,13 +480,20 @@ tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *l
           !(is_shared_link && !tsch_queue_backoff_expired(n))) {    /* If this is a shared link,
                                                                     make sure the backoff has expired */
 #if TSCH_WITH_LINK_SELECTOR
-        int packet_attr_slotframe = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
-        int packet_attr_timeslot = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
-        if(packet_attr_slotframe != 0xffff && packet_attr_slotframe != link->slotframe_handle) {
-          return NULL;
-        }
-        if(packet_attr_timeslot != 0xffff && packet_attr_timeslot != link->timeslot) {
-          return NULL;
+#if TSCH_DEDICATED_LINKS_ANY_PACKET
+        /* Dedicated links to this very neighbor (e.g. negotiated with 6P)
+         * may carry any of its packets, whatever link was selected for it */
+        if(link == NULL || is_shared_link || !linkaddr_cmp(&link->addr, &n->addr))
+#endif /* TSCH_DEDICATED_LINKS_ANY_PACKET */
+        {
+          int packet_attr_slotframe = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
+          int packet_attr_timeslot = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
+          if(packet_attr_slotframe != 0xffff && packet_attr_slotframe != link->slotframe_handle) {
+            return NULL;
+          }
+          if(packet_attr_timeslot != 0xffff && packet_attr_timeslot != link->timeslot) {
+            return NULL;
+          }
         }
 #endif
         return n->tx_array[get_index];
@@ -449,20 +519,23 @@ struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
-    struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
+    /* Only the ready list holds non-broadcast neighbors with packets that
+     * we do not have a tx link to. This runs from the slot operation, so
+     * the list does not change under our feet. */
+    struct tsch_neighbor *curr_nbr = ready_head;
     struct tsch_packet *p = NULL;
     while(curr_nbr != NULL) {
-      if(!curr_nbr->is_broadcast && curr_nbr->tx_links_count == 0) {
-        /* Only look up for non-broadcast neighbors we do not have a tx link to */
-        p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
-        if(p != NULL) {
-          if(n != NULL) {
-            *n = curr_nbr;
-          }
-          return p;
+      p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+      if(p != NULL) {
+        if(n != NULL) {
+          *n = curr_nbr;
         }
+        return p;
+      }
+      curr_nbr = curr_nbr->ready_next;
+      if(curr_nbr == ready_head) {
+        break;
       }
-      curr_nbr = list_item_next(curr_nbr);
     }
   }
   return NULL;
@@ -521,6 +594,7 @@ void
 tsch_queue_init(void)
 {
   list_init(neighbor_list);
+  ready_head = NULL;
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
   /* Add virtual EB and the broadcast neighbors */
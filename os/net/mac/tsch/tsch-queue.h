@@ -153,6 +153,13 @@ struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr,
  * \return The packet if any, else NULL
  */
 struct tsch_packet *tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link);
+/**
+ * \brief Update the membership of a neighbor in the ready list used by
+ * tsch_queue_get_unicast_packet_for_any. Must be called after the tx link
+ * counters of the neighbor have changed.
+ * \param n The neighbor queue
+ */
+void tsch_queue_update_ready(struct tsch_neighbor *n);
 /**
  * \brief Is the neighbor backoff timer expired?
  * \param n The neighbor queue
@@ -66,6 +66,68 @@ MEMB(link_memb, struct tsch_link, TSCH_SCHEDULE_MAX_LINKS);
 MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
+/* Schedule index: the links of all slotframes, one segment per slotframe
+ * in the order of slotframe_list, sorted by timeslot within a segment.
+ * It is updated when links are added or removed, so that the next link
+ * of a slotframe is found with a binary search in the slot operation. */
+static struct tsch_link *link_index[TSCH_SCHEDULE_MAX_LINKS];
+static uint16_t link_index_len;
+
+/*---------------------------------------------------------------------------*/
+/* Returns the position of the first link of a slotframe with a timeslot
+ * greater than (or equal to, if inclusive) the given timeslot */
+static uint16_t
+link_index_search(const struct tsch_slotframe *sf, uint16_t timeslot, int inclusive)
+{
+  uint16_t lo = sf->index_start;
+  uint16_t hi = sf->index_start + sf->index_len;
+
+  while(lo < hi) {
+    uint16_t mid = lo + (hi - lo) / 2;
+    if(link_index[mid]->timeslot < timeslot ||
+       (!inclusive && link_index[mid]->timeslot == timeslot)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+/*---------------------------------------------------------------------------*/
+/* Inserts a link in the schedule index. Called with the lock taken. */
+static void
+link_index_insert(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = link_index_search(sf, l->timeslot, 1);
+
+  memmove(&link_index[pos + 1], &link_index[pos],
+          (link_index_len - pos) * sizeof(link_index[0]));
+  link_index[pos] = l;
+  link_index_len++;
+  sf->index_len++;
+  /* The segments of the following slotframes move up by one */
+  for(sf = list_item_next(sf); sf != NULL; sf = list_item_next(sf)) {
+    sf->index_start++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Removes a link from the schedule index. Called with the lock taken. */
+static void
+link_index_remove(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = link_index_search(sf, l->timeslot, 1);
+
+  if(pos >= sf->index_start + sf->index_len || link_index[pos] != l) {
+    return;
+  }
+  link_index_len--;
+  memmove(&link_index[pos], &link_index[pos + 1],
+          (link_index_len - pos) * sizeof(link_index[0]));
+  sf->index_len--;
+  for(sf = list_item_next(sf); sf != NULL; sf = list_item_next(sf)) {
+    sf->index_start--;
+  }
+}
 
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
@@ -86,7 +148,11 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       /* Initialize the slotframe */
       sf->handle = handle;
       TSCH_ASN_DIVISOR_INIT(sf->size, size);
+      TSCH_ASN_MOD_CACHE_INIT(sf->timeslot_cache);
       LIST_STRUCT_INIT(sf, links_list);
+      /* The slotframe's (empty) segment is at the end of the index */
+      sf->index_start = link_index_len;
+      sf->index_len = 0;
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -251,11 +317,13 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
         l->slotframe_handle = slotframe->handle;
         l->timeslot = timeslot;
         l->channel_offset = channel_offset;
+        l->tx_nbr = NULL;
         l->data = NULL;
         if(address == NULL) {
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+        link_index_insert(slotframe, l);
 
         LOG_INFO("add_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
                  slotframe->handle,
@@ -274,7 +342,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
             if(!(l->link_options & LINK_OPTION_SHARED)) {
               n->dedicated_tx_links_count++;
             }
+            tsch_queue_update_ready(n);
           }
+          l->tx_nbr = n;
         }
       }
     }
@@ -308,6 +378,7 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
       LOG_INFO_LLADDR(&l->addr);
       LOG_INFO_("\n");
 
+      link_index_remove(slotframe, l);
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
 
@@ -322,6 +393,7 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
           if(!(link_options & LINK_OPTION_SHARED)) {
             n->dedicated_tx_links_count--;
           }
+          tsch_queue_update_ready(n);
         }
       }
 
@@ -347,15 +419,12 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
-      struct tsch_link *l = list_head(slotframe->links_list);
-      /* Loop over all items. Assume there is max one link per timeslot */
-      while(l != NULL) {
-        if(l->timeslot == timeslot) {
-          return l;
-        }
-        l = list_item_next(l);
+      /* There is max one link per timeslot */
+      uint16_t pos = link_index_search(slotframe, timeslot, 1);
+      if(pos < slotframe->index_start + slotframe->index_len &&
+         link_index[pos]->timeslot == timeslot) {
+        return link_index[pos];
       }
-      return l;
     }
   }
   return NULL;
@@ -376,10 +445,14 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
     struct tsch_slotframe *sf = list_head(slotframe_list);
     /* For each slotframe, look for the earliest occurring link */
     while(sf != NULL) {
-      /* Get timeslot from ASN, given the slotframe length */
-      uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
-      struct tsch_link *l = list_head(sf->links_list);
-      while(l != NULL) {
+      if(sf->index_len > 0) {
+        /* Get timeslot from ASN, given the slotframe length */
+        uint16_t timeslot = tsch_asn_mod_cached(asn, &sf->size, &sf->timeslot_cache);
+        /* The first link after the timeslot, or else the first link of
+         * the next slotframe iteration */
+        uint16_t pos = link_index_search(sf, timeslot, 0);
+        struct tsch_link *l = link_index[
+          pos < sf->index_start + sf->index_len ? pos : sf->index_start];
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
@@ -421,8 +494,6 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
             curr_best = new_best;
           }
         }
-
-        l = list_item_next(l);
       }
       sf = list_item_next(sf);
     }
@@ -444,6 +515,7 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+    link_index_len = 0;
     tsch_release_lock();
     return 1;
   } else {
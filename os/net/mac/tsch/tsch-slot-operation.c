@@ -237,12 +237,20 @@ tsch_release_lock(void)
 /*---------------------------------------------------------------------------*/
 /* Channel hopping utility functions */
 
+/* Hopping sequence index of the last ASN a channel was calculated for.
+ * Only used from slot operation, which moves the ASN forward. */
+static struct tsch_asn_mod_cache_t hopping_index_cache;
+
 /* Return channel from ASN and channel offset */
 uint8_t
 tsch_calculate_channel(struct tsch_asn_t *asn, uint8_t channel_offset)
 {
-  uint16_t index_of_0 = TSCH_ASN_MOD(*asn, tsch_hopping_sequence_length);
-  uint16_t index_of_offset = (index_of_0 + channel_offset) % tsch_hopping_sequence_length.val;
+  uint16_t index_of_0 = tsch_asn_mod_cached(asn, &tsch_hopping_sequence_length,
+                                            &hopping_index_cache);
+  uint16_t index_of_offset = index_of_0 + channel_offset;
+  if(index_of_offset >= tsch_hopping_sequence_length.val) {
+    index_of_offset %= tsch_hopping_sequence_length.val;
+  }
   return tsch_hopping_sequence[index_of_offset];
 }
 
@@ -274,7 +282,8 @@ check_timer_miss(rtimer_clock_t ref_time, rtimer_clock_t offset, rtimer_clock_t
  * Provides basic protection against missed deadlines and timer overflows
  * A return value of zero signals a missed deadline: no rtimer was scheduled. */
 static uint8_t
-tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_clock_t offset, const char *str)
+tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_clock_t offset,
+                             enum tsch_slot_phase phase, const char *str)
 {
   rtimer_clock_t now = RTIMER_NOW();
   int r;
@@ -282,7 +291,16 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
    * because we can not schedule rtimer less than RTIMER_GUARD in the future */
   int missed = check_timer_miss(ref_time, offset - RTIMER_GUARD, now);
 
+  /* The slack is what is left before the miss check would fail */
+  tsch_stats_slot_timing(phase, RTIMER_CLOCK_DIFF(ref_time + offset - RTIMER_GUARD, now),
+                         now - (phase == TSCH_SLOT_PHASE_END ? ref_time : current_slot_start));
+
   if(missed) {
+#if TSCH_STATS_SLOT_TIMING
+    if(phase == TSCH_SLOT_PHASE_END) {
+      tsch_slot_timing_stats.skipped_missed++;
+    }
+#endif /* TSCH_STATS_SLOT_TIMING */
     TSCH_LOG_ADD(tsch_log_message,
                 snprintf(log->message, sizeof(log->message),
                     "!dl-miss %s %d %d",
@@ -303,9 +321,9 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
 /* Schedule slot operation conditionally, and YIELD if success only.
  * Always attempt to schedule RTIMER_GUARD before the target to make sure to wake up
  * ahead of time and then busy wait to exactly hit the target. */
-#define TSCH_SCHEDULE_AND_YIELD(pt, tm, ref_time, offset, str) \
+#define TSCH_SCHEDULE_AND_YIELD(pt, tm, ref_time, offset, phase, str) \
   do { \
-    if(tsch_schedule_slot_operation(tm, ref_time, offset - RTIMER_GUARD, str)) { \
+    if(tsch_schedule_slot_operation(tm, ref_time, offset - RTIMER_GUARD, phase, str)) { \
       PT_YIELD(pt); \
       RTIMER_BUSYWAIT_UNTIL_ABS(0, ref_time, offset); \
     } \
@@ -330,7 +348,7 @@ get_packet_and_neighbor_for_link(struct tsch_link *link, struct tsch_neighbor **
       /* NORMAL link or no EB to send, pick a data packet */
       if(p == NULL) {
         /* Get neighbor queue associated to the link and get packet from it */
-        n = tsch_queue_get_nbr(&link->addr);
+        n = link->tx_nbr != NULL ? link->tx_nbr : tsch_queue_get_nbr(&link->addr);
         p = tsch_queue_get_packet_for_nbr(n, link);
         /* if it is a broadcast slot and there were no broadcast packets, pick any unicast packet */
         if(p == NULL && n == n_broadcast) {
@@ -503,7 +521,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #if TSCH_CCA_ENABLED
         cca_status = 1;
         /* delay before CCA */
-        TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_cca_offset], "cca");
+        TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_cca_offset], TSCH_SLOT_PHASE_OFFSET, "cca");
         TSCH_DEBUG_TX_EVENT();
         tsch_radio_on(TSCH_RADIO_CMD_ON_WITHIN_TIMESLOT);
         /* CCA */
@@ -518,7 +536,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* TSCH_CCA_ENABLED */
         {
           /* delay before TX */
-          TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
+          TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, TSCH_SLOT_PHASE_OFFSET, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
           /* send packet already in radio tx buffer */
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
@@ -550,7 +568,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* TSCH_HW_FRAME_FILTERING */
               /* Unicast: wait for ack after tx: sleep until ack time */
               TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start,
-                  tsch_timing[tsch_ts_tx_offset] + tx_duration + tsch_timing[tsch_ts_rx_ack_delay] - RADIO_DELAY_BEFORE_RX, "TxBeforeAck");
+                  tsch_timing[tsch_ts_tx_offset] + tx_duration + tsch_timing[tsch_ts_rx_ack_delay] - RADIO_DELAY_BEFORE_RX, TSCH_SLOT_PHASE_ACK, "TxBeforeAck");
               TSCH_DEBUG_TX_EVENT();
               tsch_radio_on(TSCH_RADIO_CMD_ON_WITHIN_TIMESLOT);
               /* Wait for ACK to come */
@@ -653,6 +671,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
     current_packet->transmissions++;
     current_packet->ret = mac_tx_status;
 
+#ifdef TSCH_CALLBACK_LINK_USED
+    TSCH_CALLBACK_LINK_USED(current_link, 1);
+#endif
+
     /* Post TX: Update neighbor queue state */
     in_queue = tsch_queue_packet_sent(current_neighbor, current_packet, current_link, mac_tx_status);
 
@@ -735,7 +757,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     current_input = &input_array[input_index];
 
     /* Wait before starting to listen */
-    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
+    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, TSCH_SLOT_PHASE_OFFSET, "RxBeforeListen");
     TSCH_DEBUG_RX_EVENT();
 
     /* Start radio for at least guard time */
@@ -866,7 +888,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 
                 /* Wait for time to ACK and transmit ACK */
                 TSCH_SCHEDULE_AND_YIELD(pt, t, rx_start_time,
-                                        packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - RADIO_DELAY_BEFORE_TX, "RxBeforeAck");
+                                        packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - RADIO_DELAY_BEFORE_TX, TSCH_SLOT_PHASE_ACK, "RxBeforeAck");
                 TSCH_DEBUG_RX_EVENT();
                 NETSTACK_RADIO.transmit(ack_len);
                 tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
@@ -894,6 +916,10 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
             /* Add current input to ringbuf */
             ringbufindex_put(&input_ringbuf);
 
+#ifdef TSCH_CALLBACK_LINK_USED
+            TSCH_CALLBACK_LINK_USED(current_link, 0);
+#endif
+
             /* If the neighbor is known, update its stats */
             if(n != NULL) {
               NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_LINK_QUALITY, &radio_last_lqi);
@@ -957,10 +983,23 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
                             tsch_lock_requested,
                             current_link == NULL);
       );
+#if TSCH_STATS_SLOT_TIMING
+      if(current_link == NULL) {
+        tsch_slot_timing_stats.skipped_no_link++;
+      } else {
+        tsch_slot_timing_stats.skipped_locked++;
+      }
+#endif /* TSCH_STATS_SLOT_TIMING */
 
     } else {
       int is_active_slot;
       TSCH_DEBUG_SLOT_START();
+#if TSCH_STATS_SLOT_TIMING
+      {
+        rtimer_clock_t latency = RTIMER_NOW() - current_slot_start;
+        tsch_stats_slot_timing(TSCH_SLOT_PHASE_WAKE, (int32_t)latency, latency);
+      }
+#endif /* TSCH_STATS_SLOT_TIMING */
       tsch_in_slot_operation = 1;
       /* Measure on-air noise level while TSCH is idle */
       tsch_stats_sample_rssi();
@@ -1072,7 +1111,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
         /* Update current slot start */
         prev_slot_start = current_slot_start;
         current_slot_start += time_to_next_active_slot;
-      } while(!tsch_schedule_slot_operation(t, prev_slot_start, time_to_next_active_slot, "main"));
+      } while(!tsch_schedule_slot_operation(t, prev_slot_start, time_to_next_active_slot, TSCH_SLOT_PHASE_END, "main"));
     }
 
     tsch_in_slot_operation = 0;
@@ -1107,7 +1146,7 @@ tsch_slot_operation_start(void)
     /* Update current slot start */
     prev_slot_start = current_slot_start;
     current_slot_start += time_to_next_active_slot;
-  } while(!tsch_schedule_slot_operation(&slot_operation_timer, prev_slot_start, time_to_next_active_slot, "assoc"));
+  } while(!tsch_schedule_slot_operation(&slot_operation_timer, prev_slot_start, time_to_next_active_slot, TSCH_SLOT_PHASE_END, "assoc"));
 }
 /*---------------------------------------------------------------------------*/
 /* Start actual slot operation */
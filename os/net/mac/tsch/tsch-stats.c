@@ -38,6 +38,7 @@
 #include "net/mac/tsch/tsch.h"
 #include "net/netstack.h"
 #include "dev/radio.h"
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -234,3 +235,62 @@ periodic(void *ptr)
 /*---------------------------------------------------------------------------*/
 #endif /* TSCH_STATS_ON */
 /*---------------------------------------------------------------------------*/
+#if TSCH_STATS_SLOT_TIMING
+/*---------------------------------------------------------------------------*/
+
+struct tsch_slot_timing_stats tsch_slot_timing_stats;
+
+static const char *const slot_phase_names[TSCH_SLOT_PHASE_COUNT] = {
+  "wake", "offset", "ack", "end"
+};
+
+/*---------------------------------------------------------------------------*/
+/* Called from the slot operation interrupt: keep it short */
+void
+tsch_stats_slot_timing(enum tsch_slot_phase phase, int32_t value,
+                       rtimer_clock_t since_slot_start)
+{
+  uint8_t bin;
+  int32_t v;
+  uint16_t *counter;
+
+  if(phase == TSCH_SLOT_PHASE_WAKE) {
+    /* A latency: the higher, the worse */
+    if(value > tsch_slot_timing_stats.worst[phase]) {
+      tsch_slot_timing_stats.worst[phase] = value;
+    }
+  } else if(value < tsch_slot_timing_stats.worst[phase]) {
+    tsch_slot_timing_stats.worst[phase] = value;
+  }
+  tsch_slot_timing_stats.last[phase] = since_slot_start;
+
+  /* Bin 0 for values <= 0, then one bin per power of two */
+  bin = 0;
+  for(v = value; v > 0 && bin < TSCH_STATS_SLOT_TIMING_BINS - 1; v >>= 1) {
+    bin++;
+  }
+  counter = &tsch_slot_timing_stats.histogram[phase][bin];
+  if(*counter < 0xffff) {
+    (*counter)++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_slot_timing_reset(void)
+{
+  int i;
+
+  memset(&tsch_slot_timing_stats, 0, sizeof(tsch_slot_timing_stats));
+  for(i = TSCH_SLOT_PHASE_OFFSET; i < TSCH_SLOT_PHASE_COUNT; i++) {
+    tsch_slot_timing_stats.worst[i] = INT32_MAX;
+  }
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_stats_slot_phase_name(enum tsch_slot_phase phase)
+{
+  return phase < TSCH_SLOT_PHASE_COUNT ? slot_phase_names[phase] : "?";
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_STATS_SLOT_TIMING */
+/*---------------------------------------------------------------------------*/
@@ -109,6 +109,28 @@
 #define TSCH_STATS_FIRST_CHANNEL 11
 #endif
 
+/*
+ * Enable the slot timing profiler? It records, for each phase of the slot
+ * operation, the slack left before the deadline, and counts skipped slots.
+ * Independent of TSCH_STATS_ON.
+ */
+#ifdef TSCH_STATS_CONF_SLOT_TIMING
+#define TSCH_STATS_SLOT_TIMING TSCH_STATS_CONF_SLOT_TIMING
+#else
+#define TSCH_STATS_SLOT_TIMING 0
+#endif
+
+/*
+ * Number of bins of the slack histograms. Bin 0 counts missed deadlines,
+ * bin i > 0 a slack in [2^(i-1), 2^i) rtimer ticks. The last bin also
+ * counts any larger slack.
+ */
+#ifdef TSCH_STATS_CONF_SLOT_TIMING_BINS
+#define TSCH_STATS_SLOT_TIMING_BINS TSCH_STATS_CONF_SLOT_TIMING_BINS
+#else
+#define TSCH_STATS_SLOT_TIMING_BINS 12
+#endif
+
 /* Internal: the scaling of the various stats */
 #define TSCH_STATS_RSSI_SCALING_FACTOR    -16
 #define TSCH_STATS_LQI_SCALING_FACTOR      16
@@ -166,6 +188,35 @@ struct tsch_neighbor_stats {
 
 struct tsch_neighbor; /* Forward declaration */
 
+/* The phases of a slot profiled by the slot timing profiler */
+enum tsch_slot_phase {
+  /* Wake-up at slot start. Recorded as a latency (how late the rtimer
+   * fired), and the histogram is of latency rather than slack */
+  TSCH_SLOT_PHASE_WAKE,
+  /* First radio operation: CCA, TxOffset or RxOffset */
+  TSCH_SLOT_PHASE_OFFSET,
+  /* Tx: start of the ACK wait. Rx: ACK transmission */
+  TSCH_SLOT_PHASE_ACK,
+  /* End of the slot: scheduling of the next active slot */
+  TSCH_SLOT_PHASE_END,
+  TSCH_SLOT_PHASE_COUNT
+};
+
+struct tsch_slot_timing_stats {
+  /* Histogram of the slack (latency for the wake phase), per phase */
+  uint16_t histogram[TSCH_SLOT_PHASE_COUNT][TSCH_STATS_SLOT_TIMING_BINS];
+  /* Lowest slack seen (highest latency for the wake phase), rtimer ticks */
+  int32_t worst[TSCH_SLOT_PHASE_COUNT];
+  /* Time of the latest occurrence of each phase, from the slot start */
+  rtimer_clock_t last[TSCH_SLOT_PHASE_COUNT];
+  /* Slots skipped as the TSCH lock was requested */
+  uint32_t skipped_locked;
+  /* Slots skipped as there was no link to operate */
+  uint32_t skipped_no_link;
+  /* Slots skipped as the end phase missed their start */
+  uint32_t skipped_missed;
+};
+
 
 /************ External variables ***********/
 
@@ -206,6 +257,27 @@ void tsch_stats_reset_neighbor_stats(void);
 
 #endif /* TSCH_STATS_ON */
 
+#if TSCH_STATS_SLOT_TIMING
+
+/* Slot timing profile of the local node */
+extern struct tsch_slot_timing_stats tsch_slot_timing_stats;
+
+/* Record a phase. value is the slack before the phase deadline, or the
+ * latency for the wake phase, and since_slot_start the time of the phase */
+void tsch_stats_slot_timing(enum tsch_slot_phase phase, int32_t value,
+                            rtimer_clock_t since_slot_start);
+
+void tsch_stats_slot_timing_reset(void);
+
+const char *tsch_stats_slot_phase_name(enum tsch_slot_phase phase);
+
+#else /* TSCH_STATS_SLOT_TIMING */
+
+#define tsch_stats_slot_timing(phase, value, since_slot_start)
+#define tsch_stats_slot_timing_reset()
+
+#endif /* TSCH_STATS_SLOT_TIMING */
+
 static inline uint8_t
 tsch_stats_channel_to_index(uint8_t channel)
 {
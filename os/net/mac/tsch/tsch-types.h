@@ -76,6 +76,10 @@ struct tsch_link {
   /* Type of link. NORMAL = 0. ADVERTISING = 1, and indicates
      the link may be used to send an Enhanced beacon. */
   enum link_type link_type;
+  /* The neighbor queue of a Tx link, so that the slot operation does not
+   * have to look it up. NULL until set, or if the neighbor could not be
+   * allocated */
+  struct tsch_neighbor *tx_nbr;
   /* Any other data for upper layers */
   void *data;
 };
@@ -89,8 +93,13 @@ struct tsch_slotframe {
   /* Number of timeslots in the slotframe.
    * Stored as struct asn_divisor_t because we often need ASN%size */
   struct tsch_asn_divisor_t size;
+  /* The timeslot of the last ASN looked up, advanced incrementally */
+  struct tsch_asn_mod_cache_t timeslot_cache;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+  /* The links of the slotframe in the schedule index, sorted by timeslot */
+  uint16_t index_start;
+  uint16_t index_len;
 };
 
 /** \brief TSCH packet information */
@@ -117,6 +126,11 @@ struct tsch_neighbor {
   uint8_t last_backoff_window; /* Last CSMA backoff window */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
+  /* Ready list of unicast neighbors with queued packets and no tx link,
+   * i.e. the neighbors that can use any shared broadcast link. Circular,
+   * ready_next is NULL when the neighbor is not in the list. */
+  struct tsch_neighbor *ready_next;
+  struct tsch_neighbor *ready_prev;
   /* Array for the ringbuf. Contains pointers to packets.
    * Its size must be a power of two to allow for atomic put */
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
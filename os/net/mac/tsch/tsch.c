@@ -500,8 +500,8 @@ tsch_tx_process_pending(void)
     mac_call_sent_callback(p->sent, p->ptr, p->ret, p->transmissions);
     /* Free packet queuebuf */
     tsch_queue_free_packet(p);
-    /* Free all unused neighbors */
-    tsch_queue_free_unused_neighbors();
+    /* Unused neighbors are kept until their entry is needed, so that the
+     * next packet to the same neighbor does not have to take the lock */
     /* Remove dequeued packet from ringbuf */
     ringbufindex_get(&dequeued_ringbuf);
   }
@@ -997,6 +997,7 @@ tsch_init(void)
 #endif
 
   tsch_stats_init();
+  tsch_stats_slot_timing_reset();
 }
 /*---------------------------------------------------------------------------*/
 /* Function send for TSCH-MAC, puts the packet in packetbuf in the MAC queue */
@@ -100,6 +100,13 @@ frequency hopping for enhanced reliability.
 #define TSCH_CALLBACK_PACKET_READY orchestra_callback_packet_ready
 #endif /* TSCH_CALLBACK_PACKET_READY */
 
+/* Cell usage statistics of the traffic-adaptive rule */
+#if TSCH_WITH_SIXTOP && TSCH_DEDICATED_LINKS_ANY_PACKET
+#ifndef TSCH_CALLBACK_LINK_USED
+#define TSCH_CALLBACK_LINK_USED orchestra_callback_link_used
+#endif /* TSCH_CALLBACK_LINK_USED */
+#endif /* TSCH_WITH_SIXTOP && TSCH_DEDICATED_LINKS_ANY_PACKET */
+
 #endif /* BUILD_WITH_ORCHESTRA */
 
 /* Called by TSCH when joining a network */
@@ -134,6 +141,12 @@ void TSCH_CALLBACK_NEW_TIME_SOURCE(const struct tsch_neighbor *old, const struct
 void TSCH_CALLBACK_PACKET_READY(void);
 #endif
 
+/* Called by TSCH from interrupt after sending a frame in a link, or
+ * receiving one */
+#ifdef TSCH_CALLBACK_LINK_USED
+void TSCH_CALLBACK_LINK_USED(const struct tsch_link *link, int is_tx);
+#endif
+
 /***** External Variables *****/
 
 /* Are we coordinator of the TSCH network? */
@@ -54,12 +54,15 @@ struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 
 static uint16_t buflen, bufptr;
 static uint8_t hdrlen;
+/* The offset of the first header byte. Headers are prepended into the
+   headroom in front of the packet instead of moving the packet. */
+static uint8_t hdrstart = PACKETBUF_HEADROOM;
 
 /* The declarations below ensure that the packet buffer is aligned on
    an even 32-bit boundary. On some platforms (most notably the
    msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
    problems when accessing words. */
-static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + 3) / 4];
+static uint32_t packetbuf_aligned[(PACKETBUF_HEADROOM + PACKETBUF_SIZE + 3) / 4];
 static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
 #define DEBUG 0
@@ -76,6 +79,7 @@ packetbuf_clear(void)
 {
   buflen = bufptr = 0;
   hdrlen = 0;
+  hdrstart = PACKETBUF_HEADROOM;
 
   packetbuf_attr_clear();
 }
@@ -87,7 +91,7 @@ packetbuf_copyfrom(const void *from, uint16_t len)
 
   packetbuf_clear();
   l = MIN(PACKETBUF_SIZE, len);
-  memcpy(packetbuf, from, l);
+  memcpy(packetbuf_dataptr(), from, l);
   buflen = l;
   return l;
 }
@@ -112,9 +116,15 @@ packetbuf_hdralloc(int size)
     return 0;
   }
 
-  /* shift data to the right */
-  for(i = packetbuf_totlen() - 1; i >= 0; i--) {
-    packetbuf[i + size] = packetbuf[i];
+  if(size <= hdrstart) {
+    /* The header fits in the headroom */
+    hdrstart -= size;
+  } else {
+    /* shift data to the right, and reclaim the remaining headroom */
+    for(i = packetbuf_totlen() - 1; i >= 0; i--) {
+      packetbuf[i + size] = packetbuf[i + hdrstart];
+    }
+    hdrstart = 0;
   }
   hdrlen += size;
   return 1;
@@ -142,13 +152,13 @@ packetbuf_set_datalen(uint16_t len)
 void *
 packetbuf_dataptr(void)
 {
-  return packetbuf + packetbuf_hdrlen();
+  return packetbuf + hdrstart + packetbuf_hdrlen();
 }
 /*---------------------------------------------------------------------------*/
 void *
 packetbuf_hdrptr(void)
 {
-  return packetbuf;
+  return packetbuf + hdrstart;
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
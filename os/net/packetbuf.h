@@ -67,6 +67,22 @@
 #define PACKETBUF_SIZE 128
 #endif
 
+/**
+ * \brief      The size of the headroom in front of the packetbuf, in bytes
+ *
+ *             Headers allocated with packetbuf_hdralloc() are placed
+ *             in the headroom, so that the packet itself does not
+ *             need to be moved. When a header does not fit in the
+ *             remaining headroom, the packet is moved instead. The
+ *             default value fits an 802.15.4 header with long
+ *             addresses and no auxiliary security header.
+ */
+#ifdef PACKETBUF_CONF_HEADROOM
+#define PACKETBUF_HEADROOM PACKETBUF_CONF_HEADROOM
+#else
+#define PACKETBUF_HEADROOM 24
+#endif
+
 /**
  * \brief      Clear and reset the packetbuf
  *
@@ -209,6 +225,22 @@ struct packetbuf_addr {
 #define PACKETBUF_ATTR_PACKET_TYPE_STREAM_END 3
 #define PACKETBUF_ATTR_PACKET_TYPE_TIMESTAMP 4
 
+/* Tag packets with a traffic class in PACKETBUF_ATTR_TRAFFIC_CLASS, for
+ * MAC layers that schedule their queues by class (CSMA does, with
+ * CSMA_CONF_WITH_TRAFFIC_CLASSES) */
+#ifdef PACKETBUF_CONF_WITH_TRAFFIC_CLASS
+#define PACKETBUF_WITH_TRAFFIC_CLASS PACKETBUF_CONF_WITH_TRAFFIC_CLASS
+#else /* PACKETBUF_CONF_WITH_TRAFFIC_CLASS */
+#define PACKETBUF_WITH_TRAFFIC_CLASS 0
+#endif /* PACKETBUF_CONF_WITH_TRAFFIC_CLASS */
+
+/* Values of PACKETBUF_ATTR_TRAFFIC_CLASS, highest priority first.
+ * Untagged packets are handled as bulk traffic. */
+#define PACKETBUF_ATTR_TRAFFIC_CLASS_NONE    0
+#define PACKETBUF_ATTR_TRAFFIC_CLASS_CONTROL 1
+#define PACKETBUF_ATTR_TRAFFIC_CLASS_LATENCY 2
+#define PACKETBUF_ATTR_TRAFFIC_CLASS_BULK    3
+
 enum {
   PACKETBUF_ATTR_NONE,
 
@@ -228,6 +260,9 @@ enum {
   PACKETBUF_ATTR_TSCH_SLOTFRAME,
   PACKETBUF_ATTR_TSCH_TIMESLOT,
 #endif /* TSCH_WITH_LINK_SELECTOR */
+#if PACKETBUF_WITH_TRAFFIC_CLASS
+  PACKETBUF_ATTR_TRAFFIC_CLASS,
+#endif /* PACKETBUF_WITH_TRAFFIC_CLASS */
 
   /* Scope 1 attributes: used between two neighbors only. */
   PACKETBUF_ATTR_FRAME_TYPE,
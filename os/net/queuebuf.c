@@ -49,6 +49,11 @@
 #include "cfs/cfs.h"
 #endif
 
+#if QUEUEBUF_SLAB_SIZE
+#include "sys/int-master.h"
+#include "net/mac/llsec802154.h"
+#endif
+
 #include <string.h> /* for memcpy() */
 
 /* Structure pointing to a buffer either stored
@@ -60,6 +65,9 @@ struct queuebuf {
   int line;
   clock_time_t time;
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_SLAB_SIZE
+  struct slab_entry *entry;
+#else /* QUEUEBUF_SLAB_SIZE */
 #if WITH_SWAP
   enum {IN_RAM, IN_CFS} location;
   union {
@@ -69,6 +77,7 @@ struct queuebuf {
     int swap_id;
   };
 #endif
+#endif /* QUEUEBUF_SLAB_SIZE */
 };
 
 /* The actual queuebuf data */
@@ -80,7 +89,66 @@ struct queuebuf_data {
 };
 
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
+#if !QUEUEBUF_SLAB_SIZE
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+#endif /* !QUEUEBUF_SLAB_SIZE */
+
+#if QUEUEBUF_SLAB_SIZE
+
+/* A queued frame in the slab. The header is followed by the frame
+   data, by the attributes that are set, and by the addresses that are
+   not null. Entries are stored back to back in the slab. */
+struct slab_entry {
+  /* The queuebuf that owns the entry, or NULL if the entry is free */
+  struct queuebuf *owner;
+  /* The size of the entry, including the header */
+  uint16_t size;
+  /* The length of the frame data */
+  uint16_t len;
+  /* The number of stored attributes */
+  uint8_t attr_count;
+  /* One bit for each stored address */
+  uint8_t addr_mask;
+};
+
+struct slab_attr {
+  uint8_t type;
+  packetbuf_attr_t val;
+};
+
+/* Entries are aligned so that the owner pointer can be accessed directly */
+#define SLAB_ALIGN(size) \
+  (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/* Room kept after the frame data of each entry. TSCH secures queued
+   frames in place, which appends the MIC to the frame data. */
+#if LLSEC802154_ENABLED
+#define SLAB_TAILROOM LLSEC802154_MIC_LEN(7)
+#else /* LLSEC802154_ENABLED */
+#define SLAB_TAILROOM 0
+#endif /* LLSEC802154_ENABLED */
+
+/* The size of the data region of an entry with a frame of len bytes */
+#define SLAB_DATA_SIZE(len) SLAB_ALIGN((len) + SLAB_TAILROOM)
+
+#define ENTRY_DATA(e)  ((uint8_t *)((e) + 1))
+#define ENTRY_ATTRS(e) ((struct slab_attr *)(ENTRY_DATA(e) + SLAB_DATA_SIZE((e)->len)))
+#define ENTRY_ADDRS(e) ((linkaddr_t *)(ENTRY_ATTRS(e) + (e)->attr_count))
+#define ENTRY_AT(offset) ((struct slab_entry *)((uint8_t *)slab + (offset)))
+
+/* The size of an entry holding a full frame with all attributes */
+#define SLAB_MAX_ENTRY_SIZE                                             \
+  SLAB_ALIGN(sizeof(struct slab_entry) + SLAB_DATA_SIZE(PACKETBUF_SIZE) + \
+             PACKETBUF_NUM_ATTRS * sizeof(struct slab_attr) +           \
+             PACKETBUF_NUM_ADDRS * sizeof(linkaddr_t))
+
+static void *slab[(QUEUEBUF_SLAB_SIZE + sizeof(void *) - 1) / sizeof(void *)];
+/* The offset of the end of the last entry */
+static uint16_t slab_end;
+/* The number of bytes used by entries that are not free */
+static uint16_t slab_live;
+
+#endif /* QUEUEBUF_SLAB_SIZE */
 
 #if WITH_SWAP
 
@@ -135,6 +203,223 @@ LIST(queuebuf_list);
 uint8_t queuebuf_len, queuebuf_max_len;
 #endif /* QUEUEBUF_STATS */
 
+#if QUEUEBUF_SLAB_SIZE
+/*---------------------------------------------------------------------------*/
+/* Get the size of an entry for the frame and attributes in packetbuf */
+static uint16_t
+slab_entry_size(uint16_t len, uint8_t *attr_count, uint8_t *addr_mask)
+{
+  int i;
+  int addr_count;
+
+  *attr_count = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(packetbuf_attr(i) != 0) {
+      (*attr_count)++;
+    }
+  }
+
+  *addr_mask = 0;
+  addr_count = 0;
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_FIRST + i), &linkaddr_null)) {
+      *addr_mask |= 1 << i;
+      addr_count++;
+    }
+  }
+
+  return SLAB_ALIGN(sizeof(struct slab_entry) + SLAB_DATA_SIZE(len) +
+                    *attr_count * sizeof(struct slab_attr) +
+                    addr_count * sizeof(linkaddr_t));
+}
+/*---------------------------------------------------------------------------*/
+/* Copy the attributes and addresses from packetbuf into an entry */
+static void
+slab_store_attrs(struct slab_entry *e, uint8_t attr_count, uint8_t addr_mask)
+{
+  int i;
+  struct slab_attr *attr;
+  linkaddr_t *addr;
+
+  e->attr_count = attr_count;
+  e->addr_mask = addr_mask;
+
+  attr = ENTRY_ATTRS(e);
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(packetbuf_attr(i) != 0) {
+      attr->type = i;
+      attr->val = packetbuf_attr(i);
+      attr++;
+    }
+  }
+
+  addr = ENTRY_ADDRS(e);
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    if(addr_mask & (1 << i)) {
+      linkaddr_copy(addr, packetbuf_addr(PACKETBUF_ADDR_FIRST + i));
+      addr++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Slide all entries that are in use towards the start of the slab */
+static void
+slab_compact(void)
+{
+  uint16_t from;
+  uint16_t to;
+  uint16_t size;
+  struct slab_entry *e;
+  int_master_status_t status;
+
+  PRINTF("queuebuf: compacting slab, end %u live %u\n", slab_end, slab_live);
+
+  for(from = to = 0; from < slab_end; from += size) {
+    e = ENTRY_AT(from);
+    size = e->size;
+    if(e->owner != NULL) {
+      if(from != to) {
+        /* The MAC layer may access queued frames from interrupt
+           context, so each entry is moved atomically. */
+        status = int_master_read_and_disable();
+        memmove(ENTRY_AT(to), e, size);
+        ENTRY_AT(to)->owner->entry = ENTRY_AT(to);
+        int_master_status_set(status);
+      }
+      to += size;
+    }
+  }
+  slab_end = to;
+}
+/*---------------------------------------------------------------------------*/
+static struct slab_entry *
+slab_alloc(uint16_t size)
+{
+  struct slab_entry *e;
+
+  if(QUEUEBUF_SLAB_SIZE - slab_live < size) {
+    return NULL;
+  }
+  if(QUEUEBUF_SLAB_SIZE - slab_end < size) {
+    slab_compact();
+  }
+
+  e = ENTRY_AT(slab_end);
+  e->owner = NULL;
+  e->size = size;
+  slab_end += size;
+  slab_live += size;
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+static void
+slab_free(struct slab_entry *e)
+{
+  e->owner = NULL;
+  slab_live -= e->size;
+  if(slab_live == 0) {
+    slab_end = 0;
+  } else if((uint8_t *)e + e->size == (uint8_t *)ENTRY_AT(slab_end)) {
+    /* Release the last entry right away */
+    slab_end -= e->size;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+slab_reverse(uint8_t *start, uint8_t *end)
+{
+  uint8_t tmp;
+
+  while(start < --end) {
+    tmp = *start;
+    *start++ = *end;
+    *end = tmp;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Grow the entry of buf to hold at least size bytes, keeping its
+   contents. Returns the entry, which may have moved, or NULL if there
+   is not enough free space in the slab. */
+static struct slab_entry *
+slab_grow(struct queuebuf *buf, uint16_t size)
+{
+  struct slab_entry *e;
+  struct slab_entry *next;
+  uint16_t next_size;
+  uint16_t old_size;
+  int_master_status_t status;
+
+  e = buf->entry;
+  old_size = e->size;
+  if(size <= old_size) {
+    return e;
+  }
+  if(QUEUEBUF_SLAB_SIZE - slab_live < size - old_size) {
+    return NULL;
+  }
+
+  if(QUEUEBUF_SLAB_SIZE - slab_end < size - old_size
+     || ((uint8_t *)e + old_size != (uint8_t *)ENTRY_AT(slab_end)
+         && QUEUEBUF_SLAB_SIZE - slab_end < size)) {
+    /* Gather the free space at the end of the slab */
+    slab_compact();
+    e = buf->entry;
+  }
+
+  if((uint8_t *)e + old_size == (uint8_t *)ENTRY_AT(slab_end)) {
+    /* Already the last entry */
+  } else if(QUEUEBUF_SLAB_SIZE - slab_end >= size) {
+    /* Copy the entry to the end of the slab */
+    memcpy(ENTRY_AT(slab_end), e, old_size);
+    buf->entry = ENTRY_AT(slab_end);
+    slab_end += old_size;
+    slab_live += old_size;
+    slab_free(e);
+  } else {
+    /* No room for a copy: swap the entry with each entry that follows
+       it. As in slab_compact(), interrupts are only disabled while two
+       entries are moved. */
+    while((uint8_t *)e + old_size != (uint8_t *)ENTRY_AT(slab_end)) {
+      next = (struct slab_entry *)((uint8_t *)e + old_size);
+      next_size = next->size;
+      status = int_master_read_and_disable();
+      slab_reverse((uint8_t *)e, (uint8_t *)next);
+      slab_reverse((uint8_t *)next, (uint8_t *)next + next_size);
+      slab_reverse((uint8_t *)e, (uint8_t *)next + next_size);
+      e->owner->entry = e;
+      e = (struct slab_entry *)((uint8_t *)e + next_size);
+      buf->entry = e;
+      int_master_status_set(status);
+    }
+  }
+
+  /* The entry is now the last one, followed by enough free space */
+  e->size = size;
+  slab_end += size - old_size;
+  slab_live += size - old_size;
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+/* Store the frame and attributes in packetbuf into a new entry for buf */
+static struct slab_entry *
+slab_store(struct queuebuf *buf)
+{
+  uint16_t len = packetbuf_totlen();
+  struct slab_entry *e;
+  uint8_t attr_count;
+  uint8_t addr_mask;
+
+  e = slab_alloc(slab_entry_size(len, &attr_count, &addr_mask));
+  if(e == NULL) {
+    return NULL;
+  }
+
+  e->owner = buf;
+  e->len = packetbuf_copyto(ENTRY_DATA(e));
+  slab_store_attrs(e, attr_count, addr_mask);
+  return e;
+}
+#endif /* QUEUEBUF_SLAB_SIZE */
 #if WITH_SWAP
 /*---------------------------------------------------------------------------*/
 static void
@@ -268,7 +553,7 @@ queuebuf_load_to_ram(struct queuebuf *b)
     }
   }
 }
-#else /* WITH_SWAP */
+#elif !QUEUEBUF_SLAB_SIZE
 /*---------------------------------------------------------------------------*/
 static struct queuebuf_data *
 queuebuf_load_to_ram(struct queuebuf *b)
@@ -287,7 +572,12 @@ queuebuf_init(void)
     qbuf_renew_file(i);
   }
 #endif
+#if QUEUEBUF_SLAB_SIZE
+  slab_end = 0;
+  slab_live = 0;
+#else /* QUEUEBUF_SLAB_SIZE */
   memb_init(&buframmem);
+#endif /* QUEUEBUF_SLAB_SIZE */
   memb_init(&bufmem);
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
@@ -297,7 +587,13 @@ queuebuf_init(void)
 int
 queuebuf_numfree(void)
 {
+#if QUEUEBUF_SLAB_SIZE
+  /* Count the number of full-sized frames that are guaranteed to fit */
+  return MIN(memb_numfree(&bufmem),
+             (QUEUEBUF_SLAB_SIZE - slab_live) / SLAB_MAX_ENTRY_SIZE);
+#else /* QUEUEBUF_SLAB_SIZE */
   return memb_numfree(&bufmem);
+#endif /* QUEUEBUF_SLAB_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 #if QUEUEBUF_DEBUG
@@ -310,7 +606,9 @@ queuebuf_new_from_packetbuf(void)
 {
   struct queuebuf *buf;
 
+#if !QUEUEBUF_SLAB_SIZE
   struct queuebuf_data *buframptr;
+#endif /* !QUEUEBUF_SLAB_SIZE */
   buf = memb_alloc(&bufmem);
   if(buf != NULL) {
 #if QUEUEBUF_DEBUG
@@ -319,6 +617,18 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_SLAB_SIZE
+    buf->entry = slab_store(buf);
+    if(buf->entry == NULL) {
+      PRINTF("queuebuf_new_from_packetbuf: no room in slab for %u bytes\n",
+             packetbuf_totlen());
+#if QUEUEBUF_DEBUG
+      list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
+      memb_free(&bufmem, buf);
+      return NULL;
+    }
+#else /* QUEUEBUF_SLAB_SIZE */
     buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
@@ -352,6 +662,7 @@ queuebuf_new_from_packetbuf(void)
       }
     }
 #endif
+#endif /* QUEUEBUF_SLAB_SIZE */
 
 #if QUEUEBUF_STATS
     ++queuebuf_len;
@@ -367,36 +678,73 @@ queuebuf_new_from_packetbuf(void)
   return buf;
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
+#if QUEUEBUF_SLAB_SIZE
+  struct slab_entry *e;
+  uint8_t attr_count;
+  uint8_t addr_mask;
+
+  e = buf->entry;
+  e = slab_grow(buf, slab_entry_size(e->len, &attr_count, &addr_mask));
+  if(e == NULL) {
+    PRINTF("queuebuf_update_attr_from_packetbuf: could not grow entry\n");
+    return 0;
+  }
+  slab_store_attrs(e, attr_count, addr_mask);
+#else /* QUEUEBUF_SLAB_SIZE */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    if(queuebuf_flush_tmpdata() == -1) {
+      return 0;
+    }
   }
 #endif
+#endif /* QUEUEBUF_SLAB_SIZE */
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
+#if QUEUEBUF_SLAB_SIZE
+  struct slab_entry *e;
+  uint8_t attr_count;
+  uint8_t addr_mask;
+
+  e = slab_grow(buf, slab_entry_size(packetbuf_totlen(),
+                                     &attr_count, &addr_mask));
+  if(e == NULL) {
+    PRINTF("queuebuf_update_from_packetbuf: could not grow entry\n");
+    return 0;
+  }
+  e->len = packetbuf_copyto(ENTRY_DATA(e));
+  slab_store_attrs(e, attr_count, addr_mask);
+#else /* QUEUEBUF_SLAB_SIZE */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    if(queuebuf_flush_tmpdata() == -1) {
+      return 0;
+    }
   }
 #endif
+#endif /* QUEUEBUF_SLAB_SIZE */
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
-#if WITH_SWAP
+#if QUEUEBUF_SLAB_SIZE
+    slab_free(buf->entry);
+#elif WITH_SWAP
     if(buf->location == IN_RAM) {
       memb_free(&buframmem, buf->ram_ptr);
     } else {
@@ -420,9 +768,29 @@ void
 queuebuf_to_packetbuf(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
+#if QUEUEBUF_SLAB_SIZE
+    struct slab_entry *e = b->entry;
+    struct slab_attr *attr;
+    linkaddr_t *addr;
+    int i;
+
+    /* packetbuf_copyfrom() clears all attributes and addresses */
+    packetbuf_copyfrom(ENTRY_DATA(e), e->len);
+    attr = ENTRY_ATTRS(e);
+    for(i = 0; i < e->attr_count; i++) {
+      packetbuf_set_attr(attr[i].type, attr[i].val);
+    }
+    addr = ENTRY_ADDRS(e);
+    for(i = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+      if(e->addr_mask & (1 << i)) {
+        packetbuf_set_addr(PACKETBUF_ADDR_FIRST + i, addr++);
+      }
+    }
+#else /* QUEUEBUF_SLAB_SIZE */
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SLAB_SIZE */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -430,8 +798,12 @@ void *
 queuebuf_dataptr(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
+#if QUEUEBUF_SLAB_SIZE
+    return ENTRY_DATA(b->entry);
+#else /* QUEUEBUF_SLAB_SIZE */
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     return buframptr->data;
+#endif /* QUEUEBUF_SLAB_SIZE */
   }
   return NULL;
 }
@@ -439,22 +811,57 @@ queuebuf_dataptr(struct queuebuf *b)
 int
 queuebuf_datalen(struct queuebuf *b)
 {
+#if QUEUEBUF_SLAB_SIZE
+  return b->entry->len;
+#else /* QUEUEBUF_SLAB_SIZE */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
   return buframptr->len;
+#endif /* QUEUEBUF_SLAB_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 linkaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
+#if QUEUEBUF_SLAB_SIZE
+  struct slab_entry *e = b->entry;
+  linkaddr_t *addr = ENTRY_ADDRS(e);
+  int i;
+
+  i = type - PACKETBUF_ADDR_FIRST;
+  if((e->addr_mask & (1 << i)) == 0) {
+    return (linkaddr_t *)&linkaddr_null;
+  }
+  /* Skip the addresses stored before this one */
+  while(--i >= 0) {
+    if(e->addr_mask & (1 << i)) {
+      addr++;
+    }
+  }
+  return addr;
+#else /* QUEUEBUF_SLAB_SIZE */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+#endif /* QUEUEBUF_SLAB_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
+#if QUEUEBUF_SLAB_SIZE
+  struct slab_entry *e = b->entry;
+  struct slab_attr *attr = ENTRY_ATTRS(e);
+  int i;
+
+  for(i = 0; i < e->attr_count; i++) {
+    if(attr[i].type == type) {
+      return attr[i].val;
+    }
+  }
+  return 0;
+#else /* QUEUEBUF_SLAB_SIZE */
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
   return buframptr->attrs[type].val;
+#endif /* QUEUEBUF_SLAB_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 void
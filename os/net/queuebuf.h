@@ -85,6 +85,26 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_SLAB_SIZE is the size in bytes of a shared arena from which
+   queuebufs are allocated with variable size. Each queued frame then
+   takes only the space needed for its data and the attributes that are
+   set, rather than a full PACKETBUF_SIZE frame and all attributes. The
+   arena is compacted when it runs out of contiguous space. The number
+   of queuebufs is still limited by QUEUEBUF_NUM, which can be set
+   larger than with fixed-size buffers for the same RAM budget. If
+   QUEUEBUF_CONF_SLAB_SIZE is unset or zero, fixed-size buffers are
+   used. In slab mode, queuebuf_numfree() returns the number of
+   full-sized frames that are guaranteed to fit. */
+#ifdef QUEUEBUF_CONF_SLAB_SIZE
+#define QUEUEBUF_SLAB_SIZE QUEUEBUF_CONF_SLAB_SIZE
+#else /* QUEUEBUF_CONF_SLAB_SIZE */
+#define QUEUEBUF_SLAB_SIZE 0
+#endif /* QUEUEBUF_CONF_SLAB_SIZE */
+
+#if QUEUEBUF_SLAB_SIZE && WITH_SWAP
+#error "QUEUEBUF_CONF_SLAB_SIZE cannot be used together with swapping"
+#endif
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -101,8 +121,10 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 #else /* QUEUEBUF_DEBUG */
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
-void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
-void queuebuf_update_from_packetbuf(struct queuebuf *b);
+/* Update a queuebuf from packetbuf. Returns 0 if the queuebuf could
+   not hold the new contents, in which case it keeps the old ones. */
+int queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -264,29 +264,14 @@ rpl_ext_header_srh_update(void)
 }
 /*---------------------------------------------------------------------------*/
 static int
-count_matching_bytes(const void *p1, const void *p2, size_t n)
-{
-  int i = 0;
-  for(i = 0; i < n; i++) {
-    if(((uint8_t *)p1)[i] != ((uint8_t *)p2)[i]) {
-      return i;
-    }
-  }
-  return n;
-}
-/*---------------------------------------------------------------------------*/
-static int
 insert_srh_header(void)
 {
   /* Implementation of RFC6554 */
-  uint8_t path_len;
   uint8_t ext_len;
-  uint8_t cmpri, cmpre; /* ComprI and ComprE fields of the RPL Source Routing Header */
-  uint8_t *hop_ptr;
   uint8_t padding;
   uip_sr_node_t *dest_node;
   uip_sr_node_t *root_node;
-  uip_sr_node_t *node;
+  uip_sr_route_t route;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
 
@@ -320,48 +305,26 @@ insert_srh_header(void)
     return 0;
   }
 
-  if(!uip_sr_is_addr_reachable(dag, &UIP_IP_BUF->destipaddr)) {
+  /* Get the compiled source route, i.e. path length, compression factor
+   * and hops, from the cache of the source routing table if possible */
+  if(!uip_sr_get_route(dest_node, root_node, &route)) {
     LOG_ERR("SRH no path found to destination\n");
     return 0;
   }
 
-  /* Compute path length and compression factors (we use cmpri == cmpre) */
-  path_len = 0;
-  node = dest_node->parent;
-  /* For simplicity, we use cmpri = cmpre */
-  cmpri = 15;
-  cmpre = 15;
-
-  if(node == root_node) {
+  if(route.path_len == 0) {
     LOG_DBG("SRH no need to insert SRH\n");
     return 1;
   }
 
-  while(node != NULL && node != root_node) {
-
-    NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
-
-    /* How many bytes in common between all nodes in the path? */
-    cmpri = MIN(cmpri, count_matching_bytes(&node_addr, &UIP_IP_BUF->destipaddr, 16));
-    cmpre = cmpri;
-
-    LOG_DBG("SRH Hop ");
-    LOG_DBG_6ADDR(&node_addr);
-    LOG_DBG_("\n");
-    node = node->parent;
-    path_len++;
-  }
-
   /* Extension header length: fixed headers + (n-1) * (16-ComprI) + (16-ComprE)*/
-  ext_len = RPL_RH_LEN + RPL_SRH_LEN
-      + (path_len - 1) * (16 - cmpre)
-      + (16 - cmpri);
+  ext_len = RPL_RH_LEN + RPL_SRH_LEN + route.len;
 
   padding = ext_len % 8 == 0 ? 0 : (8 - (ext_len % 8));
   ext_len += padding;
 
   LOG_DBG("SRH Path len: %u, ComprI %u, ComprE %u, ext len %u (padding %u)\n",
-      path_len, cmpri, cmpre, ext_len, padding);
+      route.path_len, route.cmpr, route.cmpr, ext_len, padding);
 
   /* Check if there is enough space to store the extension header */
   if(uip_len + ext_len > UIP_LINK_MTU) {
@@ -381,28 +344,17 @@ insert_srh_header(void)
   /* Initialize IPv6 Routing Header */
   rh_hdr->len = (ext_len - 8) / 8;
   rh_hdr->routing_type = RPL_RH_TYPE_SRH;
-  rh_hdr->seg_left = path_len;
+  rh_hdr->seg_left = route.path_len;
 
   /* Initialize RPL Source Routing Header */
-  srh_hdr->cmpr = (cmpri << 4) + cmpre;
+  srh_hdr->cmpr = (route.cmpr << 4) + route.cmpr;
   srh_hdr->pad = padding << 4;
 
-  /* Initialize addresses field (the actual source route).
-   * From last to first. */
-  node = dest_node;
-  hop_ptr = ((uint8_t *)rh_hdr) + ext_len - padding; /* Pointer where to write the next hop compressed address */
-
-  while(node != NULL && node->parent != root_node) {
-    NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
-
-    hop_ptr -= (16 - cmpri);
-    memcpy(hop_ptr, ((uint8_t*)&node_addr) + cmpri, 16 - cmpri);
-
-    node = node->parent;
-  }
+  /* Initialize addresses field (the actual source route) */
+  uip_sr_write_route(&route, ((uint8_t *)rh_hdr) + RPL_RH_LEN + RPL_SRH_LEN);
 
   /* The next hop (i.e. node whose parent is the root) is placed as the current IPv6 destination */
-  NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
+  NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, route.first_hop);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
   /* Update the IPv6 length field */
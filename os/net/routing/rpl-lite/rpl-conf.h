@@ -383,6 +383,20 @@
 #define RPL_PREFERENCE              0
 #endif
 
+/*
+ * Incremental parent selection. Cache the link metric, path cost and rank
+ * of every neighbor, refresh them only upon a DIO or a link update from
+ * that neighbor (and on the periodic timer, for link statistics updated
+ * by other modules), and keep the neighbors in a list ordered by path cost.
+ * Parent selection then looks at the head of the list and the preferred
+ * parent instead of evaluating the objective function for every neighbor.
+ */
+#ifdef RPL_CONF_WITH_INCREMENTAL_PARENT_SELECTION
+#define RPL_WITH_INCREMENTAL_PARENT_SELECTION RPL_CONF_WITH_INCREMENTAL_PARENT_SELECTION
+#else
+#define RPL_WITH_INCREMENTAL_PARENT_SELECTION 0
+#endif
+
 /* RPL callbacks when TSCH is enabled */
 #if MAC_CONF_WITH_TSCH
 
@@ -138,6 +138,8 @@ void
 rpl_dag_periodic(unsigned seconds)
 {
   if(curr_instance.used) {
+    /* Catch up with link statistics updated without a link callback */
+    rpl_neighbor_update_all();
     if(curr_instance.dag.lifetime != RPL_LIFETIME(RPL_INFINITE_LIFETIME)) {
       curr_instance.dag.lifetime =
         curr_instance.dag.lifetime > seconds ? curr_instance.dag.lifetime - seconds : 0;
@@ -388,6 +390,7 @@ update_nbr_from_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 #if RPL_WITH_MC
   memcpy(&nbr->mc, &dio->mc, sizeof(nbr->mc));
 #endif /* RPL_WITH_MC */
+  rpl_neighbor_update(nbr);
 
   return nbr;
 }
@@ -542,6 +545,9 @@ init_dag_from_dio(rpl_dio_t *dio)
   curr_instance.dag.version = dio->version;
   curr_instance.dag.dio_intcurrent = dio->dag_intmin;
 
+  /* Path costs depend on the instance parameters */
+  rpl_neighbor_update_all();
+
   return 1;
 }
 /*---------------------------------------------------------------------------*/
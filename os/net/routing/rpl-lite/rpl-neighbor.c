@@ -64,6 +64,12 @@ static rpl_nbr_t * best_parent(int fresh_only);
 /* Per-neighbor RPL information */
 NBR_TABLE_GLOBAL(rpl_nbr_t, rpl_neighbors);
 
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+/* All neighbors, ordered by increasing cached path cost, then link metric */
+static rpl_nbr_t *candidates[NBR_TABLE_MAX_NEIGHBORS];
+static uint8_t num_candidates;
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
+
 /*---------------------------------------------------------------------------*/
 static int
 max_acceptable_rank(void)
@@ -190,6 +196,104 @@ rpl_get_ds6_nbr(rpl_nbr_t *nbr)
 }
 #endif /* UIP_ND6_SEND_NS */
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+static int
+candidate_cmp(const rpl_nbr_t *nbr1, const rpl_nbr_t *nbr2)
+{
+  if(nbr1->path_cost != nbr2->path_cost) {
+    return nbr1->path_cost < nbr2->path_cost ? -1 : 1;
+  }
+  if(nbr1->link_metric != nbr2->link_metric) {
+    return nbr1->link_metric < nbr2->link_metric ? -1 : 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Index of the first candidate that is not ordered before nbr */
+static int
+candidate_lower_bound(const rpl_nbr_t *nbr)
+{
+  int low = 0;
+  int high = num_candidates;
+  while(low < high) {
+    int mid = (low + high) / 2;
+    if(candidate_cmp(candidates[mid], nbr) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the candidates, using its cached values to find it */
+static void
+candidate_remove(rpl_nbr_t *nbr)
+{
+  int i;
+  for(i = candidate_lower_bound(nbr);
+      i < num_candidates && candidate_cmp(candidates[i], nbr) == 0; i++) {
+    if(candidates[i] == nbr) {
+      num_candidates--;
+      memmove(&candidates[i], &candidates[i + 1],
+              (num_candidates - i) * sizeof(candidates[0]));
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+candidate_insert(rpl_nbr_t *nbr)
+{
+  int i;
+  if(num_candidates >= NBR_TABLE_MAX_NEIGHBORS) {
+    return;
+  }
+  i = candidate_lower_bound(nbr);
+  memmove(&candidates[i + 1], &candidates[i],
+          (num_candidates - i) * sizeof(candidates[0]));
+  candidates[i] = nbr;
+  num_candidates++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_cache(rpl_nbr_t *nbr)
+{
+  nbr->link_metric = curr_instance.of->nbr_link_metric(nbr);
+  nbr->path_cost = curr_instance.of->nbr_path_cost(nbr);
+  nbr->rank_via = curr_instance.of->rank_via_nbr(nbr);
+}
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
+/*---------------------------------------------------------------------------*/
+void
+rpl_neighbor_update(rpl_nbr_t *nbr)
+{
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  if(nbr != NULL && curr_instance.used) {
+    candidate_remove(nbr);
+    update_cache(nbr);
+    candidate_insert(nbr);
+  }
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_neighbor_update_all(void)
+{
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  rpl_nbr_t *nbr;
+
+  /* Rebuild from scratch: the cached values may all be stale */
+  num_candidates = 0;
+  if(curr_instance.used) {
+    for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
+      update_cache(nbr);
+      candidate_insert(nbr);
+    }
+  }
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
+}
+/*---------------------------------------------------------------------------*/
 static void
 remove_neighbor(rpl_nbr_t *nbr)
 {
@@ -202,6 +306,9 @@ remove_neighbor(rpl_nbr_t *nbr)
   if(nbr == curr_instance.dag.unicast_dio_target) {
     curr_instance.dag.unicast_dio_target = NULL;
   }
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  candidate_remove(nbr);
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
   nbr_table_remove(rpl_neighbors, nbr);
   rpl_timers_schedule_state_update(); /* Updating from here is unsafe; postpone */
 }
@@ -224,6 +331,11 @@ rpl_neighbor_is_acceptable_parent(rpl_nbr_t *nbr)
 uint16_t
 rpl_neighbor_get_link_metric(rpl_nbr_t *nbr)
 {
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  if(nbr != NULL && curr_instance.used) {
+    return nbr->link_metric;
+  }
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
   if(nbr != NULL && curr_instance.of->nbr_link_metric != NULL) {
     return curr_instance.of->nbr_link_metric(nbr);
   }
@@ -233,6 +345,11 @@ rpl_neighbor_get_link_metric(rpl_nbr_t *nbr)
 rpl_rank_t
 rpl_neighbor_rank_via_nbr(rpl_nbr_t *nbr)
 {
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  if(nbr != NULL && curr_instance.used) {
+    return nbr->rank_via;
+  }
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
   if(nbr != NULL && curr_instance.of->rank_via_nbr != NULL) {
     return curr_instance.of->rank_via_nbr(nbr);
   }
@@ -344,6 +461,33 @@ rpl_neighbor_get_from_ipaddr(uip_ipaddr_t *addr)
   return nbr_table_get_from_lladdr(rpl_neighbors, (linkaddr_t *)lladdr);
 }
 /*---------------------------------------------------------------------------*/
+/* Tells whether a neighbor may be selected as preferred parent */
+static int
+is_usable_parent(rpl_nbr_t *nbr, int fresh_only)
+{
+  if(!acceptable_rank(nbr->rank) || !curr_instance.of->nbr_is_acceptable_parent(nbr)) {
+    /* Exclude neighbors with a rank that is not acceptable) */
+    return 0;
+  }
+
+  if(fresh_only && !rpl_neighbor_is_fresh(nbr)) {
+    /* Filter out non-fresh nerighbors if fresh_only is set */
+    return 0;
+  }
+
+#if UIP_ND6_SEND_NS
+  {
+  uip_ds6_nbr_t *ds6_nbr = rpl_get_ds6_nbr(nbr);
+  /* Exclude links to a neighbor that is not reachable at a NUD level */
+  if(ds6_nbr == NULL || ds6_nbr->state != NBR_REACHABLE) {
+    return 0;
+  }
+  }
+#endif /* UIP_ND6_SEND_NS */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static rpl_nbr_t *
 best_parent(int fresh_only)
 {
@@ -354,32 +498,31 @@ best_parent(int fresh_only)
     return NULL;
   }
 
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  {
+  int i;
+  /* The first usable candidate has the lowest path cost */
+  for(i = 0; i < num_candidates; i++) {
+    if(is_usable_parent(candidates[i], fresh_only)) {
+      best = candidates[i];
+      break;
+    }
+  }
+  /* Only the preferred parent can beat it, through the OF's hysteresis */
+  nbr = curr_instance.dag.preferred_parent;
+  if(best != NULL && nbr != NULL && nbr != best && is_usable_parent(nbr, fresh_only)) {
+    best = curr_instance.of->best_parent(best, nbr);
+  }
+  }
+#else /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
   /* Search for the best parent according to the OF */
   for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
-
-    if(!acceptable_rank(nbr->rank) || !curr_instance.of->nbr_is_acceptable_parent(nbr)) {
-      /* Exclude neighbors with a rank that is not acceptable) */
-      continue;
+    if(is_usable_parent(nbr, fresh_only)) {
+      /* Now we have an acceptable parent, check if it is the new best */
+      best = curr_instance.of->best_parent(best, nbr);
     }
-
-    if(fresh_only && !rpl_neighbor_is_fresh(nbr)) {
-      /* Filter out non-fresh nerighbors if fresh_only is set */
-      continue;
-    }
-
-#if UIP_ND6_SEND_NS
-    {
-    uip_ds6_nbr_t *ds6_nbr = rpl_get_ds6_nbr(nbr);
-    /* Exclude links to a neighbor that is not reachable at a NUD level */
-    if(ds6_nbr == NULL || ds6_nbr->state != NBR_REACHABLE) {
-      continue;
-    }
-    }
-#endif /* UIP_ND6_SEND_NS */
-
-    /* Now we have an acceptable parent, check if it is the new best */
-    best = curr_instance.of->best_parent(best, nbr);
   }
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
 
   return best;
 }
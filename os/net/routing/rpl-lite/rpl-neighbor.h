@@ -185,6 +185,21 @@ void rpl_neighbor_print_list(const char *str);
 */
 void rpl_neighbor_remove_all(void);
 
+/**
+ * Refresh the cached link metric, path cost and rank of a neighbor, and its
+ * position among the parent candidates. To be called whenever the rank,
+ * metric container or link statistics of the neighbor have changed.
+ * Does nothing unless RPL_WITH_INCREMENTAL_PARENT_SELECTION is set.
+ *
+ * \param nbr The neighbor
+*/
+void rpl_neighbor_update(rpl_nbr_t *nbr);
+
+/**
+ * Refresh the cached state of all neighbors, see rpl_neighbor_update
+*/
+void rpl_neighbor_update_all(void);
+
 /**
  * Returns the best candidate for preferred parent
  *
@@ -142,6 +142,12 @@ struct rpl_nbr {
 #endif /* RPL_WITH_MC */
   rpl_rank_t rank;
   uint8_t dtsn;
+#if RPL_WITH_INCREMENTAL_PARENT_SELECTION
+  /* The OF's view of the neighbor, as of its last DIO or link update */
+  uint16_t link_metric;
+  uint16_t path_cost;
+  rpl_rank_t rank_via;
+#endif /* RPL_WITH_INCREMENTAL_PARENT_SELECTION */
 };
 typedef struct rpl_nbr rpl_nbr_t;
 
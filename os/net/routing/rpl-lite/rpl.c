@@ -104,6 +104,8 @@ rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
       if(curr_instance.dag.urgent_probing_target == nbr) {
         curr_instance.dag.urgent_probing_target = NULL;
       }
+      /* The link metric towards the neighbor has changed */
+      rpl_neighbor_update(nbr);
       /* Link stats were updated, and we need to update our internal state.
       Updating from here is unsafe; postpone */
       LOG_INFO("packet sent to ");
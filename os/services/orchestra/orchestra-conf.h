@@ -102,4 +102,67 @@
 #define ORCHESTRA_COLLISION_FREE_HASH             0 /* Set to 1 if ORCHESTRA_LINKADDR_HASH returns unique hashes */
 #endif /* ORCHESTRA_CONF_COLLISION_FREE_HASH */
 
+/* Traffic-adaptive rule (requires TSCH_CONF_WITH_SIXTOP and
+ * TSCH_CONF_DEDICATED_LINKS_ANY_PACKET). List it before the
+ * unicast rule in ORCHESTRA_CONF_RULES, so that its cells get the lower
+ * slotframe handle and take precedence over overlapping shared cells, e.g.:
+ * { &eb_per_time_source, &unicast_traffic_adaptive, &unicast_per_neighbor_rpl_ns, &default_common } */
+
+/* Length of the slotframe holding the negotiated cells */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_PERIOD
+#define ORCHESTRA_ADAPTIVE_PERIOD                 ORCHESTRA_CONF_ADAPTIVE_PERIOD
+#else /* ORCHESTRA_CONF_ADAPTIVE_PERIOD */
+#define ORCHESTRA_ADAPTIVE_PERIOD                 11
+#endif /* ORCHESTRA_CONF_ADAPTIVE_PERIOD */
+
+/* The 6P scheduling function identifier, from the unmanaged range */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_SFID
+#define ORCHESTRA_ADAPTIVE_SFID                   ORCHESTRA_CONF_ADAPTIVE_SFID
+#else /* ORCHESTRA_CONF_ADAPTIVE_SFID */
+#define ORCHESTRA_ADAPTIVE_SFID                   0xf1
+#endif /* ORCHESTRA_CONF_ADAPTIVE_SFID */
+
+/* Number of neighbors whose queues and cells are tracked */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_NBRS
+#define ORCHESTRA_ADAPTIVE_MAX_NBRS               ORCHESTRA_CONF_ADAPTIVE_MAX_NBRS
+#else /* ORCHESTRA_CONF_ADAPTIVE_MAX_NBRS */
+#define ORCHESTRA_ADAPTIVE_MAX_NBRS               4
+#endif /* ORCHESTRA_CONF_ADAPTIVE_MAX_NBRS */
+
+/* Max number of Tx cells negotiated towards a single neighbor */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS
+#define ORCHESTRA_ADAPTIVE_MAX_CELLS              ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS
+#else /* ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS */
+#define ORCHESTRA_ADAPTIVE_MAX_CELLS              3
+#endif /* ORCHESTRA_CONF_ADAPTIVE_MAX_CELLS */
+
+/* Queue backlog at or above which one more cell is requested */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_ADD_THRESHOLD
+#define ORCHESTRA_ADAPTIVE_ADD_THRESHOLD          ORCHESTRA_CONF_ADAPTIVE_ADD_THRESHOLD
+#else /* ORCHESTRA_CONF_ADAPTIVE_ADD_THRESHOLD */
+#define ORCHESTRA_ADAPTIVE_ADD_THRESHOLD          4
+#endif /* ORCHESTRA_CONF_ADAPTIVE_ADD_THRESHOLD */
+
+/* Queue backlog at or below which a cell is released. Must be lower than
+ * the add threshold, the gap being the hysteresis. */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_DELETE_THRESHOLD
+#define ORCHESTRA_ADAPTIVE_DELETE_THRESHOLD       ORCHESTRA_CONF_ADAPTIVE_DELETE_THRESHOLD
+#else /* ORCHESTRA_CONF_ADAPTIVE_DELETE_THRESHOLD */
+#define ORCHESTRA_ADAPTIVE_DELETE_THRESHOLD       1
+#endif /* ORCHESTRA_CONF_ADAPTIVE_DELETE_THRESHOLD */
+
+/* Number of consecutive checks below the delete threshold before a cell is released */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_RELEASE_DELAY
+#define ORCHESTRA_ADAPTIVE_RELEASE_DELAY          ORCHESTRA_CONF_ADAPTIVE_RELEASE_DELAY
+#else /* ORCHESTRA_CONF_ADAPTIVE_RELEASE_DELAY */
+#define ORCHESTRA_ADAPTIVE_RELEASE_DELAY          5
+#endif /* ORCHESTRA_CONF_ADAPTIVE_RELEASE_DELAY */
+
+/* Interval between two checks of the neighbor queues */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_CHECK_INTERVAL
+#define ORCHESTRA_ADAPTIVE_CHECK_INTERVAL         ORCHESTRA_CONF_ADAPTIVE_CHECK_INTERVAL
+#else /* ORCHESTRA_CONF_ADAPTIVE_CHECK_INTERVAL */
+#define ORCHESTRA_ADAPTIVE_CHECK_INTERVAL         (CLOCK_SECOND / 2)
+#endif /* ORCHESTRA_CONF_ADAPTIVE_CHECK_INTERVAL */
+
 #endif /* __ORCHESTRA_CONF_H__ */
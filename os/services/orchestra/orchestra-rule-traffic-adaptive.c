@@ -0,0 +1,674 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/**
+ * \file
+ *         Orchestra: a slotframe of dedicated unicast cells that follows the
+ *         traffic. The rule watches the TSCH queue of every unicast neighbor
+ *         and, when a backlog builds up, negotiates one more Tx cell with the
+ *         neighbor through 6P. Once the queue has stayed drained for
+ *         ORCHESTRA_ADAPTIVE_RELEASE_DELAY consecutive checks, one cell is
+ *         released again. Add and delete thresholds differ, so that a queue
+ *         hovering around a single value does not make cells flap.
+ *
+ *         The rule does not select packets: while a neighbor has no cell, its
+ *         traffic is handled by the next rule. Negotiated cells are dedicated
+ *         links to the neighbor, which TSCH uses for any of its packets.
+ *         Requires TSCH_CONF_WITH_SIXTOP and
+ *         TSCH_CONF_DEDICATED_LINKS_ANY_PACKET.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/packetbuf.h"
+#include "lib/random.h"
+
+#if TSCH_WITH_SIXTOP && TSCH_DEDICATED_LINKS_ANY_PACKET
+
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "net/mac/tsch/sixtop/sixp.h"
+#include "net/mac/tsch/sixtop/sixp-pkt.h"
+#include "net/mac/tsch/sixtop/sixp-trans.h"
+
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ipv6/uip-debug.h"
+
+/* Number of candidate cells offered in an ADD request */
+#define CANDIDATE_CELLS    3
+/* A cell on the wire: timeslot and channel offsets, little endian */
+#define CELL_LEN           4
+/* Metadata, CellOptions and NumCells of an ADD/DELETE request */
+#define REQUEST_HDR_LEN    4
+
+struct adaptive_nbr {
+  linkaddr_t addr;
+  struct orchestra_adaptive_stats stats;
+  /* Consecutive checks with a backlog below the delete threshold */
+  uint8_t low_checks;
+  /* A request of ours is waiting for its response */
+  uint8_t pending;
+  /* Cell of the ongoing transaction: offered in our ADD response, or
+   * requested in our DELETE request. 6P runs one transaction per peer. */
+  uint8_t cell[CELL_LEN];
+  uint16_t cell_len;
+  uint16_t last_backlog;
+  uint32_t last_enqueued;
+};
+
+static struct adaptive_nbr nbrs[ORCHESTRA_ADAPTIVE_MAX_NBRS];
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+static struct tsch_slotframe *sf_adaptive;
+static struct ctimer check_timer;
+static uint8_t req_storage[REQUEST_HDR_LEN + CANDIDATE_CELLS * CELL_LEN];
+/* Frames sent or received in each timeslot, counted by the slot operation.
+ * Added to the stats of the neighbor owning the cell at every check, and
+ * when the cell is removed. */
+static volatile uint16_t cell_use[ORCHESTRA_ADAPTIVE_PERIOD];
+static uint16_t cell_use_seen[ORCHESTRA_ADAPTIVE_PERIOD];
+
+/*---------------------------------------------------------------------------*/
+static struct adaptive_nbr *
+nbr_lookup(const linkaddr_t *addr)
+{
+  int i;
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_NBRS; i++) {
+    if(linkaddr_cmp(&nbrs[i].addr, addr)) {
+      return &nbrs[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+nbr_is_idle(const struct adaptive_nbr *n)
+{
+  return n->stats.tx_cells == 0 && n->stats.rx_cells == 0
+    && n->stats.backlog == 0 && !n->pending;
+}
+/*---------------------------------------------------------------------------*/
+static struct adaptive_nbr *
+nbr_get(const linkaddr_t *addr)
+{
+  int i;
+  struct adaptive_nbr *n = nbr_lookup(addr);
+  if(n != NULL) {
+    return n;
+  }
+  /* Reuse a free entry, or else one that holds no cells and no backlog */
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_NBRS; i++) {
+    if(linkaddr_cmp(&nbrs[i].addr, &linkaddr_null)) {
+      n = &nbrs[i];
+      break;
+    }
+    if(n == NULL && nbr_is_idle(&nbrs[i])) {
+      n = &nbrs[i];
+    }
+  }
+  if(n != NULL) {
+    memset(n, 0, sizeof(*n));
+    linkaddr_copy(&n->addr, addr);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_cell(uint8_t *buf, uint16_t timeslot)
+{
+  buf[0] = timeslot & 0xff;
+  buf[1] = timeslot >> 8;
+  buf[2] = channel_offset & 0xff;
+  buf[3] = channel_offset >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+read_timeslot(const uint8_t *buf)
+{
+  return buf[0] | (buf[1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static int
+timeslot_is_free(uint16_t timeslot)
+{
+  return timeslot < ORCHESTRA_ADAPTIVE_PERIOD
+    && tsch_schedule_get_link_by_timeslot(sf_adaptive, timeslot) == NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Account the frames of a cell since it was last looked at */
+static void
+collect_use(struct adaptive_nbr *n, const struct tsch_link *l)
+{
+  uint16_t used = cell_use[l->timeslot] - cell_use_seen[l->timeslot];
+  cell_use_seen[l->timeslot] += used;
+  if(n == NULL) {
+    return;
+  }
+  if(l->link_options & LINK_OPTION_TX) {
+    n->stats.tx_used += used;
+  } else {
+    n->stats.rx_used += used;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Install the cells of a list as links to a neighbor. Returns the number of
+ * cells installed. */
+static int
+add_cells(struct adaptive_nbr *n, uint8_t link_options,
+          const uint8_t *cell_list, uint16_t cell_list_len, uint8_t max)
+{
+  uint16_t i;
+  int added = 0;
+  for(i = 0; i + CELL_LEN <= cell_list_len && added < max; i += CELL_LEN) {
+    uint16_t timeslot = read_timeslot(&cell_list[i]);
+    if(timeslot_is_free(timeslot)
+       && tsch_schedule_add_link(sf_adaptive, link_options, LINK_TYPE_NORMAL,
+                                 &n->addr, timeslot, channel_offset) != NULL) {
+      /* Do not count what a previous owner of the cell used */
+      cell_use_seen[timeslot] = cell_use[timeslot];
+      added++;
+    }
+  }
+  if(link_options & LINK_OPTION_TX) {
+    n->stats.tx_cells += added;
+  } else {
+    n->stats.rx_cells += added;
+  }
+  return added;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the cells of a list that are links to a neighbor */
+static void
+remove_cells(struct adaptive_nbr *n, const uint8_t *cell_list, uint16_t cell_list_len)
+{
+  uint16_t i;
+  for(i = 0; i + CELL_LEN <= cell_list_len; i += CELL_LEN) {
+    struct tsch_link *l = tsch_schedule_get_link_by_timeslot(sf_adaptive,
+                                                             read_timeslot(&cell_list[i]));
+    if(l != NULL && linkaddr_cmp(&l->addr, &n->addr)) {
+      collect_use(n, l);
+      if(l->link_options & LINK_OPTION_TX) {
+        n->stats.tx_cells--;
+      } else {
+        n->stats.rx_cells--;
+      }
+      tsch_schedule_remove_link(sf_adaptive, l);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Drop all cells shared with a neighbor, without negotiation. Used when the
+ * neighbor left or is no longer our time source. */
+static void
+drop_cells(const linkaddr_t *addr)
+{
+  struct tsch_link *l;
+  struct adaptive_nbr *n;
+  if(sf_adaptive == NULL || addr == NULL) {
+    return;
+  }
+  n = nbr_lookup(addr);
+  l = list_head(sf_adaptive->links_list);
+  while(l != NULL) {
+    struct tsch_link *next = list_item_next(l);
+    if(linkaddr_cmp(&l->addr, addr)) {
+      collect_use(n, l);
+      tsch_schedule_remove_link(sf_adaptive, l);
+    }
+    l = next;
+  }
+  if(n != NULL) {
+    n->stats.tx_cells = 0;
+    n->stats.rx_cells = 0;
+    n->low_checks = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+request_add(struct adaptive_nbr *n)
+{
+  uint16_t start;
+  uint16_t i;
+  uint8_t num_candidates = 0;
+  uint8_t *cell_list = &req_storage[REQUEST_HDR_LEN];
+
+  /* Offer free timeslots, starting from a random one to spread the
+   * choices of neighbors negotiating at the same time */
+  start = random_rand() % ORCHESTRA_ADAPTIVE_PERIOD;
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_PERIOD && num_candidates < CANDIDATE_CELLS; i++) {
+    uint16_t timeslot = (start + i) % ORCHESTRA_ADAPTIVE_PERIOD;
+    if(timeslot_is_free(timeslot)) {
+      write_cell(&cell_list[num_candidates * CELL_LEN], timeslot);
+      num_candidates++;
+    }
+  }
+  if(num_candidates == 0) {
+    return -1;
+  }
+
+  if(sixp_pkt_set_metadata(SIXP_PKT_TYPE_REQUEST,
+                           (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                           0, req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                            1, req_storage, sizeof(req_storage)) != 0) {
+    return -1;
+  }
+
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                 ORCHESTRA_ADAPTIVE_SFID, req_storage,
+                 REQUEST_HDR_LEN + num_candidates * CELL_LEN,
+                 &n->addr, NULL, NULL, 0) != 0) {
+    return -1;
+  }
+  PRINTF("Orchestra adaptive: ADD request to %u, backlog %u, %u cells\n",
+         n->addr.u8[LINKADDR_SIZE - 1], n->stats.backlog, n->stats.tx_cells);
+  n->stats.add_requests++;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+request_delete(struct adaptive_nbr *n)
+{
+  struct tsch_link *l;
+  struct tsch_link *last = NULL;
+
+  /* Release the most recently negotiated Tx cell. Links are appended to
+   * the slotframe as they are added, so this is the last one in the list. */
+  for(l = list_head(sf_adaptive->links_list); l != NULL; l = list_item_next(l)) {
+    if(linkaddr_cmp(&l->addr, &n->addr) && (l->link_options & LINK_OPTION_TX)) {
+      last = l;
+    }
+  }
+  l = last;
+  if(l == NULL) {
+    n->stats.tx_cells = 0;
+    return -1;
+  }
+  write_cell(&req_storage[REQUEST_HDR_LEN], l->timeslot);
+  /* Keep the cell around for the response */
+  memcpy(n->cell, &req_storage[REQUEST_HDR_LEN], CELL_LEN);
+  n->cell_len = CELL_LEN;
+
+  if(sixp_pkt_set_metadata(SIXP_PKT_TYPE_REQUEST,
+                           (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                           0, req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                            1, req_storage, sizeof(req_storage)) != 0) {
+    return -1;
+  }
+
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                 ORCHESTRA_ADAPTIVE_SFID, req_storage,
+                 REQUEST_HDR_LEN + CELL_LEN,
+                 &n->addr, NULL, NULL, 0) != 0) {
+    return -1;
+  }
+  PRINTF("Orchestra adaptive: DELETE request to %u, timeslot %u\n",
+         n->addr.u8[LINKADDR_SIZE - 1], l->timeslot);
+  n->stats.delete_requests++;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_nbr(struct adaptive_nbr *n)
+{
+  struct tsch_link *l;
+  int count = tsch_queue_packet_count(&n->addr);
+  uint16_t backlog = count > 0 ? count : 0;
+  /* Whatever was queued at the last check or enqueued since, and is not
+   * queued anymore, has left the queue */
+  int32_t drained = (int32_t)(n->last_backlog + (n->stats.enqueued - n->last_enqueued)) - backlog;
+
+  if(drained > 0) {
+    n->stats.drained += drained;
+  }
+  n->last_backlog = backlog;
+  n->last_enqueued = n->stats.enqueued;
+  n->stats.backlog = backlog;
+  if(backlog > n->stats.peak_backlog) {
+    n->stats.peak_backlog = backlog;
+  }
+  for(l = list_head(sf_adaptive->links_list); l != NULL; l = list_item_next(l)) {
+    if(linkaddr_cmp(&l->addr, &n->addr)) {
+      collect_use(n, l);
+    }
+  }
+
+  if(n->pending || sixp_trans_find(&n->addr) != NULL) {
+    /* One transaction at a time per neighbor */
+    return;
+  }
+
+  if(backlog >= ORCHESTRA_ADAPTIVE_ADD_THRESHOLD
+     && n->stats.tx_cells < ORCHESTRA_ADAPTIVE_MAX_CELLS) {
+    n->low_checks = 0;
+    if(request_add(n) == 0) {
+      n->pending = 1;
+    } else {
+      n->stats.rejected++;
+    }
+  } else if(backlog <= ORCHESTRA_ADAPTIVE_DELETE_THRESHOLD
+            && n->stats.tx_cells > 0) {
+    if(++n->low_checks >= ORCHESTRA_ADAPTIVE_RELEASE_DELAY) {
+      n->low_checks = 0;
+      if(request_delete(n) == 0) {
+        n->pending = 1;
+      }
+    }
+  } else {
+    n->low_checks = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_timer_callback(void *ptr)
+{
+  int i;
+  if(tsch_is_associated) {
+    for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_NBRS; i++) {
+      if(!linkaddr_cmp(&nbrs[i].addr, &linkaddr_null)) {
+        check_nbr(&nbrs[i]);
+      }
+    }
+  }
+  ctimer_reset(&check_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_sent_callback(void *arg, uint16_t arg_len,
+                       const linkaddr_t *dest_addr, sixp_output_status_t status)
+{
+  struct adaptive_nbr *n = (struct adaptive_nbr *)arg;
+  if(status == SIXP_OUTPUT_STATUS_SUCCESS || n == NULL
+     || !linkaddr_cmp(&n->addr, dest_addr)) {
+    return;
+  }
+  /* The peer did not get the response and installs no Tx cell: release
+   * the Rx cell reserved for it */
+  remove_cells(n, n->cell, n->cell_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_request_input(const uint8_t *body, uint16_t body_len, const linkaddr_t *peer_addr)
+{
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  uint16_t i;
+  struct adaptive_nbr *n;
+
+  if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                            &cell_list, &cell_list_len,
+                            body, body_len) != 0
+     || (n = nbr_get(peer_addr)) == NULL) {
+    sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_ERR_BUSY,
+                ORCHESTRA_ADAPTIVE_SFID, NULL, 0, peer_addr, NULL, NULL, 0);
+    return;
+  }
+
+  /* Grant the first candidate that is free on our side too. If none is,
+   * answer with an empty cell list and let the peer try again. The Rx
+   * cell is installed before answering, so that the timeslot cannot be
+   * granted to another peer meanwhile. */
+  n->cell_len = 0;
+  for(i = 0; i + CELL_LEN <= cell_list_len; i += CELL_LEN) {
+    write_cell(n->cell, read_timeslot(&cell_list[i]));
+    if(add_cells(n, LINK_OPTION_RX, n->cell, CELL_LEN, 1) > 0) {
+      n->cell_len = CELL_LEN;
+      break;
+    }
+  }
+  if(sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                 ORCHESTRA_ADAPTIVE_SFID, n->cell, n->cell_len, peer_addr,
+                 response_sent_callback, n, sizeof(*n)) != 0) {
+    remove_cells(n, n->cell, n->cell_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+delete_request_input(const uint8_t *body, uint16_t body_len, const linkaddr_t *peer_addr)
+{
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  struct adaptive_nbr *n;
+
+  if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                            &cell_list, &cell_list_len,
+                            body, body_len) != 0) {
+    sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_ERR,
+                ORCHESTRA_ADAPTIVE_SFID, NULL, 0, peer_addr, NULL, NULL, 0);
+    return;
+  }
+
+  /* Deleting is always granted. The Rx cell is removed right away: should
+   * the response get lost, the peer keeps a Tx cell nobody listens to until
+   * its next release attempt. */
+  n = nbr_lookup(peer_addr);
+  if(n != NULL && cell_list_len >= CELL_LEN) {
+    memcpy(n->cell, cell_list, CELL_LEN);
+    n->cell_len = CELL_LEN;
+    remove_cells(n, n->cell, n->cell_len);
+    sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                ORCHESTRA_ADAPTIVE_SFID, n->cell, n->cell_len,
+                peer_addr, NULL, NULL, 0);
+  } else {
+    sixp_output(SIXP_PKT_TYPE_RESPONSE,
+                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                ORCHESTRA_ADAPTIVE_SFID, NULL, 0, peer_addr, NULL, NULL, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(sixp_pkt_rc_t rc, const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  const uint8_t *cell_list;
+  uint16_t cell_list_len;
+  sixp_trans_t *trans;
+  sixp_pkt_cmd_t cmd;
+  struct adaptive_nbr *n = nbr_lookup(peer_addr);
+
+  if(n == NULL || (trans = sixp_trans_find(peer_addr)) == NULL) {
+    return;
+  }
+  n->pending = 0;
+  cmd = sixp_trans_get_cmd(trans);
+
+  if(rc != SIXP_PKT_RC_SUCCESS
+     || sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                               (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                               &cell_list, &cell_list_len,
+                               body, body_len) != 0) {
+    cell_list = NULL;
+    cell_list_len = 0;
+  }
+
+  if(cmd == SIXP_PKT_CMD_ADD) {
+    if(add_cells(n, LINK_OPTION_TX, cell_list, cell_list_len, 1) == 0) {
+      n->stats.rejected++;
+    } else {
+      PRINTF("Orchestra adaptive: %u Tx cells to %u\n",
+             n->stats.tx_cells, peer_addr->u8[LINKADDR_SIZE - 1]);
+    }
+  } else if(cmd == SIXP_PKT_CMD_DELETE && rc == SIXP_PKT_RC_SUCCESS) {
+    /* Remove the cell we asked for, also if the peer did not have it anymore */
+    remove_cells(n, n->cell, n->cell_len);
+    PRINTF("Orchestra adaptive: %u Tx cells to %u\n",
+           n->stats.tx_cells, peer_addr->u8[LINKADDR_SIZE - 1]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sf_input(sixp_pkt_type_t type, sixp_pkt_code_t code,
+         const uint8_t *body, uint16_t body_len, const linkaddr_t *src_addr)
+{
+  if(sf_adaptive == NULL) {
+    return;
+  }
+  if(type == SIXP_PKT_TYPE_REQUEST) {
+    if(code.cmd == SIXP_PKT_CMD_ADD) {
+      add_request_input(body, body_len, src_addr);
+    } else if(code.cmd == SIXP_PKT_CMD_DELETE) {
+      delete_request_input(body, body_len, src_addr);
+    }
+  } else if(type == SIXP_PKT_TYPE_RESPONSE) {
+    response_input(code.rc, body, body_len, src_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sf_timeout(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr)
+{
+  struct adaptive_nbr *n = nbr_lookup(peer_addr);
+  if(n != NULL && n->pending) {
+    n->pending = 0;
+    if(cmd == SIXP_PKT_CMD_ADD) {
+      n->stats.rejected++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sf_init(void)
+{
+  int i;
+  /* Called at every association: cells from a previous network are stale */
+  for(i = 0; i < ORCHESTRA_ADAPTIVE_MAX_NBRS; i++) {
+    if(!linkaddr_cmp(&nbrs[i].addr, &linkaddr_null)) {
+      drop_cells(&nbrs[i].addr);
+      nbrs[i].pending = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const sixtop_sf_t adaptive_sf = {
+  ORCHESTRA_ADAPTIVE_SFID,
+  CLOCK_SECOND,
+  sf_init,
+  sf_input,
+  sf_timeout
+};
+/*---------------------------------------------------------------------------*/
+int
+orchestra_adaptive_get_stats(const linkaddr_t *addr, struct orchestra_adaptive_stats *stats)
+{
+  struct adaptive_nbr *n = nbr_lookup(addr);
+  if(n == NULL || addr == NULL || linkaddr_cmp(addr, &linkaddr_null)) {
+    return 0;
+  }
+  if(stats != NULL) {
+    memcpy(stats, &n->stats, sizeof(*stats));
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+orchestra_callback_link_used(const struct tsch_link *link, int is_tx)
+{
+  /* Called from the slot operation: only count, the rest is done at the
+   * next check */
+  if(sf_adaptive != NULL && link->slotframe_handle == slotframe_handle
+     && link->timeslot < ORCHESTRA_ADAPTIVE_PERIOD) {
+    cell_use[link->timeslot]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_added(const linkaddr_t *linkaddr)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_removed(const linkaddr_t *linkaddr)
+{
+  drop_cells(linkaddr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* Only account unicast data packets, leave the selection to the next rules */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && !linkaddr_cmp(dest, &linkaddr_null)
+     && !linkaddr_cmp(dest, &tsch_broadcast_address)) {
+    struct adaptive_nbr *n = nbr_get(dest);
+    if(n != NULL) {
+      n->stats.enqueued++;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(old != new && old != NULL) {
+    drop_cells(&old->addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  channel_offset = sf_handle;
+  /* An empty slotframe, populated through 6P */
+  sf_adaptive = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_ADAPTIVE_PERIOD);
+  sixtop_add_sf(&adaptive_sf);
+  ctimer_set(&check_timer, ORCHESTRA_ADAPTIVE_CHECK_INTERVAL, check_timer_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_traffic_adaptive = {
+  init,
+  new_time_source,
+  select_packet,
+  child_added,
+  child_removed,
+};
+
+#endif /* TSCH_WITH_SIXTOP && TSCH_DEDICATED_LINKS_ANY_PACKET */
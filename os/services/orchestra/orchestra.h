@@ -54,6 +54,22 @@ struct orchestra_rule eb_per_time_source;
 struct orchestra_rule unicast_per_neighbor_rpl_storing;
 struct orchestra_rule unicast_per_neighbor_rpl_ns;
 struct orchestra_rule default_common;
+struct orchestra_rule unicast_traffic_adaptive;
+
+/* Per-neighbor statistics of the traffic-adaptive rule */
+struct orchestra_adaptive_stats {
+  uint8_t tx_cells;           /* Tx cells currently negotiated towards the neighbor */
+  uint8_t rx_cells;           /* Rx cells the neighbor negotiated towards us */
+  uint16_t backlog;           /* Queue backlog at the last check */
+  uint16_t peak_backlog;      /* Highest backlog seen at a check */
+  uint32_t enqueued;          /* Packets handed to the MAC for the neighbor */
+  uint32_t drained;           /* Packets that left the queue (sent or dropped) */
+  uint32_t tx_used;           /* Frames sent in the negotiated Tx cells */
+  uint32_t rx_used;           /* Frames received in the negotiated Rx cells */
+  uint16_t add_requests;      /* 6P ADD requests sent */
+  uint16_t delete_requests;   /* 6P DELETE requests sent */
+  uint16_t rejected;          /* ADD requests that failed or were answered without cells */
+};
 
 extern linkaddr_t orchestra_parent_linkaddr;
 extern int orchestra_parent_knows_us;
@@ -69,5 +85,10 @@ void orchestra_callback_new_time_source(const struct tsch_neighbor *old, const s
 void orchestra_callback_child_added(const linkaddr_t *addr);
 /* Set with #define NETSTACK_CONF_ROUTING_NEIGHBOR_REMOVED_CALLBACK orchestra_callback_child_removed */
 void orchestra_callback_child_removed(const linkaddr_t *addr);
+/* Set with #define TSCH_CALLBACK_LINK_USED orchestra_callback_link_used, done by
+ * default when the traffic-adaptive rule can be built */
+void orchestra_callback_link_used(const struct tsch_link *link, int is_tx);
+/* Get the traffic-adaptive statistics of a neighbor. Returns 0 if the neighbor is not tracked */
+int orchestra_adaptive_get_stats(const linkaddr_t *addr, struct orchestra_adaptive_stats *stats);
 
 #endif /* __ORCHESTRA_H__ */
@@ -590,7 +590,69 @@ PT_THREAD(cmd_tsch_status(struct pt *pt, shell_output_func output, char *args))
 
   PT_END(pt);
 }
+#if TSCH_STATS_SLOT_TIMING
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_tsch_timing(struct pt *pt, shell_output_func output, char *args))
+{
+  char *next_args;
+  int phase;
+  int bin;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+  SHELL_ARGS_NEXT(args, next_args);
+
+  if(args != NULL && !strcmp(args, "reset")) {
+    tsch_stats_slot_timing_reset();
+    SHELL_OUTPUT(output, "TSCH slot timing reset\n");
+    PT_EXIT(pt);
+  }
+
+  SHELL_OUTPUT(output, "TSCH slot timing (rtimer ticks, %lu per second):\n", (unsigned long)RTIMER_SECOND);
+  SHELL_OUTPUT(output, "-- Skipped slots: locked %lu, no link %lu, missed %lu\n",
+               (unsigned long)tsch_slot_timing_stats.skipped_locked,
+               (unsigned long)tsch_slot_timing_stats.skipped_no_link,
+               (unsigned long)tsch_slot_timing_stats.skipped_missed);
+  for(phase = 0; phase < TSCH_SLOT_PHASE_COUNT; phase++) {
+    SHELL_OUTPUT(output, "-- %-6s: %s %ld, last at %lu, histogram:",
+                 tsch_stats_slot_phase_name(phase),
+                 phase == TSCH_SLOT_PHASE_WAKE ? "max latency" : "min slack",
+                 (long)tsch_slot_timing_stats.worst[phase],
+                 (unsigned long)tsch_slot_timing_stats.last[phase]);
+    for(bin = 0; bin < TSCH_STATS_SLOT_TIMING_BINS; bin++) {
+      SHELL_OUTPUT(output, " %u", tsch_slot_timing_stats.histogram[phase][bin]);
+    }
+    SHELL_OUTPUT(output, "\n");
+  }
+
+  PT_END(pt);
+}
+#endif /* TSCH_STATS_SLOT_TIMING */
 #endif /* MAC_CONF_WITH_TSCH */
+#if MAC_CONF_WITH_CSMA
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_csma_queues(struct pt *pt, shell_output_func output, char *args))
+{
+  uint8_t i;
+  const struct csma_class_stats *stats;
+
+  PT_BEGIN(pt);
+
+  SHELL_OUTPUT(output, "CSMA queues:\n");
+  for(i = 0; (stats = csma_output_class_stats(i)) != NULL; i++) {
+    SHELL_OUTPUT(output, "-- %-7s: queued %u (peak %u), enqueued %lu, sent %lu, failed %lu, expired %lu, overflows %lu\n",
+                 csma_output_class_name(i), stats->queued, stats->peak,
+                 (unsigned long)stats->enqueued, (unsigned long)stats->sent,
+                 (unsigned long)stats->failed, (unsigned long)stats->expired,
+                 (unsigned long)stats->overflows);
+  }
+
+  PT_END(pt);
+}
+#endif /* MAC_CONF_WITH_CSMA */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(cmd_routes(struct pt *pt, shell_output_func output, char *args))
@@ -867,7 +929,13 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "tsch-set-coordinator", cmd_tsch_set_coordinator, "'> tsch-set-coordinator 0/1 [0/1]': Sets node as coordinator (1) or not (0). Second, optional parameter: enable (1) or disable (0) security." },
   { "tsch-schedule",        cmd_tsch_schedule,        "'> tsch-schedule': Shows the current TSCH schedule" },
   { "tsch-status",          cmd_tsch_status,          "'> tsch-status': Shows a summary of the current TSCH state" },
+#if TSCH_STATS_SLOT_TIMING
+  { "tsch-timing",          cmd_tsch_timing,          "'> tsch-timing [reset]': Shows (or resets) the slack histograms of the TSCH slot phases" },
+#endif /* TSCH_STATS_SLOT_TIMING */
 #endif /* MAC_CONF_WITH_TSCH */
+#if MAC_CONF_WITH_CSMA
+  { "csma-queues",          cmd_csma_queues,          "'> csma-queues': Shows the CSMA queue occupancy per traffic class" },
+#endif /* MAC_CONF_WITH_CSMA */
 #if TSCH_WITH_SIXTOP
   { "6top",                 cmd_6top,                 "'> 6top help': Shows 6top command usage" },
 #endif /* TSCH_WITH_SIXTOP */
@@ -37,6 +37,7 @@
 #include "tsch.h"
 #include "tsch-stats.h"
 #include "tsch-cs.h"
+#include "lib/assert.h"
 
 /* Log configuration */
 #include "sys/log.h"
@@ -73,6 +74,23 @@ static tsch_cs_bitmap_t tsch_cs_initial_bitmap;
 /* The bitmap with the current channels */
 static tsch_cs_bitmap_t tsch_cs_current_bitmap;
 
+#if TSCH_CS_WEIGHTED_HOPPING
+/* The weighted sequence must fit in tsch_hopping_sequence. Both lengths
+ * may be sizeof expressions, so this cannot be checked by the preprocessor. */
+CTASSERT(TSCH_CS_WEIGHTED_SEQUENCE_LEN <= TSCH_HOPPING_SEQUENCE_MAX_LEN);
+/* The selected channels, each once. The hopping sequence repeats them by quality. */
+static uint8_t tsch_cs_channels[TSCH_STATS_NUM_CHANNELS];
+static uint8_t tsch_cs_num_channels;
+/* The channel qualities the current hopping sequence was built from */
+static tsch_stat_t tsch_cs_weighted_metric[TSCH_STATS_NUM_CHANNELS];
+#define TSCH_CS_CHANNELS tsch_cs_channels
+#define TSCH_CS_NUM_CHANNELS tsch_cs_num_channels
+#else /* TSCH_CS_WEIGHTED_HOPPING */
+/* The selected channels are the hopping sequence itself */
+#define TSCH_CS_CHANNELS tsch_hopping_sequence
+#define TSCH_CS_NUM_CHANNELS tsch_hopping_sequence_length.val
+#endif /* TSCH_CS_WEIGHTED_HOPPING */
+
 /* structure for sorting */
 struct tsch_cs_quality {
   /* channel number */
@@ -98,8 +116,8 @@ tsch_cs_bitmap_calc(void)
 {
   tsch_cs_bitmap_t result = 0;
   int i;
-  for(i = 0; i < tsch_hopping_sequence_length.val; ++i) {
-    result = tsch_cs_bitmap_set(result, tsch_hopping_sequence[i]);
+  for(i = 0; i < TSCH_CS_NUM_CHANNELS; ++i) {
+    result = tsch_cs_bitmap_set(result, TSCH_CS_CHANNELS[i]);
   }
   return result;
 }
@@ -107,6 +125,17 @@ tsch_cs_bitmap_calc(void)
 void
 tsch_cs_adaptations_init(void)
 {
+#if TSCH_CS_WEIGHTED_HOPPING
+  /* Start from the channels of the sequence the coordinator starts with */
+  int i;
+  tsch_cs_num_channels = 0;
+  for(i = 0; i < sizeof(TSCH_DEFAULT_HOPPING_SEQUENCE); ++i) {
+    uint8_t channel = TSCH_DEFAULT_HOPPING_SEQUENCE[i];
+    if(!tsch_cs_bitmap_contains(tsch_cs_bitmap_calc(), channel)) {
+      tsch_cs_channels[tsch_cs_num_channels++] = channel;
+    }
+  }
+#endif /* TSCH_CS_WEIGHTED_HOPPING */
   tsch_cs_initial_bitmap = tsch_cs_bitmap_calc();
   tsch_cs_current_bitmap = tsch_cs_initial_bitmap;
 }
@@ -189,29 +218,15 @@ tsch_cs_select_replacement(uint8_t old_channel, tsch_stat_t old_ewma,
   return 0xff;
 }
 /*---------------------------------------------------------------------------*/
-bool
-tsch_cs_process(void)
+/* Replace the worst selected channel if it is busy. Returns true if replaced. */
+static bool
+tsch_cs_replace_channel(void)
 {
   int i;
   bool try_replace;
-  bool has_replaced;
   struct tsch_cs_quality qualities[TSCH_STATS_NUM_CHANNELS];
   uint8_t is_channel_busy[TSCH_STATS_NUM_CHANNELS];
   uint8_t is_in_sequence[TSCH_STATS_NUM_CHANNELS];
-  static uint32_t last_time_changed;
-
-  if(!recaculation_requested) {
-    /* nothing to do */
-    return false;
-  }
-
-  if(last_time_changed != 0 && last_time_changed + TSCH_CS_MIN_UPDATE_INTERVAL_SEC > clock_seconds()) {
-    /* too soon */
-    return false;
-  }
-
-  /* reset the flag */
-  recaculation_requested = false;
 
   for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
     qualities[i].channel = i + TSCH_STATS_FIRST_CHANNEL;
@@ -226,13 +241,13 @@ tsch_cs_process(void)
     is_channel_busy[i] = (tsch_stats.channel_free_ewma[i] < TSCH_CS_FREE_THRESHOLD);
   }
   memset(is_in_sequence, 0xff, sizeof(is_in_sequence));
-  for(i = 0; i < tsch_hopping_sequence_length.val; ++i) {
-    uint8_t channel = tsch_hopping_sequence[i];
+  for(i = 0; i < TSCH_CS_NUM_CHANNELS; ++i) {
+    uint8_t channel = TSCH_CS_CHANNELS[i];
     is_in_sequence[channel - TSCH_STATS_FIRST_CHANNEL] = i;
   }
 
   /* mark the first N channels as "good" - there is nothing better to select */
-  for(i = 0; i < tsch_hopping_sequence_length.val; ++i) {
+  for(i = 0; i < TSCH_CS_NUM_CHANNELS; ++i) {
      is_channel_busy[qualities[i].channel - TSCH_STATS_FIRST_CHANNEL] = 0;
   }
 
@@ -247,8 +262,8 @@ tsch_cs_process(void)
   }
 
   try_replace = false;
-  for(i = 0; i < tsch_hopping_sequence_length.val; ++i) {
-    uint8_t channel = tsch_hopping_sequence[i];
+  for(i = 0; i < TSCH_CS_NUM_CHANNELS; ++i) {
+    uint8_t channel = TSCH_CS_CHANNELS[i];
     if(is_channel_busy[channel - TSCH_STATS_FIRST_CHANNEL]) {
       try_replace = true;
     }
@@ -258,8 +273,7 @@ tsch_cs_process(void)
     return false;
   }
 
-  has_replaced = false;
-  for(i = TSCH_STATS_NUM_CHANNELS - 1; i >= tsch_hopping_sequence_length.val; --i) {
+  for(i = TSCH_STATS_NUM_CHANNELS - 1; i >= TSCH_CS_NUM_CHANNELS; --i) {
     if(is_in_sequence[qualities[i].channel - TSCH_STATS_FIRST_CHANNEL] != 0xff) {
       /* found the worst channel; it must be busy */
       uint8_t channel = qualities[i].channel;
@@ -270,20 +284,135 @@ tsch_cs_process(void)
 
       if(replacement != 0xff) {
         printf("\ncs: replacing channel %u %u (%u) with %u\n",
-               channel, tsch_hopping_sequence[position], position, replacement);
+               channel, TSCH_CS_CHANNELS[position], position, replacement);
         /* mark the old channel as busy */
         tsch_cs_busy_since[channel - TSCH_STATS_FIRST_CHANNEL] = clock_seconds();
         /* do the actual replacement in the global TSCH HS variable */
-        tsch_hopping_sequence[position] = replacement;
-        has_replaced = true;
+        TSCH_CS_CHANNELS[position] = replacement;
         /* recalculate the hopping sequence bitmap */
         tsch_cs_current_bitmap = tsch_cs_bitmap_calc();
+        return true;
       }
       break; /* replace just one at once */
     }
   }
 
-  if(has_replaced) {
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+#if TSCH_CS_WEIGHTED_HOPPING
+/* Build the hopping sequence from the selected channels, repeating each in
+ * proportion to its quality. Returns true if the sequence has changed. */
+static bool
+tsch_cs_build_weighted_sequence(void)
+{
+  int i, j;
+  uint8_t sequence[TSCH_CS_WEIGHTED_SEQUENCE_LEN];
+  uint8_t count[TSCH_STATS_NUM_CHANNELS];
+  uint32_t remainder[TSCH_STATS_NUM_CHANNELS];
+  int16_t credit[TSCH_STATS_NUM_CHANNELS];
+  uint32_t total;
+  uint8_t spare;
+  uint8_t assigned;
+
+  if(tsch_cs_num_channels == 0) {
+    return false;
+  }
+
+  /* Every channel gets one slot, the spare ones are shared by quality */
+  total = 0;
+  for(i = 0; i < tsch_cs_num_channels; ++i) {
+    uint8_t index = tsch_cs_channels[i] - TSCH_STATS_FIRST_CHANNEL;
+    tsch_cs_weighted_metric[index] = tsch_stats.channel_free_ewma[index];
+    total += tsch_cs_weighted_metric[index];
+  }
+  spare = TSCH_CS_WEIGHTED_SEQUENCE_LEN > tsch_cs_num_channels ?
+    TSCH_CS_WEIGHTED_SEQUENCE_LEN - tsch_cs_num_channels : 0;
+  assigned = 0;
+  for(i = 0; i < tsch_cs_num_channels; ++i) {
+    uint8_t index = tsch_cs_channels[i] - TSCH_STATS_FIRST_CHANNEL;
+    uint32_t share = (uint32_t)spare * (total ? tsch_cs_weighted_metric[index] : 1);
+    uint32_t divisor = total ? total : tsch_cs_num_channels;
+    count[i] = 1 + share / divisor;
+    remainder[i] = share % divisor;
+    assigned += count[i] - 1;
+  }
+  /* Hand the slots lost to rounding to the largest remainders */
+  while(assigned < spare) {
+    uint8_t best = 0;
+    for(i = 1; i < tsch_cs_num_channels; ++i) {
+      if(remainder[i] > remainder[best]) {
+        best = i;
+      }
+    }
+    count[best]++;
+    remainder[best] = 0;
+    assigned++;
+  }
+
+  /* Interleave with smooth weighted round-robin, so that the repetitions
+   * of a channel are spread over the sequence rather than adjacent */
+  memset(credit, 0, sizeof(credit));
+  for(j = 0; j < tsch_cs_num_channels + spare; ++j) {
+    uint8_t best = 0;
+    for(i = 0; i < tsch_cs_num_channels; ++i) {
+      credit[i] += count[i];
+      if(credit[i] > credit[best]) {
+        best = i;
+      }
+    }
+    credit[best] -= tsch_cs_num_channels + spare;
+    sequence[j] = tsch_cs_channels[best];
+  }
+
+  if(j == tsch_hopping_sequence_length.val
+     && !memcmp(tsch_hopping_sequence, sequence, j)) {
+    return false;
+  }
+
+  /* The slot operation reads the sequence and its length from interrupt */
+  if(!tsch_get_lock()) {
+    /* Try again at the next processing */
+    recaculation_requested = true;
+    return false;
+  }
+  memcpy(tsch_hopping_sequence, sequence, j);
+  TSCH_ASN_DIVISOR_INIT(tsch_hopping_sequence_length, j);
+  tsch_release_lock();
+  LOG_INFO("weighted hopping sequence of %u slots over %u channels\n",
+           j, tsch_cs_num_channels);
+  return true;
+}
+#endif /* TSCH_CS_WEIGHTED_HOPPING */
+/*---------------------------------------------------------------------------*/
+bool
+tsch_cs_process(void)
+{
+  bool has_changed;
+  static uint32_t last_time_changed;
+
+  if(!recaculation_requested) {
+    /* nothing to do */
+    return false;
+  }
+
+  if(last_time_changed != 0 && last_time_changed + TSCH_CS_MIN_UPDATE_INTERVAL_SEC > clock_seconds()) {
+    /* too soon */
+    return false;
+  }
+
+  /* reset the flag */
+  recaculation_requested = false;
+
+  has_changed = tsch_cs_replace_channel();
+#if TSCH_CS_WEIGHTED_HOPPING
+  /* the selected channels or their qualities changed: rebuild the sequence */
+  if(tsch_cs_build_weighted_sequence()) {
+    has_changed = true;
+  }
+#endif /* TSCH_CS_WEIGHTED_HOPPING */
+
+  if(has_changed) {
     last_time_changed = clock_seconds();
     return true;
   }
@@ -325,4 +454,15 @@ tsch_cs_channel_stats_updated(uint8_t updated_channel, uint16_t old_busyness_met
       recaculation_requested = true;
     }
   }
+
+#if TSCH_CS_WEIGHTED_HOPPING
+  if(tsch_cs_bitmap_contains(tsch_cs_current_bitmap, updated_channel)) {
+    tsch_stat_t built = tsch_cs_weighted_metric[index];
+    tsch_stat_t now = tsch_stats.channel_free_ewma[index];
+    if((now > built ? now - built : built - now) > TSCH_CS_WEIGHT_HYSTERESIS) {
+      /* the weight of a channel in use has drifted */
+      recaculation_requested = true;
+    }
+  }
+#endif /* TSCH_CS_WEIGHTED_HOPPING */
 }
@@ -50,6 +50,34 @@
 
 #define TSCH_CS_LEARNING_PERIOD_SEC 30
 
+/* Weighted hopping: rather than hopping over each selected channel once,
+ * build a longer hopping sequence in which the selected channels appear in
+ * proportion to their `channel_free_ewma`, each at least once. The sequence
+ * is distributed in EBs like any other, so all nodes must be built with a
+ * TSCH_CONF_HOPPING_SEQUENCE_MAX_LEN that fits it. */
+#ifdef TSCH_CS_CONF_WEIGHTED_HOPPING
+#define TSCH_CS_WEIGHTED_HOPPING TSCH_CS_CONF_WEIGHTED_HOPPING
+#else
+#define TSCH_CS_WEIGHTED_HOPPING 0
+#endif
+
+/* Length of the weighted hopping sequence. The slots beyond one per
+ * selected channel are shared by quality, so the default leaves as many
+ * as there are channels. Must not exceed TSCH_HOPPING_SEQUENCE_MAX_LEN. */
+#ifdef TSCH_CS_CONF_WEIGHTED_SEQUENCE_LEN
+#define TSCH_CS_WEIGHTED_SEQUENCE_LEN TSCH_CS_CONF_WEIGHTED_SEQUENCE_LEN
+#else
+#define TSCH_CS_WEIGHTED_SEQUENCE_LEN (2 * sizeof(TSCH_DEFAULT_HOPPING_SEQUENCE))
+#endif
+
+/* Rebuild the weighted sequence when the quality of a channel in use has
+ * drifted by more than this since the sequence was last built */
+#ifdef TSCH_CS_CONF_WEIGHT_HYSTERESIS
+#define TSCH_CS_WEIGHT_HYSTERESIS TSCH_CS_CONF_WEIGHT_HYSTERESIS
+#else
+#define TSCH_CS_WEIGHT_HYSTERESIS ((tsch_stat_t)(TSCH_STATS_BINARY_SCALING_FACTOR / 10))
+#endif
+
 /**
  * \brief Initializes the TSCH hopping sequence selection module.
  */
@@ -89,6 +89,17 @@
 #define DB_RELATION_POOL_SIZE		5
 #endif /* DB_RELATION_POOL_SIZE */
 
+/* The maximum number of relations whose rows are cached in memory.
+   Set to 0 to read every row directly from the storage. */
+#ifndef DB_ROW_CACHE_LIMIT
+#define DB_ROW_CACHE_LIMIT		2
+#endif /* DB_ROW_CACHE_LIMIT */
+
+/* The size of each row cache, which is filled with one storage read. */
+#ifndef DB_ROW_CACHE_SIZE
+#define DB_ROW_CACHE_SIZE		128
+#endif /* DB_ROW_CACHE_SIZE */
+
 /* The maximum number of attributes loaded in memory. */
 #ifndef DB_ATTRIBUTE_POOL_SIZE
 #define DB_ATTRIBUTE_POOL_SIZE		16
@@ -104,6 +115,18 @@
 #define DB_MAX_ELEMENT_SIZE		16
 #endif /* DB_MAX_ELEMENT_SIZE */
 
+/* The maximum number of tuples in the smaller relation of a join for it
+   to be joined through a hash table in RAM. Set to 0 to disable hash
+   joins. */
+#ifndef DB_JOIN_HASH_LIMIT
+#define DB_JOIN_HASH_LIMIT		64
+#endif /* DB_JOIN_HASH_LIMIT */
+
+/* The number of buckets in the join hash table. */
+#ifndef DB_JOIN_HASH_BUCKETS
+#define DB_JOIN_HASH_BUCKETS		16
+#endif /* DB_JOIN_HASH_BUCKETS */
+
 
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
@@ -215,6 +238,29 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The number of keys in a B+-tree node. The default gives
+   nodes of 128 bytes. */
+#ifndef DB_BTREE_ORDER
+#define DB_BTREE_ORDER			15
+#endif /* DB_BTREE_ORDER */
+
+/* The maximum number of nodes in a B+-tree index, for which
+   space is reserved when the index is created. */
+#ifndef DB_BTREE_NODE_LIMIT
+#define DB_BTREE_NODE_LIMIT		128
+#endif /* DB_BTREE_NODE_LIMIT */
+
+/* The number of B+-tree nodes cached in RAM, shared by all
+   B+-tree indexes. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		4
+#endif /* DB_BTREE_CACHE_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -236,5 +282,17 @@
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
 #endif /* LVM_USE_FLOATS */
 
+/* Compile query predicates into register programs, or into plain range
+   checks, instead of interpreting the bytecode for each tuple. */
+#ifndef LVM_USE_COMPILER
+#define LVM_USE_COMPILER		1
+#endif /* LVM_USE_COMPILER */
+
+/* The maximum number of instructions in a compiled predicate. Larger
+   predicates are interpreted. */
+#ifndef LVM_MAX_INSTRUCTIONS
+#define LVM_MAX_INSTRUCTIONS		16
+#endif /* LVM_MAX_INSTRUCTIONS */
+
 
 #endif /* !DB_OPTIONS_H */
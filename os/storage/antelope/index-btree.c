@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The tree is stored as fixed-size nodes in a single file. The
+ *     leaves hold (key, tuple id) pairs in sorted order and are chained
+ *     from left to right, so a range query descends the tree once and
+ *     then walks along the leaves. Duplicate keys are allowed.
+ *
+ *     Nodes are accessed through a small write-back cache, which keeps
+ *     the upper levels of the tree in RAM and lets consecutive
+ *     insertions into the same leaf share one flash write. A full leaf
+ *     at the right edge of the tree is split by moving only the new
+ *     entry into a new leaf, so keys that arrive in increasing order,
+ *     such as timestamps, fill the leaves completely. Together, this
+ *     turns the loading of an index for an existing relation of
+ *     sorted rows into a bottom-up bulk load that writes every node
+ *     once. Deletions remove entries from the leaves without merging
+ *     nodes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ipv6/uip-debug.h"
+
+#define BTREE_ORDER		DB_BTREE_ORDER
+#define BTREE_MAX_HEIGHT	8
+
+/* The last pointer of a leaf links to the next leaf. */
+#define NEXT_LEAF(node)		((node)->ptrs[BTREE_ORDER])
+
+typedef int32_t btree_key_t;
+typedef uint16_t btree_node_id_t;
+
+/*
+ * A leaf stores count keys with their tuple IDs in ptrs. An inner
+ * node stores count separator keys and count + 1 child node IDs; the
+ * subtree at ptrs[i] holds keys between keys[i - 1] and keys[i].
+ */
+struct btree_node {
+  uint8_t is_leaf;
+  uint8_t count;
+  uint16_t unused;
+  btree_key_t keys[BTREE_ORDER];
+  uint32_t ptrs[BTREE_ORDER + 1];
+};
+typedef struct btree_node btree_node_t;
+
+/* The header occupies the slot of node 0, which is never allocated. */
+struct btree_header {
+  btree_node_id_t root;
+  btree_node_id_t node_count;
+  uint8_t height;
+};
+
+struct btree {
+  db_storage_id_t storage;
+  struct btree_header header;
+  uint8_t header_dirty;
+  /* The position of the ongoing range iteration. */
+  index_iterator_t *iterator;
+  btree_node_id_t leaf;
+  uint8_t slot;
+};
+typedef struct btree btree_t;
+
+struct node_cache {
+  btree_t *tree;
+  btree_node_id_t id;
+  uint8_t dirty;
+  uint16_t last_use;
+  btree_node_t node;
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(btrees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+static db_result_t flush(index_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_COMPLETE | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next,
+  flush
+};
+
+/* Clamp the bounds of open ranges, which may exceed the key type. */
+static btree_key_t
+to_key(long value)
+{
+  if(value > INT32_MAX) {
+    return INT32_MAX;
+  } else if(value < INT32_MIN) {
+    return INT32_MIN;
+  }
+  return (btree_key_t)value;
+}
+
+static int
+node_write(struct node_cache *entry)
+{
+  if(entry->dirty) {
+    if(DB_ERROR(storage_write(entry->tree->storage, &entry->node,
+                              (unsigned long)entry->id * sizeof(btree_node_t),
+                              sizeof(btree_node_t)))) {
+      PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)entry->id);
+      return 0;
+    }
+    entry->dirty = 0;
+  }
+  return 1;
+}
+
+static struct node_cache *
+cache_get_free(void)
+{
+  struct node_cache *entry;
+  struct node_cache *victim;
+
+  victim = NULL;
+  for(entry = node_cache; entry < &node_cache[DB_BTREE_CACHE_LIMIT]; entry++) {
+    if(entry->tree == NULL) {
+      return entry;
+    }
+    if(victim == NULL ||
+       (uint16_t)(cache_clock - entry->last_use) >
+       (uint16_t)(cache_clock - victim->last_use)) {
+      victim = entry;
+    }
+  }
+
+  /* Evict the least recently used node. */
+  if(!node_write(victim)) {
+    return NULL;
+  }
+  victim->tree = NULL;
+  return victim;
+}
+
+static struct node_cache *
+node_get(btree_t *tree, btree_node_id_t id)
+{
+  struct node_cache *entry;
+
+  for(entry = node_cache; entry < &node_cache[DB_BTREE_CACHE_LIMIT]; entry++) {
+    if(entry->tree == tree && entry->id == id) {
+      entry->last_use = ++cache_clock;
+      return entry;
+    }
+  }
+
+  entry = cache_get_free();
+  if(entry == NULL) {
+    return NULL;
+  }
+
+  if(DB_ERROR(storage_read(tree->storage, &entry->node,
+                           (unsigned long)id * sizeof(btree_node_t),
+                           sizeof(btree_node_t)))) {
+    PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)id);
+    return NULL;
+  }
+
+  entry->tree = tree;
+  entry->id = id;
+  entry->dirty = 0;
+  entry->last_use = ++cache_clock;
+  return entry;
+}
+
+static struct node_cache *
+node_new(btree_t *tree, uint8_t is_leaf)
+{
+  struct node_cache *entry;
+
+  entry = cache_get_free();
+  if(entry == NULL) {
+    return NULL;
+  }
+
+  memset(&entry->node, 0, sizeof(entry->node));
+  entry->node.is_leaf = is_leaf;
+  entry->tree = tree;
+  entry->id = ++tree->header.node_count;
+  entry->dirty = 1;
+  entry->last_use = ++cache_clock;
+  tree->header_dirty = 1;
+  return entry;
+}
+
+static int
+tree_flush(btree_t *tree)
+{
+  struct node_cache *entry;
+
+  for(entry = node_cache; entry < &node_cache[DB_BTREE_CACHE_LIMIT]; entry++) {
+    if(entry->tree == tree && !node_write(entry)) {
+      return 0;
+    }
+  }
+
+  if(tree->header_dirty) {
+    if(DB_ERROR(storage_write(tree->storage, &tree->header, 0,
+                              sizeof(tree->header)))) {
+      return 0;
+    }
+    tree->header_dirty = 0;
+  }
+  return 1;
+}
+
+/* Find the number of keys in a node that are smaller than the given
+   key or, if upper is set, not larger than it. */
+static int
+node_search(btree_node_t *node, btree_key_t key, int upper)
+{
+  int low;
+  int high;
+  int mid;
+
+  low = 0;
+  high = node->count;
+  while(low < high) {
+    mid = (low + high) / 2;
+    if(node->keys[mid] < key || (upper && node->keys[mid] == key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/*
+ * Descend from the root to a leaf, recording the path and the position
+ * taken in each node. A lower bound search reaches the leftmost leaf
+ * that may hold the key, whereas an upper bound search reaches the
+ * leaf into which the key would be inserted after its duplicates.
+ */
+static int
+tree_descend(btree_t *tree, btree_key_t key, int upper,
+             btree_node_id_t *path, uint8_t *slots)
+{
+  struct node_cache *entry;
+  btree_node_id_t id;
+  int level;
+
+  id = tree->header.root;
+  for(level = 0; level < tree->header.height; level++) {
+    entry = node_get(tree, id);
+    if(entry == NULL) {
+      return 0;
+    }
+    path[level] = id;
+    slots[level] = node_search(&entry->node, key, upper);
+    if(entry->node.is_leaf) {
+      return level == tree->header.height - 1;
+    }
+    id = entry->node.ptrs[slots[level]];
+  }
+  return 0;
+}
+
+static int
+tree_insert(btree_t *tree, btree_key_t key, tuple_id_t value)
+{
+  btree_node_id_t path[BTREE_MAX_HEIGHT];
+  uint8_t slots[BTREE_MAX_HEIGHT];
+  btree_key_t keys[BTREE_ORDER + 1];
+  uint32_t ptrs[BTREE_ORDER + 2];
+  struct node_cache *entry;
+  struct node_cache *right;
+  btree_node_t old;
+  btree_key_t separator;
+  uint32_t ptr;
+  int append;
+  int level;
+  int split;
+  int pos;
+
+  /* Reserve room for a split of every node on the path and a new root,
+     so that a split never fails halfway up the tree. */
+  if(tree->header.height >= BTREE_MAX_HEIGHT ||
+     tree->header.node_count + tree->header.height + 1 > DB_BTREE_NODE_LIMIT) {
+    PRINTF("DB: The B+-tree is full\n");
+    return 0;
+  }
+
+  if(!tree_descend(tree, key, 1, path, slots)) {
+    return 0;
+  }
+
+  /* The key goes to the end of the rightmost leaf, as is usual for
+     increasing keys, if no node on the path has a successor. */
+  append = 1;
+  for(level = 0; level < tree->header.height; level++) {
+    entry = node_get(tree, path[level]);
+    if(entry == NULL) {
+      return 0;
+    }
+    if(slots[level] != entry->node.count) {
+      append = 0;
+      break;
+    }
+  }
+
+  ptr = value;
+  for(level = tree->header.height - 1; level >= 0; level--) {
+    entry = node_get(tree, path[level]);
+    if(entry == NULL) {
+      return 0;
+    }
+    pos = slots[level];
+
+    if(entry->node.count < BTREE_ORDER) {
+      /* The entry fits into the node. */
+      memmove(&entry->node.keys[pos + 1], &entry->node.keys[pos],
+              (entry->node.count - pos) * sizeof(btree_key_t));
+      if(entry->node.is_leaf) {
+        memmove(&entry->node.ptrs[pos + 1], &entry->node.ptrs[pos],
+                (entry->node.count - pos) * sizeof(uint32_t));
+        entry->node.ptrs[pos] = ptr;
+      } else {
+        memmove(&entry->node.ptrs[pos + 2], &entry->node.ptrs[pos + 1],
+                (entry->node.count - pos) * sizeof(uint32_t));
+        entry->node.ptrs[pos + 1] = ptr;
+      }
+      entry->node.keys[pos] = key;
+      entry->node.count++;
+      entry->dirty = 1;
+      return 1;
+    }
+
+    /* Merge the new entry with the full node before splitting it. */
+    old = entry->node;
+    memcpy(keys, old.keys, pos * sizeof(btree_key_t));
+    keys[pos] = key;
+    memcpy(&keys[pos + 1], &old.keys[pos],
+           (BTREE_ORDER - pos) * sizeof(btree_key_t));
+    if(old.is_leaf) {
+      memcpy(ptrs, old.ptrs, pos * sizeof(uint32_t));
+      ptrs[pos] = ptr;
+      memcpy(&ptrs[pos + 1], &old.ptrs[pos],
+             (BTREE_ORDER - pos) * sizeof(uint32_t));
+    } else {
+      memcpy(ptrs, old.ptrs, (pos + 1) * sizeof(uint32_t));
+      ptrs[pos + 1] = ptr;
+      memcpy(&ptrs[pos + 2], &old.ptrs[pos + 1],
+             (BTREE_ORDER - pos) * sizeof(uint32_t));
+    }
+
+    split = append ? BTREE_ORDER : (BTREE_ORDER + 1) / 2;
+    separator = keys[split];
+
+    right = node_new(tree, old.is_leaf);
+    if(right == NULL) {
+      return 0;
+    }
+    if(old.is_leaf) {
+      right->node.count = BTREE_ORDER + 1 - split;
+      memcpy(right->node.keys, &keys[split],
+             right->node.count * sizeof(btree_key_t));
+      memcpy(right->node.ptrs, &ptrs[split],
+             right->node.count * sizeof(uint32_t));
+      NEXT_LEAF(&right->node) = NEXT_LEAF(&old);
+      NEXT_LEAF(&old) = right->id;
+    } else {
+      right->node.count = BTREE_ORDER - split;
+      memcpy(right->node.keys, &keys[split + 1],
+             right->node.count * sizeof(btree_key_t));
+      memcpy(right->node.ptrs, &ptrs[split + 1],
+             (right->node.count + 1) * sizeof(uint32_t));
+    }
+    ptr = right->id;
+
+    old.count = split;
+    memcpy(old.keys, keys, split * sizeof(btree_key_t));
+    memcpy(old.ptrs, ptrs,
+           (old.is_leaf ? split : split + 1) * sizeof(uint32_t));
+
+    /* The new node may have evicted the old one from the cache. */
+    entry = node_get(tree, path[level]);
+    if(entry == NULL) {
+      return 0;
+    }
+    entry->node = old;
+    entry->dirty = 1;
+
+    /* Insert the separator into the parent node. */
+    key = separator;
+  }
+
+  /* The root was split, so the tree grows by one level. */
+  entry = node_new(tree, 0);
+  if(entry == NULL) {
+    return 0;
+  }
+  entry->node.count = 1;
+  entry->node.keys[0] = key;
+  entry->node.ptrs[0] = path[0];
+  entry->node.ptrs[1] = ptr;
+  tree->header.root = entry->id;
+  tree->header.height++;
+
+  PRINTF("DB: The B+-tree has grown to height %u\n",
+         (unsigned)tree->header.height);
+
+  return 1;
+}
+
+static int
+tree_delete(btree_t *tree, btree_key_t key)
+{
+  btree_node_id_t path[BTREE_MAX_HEIGHT];
+  uint8_t slots[BTREE_MAX_HEIGHT];
+  struct node_cache *entry;
+  btree_node_id_t id;
+  int i;
+  int j;
+
+  if(!tree_descend(tree, key, 0, path, slots)) {
+    return 0;
+  }
+
+  /* Remove all entries with the key, which may span several leaves. */
+  for(id = path[tree->header.height - 1]; id != 0;) {
+    entry = node_get(tree, id);
+    if(entry == NULL) {
+      return 0;
+    }
+    for(i = j = 0; i < entry->node.count; i++) {
+      if(entry->node.keys[i] != key) {
+        entry->node.keys[j] = entry->node.keys[i];
+        entry->node.ptrs[j] = entry->node.ptrs[i];
+        j++;
+      }
+    }
+    if(j < entry->node.count) {
+      entry->node.count = j;
+      entry->dirty = 1;
+    }
+    if(j > 0 && entry->node.keys[j - 1] > key) {
+      /* The remaining leaves hold larger keys only. */
+      break;
+    }
+    id = NEXT_LEAF(&entry->node);
+  }
+  return 1;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+  struct node_cache *entry;
+
+  filename = storage_generate_file("btree",
+                                   (unsigned long)(DB_BTREE_NODE_LIMIT + 1) *
+                                   sizeof(btree_node_t));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    return DB_ALLOCATION_ERROR;
+  }
+
+  memset(tree, 0, sizeof(*tree));
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    goto error;
+  }
+
+  /* Start with an empty leaf as the root. */
+  entry = node_new(tree, 1);
+  if(entry == NULL) {
+    goto error;
+  }
+  tree->header.root = entry->id;
+  tree->header.height = 1;
+
+  if(!tree_flush(tree)) {
+    goto error;
+  }
+
+  PRINTF("DB: Created a B+-tree index in %s\n", index->descriptor_file);
+  return DB_OK;
+
+error:
+  release(index);
+  cfs_remove(index->descriptor_file);
+  index->descriptor_file[0] = '\0';
+  return DB_STORAGE_ERROR;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  if(index->opaque_data != NULL) {
+    release(index);
+  }
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  btree_t *tree;
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  memset(tree, 0, sizeof(*tree));
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     DB_ERROR(storage_read(tree->storage, &tree->header, 0,
+                           sizeof(tree->header))) ||
+     tree->header.root == 0) {
+    release(index);
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Loaded a B+-tree index of height %u and %u nodes from %s\n",
+         (unsigned)tree->header.height, (unsigned)tree->header.node_count,
+         index->descriptor_file);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+  struct node_cache *entry;
+  db_result_t result;
+
+  tree = index->opaque_data;
+  result = DB_OK;
+
+  if(tree->storage >= 0) {
+    if(!tree_flush(tree)) {
+      result = DB_STORAGE_ERROR;
+    }
+    storage_close(tree->storage);
+  }
+
+  for(entry = node_cache; entry < &node_cache[DB_BTREE_CACHE_LIMIT]; entry++) {
+    if(entry->tree == tree) {
+      entry->tree = NULL;
+    }
+  }
+
+  memb_free(&btrees, tree);
+  index->opaque_data = NULL;
+  return result;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+  tree->iterator = NULL;
+
+  if(!tree_insert(tree, to_key(db_value_to_long(key)), value)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           db_value_to_long(key));
+    return DB_INDEX_ERROR;
+  }
+
+  /* While an index is loaded for an existing relation, the modified
+     nodes stay in the cache until they are evicted, or flushed at the
+     end of the load. */
+  if(!(index->flags & INDEX_LOAD_NEEDED) && !tree_flush(tree)) {
+    return DB_STORAGE_ERROR;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+  tree->iterator = NULL;
+
+  if(!tree_delete(tree, to_key(db_value_to_long(value))) ||
+     !tree_flush(tree)) {
+    return DB_INDEX_ERROR;
+  }
+
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  btree_node_id_t path[BTREE_MAX_HEIGHT];
+  uint8_t slots[BTREE_MAX_HEIGHT];
+  struct node_cache *entry;
+  btree_t *tree;
+  btree_key_t min;
+  btree_key_t max;
+  tuple_id_t skip;
+
+  tree = iterator->index->opaque_data;
+  min = to_key(db_value_to_long(&iterator->min_value));
+  max = to_key(db_value_to_long(&iterator->max_value));
+  skip = 0;
+
+  if(tree->iterator != iterator || iterator->next_item_no == 0) {
+    /* Position the iteration at the first key within the range. If
+       the tree changed during an iteration, skip the items that have
+       already been returned. */
+    if(!tree_flush(tree) || !tree_descend(tree, min, 0, path, slots)) {
+      return INVALID_TUPLE;
+    }
+    tree->iterator = iterator;
+    tree->leaf = path[tree->header.height - 1];
+    tree->slot = slots[tree->header.height - 1];
+    skip = iterator->next_item_no;
+  }
+
+  while(tree->leaf != 0) {
+    entry = node_get(tree, tree->leaf);
+    if(entry == NULL) {
+      tree->leaf = 0;
+      return INVALID_TUPLE;
+    }
+
+    for(; tree->slot < entry->node.count; tree->slot++) {
+      if(entry->node.keys[tree->slot] < min) {
+        continue;
+      }
+      if(entry->node.keys[tree->slot] > max) {
+        tree->leaf = 0;
+        break;
+      }
+      if(skip > 0) {
+        skip--;
+        continue;
+      }
+      iterator->next_item_no++;
+      return (tuple_id_t)entry->node.ptrs[tree->slot++];
+    }
+
+    if(tree->leaf != 0) {
+      tree->leaf = NEXT_LEAF(&entry->node);
+      tree->slot = 0;
+    }
+  }
+
+  /* An empty range is a valid result of a successful search, which
+     the caller must not take for an index failure. */
+  if(iterator->next_item_no == 0) {
+    iterator->next_item_no = 1;
+  }
+
+  return INVALID_TUPLE;
+}
+
+static db_result_t
+flush(index_t *index)
+{
+  return tree_flush(index->opaque_data) ? DB_OK : DB_STORAGE_ERROR;
+}
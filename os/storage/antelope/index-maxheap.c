@@ -151,7 +151,8 @@ index_api_t index_maxheap = {
   release,
   insert,
   delete,
-  get_next
+  get_next,
+  NULL
 };
 
 static struct bucket_cache *
@@ -49,7 +49,7 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_maxheap, &index_btree};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -388,7 +388,7 @@ PROCESS_THREAD(db_indexer, ev, data)
       continue;
     }
 
-    for(;; row++) {
+    for(row = 0;; row++) {
       PROCESS_PAUSE();
 
       result = db_process(&handle);
@@ -418,6 +418,11 @@ PROCESS_THREAD(db_indexer, ev, data)
     PRINTF("DB: Loaded %lu rows into the index\n",
 	(unsigned long)handle.current_row);
 
+    /* The index may have buffered the insertions of the load. */
+    if(index->api->flush != NULL && DB_ERROR(index->api->flush(index))) {
+      index->flags |= INDEX_LOAD_ERROR;
+    }
+
 cleanup:
     if(index->flags & INDEX_LOAD_ERROR) {
       PRINTF("DB: Failed to load the index for %s.%s\n",
@@ -426,6 +431,12 @@ cleanup:
     index->flags &= ~INDEX_LOAD_NEEDED;
     index->flags |= INDEX_READY;
     db_free(&handle);
+
+    /* Requests that arrived during the loading may have been consumed
+       by the pauses above. */
+    if(get_next_index_to_load() != NULL) {
+      process_post(&db_indexer, load_request_event, NULL);
+    }
   }
 
 
@@ -87,6 +87,53 @@ static variable_t variables[LVM_MAX_VARIABLE_ID];
 /* Range derivations of variables that are used for index searches. */
 static derivation_t derivations[LVM_MAX_VARIABLE_ID];
 
+#if LVM_USE_COMPILER
+/*
+ * A predicate may be compiled once per query instead of being
+ * interpreted for each tuple. A conjunction of comparisons between
+ * variables and constants is reduced to one range per variable, which
+ * is checked directly. Other predicates are flattened into a linear
+ * program of three-address instructions over a register file, in
+ * which constants are preloaded and each variable is loaded once.
+ */
+#define LVM_LOAD		0x01
+#define REGISTER_COUNT		(2 * LVM_MAX_INSTRUCTIONS)
+#define NO_REGISTER		0xff
+
+enum program_type {
+  PROGRAM_NONE,
+  PROGRAM_RANGE,
+  PROGRAM_REGISTER
+};
+
+struct instruction {
+  uint8_t op;
+  uint8_t dst;
+  uint8_t src[2];
+};
+
+struct range {
+  long min;
+  long max;
+  variable_id_t id;
+};
+
+struct program {
+  lvm_instance_t *owner;
+  enum program_type type;
+  uint8_t length;
+  uint8_t registers_used;
+  uint8_t result;
+  uint8_t empty;
+  uint8_t variable_registers[LVM_MAX_VARIABLE_ID];
+  struct instruction code[LVM_MAX_INSTRUCTIONS];
+  struct range ranges[LVM_MAX_VARIABLE_ID];
+};
+
+static struct program program;
+static long registers[REGISTER_COUNT];
+#endif /* LVM_USE_COMPILER */
+
 #if DEBUG
 static void
 print_derivations(derivation_t *d)
@@ -309,6 +356,9 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
+#if LVM_USE_COMPILER
+  program.owner = NULL;
+#endif
 }
 
 lvm_ip_t
@@ -370,6 +420,350 @@ lvm_set_end(lvm_instance_t *p, lvm_ip_t end)
   return old_end;
 }
 
+#if LVM_USE_COMPILER
+static int
+compile_range(lvm_instance_t *p)
+{
+  operator_t op;
+  operand_t operand[2];
+  variable_id_t id;
+  struct range *range;
+  long value;
+  long min;
+  long max;
+  int i;
+
+  if(get_type(p) != LVM_CMP_OP) {
+    return 0;
+  }
+
+  op = *get_operator(p);
+  if(op == LVM_AND) {
+    return compile_range(p) && compile_range(p);
+  } else if(IS_CONNECTIVE(op)) {
+    return 0;
+  }
+
+  for(i = 0; i < 2; i++) {
+    if(get_type(p) != LVM_OPERAND) {
+      return 0;
+    }
+    get_operand(p, &operand[i]);
+  }
+
+  if(operand[0].type == LVM_VARIABLE && operand[1].type == LVM_LONG) {
+    id = operand[0].value.id;
+    value = operand[1].value.l;
+  } else if(operand[0].type == LVM_LONG && operand[1].type == LVM_VARIABLE) {
+    id = operand[1].value.id;
+    value = operand[0].value.l;
+    /* Mirror the comparison, so that the variable is on the left. */
+    switch(op) {
+    case LVM_GE:
+      op = LVM_LE;
+      break;
+    case LVM_GEQ:
+      op = LVM_LEQ;
+      break;
+    case LVM_LE:
+      op = LVM_GE;
+      break;
+    case LVM_LEQ:
+      op = LVM_GEQ;
+      break;
+    default:
+      break;
+    }
+  } else {
+    return 0;
+  }
+
+  if(id >= LVM_MAX_VARIABLE_ID) {
+    return 0;
+  }
+
+  min = LONG_MIN;
+  max = LONG_MAX;
+  switch(op) {
+  case LVM_EQ:
+    min = max = value;
+    break;
+  case LVM_GE:
+    if(value == LONG_MAX) {
+      program.empty = 1;
+    } else {
+      min = value + 1;
+    }
+    break;
+  case LVM_GEQ:
+    min = value;
+    break;
+  case LVM_LE:
+    if(value == LONG_MIN) {
+      program.empty = 1;
+    } else {
+      max = value - 1;
+    }
+    break;
+  case LVM_LEQ:
+    max = value;
+    break;
+  default:
+    return 0;
+  }
+
+  for(range = program.ranges; range < &program.ranges[program.length]; range++) {
+    if(range->id == id) {
+      break;
+    }
+  }
+  if(range == &program.ranges[program.length]) {
+    program.length++;
+    range->id = id;
+    range->min = LONG_MIN;
+    range->max = LONG_MAX;
+  }
+
+  if(min > range->min) {
+    range->min = min;
+  }
+  if(max < range->max) {
+    range->max = max;
+  }
+
+  return 1;
+}
+
+static int
+emit(uint8_t op, int src1, int src2)
+{
+  struct instruction *instruction;
+
+  if(src1 < 0 || src2 < 0 || program.length == LVM_MAX_INSTRUCTIONS ||
+     program.registers_used == REGISTER_COUNT) {
+    return -1;
+  }
+
+  instruction = &program.code[program.length++];
+  instruction->op = op;
+  instruction->dst = program.registers_used++;
+  instruction->src[0] = src1;
+  instruction->src[1] = src2;
+
+  return instruction->dst;
+}
+
+static int compile_expr(lvm_instance_t *p, operator_t op);
+
+static int
+compile_operand(lvm_instance_t *p)
+{
+  operand_t operand;
+  int reg;
+
+  switch(get_type(p)) {
+  case LVM_ARITH_OP:
+    return compile_expr(p, *get_operator(p));
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    if(operand.type == LVM_VARIABLE) {
+      if(operand.value.id >= LVM_MAX_VARIABLE_ID) {
+        return -1;
+      }
+      reg = program.variable_registers[operand.value.id];
+      if(reg == NO_REGISTER) {
+        reg = emit(LVM_LOAD, operand.value.id, 0);
+        program.variable_registers[operand.value.id] = reg;
+      }
+      return reg;
+    }
+
+    if(program.registers_used == REGISTER_COUNT) {
+      return -1;
+    }
+    reg = program.registers_used++;
+    registers[reg] = operand_to_long(&operand);
+    return reg;
+  default:
+    return -1;
+  }
+}
+
+static int
+compile_expr(lvm_instance_t *p, operator_t op)
+{
+  int left;
+  int right;
+
+  if(op != LVM_ADD && op != LVM_SUB && op != LVM_MUL && op != LVM_DIV) {
+    return -1;
+  }
+
+  left = compile_operand(p);
+  if(left < 0) {
+    return -1;
+  }
+  right = compile_operand(p);
+  return emit(op, left, right);
+}
+
+static int
+compile_logic(lvm_instance_t *p, operator_t op)
+{
+  int reg[2];
+  int i;
+
+  if(IS_CONNECTIVE(op)) {
+    if(op != LVM_AND && op != LVM_OR && op != LVM_NOT) {
+      return -1;
+    }
+    for(i = 0; i < (op == LVM_NOT ? 1 : 2); i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+        return -1;
+      }
+      reg[i] = compile_logic(p, *get_operator(p));
+      if(reg[i] < 0) {
+        return -1;
+      }
+    }
+    return emit(op, reg[0], op == LVM_NOT ? reg[0] : reg[1]);
+  }
+
+  if(op < LVM_EQ || op > LVM_LEQ) {
+    return -1;
+  }
+
+  reg[0] = compile_operand(p);
+  if(reg[0] < 0) {
+    return -1;
+  }
+  reg[1] = compile_operand(p);
+  return emit(op, reg[0], reg[1]);
+}
+
+static lvm_status_t
+execute_program(void)
+{
+  struct range *range;
+  struct instruction *instruction;
+  long value;
+  long a;
+  long b;
+
+  if(program.type == PROGRAM_RANGE) {
+    if(program.empty) {
+      return LVM_FALSE;
+    }
+    for(range = program.ranges; range < &program.ranges[program.length]; range++) {
+      value = variables[range->id].value.l;
+      if(value < range->min || value > range->max) {
+        return LVM_FALSE;
+      }
+    }
+    return LVM_TRUE;
+  }
+
+  for(instruction = program.code;
+      instruction < &program.code[program.length];
+      instruction++) {
+    if(instruction->op == LVM_LOAD) {
+      registers[instruction->dst] = variables[instruction->src[0]].value.l;
+      continue;
+    }
+
+    a = registers[instruction->src[0]];
+    b = registers[instruction->src[1]];
+    switch(instruction->op) {
+    case LVM_ADD:
+      value = a + b;
+      break;
+    case LVM_SUB:
+      value = a - b;
+      break;
+    case LVM_MUL:
+      value = a * b;
+      break;
+    case LVM_DIV:
+      if(b == 0) {
+        return LVM_MATH_ERROR;
+      }
+      value = a / b;
+      break;
+    case LVM_EQ:
+      value = a == b;
+      break;
+    case LVM_NEQ:
+      value = a != b;
+      break;
+    case LVM_GE:
+      value = a > b;
+      break;
+    case LVM_GEQ:
+      value = a >= b;
+      break;
+    case LVM_LE:
+      value = a < b;
+      break;
+    case LVM_LEQ:
+      value = a <= b;
+      break;
+    case LVM_AND:
+      value = a && b;
+      break;
+    case LVM_OR:
+      value = a || b;
+      break;
+    case LVM_NOT:
+      value = !a;
+      break;
+    default:
+      return LVM_EXECUTION_ERROR;
+    }
+    registers[instruction->dst] = value;
+  }
+
+  return registers[program.result] ? LVM_TRUE : LVM_FALSE;
+}
+#endif /* LVM_USE_COMPILER */
+
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+#if LVM_USE_COMPILER
+  int result;
+
+  memset(&program, 0, sizeof(program));
+
+  p->ip = 0;
+  if(compile_range(p)) {
+    PRINTF("Compiled the predicate into %d range checks\n", program.length);
+    program.type = PROGRAM_RANGE;
+    program.owner = p;
+    return LVM_TRUE;
+  }
+
+  memset(&program, 0, sizeof(program));
+  memset(program.variable_registers, NO_REGISTER,
+         sizeof(program.variable_registers));
+
+  p->ip = 0;
+  if(get_type(p) == LVM_CMP_OP) {
+    result = compile_logic(p, *get_operator(p));
+    if(result >= 0) {
+      PRINTF("Compiled the predicate into %d instructions\n", program.length);
+      program.type = PROGRAM_REGISTER;
+      program.result = result;
+      program.owner = p;
+      return LVM_TRUE;
+    }
+  }
+
+  PRINTF("The predicate is interpreted\n");
+  memset(&program, 0, sizeof(program));
+#endif /* LVM_USE_COMPILER */
+  return LVM_EXECUTION_ERROR;
+}
+
 lvm_status_t
 lvm_execute(lvm_instance_t *p)
 {
@@ -377,6 +771,12 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+#if LVM_USE_COMPILER
+  if(program.owner == p) {
+    return execute_program();
+  }
+#endif
+
   p->ip = 0;
   status = LVM_EXECUTION_ERROR;
   type = get_type(p);
@@ -516,6 +916,29 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return LVM_TRUE;
 }
 
+variable_id_t
+lvm_get_variable_id(char *name)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id == LVM_MAX_VARIABLE_ID || variables[id].name[0] == '\0') {
+    return LVM_MAX_VARIABLE_ID;
+  }
+  return id;
+}
+
+lvm_status_t
+lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value)
+{
+  if(id >= LVM_MAX_VARIABLE_ID) {
+    return LVM_INVALID_IDENTIFIER;
+  }
+
+  variables[id].value = value;
+  return LVM_TRUE;
+}
+
 lvm_status_t
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
@@ -588,14 +1011,10 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
   int i;
 
   for(i = 0; i < LVM_MAX_VARIABLE_ID; i++) {
-    if(!d1[i].derived && !d2[i].derived) {
+    if(!d1[i].derived || !d2[i].derived) {
+      /* A variable that is unconstrained on one side of the
+         disjunction is unconstrained in the union. */
       continue;
-    } else if(d1[i].derived && !d2[i].derived) {
-      result[i].min.l = d1[i].min.l;
-      result[i].max.l = d1[i].max.l;
-    } else if(!d1[i].derived && d2[i].derived) {
-      result[i].min.l = d2[i].min.l;
-      result[i].max.l = d2[i].max.l;
     } else {
       /* Both derivations have been made; create a
          union of the ranges. */
@@ -64,6 +64,7 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+  variable_id_t variable_id;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
@@ -79,6 +80,42 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/*
+ * The join strategies. For each row of the outer relation, the matching
+ * rows of the inner relation are found through an index on the inner
+ * join attribute, through a hash table built over the inner relation,
+ * or by scanning the inner relation.
+ */
+typedef enum {
+  JOIN_INDEX,
+  JOIN_HASH,
+  JOIN_NESTED_LOOP
+} join_strategy_t;
+
+struct join_entry {
+  struct join_entry *next;
+  long key;
+  tuple_id_t tuple_id;
+};
+
+static struct {
+  join_strategy_t strategy;
+  relation_t *outer_rel;
+  relation_t *inner_rel;
+  attribute_t *outer_attr;
+  attribute_t *inner_attr;
+  unsigned char *outer_row;
+  unsigned char *inner_row;
+  long key;
+  tuple_id_t inner_tuple_id;
+  struct join_entry *entry;
+} join;
+
+#if DB_JOIN_HASH_LIMIT > 0
+MEMB(join_entries_memb, struct join_entry, DB_JOIN_HASH_LIMIT);
+static struct join_entry *join_buckets[DB_JOIN_HASH_BUCKETS];
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -619,6 +656,8 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
     }
     attr_map_ptr->from_offset = offset;
     attr_map_ptr->to_offset = size_sum;
+    /* Resolve the predicate variable once instead of for each tuple. */
+    attr_map_ptr->variable_id = lvm_get_variable_id(to_attr->name);
 
     size_sum += to_attr->element_size;
     attr_map_ptr++;
@@ -655,7 +694,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 
       if(range <= min_range) {
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -701,6 +740,7 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
     }
+    lvm_compile(adt->lvm_instance);
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
@@ -791,13 +831,13 @@ relation_process_select(void *handle_ptr)
     /* Update the internal state of the PLE. */
     if(result_attr->domain == DOMAIN_INT) {
       operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      lvm_set_variable_value_by_id(attr_map_ptr->variable_id, operand_value);
     } else if(result_attr->domain == DOMAIN_LONG) {
       operand_value.l = (uint32_t)from_ptr[0] << 24 |
                         (uint32_t)from_ptr[1] << 16 |
                         (uint32_t)from_ptr[2] << 8 |
                         from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      lvm_set_variable_value_by_id(attr_map_ptr->variable_id, operand_value);
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -959,99 +999,316 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
+static db_result_t
+join_get_key(relation_t *rel, attribute_t *attr, unsigned char *from, long *key)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(relation_get_value(rel, attr, from, &value))) {
+    PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
+	attr->name);
+    return DB_IMPLEMENTATION_ERROR;
+  }
+  *key = db_value_to_long(&value);
+  return DB_OK;
+}
+
+#if DB_JOIN_HASH_LIMIT > 0
+static db_result_t
+join_build_hash_table(void)
+{
+  struct join_entry *entry;
+  struct join_entry **bucket;
+  tuple_id_t tuple_id;
+  db_result_t result;
+
+  memb_init(&join_entries_memb);
+  memset(join_buckets, 0, sizeof(join_buckets));
+
+  /* Insert the tuples in reverse order, so that each chain lists
+     matching tuples in the order of the relation. */
+  tuple_id = relation_cardinality(join.inner_rel);
+  if(tuple_id == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+  while(tuple_id-- > 0) {
+    result = storage_get_row(join.inner_rel, &tuple_id, join.inner_row);
+    if(result != DB_OK) {
+      return DB_ERROR(result) ? result : DB_IMPLEMENTATION_ERROR;
+    }
+
+    entry = memb_alloc(&join_entries_memb);
+    if(entry == NULL) {
+      return DB_ALLOCATION_ERROR;
+    }
+    if(DB_ERROR(join_get_key(join.inner_rel, join.inner_attr,
+                             join.inner_row, &entry->key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+    entry->tuple_id = tuple_id;
+
+    bucket = &join_buckets[(unsigned long)entry->key % DB_JOIN_HASH_BUCKETS];
+    entry->next = *bucket;
+    *bucket = entry;
+  }
+
+  PRINTF("DB: Built a hash table of %lu tuples of relation %s\n",
+         (unsigned long)relation_cardinality(join.inner_rel),
+         join.inner_rel->name);
+
+  return DB_OK;
+}
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
+
+/* Start the search for inner tuples that match the current outer tuple. */
+static db_result_t
+join_start_inner(db_handle_t *handle)
+{
+  attribute_value_t value;
+
+  switch(join.strategy) {
+  case JOIN_INDEX:
+    value.domain = DOMAIN_LONG;
+    VALUE_LONG(&value) = join.key;
+    if(DB_ERROR(index_get_iterator(&handle->index_iterator,
+                                   join.inner_attr->index,
+                                   &value, &value))) {
+      PRINTF("DB: Failed to get an index iterator\n");
+      return DB_INDEX_ERROR;
+    }
+    break;
+#if DB_JOIN_HASH_LIMIT > 0
+  case JOIN_HASH:
+    join.entry = join_buckets[(unsigned long)join.key % DB_JOIN_HASH_BUCKETS];
+    break;
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
+  default:
+    join.inner_tuple_id = 0;
+    break;
+  }
+
+  return DB_OK;
+}
+
+/* Read the next inner tuple that matches the current outer tuple. */
+static db_result_t
+join_next_inner(db_handle_t *handle)
+{
+  tuple_id_t tuple_id;
+  db_result_t result;
+  long key;
+
+  for(;;) {
+    switch(join.strategy) {
+    case JOIN_INDEX:
+      tuple_id = index_get_next(&handle->index_iterator);
+      if(tuple_id == INVALID_TUPLE) {
+        return DB_FINISHED;
+      }
+      break;
+#if DB_JOIN_HASH_LIMIT > 0
+    case JOIN_HASH:
+      while(join.entry != NULL && join.entry->key != join.key) {
+        join.entry = join.entry->next;
+      }
+      if(join.entry == NULL) {
+        return DB_FINISHED;
+      }
+      tuple_id = join.entry->tuple_id;
+      join.entry = join.entry->next;
+      break;
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
+    default:
+      tuple_id = join.inner_tuple_id++;
+      break;
+    }
+
+    result = storage_get_row(join.inner_rel, &tuple_id, join.inner_row);
+    if(DB_ERROR(result)) {
+      PRINTF("DB: Failed to get a row in relation %s!\n", join.inner_rel->name);
+      return result;
+    } else if(result == DB_FINISHED) {
+      if(join.strategy == JOIN_NESTED_LOOP) {
+        return DB_FINISHED;
+      }
+      PRINTF("DB: The index refers to an invalid row: %lu\n",
+             (unsigned long)tuple_id);
+      return DB_IMPLEMENTATION_ERROR;
+    }
+
+    if(join.strategy != JOIN_NESTED_LOOP) {
+      /* The index and the hash table return matching tuples only. */
+      return DB_OK;
+    }
+
+    if(DB_ERROR(join_get_key(join.inner_rel, join.inner_attr,
+                             join.inner_row, &key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+    if(key == join.key) {
+      return DB_OK;
+    }
+  }
+}
+
 db_result_t
 relation_process_join(void *handle_ptr)
 {
   db_handle_t *handle;
   db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
   relation_t *join_rel;
   unsigned char *join_next_attribute_ptr;
   size_t element_size;
-  tuple_id_t right_tuple_id;
-  attribute_value_t value;
   int i;
 
   handle = (db_handle_t *)handle_ptr;
-  left_rel = handle->left_rel;
-  right_rel = handle->right_rel;
   join_rel = handle->join_rel;
 
-  if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
-    goto inner_loop;
-  }
-
-  /* Equi-join for indexed attributes only. In the outer loop, we iterate over
-     each tuple in the left relation. */
-  for(handle->tuple_id = 0;; handle->tuple_id++) {
-    result = storage_get_row(left_rel, &handle->tuple_id, left_row);
+  /* Equi-join. In the outer loop, we iterate over each tuple in the
+     outer relation. */
+  if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+    result = storage_get_row(join.outer_rel, &handle->tuple_id, join.outer_row);
     if(DB_ERROR(result)) {
-      PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
+      PRINTF("DB: Failed to get a row in relation %s!\n", join.outer_rel->name);
       return result;
     } else if(result == DB_FINISHED) {
       return DB_FINISHED;
     }
+    handle->tuple_id++;
 
-    if(DB_ERROR(relation_get_value(left_rel, handle->left_join_attr, left_row, &value))) {
-      PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
-	handle->left_join_attr->name);
+    if(DB_ERROR(join_get_key(join.outer_rel, join.outer_attr,
+                             join.outer_row, &join.key)) ||
+       DB_ERROR(join_start_inner(handle))) {
       return DB_IMPLEMENTATION_ERROR;
     }
-
-    if(DB_ERROR(index_get_iterator(&handle->index_iterator, 
-                                   handle->right_join_attr->index, 
-                                   &value, &value))) { 
-      PRINTF("DB: Failed to get an index iterator\n");
-      return DB_INDEX_ERROR;
-    }
     handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+  }
 
-    /* In the inner loop, we iterate over all rows with a matching value for the
-       join attribute. The index component provides an iterator for this purpose. */
-inner_loop:
-    for(;;) {
-      /* Get all rows matching the attribute value in the right relation. */
-      right_tuple_id = index_get_next(&handle->index_iterator);
-      if(right_tuple_id == INVALID_TUPLE) {
-        /* Exclude this row from the left relation in the result,
-           and step to the next value in the index iteration. */
-        handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
-        break;
-      }
+  /* In the inner loop, we iterate over all rows with a matching value
+     for the join attribute. */
+  result = join_next_inner(handle);
+  if(DB_ERROR(result)) {
+    return result;
+  } else if(result == DB_FINISHED) {
+    /* Step to the next tuple of the outer relation. */
+    handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+    return DB_OK;
+  }
 
-      result = storage_get_row(right_rel, &right_tuple_id, right_row);
-      if(DB_ERROR(result)) {
-        PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
-        return result;
-      } else if(result == DB_FINISHED) {
-	PRINTF("DB: The index refers to an invalid row: %lu\n",
-	       (unsigned long)right_tuple_id);
-        return DB_IMPLEMENTATION_ERROR;
-      }
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
 
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
 
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
 
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
-      }
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
 
-      handle->current_row++;
-      return DB_GOT_ROW;
+/* Estimate the number of rows read with each strategy, and pick the
+   cheapest one. An index lookup is assumed to cost one read per level
+   of a balanced search structure. */
+static db_result_t
+plan_join(db_handle_t *handle)
+{
+  relation_t *outer_rel;
+  relation_t *inner_rel;
+  attribute_t *inner_attr;
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  tuple_id_t rows;
+  unsigned long cost;
+  unsigned long best_cost;
+  unsigned long reads;
+  int i;
+
+  left_cardinality = relation_cardinality(handle->left_rel);
+  right_cardinality = relation_cardinality(handle->right_rel);
+  if(left_cardinality == INVALID_TUPLE || right_cardinality == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  /* Without an index or enough RAM, scan the right relation for each
+     tuple of the left relation. */
+  join.strategy = JOIN_NESTED_LOOP;
+  join.outer_rel = handle->left_rel;
+  join.outer_attr = handle->left_join_attr;
+  join.inner_rel = handle->right_rel;
+  join.inner_attr = handle->right_join_attr;
+  best_cost = (unsigned long)left_cardinality * right_cardinality;
+
+  /* With an index on the join attribute of the inner relation, each tuple
+     of the outer relation costs a lookup. The relations are swapped if
+     only the left one is indexed. */
+  for(i = 0; i < 2; i++) {
+    outer_rel = i == 0 ? handle->left_rel : handle->right_rel;
+    inner_rel = i == 0 ? handle->right_rel : handle->left_rel;
+    inner_attr = i == 0 ? handle->right_join_attr : handle->left_join_attr;
+    if(!index_exists(inner_attr)) {
+      continue;
+    }
+
+    for(reads = 1, rows = relation_cardinality(inner_rel); rows > 1; rows >>= 1) {
+      reads++;
+    }
+    cost = (unsigned long)relation_cardinality(outer_rel) * reads;
+    if(cost < best_cost) {
+      best_cost = cost;
+      join.strategy = JOIN_INDEX;
+      join.outer_rel = outer_rel;
+      join.outer_attr = i == 0 ? handle->left_join_attr : handle->right_join_attr;
+      join.inner_rel = inner_rel;
+      join.inner_attr = inner_attr;
     }
   }
 
+#if DB_JOIN_HASH_LIMIT > 0
+  /* A hash table over the smaller relation is built with one scan, and
+     the larger relation is then scanned once to probe it. */
+  cost = (unsigned long)left_cardinality + right_cardinality;
+  if(cost < best_cost &&
+     (left_cardinality <= DB_JOIN_HASH_LIMIT ||
+      right_cardinality <= DB_JOIN_HASH_LIMIT)) {
+    join.strategy = JOIN_HASH;
+    if(left_cardinality < right_cardinality) {
+      join.outer_rel = handle->right_rel;
+      join.outer_attr = handle->right_join_attr;
+      join.inner_rel = handle->left_rel;
+      join.inner_attr = handle->left_join_attr;
+    } else {
+      join.outer_rel = handle->left_rel;
+      join.outer_attr = handle->left_join_attr;
+      join.inner_rel = handle->right_rel;
+      join.inner_attr = handle->right_join_attr;
+    }
+  }
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
+
+  /* The rows are read into the buffers that the source map refers to. */
+  join.outer_row = join.outer_rel == handle->left_rel ? left_row : right_row;
+  join.inner_row = join.inner_rel == handle->left_rel ? left_row : right_row;
+
+  PRINTF("DB: Joining %s with %s using strategy %d, estimated cost %lu\n",
+         join.outer_rel->name, join.inner_rel->name,
+         (int)join.strategy, best_cost);
+
+#if DB_JOIN_HASH_LIMIT > 0
+  if(join.strategy == JOIN_HASH) {
+    return join_build_hash_table();
+  }
+#endif /* DB_JOIN_HASH_LIMIT > 0 */
+
   return DB_OK;
 }
 
@@ -1120,6 +1377,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1158,11 +1416,6 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
-  }
-
   /*
    * Define the resulting relation. We start from 1 when counting attributes
    * because the first attribute is only the one to join, and is not included
@@ -1189,6 +1442,12 @@ relation_join(void *query_result, void *adt_ptr)
     handle->ncolumns++;
   }
 
+  result = plan_join(handle);
+  if(DB_ERROR(result)) {
+    PRINTF("DB: Failed to plan the join\n");
+    return result;
+  }
+
   return generate_join_result(handle);
 }
 #endif /* DB_FEATURE_JOIN */
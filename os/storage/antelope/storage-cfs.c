@@ -68,6 +68,130 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+#if DB_ROW_CACHE_LIMIT > 0
+/*
+ * A block of consecutive rows of a relation, kept as stored in the
+ * tuple file, i.e., with the last byte of each row encoded. Scans and
+ * index lookups that hit the block do not access the file at all, and
+ * rows appended by storage_put_row() are written through to it.
+ */
+struct row_cache {
+  relation_t *rel;
+  size_t row_length;
+  tuple_id_t first;
+  tuple_id_t count;
+  unsigned char rows[DB_ROW_CACHE_SIZE];
+};
+
+static struct row_cache row_caches[DB_ROW_CACHE_LIMIT];
+static uint8_t next_victim;
+
+static struct row_cache *
+row_cache_find(relation_t *rel)
+{
+  struct row_cache *cache;
+
+  for(cache = row_caches; cache < &row_caches[DB_ROW_CACHE_LIMIT]; cache++) {
+    if(cache->rel == rel) {
+      if(cache->row_length != rel->row_length) {
+        cache->rel = NULL;
+        return NULL;
+      }
+      return cache;
+    }
+  }
+  return NULL;
+}
+
+static void
+row_cache_invalidate(relation_t *rel)
+{
+  struct row_cache *cache;
+
+  cache = row_cache_find(rel);
+  if(cache != NULL) {
+    cache->rel = NULL;
+  }
+}
+
+static struct row_cache *
+row_cache_fill(relation_t *rel, tuple_id_t tuple_id, tuple_id_t nrows)
+{
+  struct row_cache *cache;
+  tuple_id_t rows;
+  unsigned length;
+  unsigned total;
+  int r;
+
+  cache = row_cache_find(rel);
+  if(cache == NULL) {
+    for(cache = row_caches;
+        cache < &row_caches[DB_ROW_CACHE_LIMIT] && cache->rel != NULL;
+        cache++);
+    if(cache == &row_caches[DB_ROW_CACHE_LIMIT]) {
+      cache = &row_caches[next_victim];
+      next_victim = (next_victim + 1) % DB_ROW_CACHE_LIMIT;
+    }
+  }
+  cache->rel = NULL;
+
+  /* Align the block, so that lookups of nearby rows in any order hit. */
+  rows = DB_ROW_CACHE_SIZE / rel->row_length;
+  cache->first = tuple_id - tuple_id % rows;
+  if(nrows - cache->first < rows) {
+    rows = nrows - cache->first;
+  }
+
+  if(cfs_seek(rel->tuple_storage, cache->first * rel->row_length,
+              CFS_SEEK_SET) == (cfs_offset_t)-1) {
+    return NULL;
+  }
+
+  total = rows * rel->row_length;
+  for(length = 0; length < total; length += r) {
+    r = cfs_read(rel->tuple_storage, cache->rows + length, total - length);
+    if(r < 0) {
+      PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+      return NULL;
+    } else if(r == 0) {
+      break;
+    }
+  }
+
+  cache->rel = rel;
+  cache->row_length = rel->row_length;
+  cache->count = length / rel->row_length;
+
+  PRINTF("DB: Cached %lu rows from relation %s\n",
+         (unsigned long)cache->count, rel->name);
+
+  return cache;
+}
+
+static void
+row_cache_append(relation_t *rel, cfs_offset_t offset, storage_row_t row)
+{
+  struct row_cache *cache;
+  tuple_id_t tuple_id;
+
+  cache = row_cache_find(rel);
+  if(cache == NULL) {
+    return;
+  }
+
+  tuple_id = offset / rel->row_length;
+  if(offset % rel->row_length == 0 &&
+     tuple_id == cache->first + cache->count &&
+     (cache->count + 1) * rel->row_length <= DB_ROW_CACHE_SIZE) {
+    memcpy(cache->rows + cache->count * rel->row_length, row,
+           rel->row_length);
+    cache->count++;
+  } else if(tuple_id < cache->first + cache->count) {
+    cache->rel = NULL;
+  }
+}
+#endif /* DB_ROW_CACHE_LIMIT > 0 */
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -103,7 +227,16 @@ storage_generate_file(char *prefix, unsigned long size)
 db_result_t
 storage_load(relation_t *rel)
 {
+  if(RELATION_HAS_TUPLES(rel)) {
+    /* Another reference to the relation, such as the loading of an
+       index, keeps the tuple file open. */
+    return DB_OK;
+  }
+
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
+#if DB_ROW_CACHE_LIMIT > 0
+  row_cache_invalidate(rel);
+#endif
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
   if(rel->tuple_storage < 0) {
@@ -119,6 +252,9 @@ storage_unload(relation_t *rel)
 {
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
+#if DB_ROW_CACHE_LIMIT > 0
+    row_cache_invalidate(rel);
+#endif
 
     cfs_close(rel->tuple_storage);
     rel->tuple_storage = -1;
@@ -279,6 +415,9 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+#if DB_ROW_CACHE_LIMIT > 0
+  row_cache_invalidate(rel);
+#endif
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -405,6 +544,18 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 {
   int r;
   tuple_id_t nrows;
+#if DB_ROW_CACHE_LIMIT > 0
+  struct row_cache *cache;
+
+  cache = NULL;
+  if(rel->row_length <= DB_ROW_CACHE_SIZE) {
+    cache = row_cache_find(rel);
+    if(cache != NULL &&
+       *tuple_id >= cache->first && *tuple_id < cache->first + cache->count) {
+      goto cached;
+    }
+  }
+#endif
 
   if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
@@ -414,6 +565,25 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
     return DB_FINISHED;
   }
 
+#if DB_ROW_CACHE_LIMIT > 0
+  if(rel->row_length <= DB_ROW_CACHE_SIZE) {
+    cache = row_cache_fill(rel, *tuple_id, nrows);
+    if(cache == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+    if(*tuple_id >= cache->first + cache->count) {
+      PRINTF("DB: Incomplete record in relation %s\n", rel->name);
+      return DB_STORAGE_ERROR;
+    }
+
+cached:
+    memcpy(row, cache->rows + (*tuple_id - cache->first) * rel->row_length,
+           rel->row_length);
+    row[rel->row_length - 1] ^= ROW_XOR;
+    return DB_OK;
+  }
+#endif /* DB_ROW_CACHE_LIMIT > 0 */
+
   if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
               (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
@@ -472,18 +642,22 @@ storage_put_row(relation_t *rel, storage_row_t row)
 
   remaining = rel->row_length;
   do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
+    r = cfs_write(rel->tuple_storage, row + rel->row_length - remaining,
+                  remaining);
     if(r < 0) {
       PRINTF("DB: Failed to store %u bytes\n", remaining);
       *last_byte ^= ROW_XOR;
       return DB_STORAGE_ERROR;
     }
-    row += r;
     remaining -= r;
   } while(remaining > 0);
 
   PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
 
+#if DB_ROW_CACHE_LIMIT > 0
+  row_cache_append(rel, end, row);
+#endif
+
   *last_byte ^= ROW_XOR;
 
   return DB_OK;
@@ -84,6 +84,48 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Keep an index of the file names and a bitmap of the allocated pages
+ * in RAM. The index is built by scanning the storage once, after which
+ * opening a file and allocating pages need no further scans.
+ */
+#ifdef COFFEE_CONF_RAM_INDEX
+#define COFFEE_RAM_INDEX  COFFEE_CONF_RAM_INDEX
+#else
+#define COFFEE_RAM_INDEX  0
+#endif
+
+/*
+ * The number of slots in the file name index. One slot is always kept
+ * empty; if more files exist, lookups of the files that did not fit
+ * fall back to scanning the storage.
+ */
+#ifdef COFFEE_CONF_RAM_INDEX_SIZE
+#define COFFEE_RAM_INDEX_SIZE  COFFEE_CONF_RAM_INDEX_SIZE
+#else
+#define COFFEE_RAM_INDEX_SIZE  32
+#endif
+
+/*
+ * Reclaim the space of removed files in a background process rather
+ * than when a reservation fails. The process erases one sector at a
+ * time, after an interval without writes, so that a reservation only
+ * waits for the garbage collector when no free extent is left.
+ */
+#ifdef COFFEE_CONF_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC  COFFEE_CONF_BACKGROUND_GC
+#else
+#define COFFEE_BACKGROUND_GC  0
+#endif
+
+/* The interval at which the background garbage collector checks for
+   idleness and, if idle, erases a sector. */
+#ifdef COFFEE_CONF_GC_INTERVAL
+#define COFFEE_GC_INTERVAL  COFFEE_CONF_GC_INTERVAL
+#else
+#define COFFEE_GC_INTERVAL  (5 * CLOCK_SECOND)
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -158,6 +200,9 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* Obsolete pages at the start of the sector, belonging to a file that
+     starts in a previous sector. */
+  coffee_page_t leading;
 };
 
 /* The structure of cached file objects. */
@@ -190,6 +235,19 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_RAM_INDEX
+/* A slot of the file name index, empty if the page is INVALID_PAGE. */
+struct name_index_entry {
+  uint16_t hash;
+  coffee_page_t page;
+};
+
+/* States of the RAM index. */
+#define INDEX_UNKNOWN     0 /* Not built yet. */
+#define INDEX_COMPLETE    1 /* All active files are indexed. */
+#define INDEX_OVERFLOW    2 /* Some active files are missing. */
+#endif /* COFFEE_RAM_INDEX */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -206,6 +264,27 @@ static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
 
+#if COFFEE_RAM_INDEX
+static struct name_index_entry name_index[COFFEE_RAM_INDEX_SIZE];
+static uint16_t name_index_entries;
+/* One bit per page, set if the page is not free (i.e., not erased). */
+static uint8_t page_bitmap[(COFFEE_PAGE_COUNT + 7) / 8];
+static uint8_t index_state;
+
+#define PAGE_ALLOCATED(page) (page_bitmap[(page) / 8] & (1 << ((page) % 8)))
+#endif /* COFFEE_RAM_INDEX */
+
+#if COFFEE_BACKGROUND_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+/* Erasures of each sector since boot. */
+static uint16_t erase_counts[COFFEE_SECTOR_COUNT];
+static coffee_page_t last_erased_sector;
+/* Set when files have been removed since the last collection. */
+static uint8_t gc_pending;
+/* Set when files have been written to since the last check. */
+static uint8_t gc_activity;
+#endif /* COFFEE_BACKGROUND_GC */
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -229,6 +308,105 @@ absolute_offset(coffee_page_t page, cfs_offset_t offset)
   return page * COFFEE_PAGE_SIZE + sizeof(struct file_header) + offset;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_RAM_INDEX
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* Names are truncated to the header size when stored. */
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = (hash << 5) + hash + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+mark_pages(coffee_page_t start, coffee_page_t count, int allocated)
+{
+  coffee_page_t page;
+
+  for(page = start; page < start + count && page < COFFEE_PAGE_COUNT; page++) {
+    if(allocated) {
+      page_bitmap[page / 8] |= 1 << (page % 8);
+    } else {
+      page_bitmap[page / 8] &= ~(1 << (page % 8));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uint16_t hash, coffee_page_t page)
+{
+  uint16_t slot;
+
+  if(index_state != INDEX_COMPLETE) {
+    return;
+  }
+
+  if(name_index_entries >= COFFEE_RAM_INDEX_SIZE - 1) {
+    PRINTF("Coffee: The file name index is full\n");
+    index_state = INDEX_OVERFLOW;
+    return;
+  }
+
+  for(slot = hash % COFFEE_RAM_INDEX_SIZE;
+      name_index[slot].page != INVALID_PAGE;
+      slot = (slot + 1) % COFFEE_RAM_INDEX_SIZE);
+  name_index[slot].hash = hash;
+  name_index[slot].page = page;
+  name_index_entries++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uint16_t hash, coffee_page_t page)
+{
+  uint16_t slot, next, home;
+
+  if(index_state == INDEX_UNKNOWN) {
+    return;
+  }
+
+  for(slot = hash % COFFEE_RAM_INDEX_SIZE;
+      name_index[slot].page != page;
+      slot = (slot + 1) % COFFEE_RAM_INDEX_SIZE) {
+    if(name_index[slot].page == INVALID_PAGE) {
+      return;
+    }
+  }
+  name_index_entries--;
+
+  /* Shift back the following entries of the probe sequence that would
+     otherwise become unreachable. */
+  for(next = (slot + 1) % COFFEE_RAM_INDEX_SIZE;
+      name_index[next].page != INVALID_PAGE;
+      next = (next + 1) % COFFEE_RAM_INDEX_SIZE) {
+    home = name_index[next].hash % COFFEE_RAM_INDEX_SIZE;
+    if(slot <= next ? (home <= slot || home > next) :
+       (home <= slot && home > next)) {
+      name_index[slot] = name_index[next];
+      slot = next;
+    }
+  }
+  name_index[slot].page = INVALID_PAGE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_index(void)
+{
+  uint16_t slot;
+
+  for(slot = 0; slot < COFFEE_RAM_INDEX_SIZE; slot++) {
+    name_index[slot].page = INVALID_PAGE;
+  }
+  name_index_entries = 0;
+  memset(page_bitmap, 0, sizeof(page_bitmap));
+  index_state = INDEX_COMPLETE;
+}
+#endif /* COFFEE_RAM_INDEX */
+/*---------------------------------------------------------------------------*/
 static coffee_page_t
 get_sector_status(coffee_page_t sector, struct sector_status *stats)
 {
@@ -268,6 +446,8 @@ get_sector_status(coffee_page_t sector, struct sector_status *stats)
     }
     active = skip_pages;
   } else {
+    stats->leading = skip_pages >= COFFEE_PAGES_PER_SECTOR ?
+      COFFEE_PAGES_PER_SECTOR : skip_pages;
     if(skip_pages >= COFFEE_PAGES_PER_SECTOR) {
       stats->obsolete = COFFEE_PAGES_PER_SECTOR;
       skip_pages -= COFFEE_PAGES_PER_SECTOR;
@@ -344,16 +524,55 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
   for(page = 0; page < skip_pages; page++) {
     write_header(&hdr, start + page);
   }
+#if COFFEE_RAM_INDEX
+  mark_pages(start, skip_pages, 1);
+#endif /* COFFEE_RAM_INDEX */
   PRINTF("Coffee: Isolated %u pages starting in sector %d\n",
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 }
 /*---------------------------------------------------------------------------*/
 static void
+erase_sector(coffee_page_t sector, coffee_page_t isolation_count,
+             coffee_page_t leading)
+{
+  coffee_page_t first_page;
+
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page < next_free) {
+    next_free = first_page;
+  }
+
+  if(isolation_count > 0) {
+    isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+  }
+
+  COFFEE_ERASE(sector);
+  PRINTF("Coffee: Erased sector %d!\n", sector);
+#if COFFEE_RAM_INDEX
+  mark_pages(first_page, COFFEE_PAGES_PER_SECTOR, 0);
+#endif /* COFFEE_RAM_INDEX */
+
+  /*
+   * The header of the obsolete file that the leading pages belong to is
+   * still in place, and it covers these pages. Isolate them so that no
+   * file is allocated there.
+   */
+  if(leading > 0) {
+    isolate_pages(first_page, leading);
+  }
+#if COFFEE_BACKGROUND_GC
+  erase_counts[sector]++;
+  last_erased_sector = sector;
+#endif /* COFFEE_BACKGROUND_GC */
+}
+/*---------------------------------------------------------------------------*/
+static void
 collect_garbage(int mode)
 {
   coffee_page_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t isolation_count;
+  char erased_previous;
 
   PRINTF("Coffee: Running the garbage collector in %s mode\n",
          mode == GC_RELUCTANT ? "reluctant" : "greedy");
@@ -361,36 +580,155 @@ collect_garbage(int mode)
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
    */
+  erased_previous = 0;
   for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
     isolation_count = get_sector_status(sector, &stats);
     PRINTF("Coffee: Sector %u has %u active, %u obsolete, and %u free pages.\n",
            (unsigned)sector, (unsigned)stats.active,
            (unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
+    /* Unless the previous sector has been erased, leading pages
+       cannot be reclaimed. */
+    if(erased_previous) {
+      stats.leading = 0;
+    }
+    erased_previous = 0;
+
+    if(stats.active > 0 || stats.obsolete == stats.leading) {
       continue;
     }
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
        (mode == GC_GREEDY && stats.obsolete > 0)) {
-      first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < next_free) {
-        next_free = first_page;
-      }
+      erase_sector(sector, isolation_count, stats.leading);
+      erased_previous = 1;
 
-      if(isolation_count > 0) {
-        isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+      if(mode == GC_RELUCTANT && isolation_count > 0) {
+        break;
       }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+/*
+ * Erase the most reclaimable sector, i.e., the one holding the most
+ * obsolete pages and no active ones. Among equally reclaimable sectors,
+ * the least erased one is chosen, and then the first one after the
+ * previously erased sector, so that erasures rotate over the storage.
+ * Returns 1 if a sector was erased.
+ */
+static int
+collect_garbage_step(void)
+{
+  coffee_page_t sector, best, reclaimable, best_reclaimable;
+  coffee_page_t distance, best_distance, isolation_count;
+  coffee_page_t best_isolation, best_leading;
+  coffee_page_t following, following_isolation;
+  struct sector_status stats;
 
-      COFFEE_ERASE(sector);
-      PRINTF("Coffee: Erased sector %d!\n", sector);
+  /*
+   * A single scan both chooses the sector and records what its erasure
+   * needs, since get_sector_status() has to iterate from sector 0.
+   * The sectors that directly follow the best one and are entirely
+   * covered by its last file are counted as well: that file loses its
+   * header with the erasure, so they are erased along with it.
+   */
+  best = INVALID_PAGE;
+  best_reclaimable = best_distance = 0;
+  best_isolation = best_leading = 0;
+  following = following_isolation = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    isolation_count = get_sector_status(sector, &stats);
+    if(best != INVALID_PAGE && sector == best + 1 + following &&
+       stats.leading == COFFEE_PAGES_PER_SECTOR) {
+      following++;
+      following_isolation = isolation_count;
+    }
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
+    /* Only sectors without free pages are considered: the free pages of
+       the others can still be allocated without an erasure. */
+    reclaimable = stats.obsolete - stats.leading;
+    if(stats.active > 0 || stats.free > 0 || reclaimable == 0) {
+      continue;
+    }
+
+    distance = (sector + COFFEE_SECTOR_COUNT - last_erased_sector - 1) %
+      COFFEE_SECTOR_COUNT;
+    if(best == INVALID_PAGE || reclaimable > best_reclaimable ||
+       (reclaimable == best_reclaimable &&
+        (erase_counts[sector] < erase_counts[best] ||
+         (erase_counts[sector] == erase_counts[best] &&
+          distance < best_distance)))) {
+      best = sector;
+      best_reclaimable = reclaimable;
+      best_distance = distance;
+      best_isolation = isolation_count;
+      best_leading = stats.leading;
+      following = following_isolation = 0;
+    }
+  }
+
+  if(best == INVALID_PAGE) {
+    return 0;
+  }
+
+  PRINTF("Coffee: Background GC erases sector %u (%u obsolete pages, %u erasures)\n",
+         (unsigned)best, (unsigned)best_reclaimable, erase_counts[best]);
+
+  /* Only the last of the following sectors can be followed by pages
+     of that file that have to be isolated. */
+  erase_sector(best, best_isolation, best_leading);
+  for(sector = best + 1; sector <= best + following; sector++) {
+    erase_sector(sector, sector == best + following ? following_isolation : 0,
+                 0);
+  }
+  gc_wait = 0;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  /* The storage may hold garbage from before the boot. */
+  gc_pending = 1;
+
+  etimer_set(&et, COFFEE_GC_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+
+    if(gc_activity) {
+      /* Not idle: postpone until an interval passes without writes. */
+      gc_activity = 0;
+      continue;
+    }
+
+    /* Erase one sector at a time, letting other processes run in between. */
+    while(gc_pending && !gc_activity) {
+      if(!collect_garbage_step()) {
+        gc_pending = 0;
         break;
       }
+      PROCESS_PAUSE();
     }
   }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_background_gc(void)
+{
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -413,6 +751,33 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_RAM_INDEX
+static void
+build_index(void)
+{
+  struct file_header hdr;
+  coffee_page_t page, next;
+
+  if(index_state != INDEX_UNKNOWN) {
+    return;
+  }
+
+  clear_index();
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next) {
+    read_header(&hdr, page);
+    next = next_file(page, &hdr);
+    if(!HDR_FREE(hdr)) {
+      mark_pages(page, next - page, 1);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+        index_add(name_hash(hdr.name), page);
+      }
+    }
+  }
+
+  PRINTF("Coffee: Indexed %u files\n", (unsigned)name_index_entries);
+}
+#endif /* COFFEE_RAM_INDEX */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -459,6 +824,37 @@ find_file(const char *name)
   struct file_header hdr;
   coffee_page_t page;
 
+#if COFFEE_RAM_INDEX
+  uint16_t hash;
+  uint16_t slot;
+
+  build_index();
+
+  /* Only read the headers of the files whose names hash alike. */
+  hash = name_hash(name);
+  for(slot = hash % COFFEE_RAM_INDEX_SIZE;
+      name_index[slot].page != INVALID_PAGE;
+      slot = (slot + 1) % COFFEE_RAM_INDEX_SIZE) {
+    if(name_index[slot].hash != hash) {
+      continue;
+    }
+    page = name_index[slot].page;
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+        if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+          return &coffee_files[i];
+        }
+      }
+      return load_file(page, &hdr);
+    }
+  }
+
+  if(index_state == INDEX_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_RAM_INDEX */
+
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
     if(FILE_FREE(&coffee_files[i])) {
@@ -520,6 +916,40 @@ static coffee_page_t
 find_contiguous_pages(coffee_page_t amount)
 {
   coffee_page_t page, start;
+#if COFFEE_RAM_INDEX
+  build_index();
+
+  /*
+   * Same allocation as below, but the free pages are looked up in the
+   * page bitmap. Fully allocated bitmap bytes are skipped at once.
+   */
+  start = INVALID_PAGE;
+  for(page = next_free; page < COFFEE_PAGE_COUNT; page++) {
+    if(page % 8 == 0 && page_bitmap[page / 8] == 0xff) {
+      start = INVALID_PAGE;
+      page += 7;
+      continue;
+    }
+    if(PAGE_ALLOCATED(page)) {
+      start = INVALID_PAGE;
+      continue;
+    }
+    if(start == INVALID_PAGE) {
+      start = page;
+      if(start + amount >= COFFEE_PAGE_COUNT) {
+        /* We can stop immediately if the remaining pages are not enough. */
+        break;
+      }
+    }
+    if(start + amount <= page + 1) {
+      if(start == next_free) {
+        next_free = start + amount;
+      }
+      return start;
+    }
+  }
+  return INVALID_PAGE;
+#else /* COFFEE_RAM_INDEX */
   struct file_header hdr;
 
   start = INVALID_PAGE;
@@ -550,6 +980,7 @@ find_contiguous_pages(coffee_page_t amount)
     }
   }
   return INVALID_PAGE;
+#endif /* COFFEE_RAM_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -572,6 +1003,11 @@ remove_by_page(coffee_page_t page, int remove_log,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_RAM_INDEX
+  if(!HDR_LOG(hdr)) {
+    index_remove(name_hash(hdr.name), page);
+  }
+#endif /* COFFEE_RAM_INDEX */
 
   gc_wait = 0;
 
@@ -592,9 +1028,14 @@ remove_by_page(coffee_page_t page, int remove_log,
     }
   }
 
+#if COFFEE_BACKGROUND_GC
+  start_background_gc();
+  gc_pending = 1;
+#else /* COFFEE_BACKGROUND_GC */
   if(!COFFEE_EXTENDED_WEAR_LEVELLING && gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
+#endif /* COFFEE_BACKGROUND_GC */
 
   return 0;
 }
@@ -618,6 +1059,11 @@ reserve(const char *name, coffee_page_t pages,
     return NULL;
   }
 
+#if COFFEE_BACKGROUND_GC
+  start_background_gc();
+  gc_activity = 1;
+#endif /* COFFEE_BACKGROUND_GC */
+
   page = find_contiguous_pages(pages);
   if(page == INVALID_PAGE) {
     if(gc_wait) {
@@ -636,6 +1082,12 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_RAM_INDEX
+  mark_pages(page, pages, 1);
+  if(!HDR_LOG(hdr)) {
+    index_add(name_hash(hdr.name), page);
+  }
+#endif /* COFFEE_RAM_INDEX */
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
@@ -1157,6 +1609,10 @@ cfs_write(int fd, const void *buf, unsigned size)
   fdp = &coffee_fd_set[fd];
   file = fdp->file;
 
+#if COFFEE_BACKGROUND_GC
+  gc_activity = 1;
+#endif /* COFFEE_BACKGROUND_GC */
+
   /* Attempt to extend the file if we try to write past the end. */
   if(!(fdp->io_flags & CFS_COFFEE_IO_FIRM_SIZE)) {
     while(size + fdp->offset + sizeof(struct file_header) >
@@ -1253,7 +1709,7 @@ cfs_readdir(struct cfs_dir *dir, struct cfs_dirent *record)
   while(page < COFFEE_PAGE_COUNT) {
     read_header(&hdr, page);
     if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
-      memcpy(record->name, hdr.name, sizeof(record->name));
+      memcpy(record->name, hdr.name, MIN(sizeof(record->name), sizeof(hdr.name)));
       record->name[sizeof(record->name) - 1] = '\0';
       record->size = file_end(page);
 
@@ -1331,13 +1787,22 @@ cfs_coffee_format(void)
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
     COFFEE_ERASE(i);
     PRINTF(".");
+#if COFFEE_BACKGROUND_GC
+    erase_counts[i]++;
+#endif /* COFFEE_BACKGROUND_GC */
   }
+#if COFFEE_BACKGROUND_GC
+  gc_pending = 0;
+#endif /* COFFEE_BACKGROUND_GC */
 
   /* Formatting invalidates the file information. */
   memset(&coffee_files, 0, sizeof(coffee_files));
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_RAM_INDEX
+  clear_index();
+#endif /* COFFEE_RAM_INDEX */
 
   PRINTF(" done!\n");
 
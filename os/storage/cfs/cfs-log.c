@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \addtogroup cfs
+ * @{
+ */
+
+/**
+ * \file
+ *	Append-only logs stored as chains of Coffee files.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "cfs/cfs-log.h"
+
+/* Room for the log name, the dot, four hex digits and the zero. */
+#define EXTENT_NAME_LENGTH (CFS_LOG_NAME_LENGTH + 5)
+
+/* Sequence numbers wrap around; compare them by their distance. */
+#define SEQ_DIFF(a, b) ((int16_t)((uint16_t)(a) - (uint16_t)(b)))
+
+/* Set in the last header byte, which is therefore never zero. */
+#define RECORD_FLAG 0x80
+/*---------------------------------------------------------------------------*/
+static void
+extent_name(const struct cfs_log *log, uint16_t seq, char *name)
+{
+  snprintf(name, EXTENT_NAME_LENGTH, "%s.%04x", log->name, (unsigned)seq);
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_extent_name(const struct cfs_log *log, const char *name, uint16_t *seq)
+{
+  size_t len;
+  unsigned value;
+  int i;
+  char c;
+
+  len = strlen(log->name);
+  if(strncmp(name, log->name, len) != 0 || name[len] != '.' ||
+     strlen(name) != len + 5) {
+    return 0;
+  }
+
+  value = 0;
+  for(i = 1; i <= 4; i++) {
+    c = name[len + i];
+    if(c >= '0' && c <= '9') {
+      value = (value << 4) | (c - '0');
+    } else if(c >= 'a' && c <= 'f') {
+      value = (value << 4) | (c - 'a' + 10);
+    } else {
+      return 0;
+    }
+  }
+  *seq = value;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Return the length of the record at the offset of an extent that
+ * Coffee considers to end at file_end, or -1 if there is no record.
+ * A header always lies within file_end, as its last byte is non-zero.
+ */
+static int
+read_record_header(int fd, cfs_offset_t offset, cfs_offset_t file_end)
+{
+  uint8_t header[CFS_LOG_RECORD_HEADER_SIZE];
+
+  if(offset + CFS_LOG_RECORD_HEADER_SIZE > file_end ||
+     cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, header, sizeof(header)) != sizeof(header) ||
+     !(header[1] & RECORD_FLAG)) {
+    return -1;
+  }
+  return header[0] | (header[1] & ~RECORD_FLAG) << 8;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the end of the last record, which may be followed by zero bytes
+   that Coffee does not count as part of the file. */
+static cfs_offset_t
+find_extent_end(const char *name)
+{
+  cfs_offset_t file_end;
+  cfs_offset_t end;
+  int fd;
+  int len;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  file_end = cfs_seek(fd, 0, CFS_SEEK_END);
+  end = 0;
+  while((len = read_record_header(fd, end, file_end)) >= 0) {
+    end += CFS_LOG_RECORD_HEADER_SIZE + len;
+  }
+  cfs_close(fd);
+  return file_end < 0 ? -1 : end;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_extent(struct cfs_log *log)
+{
+  char name[EXTENT_NAME_LENGTH];
+
+  extent_name(log, log->last, name);
+  log->end = find_extent_end(name);
+  if(log->end < 0) {
+    return -1;
+  }
+  log->fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+  if(log->fd < 0) {
+    return -1;
+  }
+  /* Appending only writes to unused bytes, so Coffee never has to log
+     or merge. The extent is never extended either. */
+  cfs_coffee_set_io_semantics(log->fd, CFS_COFFEE_IO_FLASH_AWARE |
+                              CFS_COFFEE_IO_FIRM_SIZE);
+  if(cfs_seek(log->fd, log->end, CFS_SEEK_SET) != log->end) {
+    cfs_close(log->fd);
+    log->fd = -1;
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+drop_oldest(struct cfs_log *log)
+{
+  char name[EXTENT_NAME_LENGTH];
+
+  extent_name(log, log->first, name);
+  log->first++;
+  log->count--;
+  return cfs_remove(name);
+}
+/*---------------------------------------------------------------------------*/
+static int
+new_extent(struct cfs_log *log)
+{
+  char name[EXTENT_NAME_LENGTH];
+  uint16_t seq;
+
+  if(log->fd >= 0) {
+    cfs_close(log->fd);
+    log->fd = -1;
+  }
+
+  if(log->max_extents > 0) {
+    while(log->count >= log->max_extents) {
+      drop_oldest(log);
+    }
+  }
+
+  seq = log->count > 0 ? log->last + 1 : log->first;
+  extent_name(log, seq, name);
+  while(cfs_coffee_reserve(name, log->extent_size) < 0) {
+    /* A circular log makes room by giving up its oldest data. The
+       newest extent is kept so that readers do not lose their place. */
+    if(log->max_extents == 0 || log->count < 2) {
+      return -1;
+    }
+    drop_oldest(log);
+  }
+
+  if(log->count == 0) {
+    log->first = seq;
+  }
+  log->last = seq;
+  log->count++;
+  return open_extent(log);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_log_open(struct cfs_log *log, const char *name,
+             cfs_offset_t extent_size, uint16_t max_extents)
+{
+  struct cfs_dir dir;
+  struct cfs_dirent dirent;
+  uint16_t seq;
+  uint16_t ref;
+  int16_t min;
+  int16_t max;
+  int found;
+
+  if(strlen(name) >= sizeof(log->name) ||
+     extent_size <= CFS_LOG_RECORD_HEADER_SIZE) {
+    return -1;
+  }
+
+  memset(log, 0, sizeof(*log));
+  strcpy(log->name, name);
+  log->extent_size = extent_size;
+  log->max_extents = max_extents;
+  log->fd = -1;
+
+  /* The extents have consecutive sequence numbers. Measure them
+     relative to the first one found, so that wrapping numbers are
+     ordered correctly. */
+  found = 0;
+  ref = min = max = 0;
+  if(cfs_opendir(&dir, "/") == 0) {
+    while(cfs_readdir(&dir, &dirent) == 0) {
+      if(!parse_extent_name(log, dirent.name, &seq)) {
+        continue;
+      }
+      if(!found) {
+        ref = seq;
+        found = 1;
+      }
+      if(SEQ_DIFF(seq, ref) < min) {
+        min = SEQ_DIFF(seq, ref);
+      }
+      if(SEQ_DIFF(seq, ref) > max) {
+        max = SEQ_DIFF(seq, ref);
+      }
+    }
+    cfs_closedir(&dir);
+  }
+
+  if(!found) {
+    return 0;
+  }
+
+  log->first = ref + min;
+  log->last = ref + max;
+  log->count = max - min + 1;
+  return open_extent(log);
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_log_close(struct cfs_log *log)
+{
+  if(log->fd >= 0) {
+    cfs_close(log->fd);
+    log->fd = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_log_append(struct cfs_log *log, const void *buf, unsigned len)
+{
+  const uint8_t *data;
+  uint8_t header[CFS_LOG_RECORD_HEADER_SIZE];
+  unsigned written;
+  unsigned chunk;
+
+  data = buf;
+  for(written = 0; written < len; written += chunk) {
+    if(log->fd < 0 ||
+       log->end + CFS_LOG_RECORD_HEADER_SIZE >= log->extent_size) {
+      if(new_extent(log) < 0) {
+        break;
+      }
+    }
+
+    chunk = MIN(len - written, (unsigned)(log->extent_size - log->end -
+                                          CFS_LOG_RECORD_HEADER_SIZE));
+    chunk = MIN(chunk, CFS_LOG_MAX_RECORD_LEN);
+    header[0] = chunk & 0xff;
+    header[1] = (chunk >> 8) | RECORD_FLAG;
+    if(cfs_write(log->fd, header, sizeof(header)) != sizeof(header) ||
+       cfs_write(log->fd, data + written, chunk) != chunk) {
+      break;
+    }
+    log->end += CFS_LOG_RECORD_HEADER_SIZE + chunk;
+  }
+
+  return written > 0 || len == 0 ? (int)written : -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_log_rewind(struct cfs_log *log, struct cfs_log_cursor *cursor)
+{
+  cursor->extent = log->first;
+  cursor->offset = 0;
+  cursor->left = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Read the data of the records of an extent, starting at the cursor. */
+static int
+read_extent(int fd, struct cfs_log_cursor *cursor, uint8_t *buf,
+            unsigned len)
+{
+  cfs_offset_t file_end;
+  unsigned count;
+  unsigned chunk;
+  unsigned stored;
+  int record_len;
+
+  file_end = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(file_end < 0) {
+    return -1;
+  }
+
+  for(count = 0; count < len; count += chunk) {
+    if(cursor->left == 0) {
+      record_len = read_record_header(fd, cursor->offset, file_end);
+      if(record_len < 0) {
+        break;
+      }
+      cursor->offset += CFS_LOG_RECORD_HEADER_SIZE;
+      cursor->left = record_len;
+    }
+
+    /* Coffee does not read the zero bytes at the end of the extent,
+       so they are filled in. */
+    chunk = MIN(len - count, (unsigned)cursor->left);
+    stored = 0;
+    if(cursor->offset < file_end) {
+      stored = MIN(chunk, (unsigned)(file_end - cursor->offset));
+      if(cfs_seek(fd, cursor->offset, CFS_SEEK_SET) != cursor->offset ||
+         cfs_read(fd, buf + count, stored) != stored) {
+        return -1;
+      }
+    }
+    memset(buf + count + stored, 0, chunk - stored);
+    cursor->offset += chunk;
+    cursor->left -= chunk;
+  }
+
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_log_read(struct cfs_log *log, struct cfs_log_cursor *cursor,
+             void *buf, unsigned len)
+{
+  char name[EXTENT_NAME_LENGTH];
+  unsigned count;
+  int fd;
+  int r;
+
+  if(log->count == 0 || len == 0) {
+    return 0;
+  }
+
+  if(SEQ_DIFF(cursor->extent, log->first) < 0) {
+    /* The extent has been dropped; continue with the oldest data. */
+    cfs_log_rewind(log, cursor);
+  }
+
+  count = 0;
+  while(SEQ_DIFF(cursor->extent, log->last) <= 0) {
+    extent_name(log, cursor->extent, name);
+    fd = cfs_open(name, CFS_READ);
+    if(fd >= 0) {
+      r = read_extent(fd, cursor, (uint8_t *)buf + count, len - count);
+      cfs_close(fd);
+      if(r < 0) {
+        return count > 0 ? (int)count : -1;
+      }
+      count += r;
+      if(count == len) {
+        break;
+      }
+    }
+
+    if(cursor->extent == log->last) {
+      break;
+    }
+    cursor->extent++;
+    cursor->offset = 0;
+    cursor->left = 0;
+  }
+
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_log_remove(struct cfs_log *log)
+{
+  int result;
+
+  cfs_log_close(log);
+  result = 0;
+  while(log->count > 0) {
+    if(drop_oldest(log) < 0) {
+      result = -1;
+    }
+  }
+  log->end = 0;
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \addtogroup cfs
+ * @{
+ */
+
+/**
+ * \file
+ *	Header for append-only logs on top of Coffee.
+ *
+ * A log is stored as a chain of extents, i.e., Coffee files named
+ * "<name>.<sequence number in hex>" that are reserved with a fixed
+ * size and written with flash-aware, firm-size I/O semantics. Appending
+ * never modifies written data, so Coffee neither creates micro logs nor
+ * merges the file, and an append costs the same regardless of the log
+ * size. When the newest extent is full, the next one is reserved.
+ *
+ * A log opened with a maximum number of extents is circular: the oldest
+ * extent is removed when a new one would exceed the limit, or when the
+ * file system is full.
+ *
+ * Readers keep their position in a cursor, which can be stored by the
+ * application and used again after the log has been closed and opened.
+ * A cursor that points into a removed extent continues at the oldest
+ * remaining extent.
+ *
+ * Appended data is stored in records of at most CFS_LOG_MAX_RECORD_LEN
+ * bytes, each preceded by a header of CFS_LOG_RECORD_HEADER_SIZE bytes
+ * that holds its length. Coffee determines the size of a file by
+ * searching for its last non-zero byte, so the last byte of the header
+ * is never zero. When the log is opened again, the end of the newest
+ * extent is found by following the record lengths, and data that ends
+ * with zero bytes is kept as it was appended.
+ *
+ * \name Functions called from application programs
+ * @{
+ */
+
+#ifndef CFS_LOG_H_
+#define CFS_LOG_H_
+
+#include "cfs/cfs.h"
+
+/* Size of the log name buffer, including the terminating zero. With
+   the extent suffix, names must fit into COFFEE_NAME_LENGTH. */
+#ifdef CFS_LOG_CONF_NAME_LENGTH
+#define CFS_LOG_NAME_LENGTH CFS_LOG_CONF_NAME_LENGTH
+#else
+#define CFS_LOG_NAME_LENGTH 11
+#endif
+
+/* Size of the length header of each record. */
+#define CFS_LOG_RECORD_HEADER_SIZE 2
+/* The largest record; longer appends are split into several records. */
+#define CFS_LOG_MAX_RECORD_LEN 0x7fff
+
+struct cfs_log {
+  char name[CFS_LOG_NAME_LENGTH];
+  uint16_t first;             /* Sequence number of the oldest extent */
+  uint16_t last;              /* Sequence number of the newest extent */
+  uint16_t count;             /* Number of extents, 0 if the log is empty */
+  uint16_t max_extents;       /* Retention limit, 0 for unlimited */
+  cfs_offset_t extent_size;   /* Bytes per extent */
+  cfs_offset_t end;           /* Bytes written to the newest extent */
+  int fd;                     /* Append descriptor of the newest extent */
+};
+
+struct cfs_log_cursor {
+  uint16_t extent;            /* Sequence number of the current extent */
+  cfs_offset_t offset;        /* Read offset within the extent */
+  cfs_offset_t left;          /* Unread bytes of the current record */
+};
+
+/**
+ * \brief Open a log, creating it on the first append.
+ * \param log The log.
+ * \param name The log name, at most CFS_LOG_NAME_LENGTH - 1 characters.
+ * \param extent_size The size of each extent in bytes, including the
+ *        record headers.
+ * \param max_extents The number of extents kept, or 0 to keep all.
+ * \return 0 on success, -1 on failure.
+ *
+ * The extents of an existing log with the same name are found again,
+ * so the log continues where it ended. The extent size is only used
+ * for new extents.
+ */
+int cfs_log_open(struct cfs_log *log, const char *name,
+                 cfs_offset_t extent_size, uint16_t max_extents);
+
+/**
+ * \brief Close a log.
+ * \param log The log.
+ */
+void cfs_log_close(struct cfs_log *log);
+
+/**
+ * \brief Append data to a log.
+ * \param log The log.
+ * \param buf The data.
+ * \param len The number of bytes.
+ * \return The number of bytes appended, or -1 if nothing could be
+ *         appended.
+ *
+ * Data that does not fit into the newest extent continues in a new one.
+ * Fewer than len bytes are appended if no extent could be reserved.
+ */
+int cfs_log_append(struct cfs_log *log, const void *buf, unsigned len);
+
+/**
+ * \brief Set a cursor to the oldest data of a log.
+ * \param log The log.
+ * \param cursor The cursor.
+ */
+void cfs_log_rewind(struct cfs_log *log, struct cfs_log_cursor *cursor);
+
+/**
+ * \brief Read data from a log and advance the cursor.
+ * \param log The log.
+ * \param cursor The cursor.
+ * \param buf The destination buffer.
+ * \param len The size of the buffer.
+ * \return The number of bytes read, 0 at the end of the log, or -1
+ *         on failure.
+ *
+ * The data of consecutive records and extents is read as one stream,
+ * so fewer than len bytes are only returned at the end of the log.
+ */
+int cfs_log_read(struct cfs_log *log, struct cfs_log_cursor *cursor,
+                 void *buf, unsigned len);
+
+/**
+ * \brief Remove all extents of a log.
+ * \param log The log.
+ * \return 0 on success, -1 on failure.
+ *
+ * The log stays open and is empty afterwards.
+ */
+int cfs_log_remove(struct cfs_log *log);
+
+/** @} */
+/** @} */
+
+#endif /* CFS_LOG_H_ */
@@ -0,0 +1,678 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *	A compressed time-series store on top of CFS.
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "tsdb.h"
+
+#define BLOCK_MARKER 0xa5
+
+/* The XOR window is unset at the start of each block. */
+#define NO_WINDOW 0xff
+
+#define PAYLOAD_BITS (TSDB_PAYLOAD_SIZE * 8)
+
+/* Bits of a sample, most significant first. */
+struct code {
+  uint32_t value;
+  uint8_t bits;
+};
+
+static struct tsdb_block scratch;
+/*---------------------------------------------------------------------------*/
+static void
+put_bits(uint8_t *payload, uint16_t *pos, uint32_t value, uint8_t n)
+{
+  uint8_t free;
+  uint8_t take;
+
+  while(n > 0) {
+    free = 8 - (*pos & 7);
+    take = n < free ? n : free;
+    payload[*pos >> 3] |= ((value >> (n - take)) & ((1U << take) - 1)) <<
+      (free - take);
+    *pos += take;
+    n -= take;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get_bits(const uint8_t *payload, uint16_t *pos, uint8_t n)
+{
+  uint32_t value;
+  uint8_t avail;
+  uint8_t take;
+
+  value = 0;
+  while(n > 0) {
+    avail = 8 - (*pos & 7);
+    take = n < avail ? n : avail;
+    value = (value << take) |
+      ((payload[*pos >> 3] >> (avail - take)) & ((1U << take) - 1));
+    *pos += take;
+    n -= take;
+  }
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+leading_zeros(uint32_t x)
+{
+  uint8_t n;
+
+  for(n = 0; !(x & 0x80000000UL); n++) {
+    x <<= 1;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+trailing_zeros(uint32_t x)
+{
+  uint8_t n;
+
+  for(n = 0; !(x & 1); n++) {
+    x >>= 1;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+codec_start(struct tsdb_codec *codec, uint32_t t, int32_t value)
+{
+  codec->t_prev = t;
+  codec->delta_prev = 0;
+  codec->v_prev = (uint32_t)value;
+  codec->leading = NO_WINDOW;
+  codec->trailing = 0;
+  codec->bits = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Encode a sample into at most four codes, and return their length in
+   bits. The updated codec state is stored in next, except for the bit
+   position. */
+static uint8_t
+encode(const struct tsdb_codec *codec, uint32_t t, int32_t value,
+       struct code *codes, uint8_t *count, struct tsdb_codec *next)
+{
+  uint32_t delta;
+  int32_t dod;
+  uint32_t x;
+  uint8_t leading;
+  uint8_t trailing;
+  uint8_t length;
+  uint8_t n;
+  uint8_t bits;
+
+  *next = *codec;
+  n = 0;
+
+  /* The timestamp, as a delta of deltas with a variable-length prefix.
+     Deltas are below 2^31, so the difference always fits. */
+  delta = t - codec->t_prev;
+  dod = (int32_t)(delta - codec->delta_prev);
+  if(dod == 0) {
+    codes[n].value = 0;
+    codes[n++].bits = 1;
+  } else if(dod >= -63 && dod <= 64) {
+    codes[n].value = 0x2;
+    codes[n++].bits = 2;
+    codes[n].value = dod + 63;
+    codes[n++].bits = 7;
+  } else if(dod >= -255 && dod <= 256) {
+    codes[n].value = 0x6;
+    codes[n++].bits = 3;
+    codes[n].value = dod + 255;
+    codes[n++].bits = 9;
+  } else if(dod >= -2047 && dod <= 2048) {
+    codes[n].value = 0xe;
+    codes[n++].bits = 4;
+    codes[n].value = dod + 2047;
+    codes[n++].bits = 12;
+  } else {
+    codes[n].value = 0xf;
+    codes[n++].bits = 4;
+    codes[n].value = (uint32_t)dod;
+    codes[n++].bits = 32;
+  }
+  next->t_prev = t;
+  next->delta_prev = delta;
+
+  /* The value, as the bits that differ from the previous value. */
+  x = (uint32_t)value ^ codec->v_prev;
+  if(x == 0) {
+    codes[n].value = 0;
+    codes[n++].bits = 1;
+  } else {
+    leading = leading_zeros(x);
+    trailing = trailing_zeros(x);
+    if(codec->leading != NO_WINDOW &&
+       leading >= codec->leading && trailing >= codec->trailing) {
+      /* The differing bits fit into the previous window. */
+      length = 32 - codec->leading - codec->trailing;
+      codes[n].value = 0x2;
+      codes[n++].bits = 2;
+      codes[n].value = x >> codec->trailing;
+      codes[n++].bits = length;
+    } else {
+      length = 32 - leading - trailing;
+      codes[n].value = (0x3UL << 10) | ((uint32_t)leading << 5) | (length - 1);
+      codes[n++].bits = 12;
+      codes[n].value = x >> trailing;
+      codes[n++].bits = length;
+      next->leading = leading;
+      next->trailing = trailing;
+    }
+  }
+  next->v_prev = (uint32_t)value;
+
+  *count = n;
+  for(bits = 0; n > 0; n--) {
+    bits += codes[n - 1].bits;
+  }
+  return bits;
+}
+/*---------------------------------------------------------------------------*/
+static void
+decode(struct tsdb_codec *codec, const uint8_t *payload)
+{
+  int32_t dod;
+  uint32_t x;
+  uint8_t length;
+
+  if(get_bits(payload, &codec->bits, 1) == 0) {
+    dod = 0;
+  } else if(get_bits(payload, &codec->bits, 1) == 0) {
+    dod = (int32_t)get_bits(payload, &codec->bits, 7) - 63;
+  } else if(get_bits(payload, &codec->bits, 1) == 0) {
+    dod = (int32_t)get_bits(payload, &codec->bits, 9) - 255;
+  } else if(get_bits(payload, &codec->bits, 1) == 0) {
+    dod = (int32_t)get_bits(payload, &codec->bits, 12) - 2047;
+  } else {
+    dod = (int32_t)get_bits(payload, &codec->bits, 32);
+  }
+  codec->delta_prev += dod;
+  codec->t_prev += codec->delta_prev;
+
+  if(get_bits(payload, &codec->bits, 1) == 0) {
+    return;
+  }
+  if(get_bits(payload, &codec->bits, 1) == 0) {
+    length = 32 - codec->leading - codec->trailing;
+  } else {
+    codec->leading = get_bits(payload, &codec->bits, 5);
+    length = get_bits(payload, &codec->bits, 5) + 1;
+    codec->trailing = 32 - codec->leading - length;
+  }
+  x = get_bits(payload, &codec->bits, length) << codec->trailing;
+  codec->v_prev ^= x;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(struct tsdb_series *series, uint16_t block, uint32_t t_first)
+{
+  uint16_t i;
+
+  if(block % series->index_stride != 0) {
+    return;
+  }
+  if(series->index_count == TSDB_INDEX_SIZE) {
+    /* Keep every other entry, and index half as many blocks. */
+    for(i = 0; i < TSDB_INDEX_SIZE / 2; i++) {
+      series->index[i] = series->index[2 * i];
+    }
+    series->index_count = TSDB_INDEX_SIZE / 2;
+    series->index_stride *= 2;
+    if(block % series->index_stride != 0) {
+      return;
+    }
+  }
+  series->index[series->index_count++] = t_first;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the first block that may hold samples at or after a timestamp.
+   All blocks before an indexed block whose first sample is older than
+   the timestamp end before it. */
+static uint16_t
+first_block(const struct tsdb_series *series, uint32_t from)
+{
+  uint16_t low;
+  uint16_t high;
+  uint16_t middle;
+
+  low = 0;
+  high = series->index_count;
+  while(low < high) {
+    middle = (low + high) / 2;
+    if(series->index[middle] < from) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low == 0 ? 0 : (low - 1) * series->index_stride;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_block(int fd, uint16_t block, cfs_offset_t offset, void *buf,
+           unsigned len)
+{
+  offset += (cfs_offset_t)block * TSDB_BLOCK_SIZE;
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, buf, len) != (int)len) {
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+seal_block(struct tsdb_series *series)
+{
+  int fd;
+  int written;
+
+  series->block.header.bits = series->codec.bits;
+  series->block.marker = BLOCK_MARKER;
+
+  fd = cfs_open(series->name, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return -1;
+  }
+  written = cfs_write(fd, &series->block, TSDB_BLOCK_SIZE);
+  cfs_close(fd);
+  if(written != TSDB_BLOCK_SIZE) {
+    return -1;
+  }
+
+  index_add(series, series->blocks, series->block.header.t_first);
+  series->blocks++;
+  memset(&series->block, 0, sizeof(series->block));
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_block(struct tsdb_series *series, uint32_t t, int32_t value)
+{
+  struct tsdb_block_header *header;
+
+  header = &series->block.header;
+  header->t_first = header->t_last = t;
+  header->v_first = header->v_min = header->v_max = value;
+  header->sum = value;
+  header->count = 1;
+  codec_start(&series->codec, t, value);
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_open(struct tsdb_series *series, const char *name)
+{
+  struct tsdb_block_header header;
+  cfs_offset_t size;
+  uint16_t block;
+  uint16_t blocks;
+  int fd;
+
+  if(strlen(name) >= TSDB_NAME_LENGTH) {
+    return -1;
+  }
+  memset(series, 0, sizeof(*series));
+  strcpy(series->name, name);
+  series->index_stride = 1;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    /* A new series. */
+    return 0;
+  }
+
+  size = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(size < 0) {
+    cfs_close(fd);
+    return -1;
+  }
+
+  /* Rebuild the sparse index from the block summaries. */
+  blocks = size / TSDB_BLOCK_SIZE;
+  for(block = 0; block < blocks; block++) {
+    if(read_block(fd, block, 0, &header, sizeof(header)) < 0) {
+      cfs_close(fd);
+      return -1;
+    }
+    index_add(series, block, header.t_first);
+    series->t_last = header.t_last;
+  }
+  series->blocks = blocks;
+
+  cfs_close(fd);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_close(struct tsdb_series *series)
+{
+  return tsdb_flush(series);
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_append(struct tsdb_series *series, uint32_t t, int32_t value)
+{
+  struct tsdb_block_header *header;
+  struct tsdb_codec next;
+  struct code codes[4];
+  uint8_t count;
+  uint8_t bits;
+  uint8_t i;
+
+  header = &series->block.header;
+  if((series->blocks > 0 || header->count > 0) && t < series->t_last) {
+    return -1;
+  }
+
+  if(header->count > 0) {
+    /* Larger timestamp deltas, which could overflow the delta of
+       deltas, start a new block. */
+    if(t - series->codec.t_prev <= INT32_MAX && header->count < 0xffff) {
+      bits = encode(&series->codec, t, value, codes, &count, &next);
+      if(series->codec.bits + bits <= PAYLOAD_BITS) {
+        for(i = 0; i < count; i++) {
+          put_bits(series->block.payload, &next.bits,
+                   codes[i].value, codes[i].bits);
+        }
+        series->codec = next;
+
+        header->t_last = t;
+        header->count++;
+        header->sum += value;
+        if(value < header->v_min) {
+          header->v_min = value;
+        }
+        if(value > header->v_max) {
+          header->v_max = value;
+        }
+        series->t_last = t;
+        return 0;
+      }
+    }
+
+    if(seal_block(series) < 0) {
+      return -1;
+    }
+  }
+
+  start_block(series, t, value);
+  series->t_last = t;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_flush(struct tsdb_series *series)
+{
+  if(series->block.header.count == 0) {
+    return 0;
+  }
+  return seal_block(series);
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_remove(struct tsdb_series *series)
+{
+  if(series->blocks > 0 && cfs_remove(series->name) < 0) {
+    return -1;
+  }
+
+  series->blocks = 0;
+  series->index_count = 0;
+  series->index_stride = 1;
+  series->t_last = 0;
+  memset(&series->block, 0, sizeof(series->block));
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+cfs_offset_t
+tsdb_size(struct tsdb_series *series)
+{
+  return (cfs_offset_t)series->blocks * TSDB_BLOCK_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsdb_range(struct tsdb_series *series, struct tsdb_cursor *cursor,
+           uint32_t from, uint32_t to)
+{
+  cursor->series = series;
+  cursor->from = from;
+  cursor->to = to;
+  cursor->next_block = first_block(series, from);
+  cursor->remaining = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Load the next block that overlaps the range of a cursor. */
+static int
+cursor_load(struct tsdb_cursor *cursor)
+{
+  struct tsdb_series *series;
+  struct tsdb_block_header *header;
+  uint16_t block;
+  int result;
+  int fd;
+
+  series = cursor->series;
+  header = &cursor->block.header;
+  fd = -1;
+  result = 0;
+
+  while(cursor->next_block <= series->blocks) {
+    block = cursor->next_block++;
+    if(block == series->blocks) {
+      if(series->block.header.count == 0) {
+        break;
+      }
+      memcpy(&cursor->block, &series->block, sizeof(cursor->block));
+    } else {
+      if(fd < 0) {
+        fd = cfs_open(series->name, CFS_READ);
+      }
+      if(fd < 0 || read_block(fd, block, 0, header, sizeof(*header)) < 0) {
+        result = -1;
+        break;
+      }
+    }
+
+    if(header->t_first > cursor->to) {
+      break;
+    }
+    if(header->t_last < cursor->from) {
+      continue;
+    }
+
+    if(block < series->blocks &&
+       read_block(fd, block, sizeof(*header), cursor->block.payload,
+                  TSDB_PAYLOAD_SIZE) < 0) {
+      result = -1;
+      break;
+    }
+    cursor->remaining = header->count;
+    result = 1;
+    break;
+  }
+
+  if(result != 1) {
+    /* Do not look at any further blocks. */
+    cursor->next_block = series->blocks + 1;
+  }
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_range_next(struct tsdb_cursor *cursor, uint32_t *t, int32_t *value)
+{
+  struct tsdb_block_header *header;
+  int result;
+
+  header = &cursor->block.header;
+  for(;;) {
+    if(cursor->remaining == 0) {
+      result = cursor_load(cursor);
+      if(result <= 0) {
+        return result;
+      }
+    }
+
+    if(cursor->remaining == header->count) {
+      codec_start(&cursor->codec, header->t_first, header->v_first);
+    } else {
+      decode(&cursor->codec, cursor->block.payload);
+    }
+    cursor->remaining--;
+
+    if(cursor->codec.t_prev > cursor->to) {
+      cursor->remaining = 0;
+      cursor->next_block = cursor->series->blocks + 1;
+      return 0;
+    }
+    if(cursor->codec.t_prev >= cursor->from) {
+      *t = cursor->codec.t_prev;
+      *value = (int32_t)cursor->codec.v_prev;
+      return 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+aggregate_block(const struct tsdb_block *block, uint32_t from, uint32_t to,
+                struct tsdb_aggregate *aggregate)
+{
+  struct tsdb_codec codec;
+  uint16_t i;
+  int32_t value;
+
+  codec_start(&codec, block->header.t_first, block->header.v_first);
+  for(i = 0; i < block->header.count; i++) {
+    if(i > 0) {
+      decode(&codec, block->payload);
+    }
+    if(codec.t_prev > to) {
+      break;
+    }
+    if(codec.t_prev >= from) {
+      value = (int32_t)codec.v_prev;
+      aggregate->count++;
+      aggregate->sum += value;
+      if(value < aggregate->min) {
+        aggregate->min = value;
+      }
+      if(value > aggregate->max) {
+        aggregate->max = value;
+      }
+    }
+  }
+  aggregate->blocks_decoded++;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsdb_aggregate(struct tsdb_series *series, uint32_t from, uint32_t to,
+               struct tsdb_aggregate *aggregate)
+{
+  const struct tsdb_block *block;
+  const struct tsdb_block_header *header;
+  uint32_t b;
+  int result;
+  int fd;
+
+  memset(aggregate, 0, sizeof(*aggregate));
+  aggregate->min = INT32_MAX;
+  aggregate->max = INT32_MIN;
+
+  fd = -1;
+  result = 0;
+  for(b = first_block(series, from); b <= series->blocks; b++) {
+    if(b == series->blocks) {
+      block = &series->block;
+      if(block->header.count == 0) {
+        break;
+      }
+    } else {
+      block = &scratch;
+      if(fd < 0) {
+        fd = cfs_open(series->name, CFS_READ);
+      }
+      if(fd < 0 ||
+         read_block(fd, b, 0, &scratch.header, sizeof(scratch.header)) < 0) {
+        result = -1;
+        break;
+      }
+    }
+    header = &block->header;
+
+    if(header->t_first > to) {
+      break;
+    }
+    if(header->t_last < from) {
+      continue;
+    }
+
+    if(from <= header->t_first && header->t_last <= to) {
+      /* The whole block is in the range. */
+      aggregate->count += header->count;
+      aggregate->sum += header->sum;
+      if(header->v_min < aggregate->min) {
+        aggregate->min = header->v_min;
+      }
+      if(header->v_max > aggregate->max) {
+        aggregate->max = header->v_max;
+      }
+      aggregate->blocks_summarized++;
+      continue;
+    }
+
+    if(block == &scratch &&
+       read_block(fd, b, sizeof(scratch.header), scratch.payload,
+                  TSDB_PAYLOAD_SIZE) < 0) {
+      result = -1;
+      break;
+    }
+    aggregate_block(block, from, to, aggregate);
+  }
+
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  return result;
+}
+/*---------------------------------------------------------------------------*/
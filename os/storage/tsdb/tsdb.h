@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *	A compressed time-series store on top of CFS.
+ *
+ * A series is stored in one file as a sequence of fixed-size blocks,
+ * which should match the flash page size. Each block starts with a
+ * summary of its samples (the time range, the first value, and the
+ * minimum, maximum and sum of the values), followed by the remaining
+ * samples as a bit stream:
+ *
+ * - timestamps are encoded as the difference between consecutive
+ *   deltas, which takes a single bit for periodic samples;
+ * - values are XORed with the previous value, and only the bits that
+ *   differ are stored, reusing the previous bit window when possible.
+ *
+ * Samples are collected in RAM until a block is full, and blocks are
+ * only ever appended to the file. Flushing or closing a series seals
+ * the block, even if it is only partly used, and the next sample starts
+ * a new block. Applications should therefore flush rarely.
+ *
+ * A sparse index in RAM holds the first timestamp of every Nth block,
+ * where N doubles whenever the index is full. Range queries use it to
+ * find the first block, and aggregate queries take blocks that lie
+ * within the range from their summaries without decoding them.
+ *
+ * Only the portable CFS functions are used, so series can be stored in
+ * Coffee as well as in the host file system of the native platform. On
+ * Coffee, reserving the file with cfs_coffee_reserve() beforehand saves
+ * Coffee from extending it as it grows.
+ */
+
+#ifndef TSDB_H_
+#define TSDB_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+/* Bytes per block. Must be a multiple of 8. */
+#ifdef TSDB_CONF_BLOCK_SIZE
+#define TSDB_BLOCK_SIZE TSDB_CONF_BLOCK_SIZE
+#else
+#define TSDB_BLOCK_SIZE 256
+#endif
+
+/* Number of entries in the sparse index of each series. Must be even. */
+#ifdef TSDB_CONF_INDEX_SIZE
+#define TSDB_INDEX_SIZE TSDB_CONF_INDEX_SIZE
+#else
+#define TSDB_INDEX_SIZE 32
+#endif
+
+/* Size of the file name buffer, including the terminating zero. */
+#ifdef TSDB_CONF_NAME_LENGTH
+#define TSDB_NAME_LENGTH TSDB_CONF_NAME_LENGTH
+#else
+#define TSDB_NAME_LENGTH 16
+#endif
+
+struct tsdb_block_header {
+  int64_t sum;                /* Sum of the values */
+  uint32_t t_first;           /* Timestamp of the first sample */
+  uint32_t t_last;            /* Timestamp of the last sample */
+  int32_t v_first;            /* Value of the first sample */
+  int32_t v_min;              /* Smallest value */
+  int32_t v_max;              /* Largest value */
+  uint16_t count;             /* Number of samples */
+  uint16_t bits;              /* Length of the bit stream */
+};
+
+#define TSDB_PAYLOAD_SIZE (TSDB_BLOCK_SIZE - sizeof(struct tsdb_block_header) - 1)
+
+struct tsdb_block {
+  struct tsdb_block_header header;
+  uint8_t payload[TSDB_PAYLOAD_SIZE];
+  uint8_t marker;             /* Non-zero, so that Coffee keeps the block */
+};
+
+/* The state of the encoder or decoder of a block. */
+struct tsdb_codec {
+  uint32_t t_prev;            /* Previous timestamp */
+  uint32_t delta_prev;        /* Previous timestamp delta */
+  uint32_t v_prev;            /* Previous value */
+  uint8_t leading;            /* Leading zeros of the XOR window */
+  uint8_t trailing;           /* Trailing zeros of the XOR window */
+  uint16_t bits;              /* Position in the bit stream */
+};
+
+struct tsdb_series {
+  char name[TSDB_NAME_LENGTH];
+  uint16_t blocks;            /* Number of blocks in the file */
+  uint16_t index_count;       /* Number of sparse index entries */
+  uint16_t index_stride;      /* Blocks per sparse index entry */
+  uint32_t t_last;            /* Timestamp of the last sample */
+  uint32_t index[TSDB_INDEX_SIZE]; /* First timestamps of indexed blocks */
+  struct tsdb_codec codec;    /* Encoder of the open block */
+  struct tsdb_block block;    /* The open block */
+};
+
+struct tsdb_cursor {
+  struct tsdb_series *series;
+  uint32_t from;
+  uint32_t to;
+  uint16_t next_block;        /* Next block to read */
+  uint16_t remaining;         /* Samples left in the current block */
+  struct tsdb_codec codec;
+  struct tsdb_block block;
+};
+
+struct tsdb_aggregate {
+  uint32_t count;             /* Number of samples in the range */
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  uint16_t blocks_decoded;    /* Blocks whose samples were decoded */
+  uint16_t blocks_summarized; /* Blocks taken from their summaries */
+};
+
+/**
+ * \name Functions called from application programs
+ * @{
+ */
+
+/**
+ * \brief Open a series, creating it on the first flush.
+ * \param series The series.
+ * \param name The file name, at most TSDB_NAME_LENGTH - 1 characters.
+ * \return 0 on success, -1 on failure.
+ *
+ * The block summaries of an existing file are read to rebuild the
+ * sparse index, and new samples are appended after its last block.
+ */
+int tsdb_open(struct tsdb_series *series, const char *name);
+
+/**
+ * \brief Seal the open block and close a series.
+ * \param series The series.
+ * \return 0 on success, -1 if the open block could not be written.
+ */
+int tsdb_close(struct tsdb_series *series);
+
+/**
+ * \brief Append a sample to a series.
+ * \param series The series.
+ * \param t The timestamp, which must not be older than the previous one.
+ * \param value The value.
+ * \return 0 on success, -1 if the timestamp is out of order or a full
+ *         block could not be written.
+ */
+int tsdb_append(struct tsdb_series *series, uint32_t t, int32_t value);
+
+/**
+ * \brief Write the open block to the file.
+ * \param series The series.
+ * \return 0 on success, -1 on failure.
+ *
+ * The block is sealed, and the next sample starts a new block.
+ */
+int tsdb_flush(struct tsdb_series *series);
+
+/**
+ * \brief Remove the file of a series.
+ * \param series The series.
+ * \return 0 on success, -1 on failure.
+ *
+ * The series stays open and is empty afterwards.
+ */
+int tsdb_remove(struct tsdb_series *series);
+
+/**
+ * \brief Get the number of bytes that a series occupies in its file.
+ * \param series The series.
+ * \return The size of the sealed blocks.
+ */
+cfs_offset_t tsdb_size(struct tsdb_series *series);
+
+/**
+ * \brief Start iterating over the samples within a time range.
+ * \param series The series.
+ * \param cursor The cursor.
+ * \param from The first timestamp of the range.
+ * \param to The last timestamp of the range.
+ */
+void tsdb_range(struct tsdb_series *series, struct tsdb_cursor *cursor,
+                uint32_t from, uint32_t to);
+
+/**
+ * \brief Get the next sample of a range.
+ * \param cursor The cursor.
+ * \param t The timestamp of the sample.
+ * \param value The value of the sample.
+ * \return 1 if a sample was read, 0 at the end of the range, or -1
+ *         on failure.
+ */
+int tsdb_range_next(struct tsdb_cursor *cursor, uint32_t *t, int32_t *value);
+
+/**
+ * \brief Compute the count, minimum, maximum and sum of the values
+ *        within a time range.
+ * \param series The series.
+ * \param from The first timestamp of the range.
+ * \param to The last timestamp of the range.
+ * \param aggregate The result.
+ * \return 0 on success, -1 on failure.
+ */
+int tsdb_aggregate(struct tsdb_series *series, uint32_t from, uint32_t to,
+                   struct tsdb_aggregate *aggregate);
+
+/** @} */
+
+#endif /* TSDB_H_ */
@@ -54,10 +54,15 @@
  *
  * It is the platform/CPU developer's responsibility to expand this macro to
  * a function that creates a memory barrier. Calling this macro will otherwise
- * not generate any code.
+ * not generate any code; with GCC-compatible compilers it still keeps the
+ * compiler from moving memory accesses across it.
  */
+#if defined(__GNUC__)
+#define memory_barrier() __asm__ __volatile__("" : : : "memory")
+#else
 #define memory_barrier()
 #endif
+#endif
 /*---------------------------------------------------------------------------*/
 #endif /* MEMORY_BARRIER_H_ */
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+/*
+ * Random appends, removals and reads on a set of Coffee files, checked
+ * against the lengths and contents the files should have. The storage
+ * fills up, so the garbage collector runs repeatedly, both on demand
+ * and, if enabled, in the background between batches of operations.
+ */
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_stress_test_process, "Coffee stress test process");
+AUTOSTART_PROCESSES(&coffee_stress_test_process);
+/*---------------------------------------------------------------------------*/
+#define FILE_COUNT      24
+#define MAX_APPEND      350
+/* Larger than COFFEE_DYN_SIZE on native, so that files get extended */
+#define MAX_FILE_SIZE   24000
+#define ROUNDS          100
+#define OPS_PER_ROUND   200
+/* Long enough for the background GC to see an idle interval */
+#define ROUND_PAUSE     (3 * COFFEE_CONF_GC_INTERVAL)
+
+/* The expected length of each file, and the generation that sets its
+   contents, which changes when the file is removed. */
+static uint16_t file_len[FILE_COUNT];
+static uint8_t file_gen[FILE_COUNT];
+
+static unsigned long seed = 12345;
+static unsigned errors;
+static unsigned full;
+static uint8_t buf[MAX_APPEND];
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+rnd(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+/*---------------------------------------------------------------------------*/
+/* Never zero, since Coffee determines the file size from the last
+   non-zero byte. */
+static uint8_t
+file_byte(unsigned file, unsigned offset)
+{
+  return ((file * 37 + file_gen[file] * 13 + offset * 7) & 0xff) | 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+file_name(char *name, unsigned file)
+{
+  sprintf(name, "f%u", file);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_file(unsigned file)
+{
+  char name[8];
+  int fd, r, i;
+  unsigned offset;
+
+  file_name(name, file);
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return file_len[file] == 0;
+  }
+
+  offset = 0;
+  while((r = cfs_read(fd, buf, sizeof(buf))) > 0) {
+    for(i = 0; i < r; i++, offset++) {
+      if(buf[i] != file_byte(file, offset)) {
+        cfs_close(fd);
+        return 0;
+      }
+    }
+  }
+  cfs_close(fd);
+
+  return offset == file_len[file];
+}
+/*---------------------------------------------------------------------------*/
+static void
+record_error(unsigned op, const char *what, unsigned file)
+{
+  if(errors++ == 0) {
+    printf("Operation %u: %s of f%u failed (%u bytes expected)\n",
+           op, what, file, file_len[file]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_ops(unsigned first_op)
+{
+  char name[8];
+  unsigned op, kind, file, len, i;
+  int fd, r;
+
+  for(op = first_op; op < first_op + OPS_PER_ROUND; op++) {
+    kind = rnd() % 10;
+    file = rnd() % FILE_COUNT;
+    file_name(name, file);
+
+    if(kind < 4) {
+      len = rnd() % MAX_APPEND + 1;
+      if(file_len[file] + len > MAX_FILE_SIZE) {
+        continue;
+      }
+      for(i = 0; i < len; i++) {
+        buf[i] = file_byte(file, file_len[file] + i);
+      }
+      fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+      r = fd < 0 ? -1 : cfs_write(fd, buf, len);
+      cfs_close(fd);
+      if(r == len) {
+        file_len[file] += len;
+      } else if(r >= 0 || (fd >= 0 && file_len[file] == 0)) {
+        record_error(op, "append", file);
+      } else {
+        /* No room left to create or to extend the file, which is then
+           left as it was. */
+        full++;
+      }
+    } else if(kind < 5) {
+      if(cfs_remove(name) != 0 && file_len[file] > 0) {
+        record_error(op, "removal", file);
+      }
+      file_len[file] = 0;
+      file_gen[file]++;
+    } else if(!check_file(file)) {
+      record_error(op, "read", file);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_random_ops,
+                   "Random appends, removals and reads keep file contents");
+UNIT_TEST(test_random_ops)
+{
+  unsigned file;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(errors == 0);
+
+  for(file = 0; file < FILE_COUNT; file++) {
+    UNIT_TEST_ASSERT(check_file(file));
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_stress_test_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned round;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  cfs_coffee_format();
+
+  for(round = 0; round < ROUNDS; round++) {
+    run_ops(round * OPS_PER_ROUND);
+
+    etimer_set(&et, ROUND_PAUSE);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  printf("%u appends failed on a full storage\n", full);
+  UNIT_TEST_RUN(test_random_ops);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
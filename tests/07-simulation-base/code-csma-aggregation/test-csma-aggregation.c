@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/simple-udp.h"
+#include "net/ipv6/sicslowpan.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(csma_aggregation_test_process, "CSMA aggregation test process");
+AUTOSTART_PROCESSES(&csma_aggregation_test_process);
+/*---------------------------------------------------------------------------*/
+#define UDP_PORT        5678
+#define MAX_FRAMES      4
+#define SHORT_LEN       8
+#define LONG_LEN        70
+
+/* Frames sent by the radio, replayed to the stack as if a peer sent them */
+static struct {
+  uint8_t data[PACKETBUF_SIZE];
+  uint16_t len;
+  uint8_t dispatch;
+} frames[MAX_FRAMES];
+static int frame_count;
+
+/* Payloads delivered by UDP, in order */
+static struct {
+  uint8_t data[LONG_LEN];
+  uint16_t len;
+} received[MAX_FRAMES];
+static int received_count;
+
+static struct simple_udp_connection udp_conn;
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A radio that keeps the frames it sends. CSMA calls prepare() with the
+ * frame still in packetbuf, which gives the dispatch of the payload. */
+static int
+radio_init(void)
+{
+  return 0;
+}
+static int
+radio_prepare(const void *payload, unsigned short payload_len)
+{
+  if(frame_count < MAX_FRAMES && payload_len <= PACKETBUF_SIZE) {
+    memcpy(frames[frame_count].data, payload, payload_len);
+    frames[frame_count].len = payload_len;
+    frames[frame_count].dispatch = *(uint8_t *)packetbuf_dataptr();
+    frame_count++;
+  }
+  return 0;
+}
+static int
+radio_transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  radio_prepare(payload, payload_len);
+  return radio_transmit(payload_len);
+}
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+static int
+radio_channel_clear(void)
+{
+  return 1;
+}
+static int
+radio_receiving_packet(void)
+{
+  return 0;
+}
+static int
+radio_pending_packet(void)
+{
+  return 0;
+}
+static int
+radio_on(void)
+{
+  return 0;
+}
+static int
+radio_off(void)
+{
+  return 0;
+}
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+const struct radio_driver test_radio_driver = {
+  radio_init,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_channel_clear,
+  radio_receiving_packet,
+  radio_pending_packet,
+  radio_on,
+  radio_off,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+udp_rx_callback(struct simple_udp_connection *c,
+                const uip_ipaddr_t *sender_addr,
+                uint16_t sender_port,
+                const uip_ipaddr_t *receiver_addr,
+                uint16_t receiver_port,
+                const uint8_t *data,
+                uint16_t datalen)
+{
+  if(received_count < MAX_FRAMES && datalen <= LONG_LEN) {
+    memcpy(received[received_count].data, data, datalen);
+    received[received_count].len = datalen;
+    received_count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send two packets of len bytes filled with 1 and 2 to all nodes. Both
+ * are queued before CSMA gets to send the first. */
+static void
+send_pair(uint16_t len)
+{
+  static uint8_t buf[LONG_LEN];
+  uip_ipaddr_t addr;
+  uint8_t i;
+
+  frame_count = 0;
+  received_count = 0;
+  uip_create_linklocal_allnodes_mcast(&addr);
+  for(i = 1; i <= 2; i++) {
+    memset(buf, i, len);
+    simple_udp_sendto(&udp_conn, buf, len, &addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Feed the sent frames back to the MAC, as received from another node */
+static void
+replay_frames(void)
+{
+  linkaddr_t addr;
+  linkaddr_t peer;
+  int i;
+
+  linkaddr_copy(&addr, &linkaddr_node_addr);
+  linkaddr_copy(&peer, &linkaddr_node_addr);
+  peer.u8[LINKADDR_SIZE - 1] ^= 0xff;
+  linkaddr_set_node_addr(&peer);
+  for(i = 0; i < frame_count; i++) {
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), frames[i].data, frames[i].len);
+    packetbuf_set_datalen(frames[i].len);
+    NETSTACK_MAC.input();
+  }
+  linkaddr_set_node_addr(&addr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+received_pair(uint16_t len)
+{
+  uint8_t i;
+  uint16_t j;
+
+  if(received_count != 2) {
+    return 0;
+  }
+  for(i = 0; i < 2; i++) {
+    if(received[i].len != len) {
+      return 0;
+    }
+    for(j = 0; j < len; j++) {
+      if(received[i].data[j] != i + 1) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_aggregated, "Short packets share a frame");
+UNIT_TEST(test_aggregated)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(frame_count == 1);
+  UNIT_TEST_ASSERT(frames[0].dispatch == SICSLOWPAN_DISPATCH_AGGREGATE);
+
+  replay_frames();
+  UNIT_TEST_ASSERT(received_pair(SHORT_LEN));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_separate, "Long packets are sent in their own frames");
+UNIT_TEST(test_separate)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(frame_count == 2);
+  UNIT_TEST_ASSERT(frames[0].dispatch != SICSLOWPAN_DISPATCH_AGGREGATE);
+  UNIT_TEST_ASSERT(frames[1].dispatch != SICSLOWPAN_DISPATCH_AGGREGATE);
+
+  replay_frames();
+  UNIT_TEST_ASSERT(received_pair(LONG_LEN));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_aggregation_test_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_rx_callback);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  send_pair(SHORT_LEN);
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(test_aggregated);
+
+  send_pair(LONG_LEN);
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(test_separate);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/mac/csma/csma.h"
+#include "services/unit-test/unit-test.h"
+
+#include <stdint.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(csma_classes_test_process, "CSMA traffic classes test process");
+AUTOSTART_PROCESSES(&csma_classes_test_process);
+/*---------------------------------------------------------------------------*/
+#define MAX_SENT        16
+
+/* Packet ids: class in the tens, sequence number within the class */
+#define CONTROL(n)      (10 + (n))
+#define LATENCY(n)      (20 + (n))
+#define BULK(n)         (30 + (n))
+
+/* Completed packets, in the order CSMA reported them */
+static struct {
+  uint8_t id;
+  int status;
+} sent[MAX_SENT];
+static int sent_count;
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  if(sent_count < MAX_SENT) {
+    sent[sent_count].id = (uint8_t)(uintptr_t)ptr;
+    sent[sent_count].status = status;
+    sent_count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Queue a broadcast packet carrying its id, tagged with the class of
+ * the id */
+static void
+enqueue(uint8_t id)
+{
+  packetbuf_clear();
+  packetbuf_copyfrom(&id, sizeof(id));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_null);
+  packetbuf_set_attr(PACKETBUF_ATTR_TRAFFIC_CLASS,
+                     id / 10 - 1 + PACKETBUF_ATTR_TRAFFIC_CLASS_CONTROL);
+  NETSTACK_MAC.send(packet_sent, (void *)(uintptr_t)id);
+}
+/*---------------------------------------------------------------------------*/
+static int
+sent_in_order(const uint8_t *ids, int count, int status)
+{
+  int i;
+  if(sent_count != count) {
+    return 0;
+  }
+  for(i = 0; i < count; i++) {
+    if(sent[i].id != ids[i] || sent[i].status != status) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_weighted, "Weighted round-robin between classes");
+UNIT_TEST(test_weighted)
+{
+  /* The head is sent first. Then, with weights { 4, 2, 1 }, every round
+   * serves up to four control, two latency and one bulk packet, and a
+   * new round starts once the backlogged classes used their credits. */
+  static const uint8_t order[] = {
+    BULK(1), CONTROL(1), CONTROL(2), CONTROL(3), CONTROL(4),
+    LATENCY(1), LATENCY(2), BULK(2),
+    CONTROL(5), LATENCY(3), BULK(3),
+    BULK(4)
+  };
+  const struct csma_class_stats *control = csma_output_class_stats(0);
+  const struct csma_class_stats *latency = csma_output_class_stats(1);
+  const struct csma_class_stats *bulk = csma_output_class_stats(2);
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(sent_in_order(order, sizeof(order), MAC_TX_OK));
+
+  UNIT_TEST_ASSERT(control->enqueued == 5 && control->sent == 5);
+  UNIT_TEST_ASSERT(latency->enqueued == 3 && latency->sent == 3);
+  UNIT_TEST_ASSERT(bulk->enqueued == 4 && bulk->sent == 4);
+  UNIT_TEST_ASSERT(control->peak == 5 && latency->peak == 3 && bulk->peak == 4);
+  UNIT_TEST_ASSERT(control->queued == 0 && latency->queued == 0
+                   && bulk->queued == 0);
+  UNIT_TEST_ASSERT(csma_output_class_stats(3) == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_lifetime, "Expired packets are dropped");
+UNIT_TEST(test_lifetime)
+{
+  /* Latency-sensitive packets live CLOCK_SECOND / 10; bulk ones have
+   * no lifetime */
+  const struct csma_class_stats *latency = csma_output_class_stats(1);
+  const struct csma_class_stats *bulk = csma_output_class_stats(2);
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(sent_count == 3);
+  UNIT_TEST_ASSERT(sent[0].id == LATENCY(4) && sent[0].status == MAC_TX_ERR);
+  UNIT_TEST_ASSERT(sent[1].id == LATENCY(5) && sent[1].status == MAC_TX_ERR);
+  UNIT_TEST_ASSERT(sent[2].id == BULK(5) && sent[2].status == MAC_TX_OK);
+
+  UNIT_TEST_ASSERT(latency->expired == 2 && latency->sent == 3);
+  UNIT_TEST_ASSERT(latency->queued == 0);
+  UNIT_TEST_ASSERT(bulk->expired == 0 && bulk->sent == 5);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_classes_test_process, ev, data)
+{
+  static struct etimer et;
+  static int i;
+  clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  /* Fill the queue before CSMA gets to send anything */
+  for(i = 1; i <= 4; i++) {
+    enqueue(BULK(i));
+  }
+  for(i = 1; i <= 3; i++) {
+    enqueue(LATENCY(i));
+  }
+  for(i = 1; i <= 5; i++) {
+    enqueue(CONTROL(i));
+  }
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(test_weighted);
+
+  /* Keep CSMA from sending until the latency-sensitive packets expired */
+  sent_count = 0;
+  enqueue(LATENCY(4));
+  enqueue(BULK(5));
+  enqueue(LATENCY(5));
+  start = clock_time();
+  while(clock_time() - start <= CLOCK_SECOND / 5);
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(test_lifetime);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "jsonstream.h"
+#include "jsonpath.h"
+#include "jsontree.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(json_test_process, "JSON test process");
+AUTOSTART_PROCESSES(&json_test_process);
+/*---------------------------------------------------------------------------*/
+static char trace[512];
+static char expected[512];
+static struct jsonstream_state stream;
+static struct jsonpath_matcher matcher;
+/*---------------------------------------------------------------------------*/
+static const char document[] =
+  "{\"bn\": \"/3303/0/\", \"bt\": 1520000000,\n"
+  " \"e\": [{\"n\": \"5700\", \"v\": -21.5},\n"
+  "       {\"n\": \"5701\", \"sv\": \"Cel\\u00b0\\\"s\\\"\"},\n"
+  "       {\"n\": \"5850\", \"bv\": true, \"x\": [1, [], {}, null]}],\n"
+  " \"ok\": false}";
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+record_token(struct jsonstream_state *state, int type)
+{
+  size_t len;
+
+  len = strlen(trace);
+  if(type == '{' || type == '}' || type == '[' || type == ']') {
+    snprintf(trace + len, sizeof(trace) - len, "%c%d ", type,
+             jsonstream_get_depth(state));
+  } else {
+    snprintf(trace + len, sizeof(trace) - len, "%c%d=%s ", type,
+             jsonstream_get_depth(state), jsonstream_get_value(state));
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Tokenize the document in fragments of a given size, or of random
+   sizes if the size is 0. */
+static int
+tokenize(const char *json, int fragment)
+{
+  int len;
+  int pos;
+  int n;
+
+  trace[0] = '\0';
+  jsonstream_setup(&stream, record_token, NULL);
+  len = strlen(json);
+  for(pos = 0; pos < len; pos += n) {
+    n = fragment > 0 ? fragment : 1 + rand() % 7;
+    if(n > len - pos) {
+      n = len - pos;
+    }
+    if(jsonstream_feed(&stream, json + pos, n) != JSON_ERROR_OK) {
+      return stream.error;
+    }
+  }
+  return jsonstream_finish(&stream);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_tokens, "Tokenizer");
+UNIT_TEST(test_tokens)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(tokenize(document, sizeof(document)) == JSON_ERROR_OK);
+  UNIT_TEST_ASSERT(strcmp(trace,
+                          "{0 N1=bn \"1=/3303/0/ N1=bt 01=1520000000 "
+                          "N1=e [1 {2 N3=n \"3=5700 N3=v 03=-21.5 }2 "
+                          "{2 N3=n \"3=5701 N3=sv \"3=Cel\xc2\xb0\"s\" }2 "
+                          "{2 N3=n \"3=5850 N3=bv t3=true N3=x [3 "
+                          "04=1 [4 ]4 {4 }4 n4=null ]3 }2 ]1 "
+                          "N1=ok f1=false }0 ") == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_fragments, "Tokenizer with fragments");
+UNIT_TEST(test_fragments)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(tokenize(document, sizeof(document)) == JSON_ERROR_OK);
+  strcpy(expected, trace);
+
+  UNIT_TEST_ASSERT(tokenize(document, 1) == JSON_ERROR_OK);
+  UNIT_TEST_ASSERT(strcmp(trace, expected) == 0);
+  for(i = 0; i < 20; i++) {
+    UNIT_TEST_ASSERT(tokenize(document, 0) == JSON_ERROR_OK);
+    UNIT_TEST_ASSERT(strcmp(trace, expected) == 0);
+  }
+
+  /* A number at the end is only complete when the document ends. */
+  UNIT_TEST_ASSERT(tokenize(" 42", 1) == JSON_ERROR_OK);
+  UNIT_TEST_ASSERT(strcmp(trace, "00=42 ") == 0);
+  UNIT_TEST_ASSERT(jsonstream_get_value_as_long(&stream) == 42);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_errors, "Tokenizer errors");
+UNIT_TEST(test_errors)
+{
+  char deep[2 * JSONSTREAM_MAX_DEPTH + 3];
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(tokenize("{\"a\":}", 0) == JSON_ERROR_UNEXPECTED_END_OF_OBJECT);
+  UNIT_TEST_ASSERT(tokenize("[1,]", 0) == JSON_ERROR_UNEXPECTED_END_OF_ARRAY);
+  UNIT_TEST_ASSERT(tokenize("{\"a\" 1}", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("{1:2}", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("[1 2]", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("[tru]", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("[\"a\\x\"]", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("{\"a\": [1}", 0) == JSON_ERROR_UNEXPECTED_END_OF_OBJECT);
+  UNIT_TEST_ASSERT(tokenize("{} {}", 0) == JSON_ERROR_UNEXPECTED_OBJECT);
+  UNIT_TEST_ASSERT(tokenize("{\"a\": 1", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("\"abc", 0) == JSON_ERROR_SYNTAX);
+  UNIT_TEST_ASSERT(tokenize("", 0) == JSON_ERROR_SYNTAX);
+
+  /* The open containers are limited. */
+  memset(deep, '[', JSONSTREAM_MAX_DEPTH);
+  memset(deep + JSONSTREAM_MAX_DEPTH, ']', JSONSTREAM_MAX_DEPTH);
+  deep[2 * JSONSTREAM_MAX_DEPTH] = '\0';
+  UNIT_TEST_ASSERT(tokenize(deep, 0) == JSON_ERROR_OK);
+  memset(deep, '[', JSONSTREAM_MAX_DEPTH + 1);
+  memset(deep + JSONSTREAM_MAX_DEPTH + 1, ']', JSONSTREAM_MAX_DEPTH + 1);
+  deep[2 * JSONSTREAM_MAX_DEPTH + 2] = '\0';
+  UNIT_TEST_ASSERT(tokenize(deep, 0) == JSON_ERROR_SYNTAX);
+
+  /* Long values are truncated, but still delimited correctly. */
+  UNIT_TEST_ASSERT(tokenize("[\"0123456789012345678901234567890123456789\", 7]",
+                            3) == JSON_ERROR_OK);
+  UNIT_TEST_ASSERT(strcmp(trace, "[0 \"1=0123456789012345678901234567890 "
+                          "01=7 ]0 ") == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+struct record {
+  char name[8];
+  long value;
+  int has_value;
+};
+
+static struct record records[4];
+static int record_count;
+static char base_name[16];
+static int ok_value;
+static int null_value;
+static int document_ends;
+
+static void
+on_base_name(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  strncpy(base_name, jsonstream_get_value(&m->stream), sizeof(base_name) - 1);
+}
+
+static void
+on_record(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  if(type == '}') {
+    record_count++;
+  } else if(type == '{' && record_count < 4) {
+    memset(&records[record_count], 0, sizeof(records[0]));
+  }
+}
+
+static void
+on_name(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  strncpy(records[record_count].name, jsonstream_get_value(&m->stream),
+          sizeof(records[0].name) - 1);
+}
+
+static void
+on_value(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  records[record_count].value = jsonstream_get_value_as_long(&m->stream);
+  records[record_count].has_value = 1;
+}
+
+static void
+on_ok(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  ok_value = type;
+}
+
+static void
+on_null(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  null_value = type;
+}
+
+static void
+on_document(struct jsonpath_matcher *m, struct jsonpath *path, int type)
+{
+  if(type == '}') {
+    document_ends++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_paths, "Path matcher");
+UNIT_TEST(test_paths)
+{
+  static struct jsonpath paths[8];
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], "bn", on_base_name) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[1], "e[*]", on_record) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[2], "e[*].n", on_name) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[3], "*[0].v", on_value) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[4], "ok", on_ok) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[5], "", on_document) == 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[6], "e[2].x[3]", on_null) == 0);
+  /* This must not match the member names of the records. */
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[7], "n", on_name) == 0);
+
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], "e.", on_ok) < 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], "e[x]", on_ok) < 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], ".e", on_ok) < 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], "a.b.c.d.e", on_ok) < 0);
+  UNIT_TEST_ASSERT(jsonpath_compile(&paths[0], "bn", on_base_name) == 0);
+
+  memset(records, 0, sizeof(records));
+  record_count = 0;
+  ok_value = 0;
+  null_value = 0;
+  document_ends = 0;
+
+  /* Feed the document one byte at a time. */
+  jsonpath_setup(&matcher, NULL);
+  for(i = 0; i < 8; i++) {
+    jsonpath_add(&matcher, &paths[i]);
+  }
+  for(i = 0; document[i] != '\0'; i++) {
+    UNIT_TEST_ASSERT(jsonpath_feed(&matcher, &document[i], 1) == JSON_ERROR_OK);
+  }
+  UNIT_TEST_ASSERT(jsonpath_finish(&matcher) == JSON_ERROR_OK);
+
+  UNIT_TEST_ASSERT(strcmp(base_name, "/3303/0/") == 0);
+  UNIT_TEST_ASSERT(record_count == 3);
+  UNIT_TEST_ASSERT(strcmp(records[0].name, "5700") == 0);
+  UNIT_TEST_ASSERT(strcmp(records[1].name, "5701") == 0);
+  UNIT_TEST_ASSERT(strcmp(records[2].name, "5850") == 0);
+  UNIT_TEST_ASSERT(records[0].has_value && records[0].value == -21);
+  UNIT_TEST_ASSERT(!records[1].has_value && !records[2].has_value);
+  UNIT_TEST_ASSERT(ok_value == JSON_TYPE_FALSE);
+  UNIT_TEST_ASSERT(null_value == JSON_TYPE_NULL);
+  UNIT_TEST_ASSERT(document_ends == 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static int serialized_len;
+
+static int
+serialize_putchar(int c)
+{
+  if(serialized_len < sizeof(expected)) {
+    expected[serialized_len++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static int
+output_samples(struct jsontree_context *js_ctx)
+{
+  /* Output one sample per call, like a sensor history would */
+  js_ctx->putchar(js_ctx->callback_state == 0 ? '[' : ',');
+  jsontree_write_int(js_ctx, -1000 * js_ctx->callback_state - 7);
+  if(++js_ctx->callback_state < 5) {
+    return 1;
+  }
+  js_ctx->putchar(']');
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct jsontree_string name = JSONTREE_STRING("a \"quoted\" name");
+static struct jsontree_uint uptime = { JSON_TYPE_UINT, 4294967295U };
+static struct jsontree_int offset = { JSON_TYPE_INT, -42 };
+static struct jsontree_callback samples = JSONTREE_CALLBACK(output_samples, NULL);
+static struct jsontree_string unit = JSONTREE_STRING("Cel");
+JSONTREE_ARRAY(list, 3);
+JSONTREE_OBJECT(sensor,
+                JSONTREE_PAIR("unit", &unit),
+                JSONTREE_PAIR("samples", &samples),
+                JSONTREE_PAIR("list", &list));
+JSONTREE_OBJECT(tree,
+                JSONTREE_PAIR("name", &name),
+                JSONTREE_PAIR("uptime", &uptime),
+                JSONTREE_PAIR("offset", &offset),
+                JSONTREE_PAIR("sensor", &sensor),
+                JSONTREE_PAIR("", &unit));
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_chunks, "Chunked serializer");
+UNIT_TEST(test_chunks)
+{
+  struct jsontree_context js_ctx;
+  uint32_t pos;
+  int size;
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  jsontree_valuelist[0] = (struct jsontree_value *)&offset;
+  jsontree_valuelist[1] = (struct jsontree_value *)&samples;
+  jsontree_valuelist[2] = (struct jsontree_value *)&unit;
+
+  /* Reference output through the per-character interface */
+  serialized_len = 0;
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&tree, serialize_putchar);
+  while(jsontree_print_next(&js_ctx));
+  UNIT_TEST_ASSERT(serialized_len > 64 && serialized_len < sizeof(expected));
+
+  /* Consecutive chunks of every size reproduce the output */
+  for(size = 1; size <= 64; size++) {
+    jsontree_setup_chunked(&js_ctx, (struct jsontree_value *)&tree);
+    pos = 0;
+    do {
+      len = jsontree_print_chunk(&js_ctx, &trace[pos], size, pos);
+      UNIT_TEST_ASSERT(len == size || jsontree_print_done(&js_ctx));
+      pos += len;
+      UNIT_TEST_ASSERT(pos <= serialized_len);
+    } while(!jsontree_print_done(&js_ctx));
+    UNIT_TEST_ASSERT(pos == serialized_len);
+    UNIT_TEST_ASSERT(memcmp(trace, expected, serialized_len) == 0);
+  }
+
+  /* Blocks requested out of order, repeated, or after a gap */
+  jsontree_setup_chunked(&js_ctx, (struct jsontree_value *)&tree);
+  for(pos = 0; pos < 4 * 16; pos += 16) {
+    len = jsontree_print_chunk(&js_ctx, trace, 16, (pos * 3) % 64);
+    UNIT_TEST_ASSERT(len == 16);
+    UNIT_TEST_ASSERT(memcmp(trace, &expected[(pos * 3) % 64], len) == 0);
+    len = jsontree_print_chunk(&js_ctx, trace, 16, (pos * 3) % 64);
+    UNIT_TEST_ASSERT(len == 16);
+    UNIT_TEST_ASSERT(memcmp(trace, &expected[(pos * 3) % 64], len) == 0);
+  }
+  len = jsontree_print_chunk(&js_ctx, trace, 64, serialized_len - 5);
+  UNIT_TEST_ASSERT(len == 5 && jsontree_print_done(&js_ctx));
+  UNIT_TEST_ASSERT(memcmp(trace, &expected[serialized_len - 5], len) == 0);
+  len = jsontree_print_chunk(&js_ctx, trace, 64, serialized_len + 3);
+  UNIT_TEST_ASSERT(len == 0 && jsontree_print_done(&js_ctx));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(json_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_tokens);
+  UNIT_TEST_RUN(test_fragments);
+  UNIT_TEST_RUN(test_errors);
+  UNIT_TEST_RUN(test_paths);
+  UNIT_TEST_RUN(test_chunks);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
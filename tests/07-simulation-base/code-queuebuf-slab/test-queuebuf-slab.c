@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(queuebuf_slab_test_process, "Queuebuf slab test process");
+AUTOSTART_PROCESSES(&queuebuf_slab_test_process);
+/*---------------------------------------------------------------------------*/
+#define MAX_FRAMES      QUEUEBUF_CONF_NUM
+
+/* A queued frame and what it should hold. Frame id has its data bytes
+ * derived from id, the id as sequence number, a receiver address if id
+ * is odd, and a few more attributes if extra is set. */
+static struct {
+  struct queuebuf *qb;
+  uint16_t len;
+  uint8_t id;
+  uint8_t extra;
+} frames[MAX_FRAMES];
+static int frame_count;
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_receiver(linkaddr_t *addr, uint8_t id)
+{
+  memset(addr, id, sizeof(linkaddr_t));
+}
+/*---------------------------------------------------------------------------*/
+/* Put frame id in packetbuf */
+static void
+fill(uint8_t id, uint16_t len, uint8_t extra)
+{
+  uint8_t *data;
+  linkaddr_t addr;
+  uint16_t i;
+
+  packetbuf_clear();
+  data = packetbuf_dataptr();
+  for(i = 0; i < len; i++) {
+    data[i] = id * 31 + i;
+  }
+  packetbuf_set_datalen(len);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, id);
+  if(id & 1) {
+    set_receiver(&addr, id);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+  }
+  if(extra) {
+    packetbuf_set_attr(PACKETBUF_ATTR_CHANNEL, 11 + id);
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, 100 + id);
+    packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, 1000 + id);
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS, 3);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Queue frame id, returns 0 if there is no room */
+static int
+add(uint8_t id, uint16_t len)
+{
+  struct queuebuf *qb;
+
+  if(frame_count == MAX_FRAMES) {
+    return 0;
+  }
+  fill(id, len, 0);
+  qb = queuebuf_new_from_packetbuf();
+  if(qb == NULL) {
+    return 0;
+  }
+  frames[frame_count].qb = qb;
+  frames[frame_count].len = len;
+  frames[frame_count].id = id;
+  frames[frame_count].extra = 0;
+  frame_count++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_frame(int index)
+{
+  queuebuf_free(frames[index].qb);
+  memmove(&frames[index], &frames[index + 1],
+          (frame_count - index - 1) * sizeof(frames[0]));
+  frame_count--;
+}
+/*---------------------------------------------------------------------------*/
+/* Does a queued frame hold what it should, both through the accessors
+ * and once copied back to packetbuf? */
+static int
+frame_is_intact(int index)
+{
+  struct queuebuf *qb = frames[index].qb;
+  uint8_t id = frames[index].id;
+  uint16_t len = frames[index].len;
+  uint8_t extra = frames[index].extra;
+  const uint8_t *data;
+  linkaddr_t addr;
+  uint16_t i;
+
+  if(queuebuf_datalen(qb) != len
+     || queuebuf_attr(qb, PACKETBUF_ATTR_MAC_SEQNO) != id
+     || queuebuf_attr(qb, PACKETBUF_ATTR_RSSI) != (extra ? 100 + id : 0)) {
+    return 0;
+  }
+  data = queuebuf_dataptr(qb);
+  for(i = 0; i < len; i++) {
+    if(data[i] != (uint8_t)(id * 31 + i)) {
+      return 0;
+    }
+  }
+
+  queuebuf_to_packetbuf(qb);
+  if(packetbuf_datalen() != len
+     || memcmp(packetbuf_dataptr(), data, len) != 0
+     || packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) != id) {
+    return 0;
+  }
+  if(extra
+     && (packetbuf_attr(PACKETBUF_ATTR_CHANNEL) != 11 + id
+         || packetbuf_attr(PACKETBUF_ATTR_RSSI) != 100 + id
+         || packetbuf_attr(PACKETBUF_ATTR_TIMESTAMP) != 1000 + id
+         || packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) != 3)) {
+    return 0;
+  }
+  if(id & 1) {
+    set_receiver(&addr, id);
+  } else {
+    linkaddr_copy(&addr, &linkaddr_null);
+  }
+  return linkaddr_cmp(queuebuf_addr(qb, PACKETBUF_ADDR_RECEIVER), &addr)
+    && linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &addr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+all_intact(void)
+{
+  int i;
+  for(i = 0; i < frame_count; i++) {
+    if(!frame_is_intact(i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+find(uint8_t id)
+{
+  int i;
+  for(i = 0; i < frame_count; i++) {
+    if(frames[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_fill, "Frames of mixed sizes fill the slab");
+UNIT_TEST(test_fill)
+{
+  static const uint16_t lens[] = { 12, 40, 7, 64, 25, 90 };
+  uint8_t id;
+
+  UNIT_TEST_BEGIN();
+
+  for(id = 1; id < MAX_FRAMES; id++) {
+    if(!add(id, lens[(id - 1) % (sizeof(lens) / sizeof(lens[0]))])) {
+      break;
+    }
+  }
+  /* The slab, not the queuebufs, runs out */
+  UNIT_TEST_ASSERT(id < MAX_FRAMES);
+  UNIT_TEST_ASSERT(frame_count > 4);
+  UNIT_TEST_ASSERT(all_intact());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_compact, "Freed space is reused after compaction");
+UNIT_TEST(test_compact)
+{
+  UNIT_TEST_BEGIN();
+
+  /* Leave holes in the middle of the slab */
+  remove_frame(find(2));
+  remove_frame(find(5));
+  UNIT_TEST_ASSERT(all_intact());
+
+  /* Only fits once the holes are gathered */
+  UNIT_TEST_ASSERT(add(20, 40));
+  UNIT_TEST_ASSERT(all_intact());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_grow, "Grown frames and the others survive moves");
+UNIT_TEST(test_grow)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* The first frame grows beyond the free space at the end of the slab:
+   * it is swapped with all frames that follow it */
+  i = find(1);
+  fill(1, 80, 0);
+  UNIT_TEST_ASSERT(queuebuf_update_from_packetbuf(frames[i].qb));
+  frames[i].len = 80;
+  UNIT_TEST_ASSERT(all_intact());
+
+  /* Grow another one with attributes only, after making a hole */
+  remove_frame(find(3));
+  i = find(4);
+  queuebuf_to_packetbuf(frames[i].qb);
+  fill(4, frames[i].len, 1);
+  UNIT_TEST_ASSERT(queuebuf_update_attr_from_packetbuf(frames[i].qb));
+  frames[i].extra = 1;
+  UNIT_TEST_ASSERT(all_intact());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_no_room, "A frame that cannot grow is kept");
+UNIT_TEST(test_no_room)
+{
+  int i;
+  int numfree;
+  uint8_t id;
+
+  UNIT_TEST_BEGIN();
+
+  /* Use up the slab with short frames */
+  for(id = 30; add(id, 12); id++);
+  UNIT_TEST_ASSERT(frame_count < MAX_FRAMES);
+
+  i = find(6);
+  fill(6, PACKETBUF_SIZE, 1);
+  UNIT_TEST_ASSERT(!queuebuf_update_from_packetbuf(frames[i].qb));
+  UNIT_TEST_ASSERT(all_intact());
+
+  /* Everything is released */
+  while(frame_count > 0) {
+    remove_frame(0);
+  }
+  numfree = queuebuf_numfree();
+  UNIT_TEST_ASSERT(numfree > 0);
+  UNIT_TEST_ASSERT(add(1, PACKETBUF_SIZE));
+  UNIT_TEST_ASSERT(all_intact());
+  remove_frame(0);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == numfree);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(queuebuf_slab_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_fill);
+  UNIT_TEST_RUN(test_compact);
+  UNIT_TEST_RUN(test_grow);
+  UNIT_TEST_RUN(test_no_room);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/ipv6/simple-udp.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(rfrag_test_process, "RFRAG test process");
+AUTOSTART_PROCESSES(&rfrag_test_process);
+/*---------------------------------------------------------------------------*/
+#define MAX_FRAMES      40
+#define FRAME_PAYLOAD   44
+#define UDP_PORT        5683
+
+/* The frames passed to the MAC layer */
+static struct frame {
+  uint8_t data[PACKETBUF_SIZE];
+  uint16_t len;
+} frames[MAX_FRAMES];
+static int frame_count;
+
+static const linkaddr_t peer = { { 0x02, 0x00, 0x00, 0x00,
+                                   0x00, 0x00, 0x00, 0x02 } };
+static struct simple_udp_connection udp_conn;
+static uint8_t received[200];
+static uint16_t received_len;
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  if(frame_count < MAX_FRAMES) {
+    memcpy(frames[frame_count].data, packetbuf_dataptr(), packetbuf_datalen());
+    frames[frame_count].len = packetbuf_datalen();
+    frame_count++;
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_max_payload(void)
+{
+  return FRAME_PAYLOAD;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver test_mac_driver = {
+  "test-mac",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+static int
+frame_is_rfrag(int i)
+{
+  return (frames[i].data[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK) ==
+    SICSLOWPAN_DISPATCH_RFRAG;
+}
+/*---------------------------------------------------------------------------*/
+static int
+frame_is_ack(int i)
+{
+  return (frames[i].data[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK) ==
+    SICSLOWPAN_DISPATCH_RFRAG_ACK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+frame_seq(int i)
+{
+  return (frames[i].data[2] >> 2) & 0x1f;
+}
+/*---------------------------------------------------------------------------*/
+static int
+frame_ack_request(int i)
+{
+  return (frames[i].data[2] & 0x80) != 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+frame_bitmap(int i)
+{
+  return ((uint32_t)frames[i].data[2] << 24) | ((uint32_t)frames[i].data[3] << 16) |
+    ((uint32_t)frames[i].data[4] << 8) | frames[i].data[5];
+}
+/*---------------------------------------------------------------------------*/
+/* The bitmap of the first count fragments, count being less than 32 */
+static uint32_t
+window(int count)
+{
+  return (uint32_t)(0xffffffffUL << (32 - count));
+}
+/*---------------------------------------------------------------------------*/
+/* Send a UDP datagram to all nodes through 6LoWPAN, addressed to the
+   peer at the link layer. Returns the number of fragments. */
+static int
+send_datagram(uint16_t payload_len)
+{
+  int i;
+  uint8_t *payload;
+
+  uipbuf_clear();
+  memset(uip_buf, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xff02, 0, 0, 0, 0, 0, 0, 1);
+  UIP_UDP_BUF->srcport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(UDP_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + payload_len);
+  payload = uip_buf + UIP_IPUDPH_LEN;
+  for(i = 0; i < payload_len; i++) {
+    payload[i] = i * 7;
+  }
+  uip_len = UIP_IPUDPH_LEN + payload_len;
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+
+  frame_count = 0;
+  NETSTACK_NETWORK.output(&peer);
+  return frame_count;
+}
+/*---------------------------------------------------------------------------*/
+/* Pass a frame to 6LoWPAN as if it had been received from the peer */
+static void
+receive(const uint8_t *data, uint16_t len)
+{
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), data, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &peer);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  frame_count = 0;
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive_ack(uint8_t tag, uint32_t bitmap)
+{
+  uint8_t ack[SICSLOWPAN_RFRAG_ACK_HDR_LEN];
+
+  ack[0] = SICSLOWPAN_DISPATCH_RFRAG_ACK;
+  ack[1] = tag;
+  ack[2] = bitmap >> 24;
+  ack[3] = bitmap >> 16;
+  ack[4] = bitmap >> 8;
+  ack[5] = bitmap;
+  receive(ack, sizeof(ack));
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_rx_callback(struct simple_udp_connection *c,
+                const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+                const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+                const uint8_t *data, uint16_t datalen)
+{
+  received_len = MIN(datalen, sizeof(received));
+  memcpy(received, data, received_len);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_ack, "Selective retransmission");
+UNIT_TEST(test_ack)
+{
+  int i;
+  int count;
+  uint8_t tag;
+
+  UNIT_TEST_BEGIN();
+
+  count = send_datagram(150);
+  UNIT_TEST_ASSERT(count > 4 && count < 32);
+  for(i = 0; i < count; i++) {
+    UNIT_TEST_ASSERT(frame_is_rfrag(i));
+    UNIT_TEST_ASSERT(frame_seq(i) == i);
+    UNIT_TEST_ASSERT(frame_ack_request(i) == (i == count - 1));
+  }
+  tag = frames[0].data[1];
+
+  /* Only the fragments missing in the bitmap are sent again */
+  receive_ack(tag, window(count) & ~0x40000000UL & ~0x10000000UL);
+  UNIT_TEST_ASSERT(frame_count == 2);
+  UNIT_TEST_ASSERT(frame_seq(0) == 1 && !frame_ack_request(0));
+  UNIT_TEST_ASSERT(frame_seq(1) == 3 && frame_ack_request(1));
+
+  /* The acknowledgments accumulate until all fragments are delivered */
+  receive_ack(tag, 0x40000000UL);
+  UNIT_TEST_ASSERT(frame_count == 1 && frame_seq(0) == 3);
+  receive_ack(tag, 0x10000000UL);
+  UNIT_TEST_ASSERT(frame_count == 0);
+  /* The datagram is released */
+  receive_ack(tag, 0x80000000UL);
+  UNIT_TEST_ASSERT(frame_count == 0);
+
+  /* An empty bitmap aborts the datagram */
+  send_datagram(150);
+  tag = frames[0].data[1];
+  receive_ack(tag, 0);
+  UNIT_TEST_ASSERT(frame_count == 0);
+  receive_ack(tag, 0x80000000UL);
+  UNIT_TEST_ASSERT(frame_count == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_full_window, "Full window of 32 fragments");
+UNIT_TEST(test_full_window)
+{
+  int i;
+  uint8_t tag;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(send_datagram(1180) == 32);
+  UNIT_TEST_ASSERT(frame_seq(31) == 31 && frame_ack_request(31));
+  tag = frames[0].data[1];
+
+  /* Half of the window is acknowledged, the other half is resent */
+  receive_ack(tag, 0xffff0000UL);
+  UNIT_TEST_ASSERT(frame_count == 16);
+  for(i = 0; i < 16; i++) {
+    UNIT_TEST_ASSERT(frame_seq(i) == 16 + i);
+  }
+  receive_ack(tag, 0x0000ffffUL);
+  UNIT_TEST_ASSERT(frame_count == 0);
+  receive_ack(tag, 0x00000001UL);
+  UNIT_TEST_ASSERT(frame_count == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_reassembly, "Reassembly and acknowledgment");
+UNIT_TEST(test_reassembly)
+{
+  static struct frame sent[MAX_FRAMES];
+  int i;
+  int count;
+  uint8_t tag;
+
+  UNIT_TEST_BEGIN();
+
+  /* Send a datagram, keep its fragments, and complete it */
+  count = send_datagram(150);
+  UNIT_TEST_ASSERT(count > 4);
+  memcpy(sent, frames, sizeof(sent));
+  tag = sent[0].data[1];
+  receive_ack(tag, 0xffffffffUL);
+
+  /* Receive the fragments, except for the third one */
+  received_len = 0;
+  for(i = 0; i < count; i++) {
+    if(i != 2) {
+      receive(sent[i].data, sent[i].len);
+    }
+  }
+  /* The last fragment requests an acknowledgment */
+  UNIT_TEST_ASSERT(frame_count == 1 && frame_is_ack(0));
+  UNIT_TEST_ASSERT(frames[0].data[1] == tag);
+  UNIT_TEST_ASSERT(frame_bitmap(0) ==
+                   (window(count) & ~0x20000000UL));
+  UNIT_TEST_ASSERT(received_len == 0);
+
+  /* A duplicate fragment is acknowledged with the same bitmap */
+  sent[1].data[2] |= 0x80;
+  receive(sent[1].data, sent[1].len);
+  UNIT_TEST_ASSERT(frame_count == 1 && frame_is_ack(0));
+  UNIT_TEST_ASSERT(frame_bitmap(0) ==
+                   (window(count) & ~0x20000000UL));
+
+  /* The missing fragment completes the datagram */
+  receive(sent[2].data, sent[2].len);
+  UNIT_TEST_ASSERT(frame_count == 1 && frame_is_ack(0));
+  UNIT_TEST_ASSERT(frame_bitmap(0) == 0xffffffffUL);
+  UNIT_TEST_ASSERT(received_len == 150);
+  for(i = 0; i < 150; i++) {
+    UNIT_TEST_ASSERT(received[i] == (uint8_t)(i * 7));
+  }
+
+  /* A late fragment of the delivered datagram is acknowledged again */
+  receive(sent[count - 1].data, sent[count - 1].len);
+  UNIT_TEST_ASSERT(frame_count == 1 && frame_is_ack(0));
+  UNIT_TEST_ASSERT(frame_bitmap(0) == 0xffffffffUL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rfrag_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_rx_callback);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_ack);
+  UNIT_TEST_RUN(test_full_window);
+  UNIT_TEST_RUN(test_reassembly);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -345,6 +345,45 @@ UNIT_TEST(test_ringbufindex_empty)
   UNIT_TEST_END();
 }
 
+UNIT_TEST_REGISTER(test_ringbufindex_spsc, "SPSC");
+UNIT_TEST(test_ringbufindex_spsc)
+{
+  static uint16_t elements[8];
+  uint16_t produced = 0;
+  uint16_t consumed = 0;
+  int index;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  ringbufindex_init(&ri, 8);
+
+  /* Interleave a producer and a consumer over many wrap-arounds, the
+   * producer writing through peek_put/put and the consumer reading
+   * through peek_get/get, and check the elements come out in order */
+  for(i = 0; i < 1000; i++) {
+    while((i % 3) != 0 && (index = ringbufindex_peek_put(&ri)) != -1) {
+      elements[index] = produced++;
+      UNIT_TEST_ASSERT(ringbufindex_put(&ri) == 1);
+      if((produced % 5) == 0) {
+        break;
+      }
+    }
+    while((index = ringbufindex_peek_get(&ri)) != -1) {
+      UNIT_TEST_ASSERT(elements[index] == consumed);
+      consumed++;
+      UNIT_TEST_ASSERT(ringbufindex_get(&ri) == index);
+      if((consumed % 3) == 0) {
+        break;
+      }
+    }
+    UNIT_TEST_ASSERT(ringbufindex_elements(&ri) == produced - consumed);
+  }
+  UNIT_TEST_ASSERT(produced > 500 && consumed + ringbufindex_elements(&ri) == produced);
+
+  UNIT_TEST_END();
+}
+
 PROCESS_THREAD(test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -360,6 +399,7 @@ PROCESS_THREAD(test_process, ev, data)
   UNIT_TEST_RUN(test_ringbufindex_elements);
   UNIT_TEST_RUN(test_ringbufindex_full);
   UNIT_TEST_RUN(test_ringbufindex_empty);
+  UNIT_TEST_RUN(test_ringbufindex_spsc);
 
   printf("=check-me= DONE\n");
   PROCESS_END();
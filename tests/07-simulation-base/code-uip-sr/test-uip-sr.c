@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2026, COMSYS, RWTH Aachen University.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-sr.h"
+#include "net/routing/routing.h"
+#include "services/unit-test/unit-test.h"
+
+#include <string.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+PROCESS(uip_sr_test_process, "Source routing test process");
+AUTOSTART_PROCESSES(&uip_sr_test_process);
+/*---------------------------------------------------------------------------*/
+#define ROOT_ID         1
+#define LIFETIME        100
+
+static int graph;
+/*---------------------------------------------------------------------------*/
+void
+print_test_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* fd00::200:0:0:<id> */
+static void
+set_addr(uip_ipaddr_t *addr, uint8_t id)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0200, 0, 0, id);
+}
+/*---------------------------------------------------------------------------*/
+/* A routing driver that only provides addresses to the source routing
+ * graph: all nodes share the prefix fd00::/64, the root is ROOT_ID */
+static void
+init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+root_set_prefix(uip_ipaddr_t *prefix, uip_ipaddr_t *iid)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+root_start(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+node_is_root(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_root_ipaddr(uip_ipaddr_t *ipaddr)
+{
+  set_addr(ipaddr, ROOT_ID);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+get_sr_node_ipaddr(uip_ipaddr_t *addr, const uip_sr_node_t *node)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0);
+  memcpy(&addr->u8[8], node->link_identifier, 8);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+leave_network(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+node_has_joined(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+node_is_reachable(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+global_repair(const char *str)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+local_repair(const char *str)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+ext_header_remove(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+ext_header_update(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+ext_header_srh_update(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+ext_header_srh_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_callback(const linkaddr_t *addr, int status, int numtx)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_state_changed(uip_ds6_nbr_t *nbr)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+drop_route(uip_ds6_route_t *route)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct routing_driver test_routing_driver = {
+  "test-routing",
+  init,
+  root_set_prefix,
+  root_start,
+  node_is_root,
+  get_root_ipaddr,
+  get_sr_node_ipaddr,
+  leave_network,
+  node_has_joined,
+  node_is_reachable,
+  global_repair,
+  local_repair,
+  ext_header_remove,
+  ext_header_update,
+  ext_header_hbh_update,
+  ext_header_srh_update,
+  ext_header_srh_get_next_hop,
+  link_callback,
+  neighbor_state_changed,
+  drop_route,
+};
+/*---------------------------------------------------------------------------*/
+static uip_sr_node_t *
+update(uint8_t id, uint8_t parent_id, uint32_t lifetime)
+{
+  uip_ipaddr_t child;
+  uip_ipaddr_t parent;
+  set_addr(&child, id);
+  set_addr(&parent, parent_id);
+  return uip_sr_update_node(&graph, &child, &parent, lifetime);
+}
+/*---------------------------------------------------------------------------*/
+static uip_sr_node_t *
+get_node(uint8_t id)
+{
+  uip_ipaddr_t addr;
+  set_addr(&addr, id);
+  return uip_sr_get_node(&graph, &addr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+has_node(uint8_t id)
+{
+  uip_sr_node_t *node = get_node(id);
+  return node != NULL && node->link_identifier[7] == id;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_node_index, "Node index lookups and removals");
+UNIT_TEST(test_node_index)
+{
+  /* The link identifiers differ in their last byte only, so ids 33 apart
+   * share a home slot of the 33-slot index: 2, 35, 68, ... form a long
+   * probe sequence, which the ids 3 to 10 interleave with */
+  static const uint8_t ids[] = { 2, 35, 68, 101, 134, 167, 200,
+                                 3, 4, 5, 6, 7, 8, 9, 10 };
+  static const uint8_t removed[] = { 35, 101, 4, 200 };
+  int i;
+  int j;
+
+  UNIT_TEST_BEGIN();
+
+  uip_sr_init();
+  for(i = 0; i < sizeof(ids); i++) {
+    UNIT_TEST_ASSERT(update(ids[i], ROOT_ID, LIFETIME) != NULL);
+  }
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == sizeof(ids) + 1);
+  UNIT_TEST_ASSERT(has_node(ROOT_ID));
+  for(i = 0; i < sizeof(ids); i++) {
+    UNIT_TEST_ASSERT(has_node(ids[i]));
+  }
+  UNIT_TEST_ASSERT(get_node(36) == NULL);
+  UNIT_TEST_ASSERT(get_node(11) == NULL);
+
+  /* The pool is full */
+  UNIT_TEST_ASSERT(update(11, ROOT_ID, LIFETIME) == NULL);
+
+  /* Expire nodes from the middle and the end of the probe sequences */
+  for(i = 0; i < sizeof(removed); i++) {
+    UNIT_TEST_ASSERT(update(removed[i], ROOT_ID, 0) != NULL);
+  }
+  uip_sr_periodic(1);
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == sizeof(ids) + 1 - sizeof(removed));
+  for(i = 0; i < sizeof(ids); i++) {
+    int is_removed = 0;
+    for(j = 0; j < sizeof(removed); j++) {
+      is_removed |= ids[i] == removed[j];
+    }
+    UNIT_TEST_ASSERT(has_node(ids[i]) == !is_removed);
+  }
+
+  /* Freed entries are reused */
+  UNIT_TEST_ASSERT(update(101, ROOT_ID, LIFETIME) != NULL);
+  UNIT_TEST_ASSERT(update(11, ROOT_ID, LIFETIME) != NULL);
+  UNIT_TEST_ASSERT(has_node(101) && has_node(11) && has_node(134));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_route_cache, "Route cache");
+UNIT_TEST(test_route_cache)
+{
+  uip_sr_route_t route;
+  uip_sr_route_t cached;
+  uint8_t buf[16];
+
+  UNIT_TEST_BEGIN();
+
+  uip_sr_init();
+  /* root <- 2 <- 3 <- 4 */
+  update(2, ROOT_ID, LIFETIME);
+  update(3, 2, LIFETIME);
+  update(4, 3, LIFETIME);
+
+  /* The first hop is the IPv6 destination, the list holds 3 and 4 with
+   * all but the last byte elided */
+  UNIT_TEST_ASSERT(uip_sr_get_route(get_node(4), get_node(ROOT_ID), &route));
+  UNIT_TEST_ASSERT(route.node == get_node(4) && route.first_hop == get_node(2));
+  UNIT_TEST_ASSERT(route.path_len == 2 && route.cmpr == 15 && route.len == 2);
+  UNIT_TEST_ASSERT(route.addrs != NULL);
+  uip_sr_write_route(&route, buf);
+  UNIT_TEST_ASSERT(buf[0] == 3 && buf[1] == 4);
+
+  /* Served from the cache as long as the topology does not change */
+  UNIT_TEST_ASSERT(uip_sr_get_route(get_node(4), get_node(ROOT_ID), &cached));
+  UNIT_TEST_ASSERT(cached.addrs == route.addrs && cached.len == route.len);
+
+  /* A new parent invalidates the cached route */
+  update(4, 2, LIFETIME);
+  UNIT_TEST_ASSERT(uip_sr_get_route(get_node(4), get_node(ROOT_ID), &route));
+  UNIT_TEST_ASSERT(route.first_hop == get_node(2) && route.path_len == 1);
+  uip_sr_write_route(&route, buf);
+  UNIT_TEST_ASSERT(route.len == 1 && buf[0] == 4);
+
+  /* A node whose parent is unknown has no route */
+  update(5, 6, LIFETIME);
+  UNIT_TEST_ASSERT(!uip_sr_get_route(get_node(5), get_node(ROOT_ID), &route));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_route_cache_wrap, "Route cache across a generation wrap");
+UNIT_TEST(test_route_cache_wrap)
+{
+  uip_sr_route_t route;
+  uint32_t i;
+
+  UNIT_TEST_BEGIN();
+
+  uip_sr_init();
+  /* root <- 2 <- 3, and 4 */
+  update(2, ROOT_ID, LIFETIME);
+  update(3, 2, LIFETIME);
+  update(4, ROOT_ID, LIFETIME);
+  UNIT_TEST_ASSERT(uip_sr_get_route(get_node(3), get_node(ROOT_ID), &route));
+  UNIT_TEST_ASSERT(route.path_len == 1);
+
+  /* 65535 parent changes of another node, and one of node 3: exactly
+   * 65536 topology changes since the route to 3 was cached */
+  for(i = 0; i < 65535; i++) {
+    update(4, (i & 1) ? ROOT_ID : 2, LIFETIME);
+  }
+  update(3, ROOT_ID, LIFETIME);
+
+  UNIT_TEST_ASSERT(uip_sr_get_route(get_node(3), get_node(ROOT_ID), &route));
+  UNIT_TEST_ASSERT(route.first_hop == get_node(3) && route.path_len == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(uip_sr_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_node_index);
+  UNIT_TEST_RUN(test_route_cache);
+  UNIT_TEST_RUN(test_route_cache_wrap);
+
+  printf("=check-me= DONE\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
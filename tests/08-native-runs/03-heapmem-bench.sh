@@ -0,0 +1,38 @@
+#!/bin/bash
+source ../utils.sh
+
+# Contiki directory
+CONTIKI=$1
+
+# Example code directory
+CODE_DIR=$CONTIKI/examples/benchmarks/heapmem/
+CODE=heapmem-bench
+
+# Replay the built-in traces with both allocator modes
+for SEGREGATED in 0 1 ; do
+  echo "Running $CODE with SEGREGATED=$SEGREGATED"
+  make -C $CODE_DIR TARGET=native clean > /dev/null 2>&1
+  make -C $CODE_DIR TARGET=native SEGREGATED=$SEGREGATED >> make.log 2>> make.err
+  timeout 60 $CODE_DIR/$CODE.native >> $CODE.log 2>> $CODE.err
+done
+
+if grep -q "=check-me= FAILED" $CODE.log || [ $(grep -c "=check-me= DONE" $CODE.log) -ne 2 ] ; then
+  echo "==== make.log ====" ; cat make.log;
+  echo "==== make.err ====" ; cat make.err;
+  echo "==== $CODE.log ====" ; cat $CODE.log;
+  echo "==== $CODE.err ====" ; cat $CODE.err;
+
+  printf "%-32s TEST FAIL\n" "$CODE" | tee $CODE.testlog;
+else
+  cp $CODE.log $CODE.testlog
+  printf "%-32s TEST OK\n" "$CODE" | tee $CODE.testlog;
+fi
+
+rm make.log
+rm make.err
+rm $CODE.log
+rm $CODE.err
+
+# We do not want Make to stop -> Return 0
+# The Makefile will check if a log contains FAIL at the end
+exit 0
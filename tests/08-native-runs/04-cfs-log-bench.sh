@@ -0,0 +1,38 @@
+#!/bin/bash
+source ../utils.sh
+
+# Contiki directory
+CONTIKI=$1
+
+# Example code directory
+CODE_DIR=$CONTIKI/examples/benchmarks/cfs-log/
+CODE=cfs-log-bench
+
+# Run with the default Coffee options and with the RAM index and background GC
+for OPTIONS in "" "COFFEE_CONF_RAM_INDEX=1,COFFEE_CONF_BACKGROUND_GC=1" ; do
+  echo "Running $CODE with DEFINES=$OPTIONS"
+  make -C $CODE_DIR TARGET=native clean > /dev/null 2>&1
+  make -C $CODE_DIR TARGET=native DEFINES=$OPTIONS >> make.log 2>> make.err
+  timeout 60 $CODE_DIR/$CODE.native >> $CODE.log 2>> $CODE.err
+done
+
+if grep -q "=check-me= FAILED" $CODE.log || [ $(grep -c "=check-me= DONE" $CODE.log) -ne 2 ] ; then
+  echo "==== make.log ====" ; cat make.log;
+  echo "==== make.err ====" ; cat make.err;
+  echo "==== $CODE.log ====" ; cat $CODE.log;
+  echo "==== $CODE.err ====" ; cat $CODE.err;
+
+  printf "%-32s TEST FAIL\n" "$CODE" | tee $CODE.testlog;
+else
+  cp $CODE.log $CODE.testlog
+  printf "%-32s TEST OK\n" "$CODE" | tee $CODE.testlog;
+fi
+
+rm make.log
+rm make.err
+rm $CODE.log
+rm $CODE.err
+
+# We do not want Make to stop -> Return 0
+# The Makefile will check if a log contains FAIL at the end
+exit 0
@@ -0,0 +1,39 @@
+#!/bin/bash
+source ../utils.sh
+
+# Contiki directory
+CONTIKI=$1
+
+# Example code directory
+CODE_DIR=$CONTIKI/examples/benchmarks/antelope/
+CODE=antelope-bench
+
+# Run the queries with interpreted and with compiled predicates, with
+# a B+-tree index on the sample IDs, and with nested-loop joins only
+for VARIANT in "COMPILER=0" "COMPILER=1" "BTREE=1" "DEFINES=DB_JOIN_HASH_LIMIT=0" ; do
+  echo "Running $CODE with $VARIANT"
+  make -C $CODE_DIR TARGET=native clean > /dev/null 2>&1
+  make -C $CODE_DIR TARGET=native $VARIANT >> make.log 2>> make.err
+  timeout 60 $CODE_DIR/$CODE.native >> $CODE.log 2>> $CODE.err
+done
+
+if grep -q "=check-me= FAILED" $CODE.log || [ $(grep -c "=check-me= DONE" $CODE.log) -ne 4 ] ; then
+  echo "==== make.log ====" ; cat make.log;
+  echo "==== make.err ====" ; cat make.err;
+  echo "==== $CODE.log ====" ; cat $CODE.log;
+  echo "==== $CODE.err ====" ; cat $CODE.err;
+
+  printf "%-32s TEST FAIL\n" "$CODE" | tee $CODE.testlog;
+else
+  cp $CODE.log $CODE.testlog
+  printf "%-32s TEST OK\n" "$CODE" | tee $CODE.testlog;
+fi
+
+rm make.log
+rm make.err
+rm $CODE.log
+rm $CODE.err
+
+# We do not want Make to stop -> Return 0
+# The Makefile will check if a log contains FAIL at the end
+exit 0